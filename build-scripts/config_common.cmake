@@ -80,6 +80,11 @@ endif ()
 if (WAMR_BUILD_JIT EQUAL 1)
   if (WAMR_BUILD_AOT EQUAL 1)
     add_definitions("-DWASM_ENABLE_JIT=1")
+    if (NOT WAMR_BUILD_LAZY_JIT EQUAL 0)
+      # Enable lazy JIT by default
+      set (WAMR_BUILD_LAZY_JIT 1)
+      add_definitions("-DWASM_ENABLE_LAZY_JIT=1")
+    endif ()
     if (NOT DEFINED LLVM_DIR)
       set (LLVM_SRC_ROOT "${WAMR_ROOT_DIR}/core/deps/llvm")
       set (LLVM_BUILD_ROOT "${LLVM_SRC_ROOT}/build")
@@ -118,7 +123,11 @@ else ()
   message ("     WAMR AOT disabled")
 endif ()
 if (WAMR_BUILD_JIT EQUAL 1)
-  message ("     WAMR JIT enabled")
+  if (WAMR_BUILD_LAZY_JIT EQUAL 1)
+    message ("     WAMR LLVM ORC lazy JIT enabled")
+  else ()
+    message ("     WAMR LLVM MCJIT enabled")
+  endif ()
 else ()
   message ("     WAMR JIT disabled")
 endif ()
@@ -141,6 +150,15 @@ else ()
   add_definitions (-DWASM_ENABLE_FAST_INTERP=0)
   message ("     Fast interpreter disabled")
 endif ()
+if (WAMR_BUILD_BASELINE_JIT EQUAL 1)
+  if (NOT (WAMR_BUILD_TARGET STREQUAL "X86_64" OR WAMR_BUILD_TARGET STREQUAL "AMD_64"))
+    message (FATAL_ERROR "-- Baseline JIT is only supported on X86_64 target")
+  elseif (NOT WAMR_BUILD_FAST_INTERP EQUAL 1)
+    message (FATAL_ERROR "-- Baseline JIT requires the fast interpreter")
+  endif ()
+  add_definitions (-DWASM_ENABLE_BASELINE_JIT=1)
+  message ("     Baseline JIT enabled")
+endif ()
 if (WAMR_BUILD_MULTI_MODULE EQUAL 1)
   add_definitions (-DWASM_ENABLE_MULTI_MODULE=1)
   message ("     Multiple modules enabled")
@@ -218,6 +236,78 @@ if (WAMR_BUILD_REF_TYPES EQUAL 1)
 else ()
   message ("     Reference types disabled")
 endif ()
+if (WAMR_BUILD_EXEC_ENV_CACHE EQUAL 1)
+  add_definitions (-DWASM_ENABLE_EXEC_ENV_CACHE=1)
+  message ("     Exec env cache enabled")
+endif ()
+if (WAMR_BUILD_INSTANCE_POOL EQUAL 1)
+  add_definitions (-DWASM_ENABLE_INSTANCE_POOL=1)
+  message ("     Instance pool enabled")
+endif ()
+if (WAMR_BUILD_MEMORY64 EQUAL 1)
+  if (NOT (WAMR_BUILD_TARGET STREQUAL "X86_64" OR WAMR_BUILD_TARGET STREQUAL "AMD_64" OR WAMR_BUILD_TARGET MATCHES "AARCH64.*" OR WAMR_BUILD_TARGET MATCHES "RISCV64.*"))
+    message (FATAL_ERROR "-- Memory64 is only supported on 64-bit targets")
+  endif ()
+  add_definitions (-DWASM_ENABLE_MEMORY64=1)
+  message ("     Memory64 enabled")
+endif ()
+if (WAMR_BUILD_STATIC_PGO EQUAL 1)
+  add_definitions (-DWASM_ENABLE_STATIC_PGO=1)
+  message ("     AOT static PGO enabled")
+endif ()
+if (WAMR_BUILD_LINUX_PERF EQUAL 1)
+  if (NOT WAMR_BUILD_PLATFORM STREQUAL "linux")
+    message (FATAL_ERROR "-- Linux perf support is only available on Linux")
+  endif ()
+  add_definitions (-DWASM_ENABLE_LINUX_PERF=1)
+  message ("     Linux perf map and jitdump enabled")
+endif ()
+if (WAMR_BUILD_SAMPLING_PROFILER EQUAL 1)
+  if (NOT WAMR_BUILD_PLATFORM STREQUAL "linux")
+    message (FATAL_ERROR "-- Sampling profiler is only available on Linux")
+  endif ()
+  add_definitions (-DWASM_ENABLE_SAMPLING_PROFILER=1)
+  message ("     Sampling profiler enabled")
+endif ()
+if (WAMR_BUILD_STARTUP_TIMING EQUAL 1)
+  add_definitions (-DWASM_ENABLE_STARTUP_TIMING=1)
+  message ("     Startup timing enabled")
+endif ()
+if (WAMR_BUILD_OPCODE_COUNTER EQUAL 1)
+  if (WAMR_BUILD_FAST_INTERP EQUAL 1)
+    add_definitions (-DWASM_ENABLE_OPCODE_COUNTER=1)
+    message ("     Opcode counter enabled")
+  else ()
+    message ("     Opcode counter disabled due to fast interpreter disabled")
+  endif ()
+endif ()
+if (WAMR_BUILD_METRICS EQUAL 1)
+  add_definitions (-DWASM_ENABLE_METRICS=1)
+  message ("     Runtime metrics enabled")
+endif ()
+if (WAMR_BUILD_USDT EQUAL 1)
+  if (NOT WAMR_BUILD_PLATFORM STREQUAL "linux")
+    message (FATAL_ERROR "-- USDT tracepoints are only available on Linux")
+  endif ()
+  include (CheckIncludeFile)
+  check_include_file (sys/sdt.h WAMR_HAVE_SYS_SDT_H)
+  if (NOT WAMR_HAVE_SYS_SDT_H)
+    message (FATAL_ERROR "-- USDT tracepoints require sys/sdt.h, please install systemtap-sdt-dev or systemtap-sdt-devel")
+  endif ()
+  add_definitions (-DWASM_ENABLE_USDT=1)
+  message ("     USDT tracepoints enabled")
+endif ()
+if (WAMR_BUILD_NATIVE_CALL_STATS EQUAL 1)
+  add_definitions (-DWASM_ENABLE_NATIVE_CALL_STATS=1)
+  message ("     Native call stats enabled")
+endif ()
+if (WAMR_BUILD_ASYNC_LOG EQUAL 1)
+  if (MSVC)
+    message (FATAL_ERROR "-- Async log requires the atomic builtins of GCC or Clang")
+  endif ()
+  add_definitions (-DWASM_ENABLE_ASYNC_LOG=1)
+  message ("     Async log enabled")
+endif ()
 if (DEFINED WAMR_BH_VPRINTF)
   add_definitions (-DBH_VPRINTF=${WAMR_BH_VPRINTF})
 endif ()
@@ -10,6 +10,7 @@
 #include "event.h"
 #include "watchdog.h"
 #include "coap_ext.h"
+#include "wasm_usdt.h"
 
 /* Queue of app manager */
 static bh_queue *g_app_mgr_queue;
@@ -247,6 +248,8 @@ static void app_manager_queue_callback(void *message, void *arg)
 
     (void)arg;
 
+    USDT_PROBE2(app_request, request->url, request->action);
+
     if ((offset = check_url_start(request->url, strlen(request->url), "/applet"))
             > 0) {
         module_type = get_module_type(request->url + offset);
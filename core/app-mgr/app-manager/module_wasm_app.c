@@ -14,6 +14,7 @@
 #include "watchdog.h"
 #include "runtime_lib.h"
 #include "wasm.h"
+#include "wasm_usdt.h"
 #if WASM_ENABLE_AOT != 0
 #include "aot_export.h"
 #endif
@@ -189,7 +190,7 @@ app_manager_lookup_function(const wasm_module_inst_t module_inst,
 
 
 static void
-app_instance_queue_callback(void *queue_msg, void *arg)
+handle_app_instance_message(void *queue_msg, void *arg)
 {
     uint32 argv[2];
     wasm_function_inst_t func_onRequest, func_onTimer;
@@ -368,6 +369,15 @@ app_instance_queue_callback(void *queue_msg, void *arg)
     }
 }
 
+static void
+app_instance_queue_callback(void *queue_msg, void *arg)
+{
+    /* arg is the module instance of the app */
+    USDT_PROBE2(app_msg_begin, arg, bh_message_type(queue_msg));
+    handle_app_instance_message(queue_msg, arg);
+    USDT_PROBE2(app_msg_end, arg, bh_message_type(queue_msg));
+}
+
 #if WASM_ENABLE_LIBC_WASI != 0
 static bool
 wasm_app_prepare_wasi_dir(wasm_module_t module, const char *module_name,
@@ -66,7 +66,7 @@
 #endif
 
 #define AOT_MAGIC_NUMBER 0x746f6100
-#define AOT_CURRENT_VERSION 3
+#define AOT_CURRENT_VERSION 4
 
 #ifndef WASM_ENABLE_JIT
 #define WASM_ENABLE_JIT 0
@@ -78,6 +78,23 @@
 #define WASM_ENABLE_JIT 0
 #endif
 
+/* Compile the functions lazily on their first calls with LLVM ORC
+   instead of compiling the whole module with MCJIT when loading */
+#ifndef WASM_ENABLE_LAZY_JIT
+#define WASM_ENABLE_LAZY_JIT 0
+#endif
+
+#if (WASM_ENABLE_JIT == 0) && (WASM_ENABLE_LAZY_JIT != 0)
+#undef WASM_ENABLE_LAZY_JIT
+#define WASM_ENABLE_LAZY_JIT 0
+#endif
+
+/* Number of the threads to compile the functions in lazy JIT mode,
+   0 means compiling in the thread calling the function */
+#ifndef WASM_LAZY_JIT_COMPILE_THREAD_NUM
+#define WASM_LAZY_JIT_COMPILE_THREAD_NUM 4
+#endif
+
 #ifndef WASM_ENABLE_WAMR_COMPILER
 #define WASM_ENABLE_WAMR_COMPILER 0
 #endif
@@ -158,11 +175,30 @@
 #define WASM_DEBUG_PREPROCESSOR 0
 #endif
 
-/* Enable opcode counter or not */
+/* Compile the pre-compiled code of the fast interpreter into machine
+   code with the single-pass baseline JIT, x86-64 only */
+#ifndef WASM_ENABLE_BASELINE_JIT
+#define WASM_ENABLE_BASELINE_JIT 0
+#endif
+
+#if (WASM_ENABLE_FAST_INTERP == 0) \
+    || (!defined(BUILD_TARGET_X86_64) && !defined(BUILD_TARGET_AMD_64))
+#undef WASM_ENABLE_BASELINE_JIT
+#define WASM_ENABLE_BASELINE_JIT 0
+#endif
+
+/* Enable opcode counter or not, it also counts the calls and the
+   instructions of each function and the entries of each block */
 #ifndef WASM_ENABLE_OPCODE_COUNTER
 #define WASM_ENABLE_OPCODE_COUNTER 0
 #endif
 
+/* The counters are only supported by the fast interpreter */
+#if WASM_ENABLE_FAST_INTERP == 0
+#undef WASM_ENABLE_OPCODE_COUNTER
+#define WASM_ENABLE_OPCODE_COUNTER 0
+#endif
+
 /* Support a module with dependency, other modules */
 #ifndef WASM_ENABLE_MULTI_MODULE
 #define WASM_ENABLE_MULTI_MODULE 0
@@ -247,6 +283,19 @@
 #else
 #define DEFAULT_WASM_STACK_SIZE (12 * 1024)
 #endif
+/* The exec env whose wasm stack size is not less than the threshold is
+   allocated with os_mmap on the platforms with demand paging, so that the
+   stack pages don't cost RSS until they are used, 0 to disable it */
+#ifndef WASM_STACK_MMAP_THRESHOLD
+#define WASM_STACK_MMAP_THRESHOLD (64 * 1024)
+#endif
+
+/* The initial accessible size of the wasm stack allocated with os_mmap,
+   the stack grows on demand until the wasm stack size is reached */
+#ifndef WASM_STACK_INIT_COMMIT_SIZE
+#define WASM_STACK_INIT_COMMIT_SIZE (8 * 1024)
+#endif
+
 /* Min auxilliary stack size of each wasm thread */
 #define WASM_THREAD_AUX_STACK_SIZE_MIN (256)
 
@@ -296,5 +345,107 @@
 #define WASM_ENABLE_REF_TYPES 0
 #endif
 
+/* Thread-local exec env cache, the exec env destroyed by
+   wasm_runtime_destroy_exec_env is kept for the next creation */
+#ifndef WASM_ENABLE_EXEC_ENV_CACHE
+#define WASM_ENABLE_EXEC_ENV_CACHE 0
+#endif
+
+/* Max count of the exec envs cached by each thread */
+#ifndef WASM_EXEC_ENV_CACHE_SIZE
+#define WASM_EXEC_ENV_CACHE_SIZE 4
+#endif
+
+/* Instance pool, pre-instantiate module instances and
+   reset them when they are released back to the pool */
+#ifndef WASM_ENABLE_INSTANCE_POOL
+#define WASM_ENABLE_INSTANCE_POOL 0
+#endif
+
+/* Memory64 proposal, only supported on 64-bit targets */
+#ifndef WASM_ENABLE_MEMORY64
+#define WASM_ENABLE_MEMORY64 0
+#endif
+
+/* Max page count of a memory64 linear memory in interpreter mode,
+   16 GB by default, the space is reserved with os_mmap when the
+   memory is instantiated and committed when it is enlarged */
+#ifndef WASM_MEMORY64_MAX_PAGES
+#define WASM_MEMORY64_MAX_PAGES 262144
+#endif
+
+/* Collect the profile data of the AOT modules compiled with
+   wamrc --enable-pgo-instrument */
+#ifndef WASM_ENABLE_STATIC_PGO
+#define WASM_ENABLE_STATIC_PGO 0
+#endif
+
+/* Emit the native code of the wasm functions into the perf map and
+   the jitdump file of the Linux perf tool, only supported on Linux */
+#ifndef WASM_ENABLE_LINUX_PERF
+#define WASM_ENABLE_LINUX_PERF 0
+#endif
+
+/* Sample the wasm call stacks of the running threads with SIGPROF and
+   aggregate them into a folded stack profile, only supported on Linux */
+#ifndef WASM_ENABLE_SAMPLING_PROFILER
+#define WASM_ENABLE_SAMPLING_PROFILER 0
+#endif
+
+/* Default sampling frequency of the sampling profiler, in Hz */
+#ifndef WASM_SAMPLING_PROFILER_DEFAULT_FREQUENCY
+#define WASM_SAMPLING_PROFILER_DEFAULT_FREQUENCY 999
+#endif
+
+/* Max count of the wasm frames recorded in a sample */
+#ifndef WASM_SAMPLING_PROFILER_MAX_DEPTH
+#define WASM_SAMPLING_PROFILER_MAX_DEPTH 64
+#endif
+
+/* Count of the samples buffered before they are aggregated */
+#ifndef WASM_SAMPLING_PROFILER_SLOT_COUNT
+#define WASM_SAMPLING_PROFILER_SLOT_COUNT 1024
+#endif
+
+/* Time the phases of loading and instantiating the modules */
+#ifndef WASM_ENABLE_STARTUP_TIMING
+#define WASM_ENABLE_STARTUP_TIMING 0
+#endif
+
+/* Keep the runtime metrics, e.g. the instances alive, the memory usage,
+   the host calls and the traps, which can be read as a snapshot */
+#ifndef WASM_ENABLE_METRICS
+#define WASM_ENABLE_METRICS 0
+#endif
+
+/* Add the static tracepoints (USDT) of the runtime events, which need
+   sys/sdt.h of SystemTap and can be attached by bpftrace or perf */
+#ifndef WASM_ENABLE_USDT
+#define WASM_ENABLE_USDT 0
+#endif
+
+/* Count the calls and the latency of each registered native symbol
+   called by the wasm functions */
+#ifndef WASM_ENABLE_NATIVE_CALL_STATS
+#define WASM_ENABLE_NATIVE_CALL_STATS 0
+#endif
+
+/* Queue the logs into a bounded ring and print them in a background
+   thread, so that logging doesn't block the threads on stdio */
+#ifndef WASM_ENABLE_ASYNC_LOG
+#define WASM_ENABLE_ASYNC_LOG 0
+#endif
+
+/* Count of the slots of the async log ring, must be a power of 2 */
+#ifndef WASM_ASYNC_LOG_SLOT_COUNT
+#define WASM_ASYNC_LOG_SLOT_COUNT 256
+#endif
+
+/* Max length of the message of an async log, including the null
+   character, the longer ones are truncated */
+#ifndef WASM_ASYNC_LOG_MSG_SIZE
+#define WASM_ASYNC_LOG_MSG_SIZE 256
+#endif
+
 #endif /* end of _CONFIG_H_ */
 
@@ -9,12 +9,23 @@
 #include "aot_reloc.h"
 #include "../common/wasm_runtime_common.h"
 #include "../common/wasm_native.h"
+#include "../common/wasm_startup_timing.h"
 #include "../compilation/aot.h"
+#if WASM_ENABLE_LINUX_PERF != 0
+#include "../common/wasm_linux_perf.h"
+#endif
 #if WASM_ENABLE_JIT != 0
 #include "../compilation/aot_llvm.h"
 #include "../interpreter/wasm_loader.h"
 #endif
 
+#if (defined(BUILD_TARGET_X86_64) || defined(BUILD_TARGET_AMD_64) \
+     || defined(BUILD_TARGET_X86_32))                                \
+    && defined(__GNUC__)
+#include <cpuid.h>
+#define AOT_CPUID_SUPPORTED 1
+#endif
+
 #define XMM_PLT_PREFIX "__xmm@"
 #define REAL_PLT_PREFIX "__real@"
 
@@ -310,7 +321,7 @@ load_target_info_section(const uint8 *buf, const uint8 *buf_end,
     read_uint16(p, p_end, target_info.e_machine);
     read_uint32(p, p_end, target_info.e_version);
     read_uint32(p, p_end, target_info.e_flags);
-    read_uint32(p, p_end, target_info.reserved);
+    read_uint32(p, p_end, target_info.feature_flags);
     read_byte_array(p, p_end,
                     target_info.arch, sizeof(target_info.arch));
 
@@ -359,6 +370,7 @@ load_target_info_section(const uint8 *buf, const uint8 *buf_end,
         return false;
     }
 
+    module->feature_flags = target_info.feature_flags;
     return true;
 fail:
     return false;
@@ -463,6 +475,13 @@ load_memory_info(const uint8 **p_buf, const uint8 *buf_end,
         read_uint32(buf, buf_end, module->memories[i].num_bytes_per_page);
         read_uint32(buf, buf_end, module->memories[i].mem_init_page_count);
         read_uint32(buf, buf_end, module->memories[i].mem_max_page_count);
+#if WASM_ENABLE_MEMORY64 == 0
+        if (module->memories[i].memory_flags & MEMORY64_FLAG) {
+            set_error_buf(error_buf, error_buf_size,
+                          "memory64 isn't enabled");
+            return false;
+        }
+#endif
     }
 
     read_uint32(buf, buf_end, module->mem_init_data_count);
@@ -963,6 +982,10 @@ load_import_funcs(const uint8 **p_buf, const uint8 *buf_end,
                                                &import_funcs[i].signature,
                                                &import_funcs[i].attachment,
                                                &import_funcs[i].call_conv_raw);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        import_funcs[i].call_stats = import_funcs[i].func_ptr_linked
+            ? wasm_native_lookup_call_stats(module_name, field_name) : NULL;
+#endif
 
 #if WASM_ENABLE_LIBC_WASI != 0
         if (!strcmp(import_funcs[i].module_name, "wasi_unstable")
@@ -1968,6 +1991,92 @@ fail:
     return ret;
 }
 
+#ifdef AOT_FUNC_CODE_RANGES_ENABLED
+static int
+func_code_range_cmp(const void *a, const void *b)
+{
+    const uint8 *code_a = ((const AOTFuncCodeRange *)a)->code;
+    const uint8 *code_b = ((const AOTFuncCodeRange *)b)->code;
+
+    return code_a < code_b ? -1 : (code_a > code_b ? 1 : 0);
+}
+
+/* Sort the functions by the code address, so that the function of a
+   native code address is binary searched */
+static bool
+create_func_code_ranges(AOTModule *module,
+                        char *error_buf, uint32 error_buf_size)
+{
+    AOTFuncCodeRange *ranges;
+    uint64 size = sizeof(AOTFuncCodeRange) * (uint64)module->func_count;
+    uint32 i;
+
+    if (size == 0)
+        return true;
+
+    if (!(ranges = loader_malloc(size, error_buf, error_buf_size)))
+        return false;
+
+    for (i = 0; i < module->func_count; i++) {
+        /* clear bits[0] of thumb function address */
+        ranges[i].code = (uint8*)((uintptr_t)module->func_ptrs[i]
+                                  & ~(uintptr_t)1);
+        ranges[i].func_index = i;
+    }
+    qsort(ranges, module->func_count, sizeof(AOTFuncCodeRange),
+          func_code_range_cmp);
+
+    module->func_code_ranges = ranges;
+    return true;
+}
+#endif /* end of AOT_FUNC_CODE_RANGES_ENABLED */
+
+#if WASM_ENABLE_LINUX_PERF != 0
+/* Emit the native code of the functions for the Linux perf tool, the
+   AOT file has no function size, so the code of a function is taken
+   to end at the start of the next function */
+static void
+emit_linux_perf_funcs(AOTModule *module)
+{
+    AOTFuncCodeRange *ranges = module->func_code_ranges;
+    AOTExport *exports = module->exports;
+    uint8 *code_end;
+    uint32 i, j, func_index;
+    const char *name;
+    char buf[32];
+
+    if (!wasm_linux_perf_enabled() || !ranges)
+        return;
+
+    for (i = 0; i < module->func_count; i++) {
+        code_end = i + 1 < module->func_count
+                   ? ranges[i + 1].code
+                   : (uint8*)module->code + module->code_size
+                         - get_plt_table_size();
+
+        func_index = ranges[i].func_index + module->import_func_count;
+        name = NULL;
+        for (j = 0; j < module->export_count; j++) {
+            if (exports[j].kind == EXPORT_KIND_FUNC
+                && exports[j].index == func_index) {
+                name = exports[j].name;
+                break;
+            }
+        }
+        if (!name) {
+            snprintf(buf, sizeof(buf), "%s%u", AOT_FUNC_PREFIX,
+                     ranges[i].func_index);
+            name = buf;
+        }
+
+        if (code_end > ranges[i].code)
+            wasm_linux_perf_add_code(ranges[i].code,
+                                     (uint64)(code_end - ranges[i].code),
+                                     name);
+    }
+}
+#endif /* end of WASM_ENABLE_LINUX_PERF != 0 */
+
 static bool
 load_from_sections(AOTModule *module, AOTSection *sections,
                    char *error_buf, uint32 error_buf_size)
@@ -2020,9 +2129,13 @@ load_from_sections(AOTModule *module, AOTSection *sections,
                     return false;
                 break;
             case AOT_SECTION_TYPE_RELOCATION:
+                STARTUP_TIMING_BEGIN(WASM_STARTUP_RELOCATE);
                 if (!load_relocation_section(buf, buf_end, module,
-                                             error_buf, error_buf_size))
+                                             error_buf, error_buf_size)) {
+                    STARTUP_TIMING_END(WASM_STARTUP_RELOCATE);
                     return false;
+                }
+                STARTUP_TIMING_END(WASM_STARTUP_RELOCATE);
                 break;
             default:
                 set_error_buf(error_buf, error_buf_size,
@@ -2134,6 +2247,15 @@ load_from_sections(AOTModule *module, AOTSection *sections,
      * otherwise unpredictable behavior can occur. */
     os_dcache_flush();
 
+#ifdef AOT_FUNC_CODE_RANGES_ENABLED
+    if (!create_func_code_ranges(module, error_buf, error_buf_size))
+        return false;
+#endif
+
+#if WASM_ENABLE_LINUX_PERF != 0
+    emit_linux_perf_funcs(module);
+#endif
+
 #if WASM_ENABLE_MEMORY_TRACING != 0
     wasm_runtime_dump_module_mem_consumption((WASMModuleCommon*)module);
 #endif
@@ -2242,6 +2364,10 @@ create_sections(const uint8 *buf, uint32 size,
 #else
                     int map_flags = MMAP_MAP_NONE;
 #endif
+                    if (wasm_runtime_is_huge_page_enabled())
+                        /* Reduce iTLB misses of large AOT code */
+                        map_flags |= MMAP_MAP_HUGEPAGE;
+
                     total_size = (uint64)section_size + aot_get_plt_table_size();
                     total_size = (total_size + 3) & ~((uint64)3);
                     if (total_size >= UINT32_MAX
@@ -2347,13 +2473,161 @@ fail:
     return false;
 }
 
+/* Get the AOT_CPU_FEATURE_* flags supported by the CPU and the OS */
+static uint32
+get_host_cpu_features()
+{
+    uint32 features = 0;
+#ifdef AOT_CPUID_SUPPORTED
+    uint32 eax, ebx, ecx, edx, max_leaf, xcr0 = 0;
+
+    if (!__get_cpuid(0, &max_leaf, &ebx, &ecx, &edx) || max_leaf < 1)
+        return 0;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (ecx & (1 << 9))
+        features |= AOT_CPU_FEATURE_SSSE3;
+    if (ecx & (1 << 19))
+        features |= AOT_CPU_FEATURE_SSE4_1;
+    if (ecx & (1 << 20))
+        features |= AOT_CPU_FEATURE_SSE4_2;
+    if (ecx & (1 << 23))
+        features |= AOT_CPU_FEATURE_POPCNT;
+    if (ecx & (1 << 22))
+        features |= AOT_CPU_FEATURE_MOVBE;
+
+    /* The AVX registers can be used only if the OS saves them */
+    if (ecx & (1 << 27)) {
+        __asm__ volatile("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+    }
+    if ((xcr0 & 0x6) == 0x6) {
+        if (ecx & (1 << 28))
+            features |= AOT_CPU_FEATURE_AVX;
+        if (ecx & (1 << 12))
+            features |= AOT_CPU_FEATURE_FMA;
+        if (ecx & (1 << 29))
+            features |= AOT_CPU_FEATURE_F16C;
+    }
+
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (ebx & (1 << 3))
+            features |= AOT_CPU_FEATURE_BMI;
+        if (ebx & (1 << 8))
+            features |= AOT_CPU_FEATURE_BMI2;
+        if ((xcr0 & 0x6) == 0x6 && (ebx & (1 << 5)))
+            features |= AOT_CPU_FEATURE_AVX2;
+        /* The opmask and upper ZMM registers must be saved too */
+        if ((xcr0 & 0xE6) == 0xE6) {
+            if (ebx & (1 << 16))
+                features |= AOT_CPU_FEATURE_AVX512F;
+            if (ebx & (1 << 17))
+                features |= AOT_CPU_FEATURE_AVX512DQ;
+            if (ebx & (1 << 28))
+                features |= AOT_CPU_FEATURE_AVX512CD;
+            if (ebx & (1u << 30))
+                features |= AOT_CPU_FEATURE_AVX512BW;
+            if (ebx & (1u << 31))
+                features |= AOT_CPU_FEATURE_AVX512VL;
+            if (ecx & (1 << 1))
+                features |= AOT_CPU_FEATURE_AVX512VBMI;
+            if (ecx & (1 << 11))
+                features |= AOT_CPU_FEATURE_AVX512VNNI;
+        }
+    }
+
+    if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx)
+        && (ecx & (1 << 5)))
+        features |= AOT_CPU_FEATURE_LZCNT;
+#endif
+    return features;
+}
+
+static uint32
+get_cpu_feature_num(uint32 features)
+{
+    uint32 num = 0;
+
+    for (; features; features &= features - 1)
+        num++;
+    return num;
+}
+
+/* If it is a fat AOT file, find the variant requiring the most CPU
+   features which are all supported by the host, and return the buffer
+   of its AOT file in *p_buf and *p_size */
+static bool
+select_cpu_variant(const uint8 **p_buf, uint32 *p_size,
+                   char *error_buf, uint32 error_buf_size)
+{
+    const uint8 *buf = *p_buf, *buf_end = buf + *p_size;
+    const uint8 *p = buf, *p_end = buf_end;
+    const uint8 *variant_buf = NULL;
+    uint32 magic_number, version, section_type, section_size;
+    uint32 variant_count, cpu_features, aot_file_size, variant_size = 0;
+    uint32 host_cpu_features, i;
+    int32 best_feature_num = -1;
+
+    read_uint32(p, p_end, magic_number);
+    read_uint32(p, p_end, version);
+    if (magic_number != AOT_MAGIC_NUMBER || version != AOT_CURRENT_VERSION
+        || p == p_end) {
+        /* Let load() report the error */
+        return true;
+    }
+
+    read_uint32(p, p_end, section_type);
+    if (section_type != AOT_SECTION_TYPE_CPU_VARIANTS)
+        return true;
+
+    read_uint32(p, p_end, section_size);
+    CHECK_BUF(p, p_end, section_size);
+    p_end = p + section_size;
+
+    host_cpu_features = get_host_cpu_features();
+
+    read_uint32(p, p_end, variant_count);
+    for (i = 0; i < variant_count; i++) {
+        read_uint32(p, p_end, cpu_features);
+        read_uint32(p, p_end, aot_file_size);
+        CHECK_BUF(p, p_end, aot_file_size);
+
+        if ((cpu_features & ~host_cpu_features) == 0
+            && (int32)get_cpu_feature_num(cpu_features) > best_feature_num) {
+            best_feature_num = (int32)get_cpu_feature_num(cpu_features);
+            variant_buf = p;
+            variant_size = aot_file_size;
+        }
+        p += aot_file_size;
+    }
+
+    if (!variant_buf) {
+        set_error_buf(error_buf, error_buf_size,
+                      "no code variant supports the host CPU");
+        return false;
+    }
+
+    LOG_VERBOSE("Load the variant %u bytes at offset %u of the fat AOT "
+                "file, host CPU features: 0x%x.\n",
+                variant_size, (uint32)(variant_buf - buf),
+                host_cpu_features);
+    *p_buf = variant_buf;
+    *p_size = variant_size;
+    return true;
+fail:
+    return false;
+}
+
 AOTModule*
 aot_load_from_aot_file(const uint8 *buf, uint32 size,
                        char *error_buf, uint32 error_buf_size)
 {
-    AOTModule *module = create_module(error_buf, error_buf_size);
+    AOTModule *module;
 
-    if (!module)
+    if (!select_cpu_variant(&buf, &size, error_buf, error_buf_size))
+        return NULL;
+
+    if (!(module = create_module(error_buf, error_buf_size)))
         return NULL;
 
     if (!load(buf, size, module, error_buf, error_buf_size)) {
@@ -2372,7 +2646,9 @@ aot_load_from_comp_data(AOTCompData *comp_data, AOTCompContext *comp_ctx,
 {
     uint32 i;
     uint64 size;
+#if WASM_ENABLE_LAZY_JIT == 0
     char func_name[32];
+#endif
     AOTModule *module;
 
     /* Allocate memory for module */
@@ -2438,6 +2714,19 @@ aot_load_from_comp_data(AOTCompData *comp_data, AOTCompContext *comp_ctx,
     }
 
     /* Resolve function addresses */
+#if WASM_ENABLE_LAZY_JIT != 0
+    /* The addresses are the lazy compilation stubs, the functions
+       are compiled on their first calls */
+    bh_assert(comp_ctx->lazy_jit);
+    if (module->func_count > 0
+        && aot_lazy_jit_lookup_funcs(comp_ctx->lazy_jit, AOT_FUNC_PREFIX,
+                                     module->func_count,
+                                     module->func_ptrs) != 0) {
+        set_error_buf(error_buf, error_buf_size,
+                      "get function address failed");
+        goto fail3;
+    }
+#else
     bh_assert(comp_ctx->exec_engine);
     for (i = 0; i < comp_data->func_count; i++) {
         snprintf(func_name, sizeof(func_name), "%s%d", AOT_FUNC_PREFIX, i);
@@ -2449,6 +2738,7 @@ aot_load_from_comp_data(AOTCompData *comp_data, AOTCompContext *comp_ctx,
             goto fail3;
         }
     }
+#endif
 
     /* Allocation memory for function type indexes */
     size = (uint64)module->func_count * sizeof(uint32);
@@ -2551,9 +2841,16 @@ aot_convert_wasm_module(WASMModule *wasm_module,
 #if (WASM_ENABLE_PERF_PROFILING != 0) || (WASM_ENABLE_DUMP_CALL_STACK != 0)
     option.enable_aux_stack_frame = true;
 #endif
+#if WASM_ENABLE_LINUX_PERF != 0
+    /* perf record --call-graph=fp walks the JITed code */
+    option.enable_frame_pointer = true;
+#endif
+
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_COMPILE);
 
     comp_ctx = aot_create_comp_context(comp_data, &option);
     if (!comp_ctx) {
+        STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
         aot_last_error = aot_get_last_error();
         bh_assert(aot_last_error != NULL);
         set_error_buf(error_buf, error_buf_size, aot_last_error);
@@ -2561,6 +2858,7 @@ aot_convert_wasm_module(WASMModule *wasm_module,
     }
 
     if (!aot_compile_wasm(comp_ctx)) {
+        STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
         aot_last_error = aot_get_last_error();
         bh_assert(aot_last_error != NULL);
         set_error_buf(error_buf, error_buf_size, aot_last_error);
@@ -2569,6 +2867,7 @@ aot_convert_wasm_module(WASMModule *wasm_module,
 
     aot_module = aot_load_from_comp_data(comp_data, comp_ctx,
                                          error_buf, error_buf_size);
+    STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
     if (!aot_module) {
         goto fail2;
     }
@@ -2648,6 +2947,11 @@ aot_unload(AOTModule *module)
     if (module->func_ptrs)
         wasm_runtime_free(module->func_ptrs);
 
+#ifdef AOT_FUNC_CODE_RANGES_ENABLED
+    if (module->func_code_ranges)
+        wasm_runtime_free(module->func_code_ranges);
+#endif
+
     if (module->const_str_set)
         bh_hash_map_destroy(module->const_str_set);
 
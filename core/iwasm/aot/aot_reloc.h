@@ -48,6 +48,13 @@ typedef struct {
 #define REG_AOT_TRACE_SYM()
 #endif
 
+#if WASM_ENABLE_STATIC_PGO != 0
+#define REG_AOT_PGO_SYM()                 \
+    REG_SYM(aot_pgo_record_call_target),
+#else
+#define REG_AOT_PGO_SYM()
+#endif
+
 #define REG_COMMON_SYMBOLS                \
     REG_SYM(aot_set_exception_with_id),   \
     REG_SYM(aot_invoke_native),           \
@@ -71,7 +78,8 @@ typedef struct {
     REG_BULK_MEMORY_SYM()                 \
     REG_ATOMIC_WAIT_SYM()                 \
     REG_REF_TYPES_SYM()                   \
-    REG_AOT_TRACE_SYM()
+    REG_AOT_TRACE_SYM()                   \
+    REG_AOT_PGO_SYM()
 
 #define CHECK_RELOC_OFFSET(data_size) do {                                  \
     if (!check_reloc_offset(target_section_size, reloc_offset, data_size,   \
@@ -13,6 +13,12 @@
 #if WASM_ENABLE_THREAD_MGR != 0
 #include "../libraries/thread-mgr/thread_manager.h"
 #endif
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+#include "../common/wasm_sampling_profiler.h"
+#endif
+#include "../common/wasm_startup_timing.h"
+#include "../common/wasm_metrics.h"
+#include "../common/wasm_usdt.h"
 
 static void
 set_error_buf(char *error_buf, uint32 error_buf_size, const char *string)
@@ -308,6 +314,26 @@ table_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
     return true;
 }
 
+#ifdef OS_ENABLE_HW_BOUND_CHECK
+/**
+ * Get the size of the space reserved for the linear memory, 8GB is
+ * reserved for the memory of i32 address, see memory_instantiate, and
+ * the max size plus AOT_MEMORY64_GUARD_SIZE is reserved for memory64
+ */
+static uint64
+get_memory_map_size(bool is_memory64, uint32 num_bytes_per_page,
+                    uint32 max_page_count)
+{
+    uint64 page_size = os_getpagesize();
+
+    if (is_memory64)
+        return (((uint64)num_bytes_per_page * max_page_count
+                 + page_size - 1) & ~(page_size - 1))
+               + AOT_MEMORY64_GUARD_SIZE;
+    return 8 * (uint64)BH_GB;
+}
+#endif
+
 static void
 memories_deinstantiate(AOTModuleInstance *module_inst)
 {
@@ -345,7 +371,9 @@ memories_deinstantiate(AOTModuleInstance *module_inst)
                                 * memory_inst->cur_page_count);
 #endif
                 os_munmap((uint8*)memory_inst->memory_data.ptr,
-                          8 * (uint64)BH_GB);
+                          get_memory_map_size(memory_inst->is_memory64,
+                                              memory_inst->num_bytes_per_page,
+                                              memory_inst->max_page_count));
 #endif
             }
         }
@@ -365,12 +393,15 @@ memory_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
     uint32 inc_page_count, aux_heap_base, global_idx;
     uint32 bytes_of_last_page, bytes_to_page_end;
     uint32 heap_offset = num_bytes_per_page *init_page_count;
+    uint32 max_page_limit = 65536;
     uint64 total_size;
     uint8 *p = NULL, *global_addr;
+    bool is_memory64 = false;
 #ifdef OS_ENABLE_HW_BOUND_CHECK
     uint8 *mapped_mem;
-    uint64 map_size = 8 * (uint64)BH_GB;
+    uint64 map_size;
     uint64 page_size = os_getpagesize();
+    int map_flags = MMAP_MAP_NONE;
 #endif
 
 #if WASM_ENABLE_SHARED_MEMORY != 0
@@ -398,6 +429,27 @@ memory_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
     }
 #endif
 
+#if WASM_ENABLE_MEMORY64 != 0
+    if (memory->memory_flags & MEMORY64_FLAG) {
+        is_memory64 = true;
+#ifdef OS_ENABLE_HW_BOUND_CHECK
+        /* The max pages and a guard region are reserved, the memory
+           isn't moved when it is enlarged, so it may exceed 4GB like
+           the memory64 of interpreter. Otherwise it is re-allocated
+           with uint32 size and is limited to 4GB */
+        max_page_limit = WASM_MEMORY64_MAX_PAGES;
+#endif
+        if (init_page_count > max_page_limit) {
+            set_error_buf_v(error_buf, error_buf_size,
+                            "memory size must be at most %u pages",
+                            max_page_limit);
+            return NULL;
+        }
+        if (max_page_count > max_page_limit)
+            max_page_count = max_page_limit;
+    }
+#endif
+
     if (heap_size > 0
         && module->malloc_func_index != (uint32)-1
         && module->free_func_index != (uint32)-1) {
@@ -406,6 +458,17 @@ memory_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
         heap_size = 0;
     }
 
+#if WASM_ENABLE_MEMORY64 != 0
+    if (is_memory64 && heap_size > 0
+        && (uint64)num_bytes_per_page * init_page_count + heap_size
+             > UINT32_MAX) {
+        /* The app heap is accessed with 32-bit app offsets */
+        LOG_WARNING("App heap is disabled since memory64 initial size "
+                    "exceeds 4GB");
+        heap_size = 0;
+    }
+#endif
+
     if (init_page_count == max_page_count && init_page_count == 1) {
         /* If only one page and at most one page, we just append
            the app heap to the end of linear memory, enlarge the
@@ -461,13 +524,14 @@ memory_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
         }
         init_page_count += inc_page_count;
         max_page_count += inc_page_count;
-        if (init_page_count > 65536) {
-            set_error_buf(error_buf, error_buf_size,
-                          "memory size must be at most 65536 pages (4GiB)");
+        if (init_page_count > max_page_limit) {
+            set_error_buf_v(error_buf, error_buf_size,
+                            "memory size must be at most %u pages",
+                            max_page_limit);
             return NULL;
         }
-        if (max_page_count > 65536)
-            max_page_count = 65536;
+        if (max_page_count > max_page_limit)
+            max_page_count = max_page_limit;
     }
 
     LOG_VERBOSE("Memory instantiate:");
@@ -496,10 +560,19 @@ memory_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
      *   ea = i + memarg.offset
      * both i and memarg.offset are u32 in range 0 to 4G
      * so the range of ea is 0 to 8G
+     * For memory64, the max pages and a guard region are mapped
      */
-    if (total_size >= UINT32_MAX
+    map_size = get_memory_map_size(is_memory64, num_bytes_per_page,
+                                   max_page_count);
+
+    if (wasm_runtime_is_huge_page_enabled())
+        /* Align the reservation to huge page boundary to reduce
+           dTLB misses when accessing the linear memory */
+        map_flags |= MMAP_MAP_HUGEPAGE;
+
+    if ((!is_memory64 && total_size >= UINT32_MAX)
         || !(p = mapped_mem = os_mmap(NULL, map_size,
-                                      MMAP_PROT_NONE, MMAP_MAP_NONE))) {
+                                      MMAP_PROT_NONE, map_flags))) {
         set_error_buf(error_buf, error_buf_size, "mmap memory failed");
         return NULL;
     }
@@ -520,18 +593,19 @@ memory_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
         os_munmap(mapped_mem, map_size);
         return NULL;
     }
-    memset(p, 0, (uint32)total_size);
+    /* The pages of the new mapping are already zeroed */
 #endif /* end of OS_ENABLE_HW_BOUND_CHECK */
 
     memory_inst->module_type = Wasm_Module_AoT;
+    memory_inst->is_memory64 = is_memory64;
     memory_inst->num_bytes_per_page = num_bytes_per_page;
     memory_inst->cur_page_count = init_page_count;
     memory_inst->max_page_count = max_page_count;
 
     /* Init memory info */
     memory_inst->memory_data.ptr = p;
-    memory_inst->memory_data_end.ptr = p + (uint32)total_size;
-    memory_inst->memory_data_size = (uint32)total_size;
+    memory_inst->memory_data_end.ptr = p + total_size;
+    memory_inst->memory_data_size = total_size;
 
     /* Initialize heap info */
     memory_inst->heap_data.ptr = p + heap_offset;
@@ -618,38 +692,17 @@ aot_get_default_memory(AOTModuleInstance *module_inst)
         return NULL;
 }
 
+/**
+ * Initialize the default memory with the active data segments
+ */
 static bool
-memories_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
-                     uint32 heap_size, char *error_buf, uint32 error_buf_size)
+memories_init_data_segments(AOTModuleInstance *module_inst, AOTModule *module,
+                            char *error_buf, uint32 error_buf_size)
 {
-    uint32 global_index, global_data_offset, base_offset, length;
-    uint32 i, memory_count = module->memory_count;
-    AOTMemoryInstance *memories, *memory_inst;
+    uint32 global_index, global_data_offset, length, i;
+    uint64 base_offset;
+    AOTMemoryInstance *memory_inst = aot_get_default_memory(module_inst);
     AOTMemInitData *data_seg;
-    uint64 total_size;
-
-    module_inst->memory_count = memory_count;
-    total_size = sizeof(AOTPointer) * (uint64)memory_count;
-    if (!(module_inst->memories.ptr =
-            runtime_malloc(total_size, error_buf, error_buf_size))) {
-        return false;
-    }
-
-    memories = module_inst->global_table_data.memory_instances;
-    for (i = 0; i < memory_count; i++, memories++) {
-        memory_inst =
-            memory_instantiate(module_inst, module,
-                               memories, &module->memories[i],
-                               heap_size, error_buf, error_buf_size);
-        if (!memory_inst) {
-            return false;
-        }
-
-        ((AOTMemoryInstance **)module_inst->memories.ptr)[i] = memory_inst;
-    }
-
-    /* Get default memory instance */
-    memory_inst = aot_get_default_memory(module_inst);
 
     for (i = 0; i < module->mem_init_data_count; i++) {
         data_seg = module->mem_init_data_list[i];
@@ -660,6 +713,8 @@ memories_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
 
         bh_assert(data_seg->offset.init_expr_type ==
                         INIT_EXPR_TYPE_I32_CONST
+                  || data_seg->offset.init_expr_type ==
+                        INIT_EXPR_TYPE_I64_CONST
                   || data_seg->offset.init_expr_type ==
                         INIT_EXPR_TYPE_GET_GLOBAL);
 
@@ -680,9 +735,21 @@ memories_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
                     module->globals[global_index - module->import_global_count]
                             .data_offset;
 
+#if WASM_ENABLE_MEMORY64 != 0
+            if (module->memories[0].memory_flags & MEMORY64_FLAG)
+                base_offset = *(uint64*)
+                    ((uint8*)module_inst->global_data.ptr + global_data_offset);
+            else
+#endif
             base_offset = *(uint32*)
                 ((uint8*)module_inst->global_data.ptr + global_data_offset);
         }
+#if WASM_ENABLE_MEMORY64 != 0
+        else if (data_seg->offset.init_expr_type
+                 == INIT_EXPR_TYPE_I64_CONST) {
+            base_offset = (uint64)data_seg->offset.u.i64;
+        }
+#endif
         else {
             base_offset = (uint32)data_seg->offset.u.i32;
         }
@@ -694,8 +761,8 @@ memories_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
         /* Check memory data */
         /* check offset since length might negative */
         if (base_offset > memory_inst->memory_data_size) {
-            LOG_DEBUG("base_offset(%d) > memory_data_size(%d)", base_offset,
-                      memory_inst->memory_data_size);
+            LOG_DEBUG("base_offset(%"PRIu64") > memory_data_size(%"PRIu64")",
+                      base_offset, memory_inst->memory_data_size);
 #if WASM_ENABLE_REF_TYPES != 0
             set_error_buf(error_buf, error_buf_size,
                           "out of bounds memory access");
@@ -709,7 +776,8 @@ memories_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
         /* check offset + length(could be zero) */
         length = data_seg->byte_count;
         if (base_offset + length > memory_inst->memory_data_size) {
-            LOG_DEBUG("base_offset(%d) + length(%d) > memory_data_size(%d)",
+            LOG_DEBUG("base_offset(%"PRIu64") + length(%u) "
+                      "> memory_data_size(%"PRIu64")",
                       base_offset, length, memory_inst->memory_data_size);
 #if WASM_ENABLE_REF_TYPES != 0
             set_error_buf(error_buf, error_buf_size,
@@ -723,14 +791,45 @@ memories_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
 
         if (memory_inst->memory_data.ptr) {
             bh_memcpy_s((uint8*)memory_inst->memory_data.ptr + base_offset,
-                        memory_inst->memory_data_size - base_offset,
-                        data_seg->bytes, length);
+                        length, data_seg->bytes, length);
         }
     }
 
     return true;
 }
 
+static bool
+memories_instantiate(AOTModuleInstance *module_inst, AOTModule *module,
+                     uint32 heap_size, char *error_buf, uint32 error_buf_size)
+{
+    uint32 i, memory_count = module->memory_count;
+    AOTMemoryInstance *memories, *memory_inst;
+    uint64 total_size;
+
+    module_inst->memory_count = memory_count;
+    total_size = sizeof(AOTPointer) * (uint64)memory_count;
+    if (!(module_inst->memories.ptr =
+            runtime_malloc(total_size, error_buf, error_buf_size))) {
+        return false;
+    }
+
+    memories = module_inst->global_table_data.memory_instances;
+    for (i = 0; i < memory_count; i++, memories++) {
+        memory_inst =
+            memory_instantiate(module_inst, module,
+                               memories, &module->memories[i],
+                               heap_size, error_buf, error_buf_size);
+        if (!memory_inst) {
+            return false;
+        }
+
+        ((AOTMemoryInstance **)module_inst->memories.ptr)[i] = memory_inst;
+    }
+
+    return memories_init_data_segments(module_inst, module,
+                                       error_buf, error_buf_size);
+}
+
 static bool
 init_func_ptrs(AOTModuleInstance *module_inst, AOTModule *module,
                char *error_buf, uint32 error_buf_size)
@@ -1026,6 +1125,7 @@ aot_instantiate(AOTModule *module, bool is_sub_inst,
 
 #if WASM_ENABLE_LIBC_WASI != 0
     if (!is_sub_inst) {
+        STARTUP_TIMING_BEGIN(WASM_STARTUP_WASI_INIT);
         if (!wasm_runtime_init_wasi((WASMModuleInstanceCommon*)module_inst,
                                     module->wasi_args.dir_list,
                                     module->wasi_args.dir_count,
@@ -1038,8 +1138,11 @@ aot_instantiate(AOTModule *module, bool is_sub_inst,
                                     module->wasi_args.stdio[0],
                                     module->wasi_args.stdio[1],
                                     module->wasi_args.stdio[2],
-                                    error_buf, error_buf_size))
+                                    error_buf, error_buf_size)) {
+            STARTUP_TIMING_END(WASM_STARTUP_WASI_INIT);
             goto fail;
+        }
+        STARTUP_TIMING_END(WASM_STARTUP_WASI_INIT);
     }
 #endif
 
@@ -1068,9 +1171,22 @@ aot_instantiate(AOTModule *module, bool is_sub_inst,
     }
 #endif
 
-    /* Execute __post_instantiate function and start function*/
+#if WASM_ENABLE_BULK_MEMORY != 0 || WASM_ENABLE_REF_TYPES != 0
+    total_size = (uint64)sizeof(bool) * (module->mem_init_data_count
+                                         + module->table_init_data_count);
+    if (total_size > 0
+        && !(module_inst->seg_dropped.ptr =
+                runtime_malloc(total_size, error_buf, error_buf_size))) {
+        goto fail;
+    }
+#endif
+
+    /* Execute __post_instantiate function, start function and memory
+       init function, they are timed as one start function phase */
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_START_FUNC);
     if (!execute_post_inst_function(module_inst)
         || !execute_start_function(module_inst)) {
+        STARTUP_TIMING_END(WASM_STARTUP_START_FUNC);
         set_error_buf(error_buf, error_buf_size,
                       module_inst->cur_exception);
         goto fail;
@@ -1085,6 +1201,7 @@ aot_instantiate(AOTModule *module, bool is_sub_inst,
         */
         if (!is_sub_inst) {
             if (!execute_memory_init_function(module_inst)) {
+                STARTUP_TIMING_END(WASM_STARTUP_START_FUNC);
                 set_error_buf(error_buf, error_buf_size,
                               module_inst->cur_exception);
                 goto fail;
@@ -1094,6 +1211,7 @@ aot_instantiate(AOTModule *module, bool is_sub_inst,
     }
 #endif
 #endif
+    STARTUP_TIMING_END(WASM_STARTUP_START_FUNC);
 
 #if WASM_ENABLE_MEMORY_TRACING != 0
     wasm_runtime_dump_module_inst_mem_consumption
@@ -1157,6 +1275,9 @@ aot_deinstantiate(AOTModuleInstance *module_inst, bool is_sub_inst)
     if (module_inst->func_type_indexes.ptr)
         wasm_runtime_free(module_inst->func_type_indexes.ptr);
 
+    if (module_inst->seg_dropped.ptr)
+        wasm_runtime_free(module_inst->seg_dropped.ptr);
+
     if (module_inst->exec_env_singleton.ptr)
         wasm_exec_env_destroy((WASMExecEnv *)
                               module_inst->exec_env_singleton.ptr);
@@ -1164,6 +1285,158 @@ aot_deinstantiate(AOTModuleInstance *module_inst, bool is_sub_inst)
     wasm_runtime_free(module_inst);
 }
 
+#if WASM_ENABLE_INSTANCE_POOL != 0
+static bool
+memory_reset(AOTMemoryInstance *memory_inst,
+             char *error_buf, uint32 error_buf_size)
+{
+    uint32 heap_size = (uint32)((uint8*)memory_inst->heap_data_end.ptr
+                                - (uint8*)memory_inst->heap_data.ptr);
+
+#if defined(OS_ENABLE_HW_BOUND_CHECK) && !defined(BH_PLATFORM_WINDOWS)
+    int map_flags = MMAP_MAP_FIXED;
+
+    if (wasm_runtime_is_huge_page_enabled())
+        map_flags |= MMAP_MAP_HUGEPAGE;
+
+    /* Discard the pages by mapping fresh zero pages over them, the
+       pages are only populated again when they are touched */
+    if (memory_inst->memory_data_size > 0
+        && os_mmap(memory_inst->memory_data.ptr,
+                   memory_inst->memory_data_size,
+                   MMAP_PROT_READ | MMAP_PROT_WRITE, map_flags)
+           != memory_inst->memory_data.ptr) {
+        set_error_buf(error_buf, error_buf_size, "mmap memory failed");
+        return false;
+    }
+#else
+    if (memory_inst->memory_data.ptr)
+        memset(memory_inst->memory_data.ptr, 0,
+               memory_inst->memory_data_size);
+#endif
+
+    if (memory_inst->heap_handle.ptr) {
+        mem_allocator_destroy(memory_inst->heap_handle.ptr);
+        if (!mem_allocator_create_with_struct_and_pool
+                    (memory_inst->heap_handle.ptr,
+                     mem_allocator_get_heap_struct_size(),
+                     memory_inst->heap_data.ptr, heap_size)) {
+            set_error_buf(error_buf, error_buf_size,
+                          "init app heap failed");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+aot_reset_instance(AOTModuleInstance *module_inst,
+                   char *error_buf, uint32 error_buf_size)
+{
+    AOTModule *module = (AOTModule*)module_inst->aot_module.ptr;
+    AOTTableInstance *tbl_inst = (AOTTableInstance*)module_inst->tables.ptr;
+    AOTMemoryInstance *memory_inst;
+    uint8 *heap_base_addr = NULL;
+    uint32 heap_base = 0, i;
+
+#if WASM_ENABLE_SHARED_MEMORY != 0
+    for (i = 0; i < module_inst->memory_count; i++) {
+        memory_inst = ((AOTMemoryInstance **)module_inst->memories.ptr)[i];
+        if (memory_inst->is_shared) {
+            set_error_buf(error_buf, error_buf_size,
+                          "reset instance failed: memory is shared");
+            return false;
+        }
+    }
+#endif
+
+#if WASM_ENABLE_LIBC_WASI != 0
+    /* The wasi ctx is allocated from app heap, destroy it before
+       the app heap is re-created */
+    wasm_runtime_destroy_wasi((WASMModuleInstanceCommon*)module_inst);
+#endif
+
+    for (i = 0; i < module_inst->memory_count; i++) {
+        memory_inst = ((AOTMemoryInstance **)module_inst->memories.ptr)[i];
+        if (!memory_reset(memory_inst, error_buf, error_buf_size))
+            return false;
+    }
+
+    /* __heap_base global may have been adjusted by memory_instantiate
+       to insert the app heap, keep the adjusted value */
+    if (module->aux_heap_base_global_index != (uint32)-1
+        && module->aux_heap_base_global_index
+           >= module->import_global_count) {
+        heap_base_addr = (uint8*)module_inst->global_data.ptr
+                         + module->globals[module->aux_heap_base_global_index
+                                           - module->import_global_count]
+                             .data_offset;
+        heap_base = *(uint32*)heap_base_addr;
+    }
+    if (!global_instantiate(module_inst, module, error_buf, error_buf_size))
+        return false;
+    if (heap_base_addr)
+        *(uint32*)heap_base_addr = heap_base;
+
+    if (module_inst->seg_dropped.ptr)
+        memset(module_inst->seg_dropped.ptr, 0,
+               sizeof(bool) * (module->mem_init_data_count
+                               + module->table_init_data_count));
+
+    for (i = 0; i < module_inst->table_count; i++)
+        tbl_inst = aot_next_tbl_inst(tbl_inst);
+    /* Set all elements to -1 to mark them as uninitialized elements */
+    memset(module_inst->tables.ptr, 0xff,
+           (uint32)((uint8*)tbl_inst - (uint8*)module_inst->tables.ptr));
+    if (!table_instantiate(module_inst, module, error_buf, error_buf_size)
+        || !memories_init_data_segments(module_inst, module,
+                                        error_buf, error_buf_size))
+        return false;
+
+    aot_clear_exception(module_inst);
+
+#if WASM_ENABLE_LIBC_WASI != 0
+    if (!wasm_runtime_init_wasi((WASMModuleInstanceCommon*)module_inst,
+                                module->wasi_args.dir_list,
+                                module->wasi_args.dir_count,
+                                module->wasi_args.map_dir_list,
+                                module->wasi_args.map_dir_count,
+                                module->wasi_args.env,
+                                module->wasi_args.env_count,
+                                module->wasi_args.argv,
+                                module->wasi_args.argc,
+                                module->wasi_args.stdio[0],
+                                module->wasi_args.stdio[1],
+                                module->wasi_args.stdio[2],
+                                error_buf, error_buf_size))
+        return false;
+#endif
+
+    if (!execute_post_inst_function(module_inst)
+        || !execute_start_function(module_inst)) {
+        set_error_buf(error_buf, error_buf_size,
+                      module_inst->cur_exception);
+        return false;
+    }
+
+#if WASM_ENABLE_BULK_MEMORY != 0
+#if WASM_ENABLE_LIBC_WASI != 0
+    if (!module->is_wasi_module) {
+#endif
+        if (!execute_memory_init_function(module_inst)) {
+            set_error_buf(error_buf, error_buf_size,
+                          module_inst->cur_exception);
+            return false;
+        }
+#if WASM_ENABLE_LIBC_WASI != 0
+    }
+#endif
+#endif
+
+    return true;
+}
+#endif /* end of WASM_ENABLE_INSTANCE_POOL */
+
 AOTFunctionInstance*
 aot_lookup_function(const AOTModuleInstance *module_inst,
                     const char *name, const char *signature)
@@ -1207,7 +1480,10 @@ aot_signal_handler(void *sig_addr)
         if (memory_inst) {
             mapped_mem_start_addr = (uint8*)memory_inst->memory_data.ptr;
             mapped_mem_end_addr = (uint8*)memory_inst->memory_data.ptr
-                                  + 8 * (uint64)BH_GB;
+                                  + get_memory_map_size(
+                                        memory_inst->is_memory64,
+                                        memory_inst->num_bytes_per_page,
+                                        memory_inst->max_page_count);
         }
 
         /* Get stack info of current thread */
@@ -1255,7 +1531,10 @@ aot_exception_handler(EXCEPTION_POINTERS *exce_info)
             if (memory_inst) {
                 mapped_mem_start_addr = (uint8*)memory_inst->memory_data.ptr;
                 mapped_mem_end_addr = (uint8*)memory_inst->memory_data.ptr
-                                      + 8 * (uint64)BH_GB;
+                                      + get_memory_map_size(
+                                            memory_inst->is_memory64,
+                                            memory_inst->num_bytes_per_page,
+                                            memory_inst->max_page_count);
                 if (mapped_mem_start_addr <= (uint8*)sig_addr
                     && (uint8*)sig_addr < mapped_mem_end_addr) {
                     /* The address which causes segmentation fault is inside
@@ -1554,6 +1833,9 @@ aot_create_exec_env_and_call_function(AOTModuleInstance *module_inst,
 {
     WASMExecEnv *exec_env = NULL, *existing_exec_env = NULL;
     bool ret;
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    WASMSamplingContext prev_sampling_ctx;
+#endif
 
 #if defined(OS_ENABLE_HW_BOUND_CHECK)
     existing_exec_env = exec_env = aot_exec_env;
@@ -1575,8 +1857,16 @@ aot_create_exec_env_and_call_function(AOTModuleInstance *module_inst,
     wasm_runtime_prepare_call_function(exec_env, func);
 #endif
 
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_enter(exec_env, &prev_sampling_ctx);
+#endif
+
     ret = aot_call_function(exec_env, func, argc, argv);
 
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_leave(&prev_sampling_ctx);
+#endif
+
 #if WASM_ENABLE_REF_TYPES != 0
     wasm_runtime_finalize_call_function(exec_env, func, ret, argv);
 #endif
@@ -1592,18 +1882,143 @@ void
 aot_set_exception(AOTModuleInstance *module_inst,
                   const char *exception)
 {
+#if WASM_ENABLE_METRICS != 0
     if (exception)
+        wasm_metrics_count_trap(exception);
+#endif
+
+    if (exception) {
+        USDT_PROBE2(trap, module_inst, exception);
         snprintf(module_inst->cur_exception,
                  sizeof(module_inst->cur_exception),
                  "Exception: %s", exception);
+    }
     else
         module_inst->cur_exception[0] = '\0';
 }
 
+uint32
+aot_get_func_index_by_code_addr(const AOTModule *module, const void *addr)
+{
+#ifdef AOT_FUNC_CODE_RANGES_ENABLED
+    const AOTFuncCodeRange *ranges = module->func_code_ranges;
+    uintptr_t code_start = (uintptr_t)module->code;
+    uint32 low = 0, high = module->func_count, mid;
+
+    if (module->is_jit_mode || !ranges
+        || (uintptr_t)addr < code_start
+        || (uintptr_t)addr >= code_start + module->code_size)
+        return (uint32)-1;
+
+    /* Binary search the last function starting at or before the
+       address, it is called for each frame in the signal handler of
+       the sampling profiler */
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if ((uintptr_t)ranges[mid].code <= (uintptr_t)addr)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == 0)
+        return (uint32)-1;
+    return ranges[low - 1].func_index + module->import_func_count;
+#else
+    (void)module;
+    (void)addr;
+    return (uint32)-1;
+#endif
+}
+
+uint32
+aot_walk_frame_pointers(const AOTModule *module, const uint8 *fp,
+                        const uint8 *stack_bottom, const uint8 *stack_top,
+                        uint32 *func_indexes, uint32 max_count)
+{
+    uint32 count = 0;
+#ifdef AOT_FRAME_RECORD_SUPPORTED
+    const uint8 *next_fp;
+    uintptr_t ret_addr;
+    uint32 func_index;
+
+    if (!(module->feature_flags & AOT_FEATURE_FRAME_POINTER))
+        return 0;
+
+    while (count < max_count && fp >= stack_bottom
+           && ((uintptr_t)fp & (sizeof(uintptr_t) - 1)) == 0
+           && (!stack_top || fp + sizeof(uintptr_t) * 2 <= stack_top)) {
+        ret_addr = ((const uintptr_t *)fp)[1];
+        /* The return address is after the call instruction, the caller
+           outside the AOT code may not keep the frame pointer */
+        if ((func_index = aot_get_func_index_by_code_addr(
+                 module, (const void *)(ret_addr - 1)))
+            == (uint32)-1)
+            break;
+        func_indexes[count++] = func_index;
+
+        next_fp = (const uint8 *)((const uintptr_t *)fp)[0];
+        if (next_fp <= fp)
+            break;
+        fp = next_fp;
+    }
+#else
+    (void)module;
+    (void)fp;
+    (void)stack_bottom;
+    (void)stack_top;
+    (void)func_indexes;
+    (void)max_count;
+#endif
+    return count;
+}
+
+#if WASM_ENABLE_DUMP_CALL_STACK != 0 && defined(AOT_FRAME_RECORD_SUPPORTED) \
+    && defined(__GNUC__)
+#define AOT_NATIVE_FRAME_MAX_COUNT 64
+
+/* Walk the frames of the wasm functions from the native stack when the
+   AOT code compiled with the frame pointers throws an exception, so
+   that the call stack is dumped without the auxiliary frames */
+static void
+capture_native_frames(AOTModuleInstance *module_inst, const uint8 *fp)
+{
+    AOTModule *module = (AOTModule *)module_inst->aot_module.ptr;
+    uint32 func_indexes[AOT_NATIVE_FRAME_MAX_COUNT], count, i;
+    WASMCApiFrame frame = { 0 };
+
+    module_inst->native_frame_count = 0;
+    if (!(count = aot_walk_frame_pointers(module, fp, fp, NULL, func_indexes,
+                                          AOT_NATIVE_FRAME_MAX_COUNT)))
+        return;
+
+    if (!bh_vector_destroy(module_inst->frames.ptr)
+        || !bh_vector_init(module_inst->frames.ptr, count,
+                           sizeof(WASMCApiFrame)))
+        return;
+
+    frame.instance = module_inst;
+    for (i = 0; i < count; i++) {
+        frame.func_index = func_indexes[i];
+        if (!bh_vector_append(module_inst->frames.ptr, &frame)) {
+            bh_vector_destroy(module_inst->frames.ptr);
+            return;
+        }
+    }
+    module_inst->native_frame_count = count;
+}
+#endif
+
 void
 aot_set_exception_with_id(AOTModuleInstance *module_inst,
                           uint32 id)
 {
+#if WASM_ENABLE_DUMP_CALL_STACK != 0 && defined(AOT_FRAME_RECORD_SUPPORTED) \
+    && defined(__GNUC__)
+    /* The caller is the AOT code if it throws the exception */
+    capture_native_frames(module_inst,
+                          (const uint8 *)__builtin_frame_address(0));
+#endif
+
     switch (id) {
         case EXCE_UNREACHABLE:
             aot_set_exception(module_inst, "unreachable");
@@ -1988,7 +2403,7 @@ aot_get_app_addr_range(AOTModuleInstance *module_inst,
                        uint32 *p_app_end_offset)
 {
     AOTMemoryInstance *memory_inst = aot_get_default_memory(module_inst);
-    uint32 memory_data_size;
+    uint64 memory_data_size;
 
     if (!memory_inst) {
         return false;
@@ -2000,7 +2415,9 @@ aot_get_app_addr_range(AOTModuleInstance *module_inst,
         if (p_app_start_offset)
             *p_app_start_offset = 0;
         if (p_app_end_offset)
-            *p_app_end_offset = memory_data_size;
+            /* The app offset is u32, memory64 may be larger than 4GB */
+            *p_app_end_offset = memory_data_size > UINT32_MAX
+                                ? UINT32_MAX : (uint32)memory_data_size;
         return true;
     }
     return false;
@@ -2031,8 +2448,8 @@ aot_get_native_addr_range(AOTModuleInstance *module_inst,
 }
 
 #ifndef OS_ENABLE_HW_BOUND_CHECK
-bool
-aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
+static bool
+enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
 {
     AOTMemoryInstance *memory_inst = aot_get_default_memory(module_inst);
     uint32 num_bytes_per_page, cur_page_count, max_page_count;
@@ -2047,7 +2464,7 @@ aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
     cur_page_count = memory_inst->cur_page_count;
     max_page_count = memory_inst->max_page_count;
     total_page_count = cur_page_count + inc_page_count;
-    total_size_old = memory_inst->memory_data_size;
+    total_size_old = (uint32)memory_inst->memory_data_size;
     total_size = (uint64)num_bytes_per_page * total_page_count;
     heap_size = (uint32)((uint8 *)memory_inst->heap_data_end.ptr
                          - (uint8 *)memory_inst->heap_data.ptr);
@@ -2092,7 +2509,7 @@ aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
            0, (uint32)total_size - total_size_old);
 
     memory_inst->cur_page_count = total_page_count;
-    memory_inst->memory_data_size = (uint32)total_size;
+    memory_inst->memory_data_size = total_size;
     memory_inst->memory_data.ptr = memory_data;
     memory_inst->memory_data_end.ptr = memory_data + total_size;
 
@@ -2126,13 +2543,13 @@ aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
     return true;
 }
 #else /* else of OS_ENABLE_HW_BOUND_CHECK */
-bool
-aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
+static bool
+enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
 {
     AOTMemoryInstance *memory_inst = aot_get_default_memory(module_inst);
     uint32 num_bytes_per_page, cur_page_count, max_page_count;
     uint32 total_page_count;
-    uint64 total_size;
+    uint64 total_size, inc_size;
 
     if (!memory_inst)
         return false;
@@ -2152,31 +2569,29 @@ aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
         return false;
     }
 
+    inc_size = (uint64)num_bytes_per_page * inc_page_count;
+
 #ifdef BH_PLATFORM_WINDOWS
-    if (!os_mem_commit(memory_inst->memory_data_end.ptr,
-                       num_bytes_per_page * inc_page_count,
+    if (!os_mem_commit(memory_inst->memory_data_end.ptr, inc_size,
                        MMAP_PROT_READ | MMAP_PROT_WRITE)) {
         return false;
     }
 #endif
 
-    if (os_mprotect(memory_inst->memory_data_end.ptr,
-                    num_bytes_per_page * inc_page_count,
+    if (os_mprotect(memory_inst->memory_data_end.ptr, inc_size,
                     MMAP_PROT_READ | MMAP_PROT_WRITE) != 0) {
 #ifdef BH_PLATFORM_WINDOWS
-        os_mem_decommit(memory_inst->memory_data_end.ptr,
-                        num_bytes_per_page * inc_page_count);
+        os_mem_decommit(memory_inst->memory_data_end.ptr, inc_size);
 #endif
         return false;
     }
 
-    memset(memory_inst->memory_data_end.ptr, 0,
-           num_bytes_per_page * inc_page_count);
+    memset(memory_inst->memory_data_end.ptr, 0, inc_size);
 
     memory_inst->cur_page_count = total_page_count;
-    memory_inst->memory_data_size = (uint32)total_size;
+    memory_inst->memory_data_size = total_size;
     memory_inst->memory_data_end.ptr = (uint8 *)memory_inst->memory_data.ptr
-                                       + (uint32)total_size;
+                                       + total_size;
 
     if (sizeof(uintptr_t) == sizeof(uint64)) {
         memory_inst->mem_bound_check_1byte.u64 = total_size - 1;
@@ -2196,6 +2611,19 @@ aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
 }
 #endif /* end of OS_ENABLE_HW_BOUND_CHECK */
 
+bool
+aot_enlarge_memory(AOTModuleInstance *module_inst, uint32 inc_page_count)
+{
+#if WASM_ENABLE_USDT != 0
+    AOTMemoryInstance *memory_inst = aot_get_default_memory(module_inst);
+    uint32 cur_page_count = memory_inst ? memory_inst->cur_page_count : 0;
+#endif
+    bool ret = enlarge_memory(module_inst, inc_page_count);
+
+    USDT_PROBE4(memory_grow, module_inst, cur_page_count, inc_page_count, ret);
+    return ret;
+}
+
 bool
 aot_is_wasm_type_equal(AOTModuleInstance *module_inst,
                        uint32 type1_idx, uint32 type2_idx)
@@ -2234,6 +2662,10 @@ aot_invoke_native(WASMExecEnv *exec_env, uint32 func_idx,
     const char *signature;
     void *attachment;
     char buf[128];
+    bool ret;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    uint64 call_begin_ns = 0;
+#endif
 
     bh_assert(func_idx < aot_module->import_func_count);
 
@@ -2246,24 +2678,39 @@ aot_invoke_native(WASMExecEnv *exec_env, uint32 func_idx,
         return false;
     }
 
+    METRICS_INC(host_calls);
+
     attachment = import_func->attachment;
     if (import_func->call_conv_wasm_c_api) {
         return wasm_runtime_invoke_c_api_native(
           (WASMModuleInstanceCommon *)module_inst, func_ptr, func_type, argc,
           argv, import_func->wasm_c_api_with_env, attachment);
     }
-    else if (!import_func->call_conv_raw) {
-        signature = import_func->signature;
-        return wasm_runtime_invoke_native(exec_env, func_ptr,
-                                          func_type, signature, attachment,
-                                          argv, argc, argv);
+
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    if (import_func->call_stats)
+        call_begin_ns = wasm_native_call_stats_now();
+#endif
+
+    signature = import_func->signature;
+    USDT_PROBE2(host_call_begin, exec_env, func_ptr);
+    if (!import_func->call_conv_raw) {
+        ret = wasm_runtime_invoke_native(exec_env, func_ptr,
+                                         func_type, signature, attachment,
+                                         argv, argc, argv);
     }
     else {
-        signature = import_func->signature;
-        return wasm_runtime_invoke_native_raw(exec_env, func_ptr,
-                                              func_type, signature, attachment,
-                                              argv, argc, argv);
+        ret = wasm_runtime_invoke_native_raw(exec_env, func_ptr,
+                                             func_type, signature, attachment,
+                                             argv, argc, argv);
     }
+    USDT_PROBE3(host_call_end, exec_env, func_ptr, ret);
+
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    if (import_func->call_stats)
+        wasm_native_call_stats_add(import_func->call_stats, call_begin_ns);
+#endif
+    return ret;
 }
 
 bool
@@ -2283,7 +2730,11 @@ aot_call_indirect(WASMExecEnv *exec_env,
     const char *signature = NULL;
     void *attachment = NULL;
     char buf[128];
-    bool ret;
+    bool is_import = false, ret;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    WASMNativeCallStats *call_stats = NULL;
+    uint64 call_begin_ns = 0;
+#endif
 
     /* this function is called from native code, so exec_env->handle and
        exec_env->native_stack_boundary must have been set, we don't set
@@ -2325,13 +2776,29 @@ aot_call_indirect(WASMExecEnv *exec_env,
         /* Call native function */
         import_func = aot_module->import_funcs + func_idx;
         signature = import_func->signature;
+        METRICS_INC(host_calls);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        call_stats = import_func->call_stats;
+#endif
         if (import_func->call_conv_raw) {
             attachment = import_func->attachment;
-            return wasm_runtime_invoke_native_raw(exec_env, func_ptr,
-                                                  func_type, signature,
-                                                  attachment,
-                                                  argv, argc, argv);
+            USDT_PROBE2(host_call_begin, exec_env, func_ptr);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+            if (call_stats)
+                call_begin_ns = wasm_native_call_stats_now();
+#endif
+            ret = wasm_runtime_invoke_native_raw(exec_env, func_ptr,
+                                                 func_type, signature,
+                                                 attachment,
+                                                 argv, argc, argv);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+            if (call_stats)
+                wasm_native_call_stats_add(call_stats, call_begin_ns);
+#endif
+            USDT_PROBE3(host_call_end, exec_env, func_ptr, ret);
+            return ret;
         }
+        is_import = true;
     }
 
     ext_ret_count = func_type->result_count > 1
@@ -2368,9 +2835,21 @@ aot_call_indirect(WASMExecEnv *exec_env,
             cell_num += wasm_value_type_cell_num(ext_ret_types[i]);
         }
 
+        if (is_import)
+            USDT_PROBE2(host_call_begin, exec_env, func_ptr);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        if (call_stats)
+            call_begin_ns = wasm_native_call_stats_now();
+#endif
         ret = invoke_native_internal(exec_env, func_ptr,
                                      func_type, signature, attachment,
                                      argv1, argc, argv);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        if (call_stats)
+            wasm_native_call_stats_add(call_stats, call_begin_ns);
+#endif
+        if (is_import)
+            USDT_PROBE3(host_call_end, exec_env, func_ptr, ret);
         if (!ret || aot_get_exception(module_inst)) {
             if (argv1 != argv1_buf)
                 wasm_runtime_free(argv1);
@@ -2412,9 +2891,21 @@ aot_call_indirect(WASMExecEnv *exec_env,
         return true;
     }
     else {
+        if (is_import)
+            USDT_PROBE2(host_call_begin, exec_env, func_ptr);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        if (call_stats)
+            call_begin_ns = wasm_native_call_stats_now();
+#endif
         ret = invoke_native_internal(exec_env, func_ptr,
                                      func_type, signature, attachment,
                                      argv, argc, argv);
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        if (call_stats)
+            wasm_native_call_stats_add(call_stats, call_begin_ns);
+#endif
+        if (is_import)
+            USDT_PROBE3(host_call_end, exec_env, func_ptr, ret);
         if (clear_wasi_proc_exit_exception(module_inst))
             return true;
         return ret;
@@ -2436,7 +2927,7 @@ aot_memset(void *s, int c, size_t n)
 #if WASM_ENABLE_BULK_MEMORY != 0
 bool
 aot_memory_init(AOTModuleInstance *module_inst, uint32 seg_index,
-                uint32 offset, uint32 len, uint32 dst)
+                uint32 offset, uint32 len, uint64 dst)
 {
     AOTMemoryInstance *memory_inst = aot_get_default_memory(module_inst);
     AOTModule *aot_module;
@@ -2455,39 +2946,35 @@ aot_memory_init(AOTModuleInstance *module_inst, uint32 seg_index,
         seg_len = aot_module->mem_init_data_list[seg_index]->byte_count;
         data = aot_module->mem_init_data_list[seg_index]->bytes;
     }
+    /* A dropped segment is treated as an empty segment */
+    if (((bool *)module_inst->seg_dropped.ptr)[seg_index])
+        seg_len = 0;
 
-    if (!aot_validate_app_addr(module_inst, dst, len))
+    /* The dst of memory64 may be larger than 4GB */
+    if (!memory_inst || dst > memory_inst->memory_data_size
+        || len > memory_inst->memory_data_size - dst) {
+        aot_set_exception(module_inst, "out of bounds memory access");
         return false;
+    }
 
     if ((uint64)offset + (uint64)len > seg_len) {
         aot_set_exception(module_inst, "out of bounds memory access");
         return false;
     }
 
-    maddr = aot_addr_app_to_native(module_inst, dst);
+    maddr = (uint8 *)memory_inst->memory_data.ptr + dst;
 
-    bh_memcpy_s(maddr, memory_inst->memory_data_size - dst,
-                data + offset, len);
+    bh_memcpy_s(maddr, len, data + offset, len);
     return true;
 }
 
 bool
 aot_data_drop(AOTModuleInstance *module_inst, uint32 seg_index)
 {
-    AOTModule *aot_module = (AOTModule *)(module_inst->aot_module.ptr);
-
-    if (aot_module->is_jit_mode) {
-#if WASM_ENABLE_JIT != 0
-        aot_module->wasm_module->data_segments[seg_index]->data_length = 0;
-        /* Currently we can't free the dropped data segment
-            as they are stored in wasm bytecode */
-#endif
-    }
-    else {
-        aot_module->mem_init_data_list[seg_index]->byte_count = 0;
-        /* Currently we can't free the dropped data segment
-            as the mem_init_data_count is a continuous array */
-    }
+    /* Only mark the segment of this instance as dropped, currently we
+       can't free the dropped data segment as it is shared by all the
+       instances of the module */
+    ((bool *)module_inst->seg_dropped.ptr)[seg_index] = true;
     return true;
 }
 #endif /* WASM_ENABLE_BULK_MEMORY */
@@ -2591,6 +3078,11 @@ aot_get_module_mem_consumption(const AOTModule *module,
     /* func_ptrs and func_type_indexes */
     mem_conspn->functions_size =
         (sizeof(void *) + sizeof(uint32)) * module->func_count;
+#ifdef AOT_FUNC_CODE_RANGES_ENABLED
+    if (module->func_code_ranges)
+        mem_conspn->functions_size +=
+            sizeof(AOTFuncCodeRange) * module->func_count;
+#endif
 
     mem_conspn->tables_size = sizeof(AOTTable) * module->table_count;
 
@@ -2705,8 +3197,9 @@ void
 aot_drop_table_seg(AOTModuleInstance *module_inst, uint32 tbl_seg_idx)
 {
     AOTModule *module = (AOTModule *)module_inst->aot_module.ptr;
-    AOTTableInitData *tbl_seg = module->table_init_data_list[tbl_seg_idx];
-    tbl_seg->is_dropped = true;
+
+    ((bool *)module_inst->seg_dropped.ptr)[module->mem_init_data_count
+                                           + tbl_seg_idx] = true;
 }
 
 void
@@ -2735,7 +3228,8 @@ aot_table_init(AOTModuleInstance *module_inst,
         return;
     }
 
-    if (tbl_seg->is_dropped) {
+    if (((bool *)module_inst->seg_dropped.ptr)[module->mem_init_data_count
+                                               + tbl_seg_idx]) {
         aot_set_exception_with_id(module_inst,
                                   EXCE_OUT_OF_BOUNDS_TABLE_ACCESS);
         return;
@@ -2914,6 +3408,34 @@ aot_free_frame(WASMExecEnv *exec_env)
                  || (WASM_ENABLE_PERF_PROFILING != 0) */
 
 #if WASM_ENABLE_DUMP_CALL_STACK != 0
+/* Dump the frames captured when the exception was thrown */
+static void
+dump_native_frames(AOTModuleInstance *module_inst)
+{
+    WASMCApiFrame frame;
+    const char *func_name;
+    uint32 n;
+
+    os_printf("\n");
+    for (n = 0; n < module_inst->native_frame_count; n++) {
+        if (!bh_vector_get(module_inst->frames.ptr, n, &frame))
+            break;
+        func_name = get_func_name_from_index(module_inst, frame.func_index);
+
+        /* function name not exported, print number instead */
+        if (func_name == NULL) {
+            os_printf("#%02d $f%d \n", n, frame.func_index);
+        }
+        else {
+            os_printf("#%02d %s \n", n, func_name);
+        }
+    }
+    os_printf("\n");
+
+    /* The frames are kept for wasm_trap_trace */
+    module_inst->native_frame_count = 0;
+}
+
 void
 aot_dump_call_stack(WASMExecEnv *exec_env)
 {
@@ -2924,6 +3446,11 @@ aot_dump_call_stack(WASMExecEnv *exec_env)
     const char *func_name;
     uint32 n = 0;
 
+    if (module_inst->native_frame_count > 0) {
+        dump_native_frames(module_inst);
+        return;
+    }
+
     os_printf("\n");
     while (cur_frame) {
         func_name =
@@ -2993,3 +3520,85 @@ aot_dump_perf_profiling(const AOTModuleInstance *module_inst)
 }
 #endif /* end of WASM_ENABLE_PERF_PROFILING */
 
+#if WASM_ENABLE_STATIC_PGO != 0
+void
+aot_pgo_record_call_target(uint64 *site_counters, uint32 func_idx)
+{
+    uint64 target = (uint64)func_idx + 1;
+    uint32 i;
+
+    for (i = 0; i < AOT_PGO_INDIRECT_TARGET_NUM; i++) {
+        if (site_counters[i * 2] == target) {
+            site_counters[i * 2 + 1]++;
+            return;
+        }
+        if (site_counters[i * 2] == 0) {
+            site_counters[i * 2] = target;
+            site_counters[i * 2 + 1] = 1;
+            return;
+        }
+    }
+
+    /* All the slots are taken by other targets */
+    site_counters[AOT_PGO_INDIRECT_TARGET_NUM * 2]++;
+}
+
+static uint64 *
+get_pgo_prof_data(const AOTModuleInstance *module_inst, uint32 *p_size)
+{
+    AOTModule *module = (AOTModule *)module_inst->aot_module.ptr;
+    AOTObjectDataSection *data_section = module->data_sections;
+    uint64 *data, size;
+    uint32 i, j;
+
+    for (i = 0; i < module->data_section_count; i++, data_section++) {
+        if (strcmp(data_section->name, ".data"))
+            continue;
+
+        data = (uint64 *)data_section->data;
+        for (j = 0; (uint64)(j + AOT_PGO_HEADER_COUNT) * sizeof(uint64)
+                    <= data_section->size; j++) {
+            if (data[j] != AOT_PGO_MAGIC || data[j + 1] != AOT_PGO_VERSION
+                || data[j + 3] > UINT32_MAX)
+                continue;
+            size = (data[j + 3] + AOT_PGO_HEADER_COUNT) * sizeof(uint64);
+            if (size > data_section->size - j * sizeof(uint64))
+                return NULL;
+            *p_size = (uint32)size;
+            return data + j;
+        }
+    }
+
+    return NULL;
+}
+
+uint32
+aot_get_pgo_prof_data_size(const AOTModuleInstance *module_inst)
+{
+    uint32 size = 0;
+
+    get_pgo_prof_data(module_inst, &size);
+    return size;
+}
+
+uint32
+aot_dump_pgo_prof_data_to_buf(const AOTModuleInstance *module_inst,
+                              char *buf, uint32 len)
+{
+    uint64 *data;
+    uint32 size = 0;
+
+    if (!(data = get_pgo_prof_data(module_inst, &size))) {
+        LOG_ERROR("the module isn't compiled with --enable-pgo-instrument");
+        return 0;
+    }
+
+    if (len < size) {
+        LOG_ERROR("buffer is too small to dump the profile data");
+        return 0;
+    }
+
+    bh_memcpy_s(buf, len, data, size);
+    return size;
+}
+#endif /* end of WASM_ENABLE_STATIC_PGO */
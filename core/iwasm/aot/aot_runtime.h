@@ -45,9 +45,72 @@ typedef enum AOTSectionType {
     AOT_SECTION_TYPE_FUNCTION,
     AOT_SECTION_TYPE_EXPORT,
     AOT_SECTION_TYPE_RELOCATION,
-    AOT_SECTION_TYPE_SIGANATURE
+    AOT_SECTION_TYPE_SIGANATURE,
+    /* The only section of a fat AOT file */
+    AOT_SECTION_TYPE_CPU_VARIANTS
 } AOTSectionType;
 
+/* Layout of the fat AOT file generated by wamrc --cpu-variants: the AOT
+   file header followed by the AOT_SECTION_TYPE_CPU_VARIANTS section,
+   whose body is the variant count and then, for each variant, the
+   AOT_CPU_FEATURE_* flags its code requires, its size and the AOT file
+   compiled for it, aligned to 4 bytes. The loader loads the variant
+   requiring the most features among those supported by the CPU. */
+#define AOT_CPU_VARIANT_MAX_NUM 8
+
+#define AOT_CPU_FEATURE_SSSE3 0x1
+#define AOT_CPU_FEATURE_SSE4_1 0x2
+#define AOT_CPU_FEATURE_SSE4_2 0x4
+#define AOT_CPU_FEATURE_POPCNT 0x8
+#define AOT_CPU_FEATURE_AVX 0x10
+#define AOT_CPU_FEATURE_AVX2 0x20
+#define AOT_CPU_FEATURE_FMA 0x40
+#define AOT_CPU_FEATURE_F16C 0x80
+#define AOT_CPU_FEATURE_BMI 0x100
+#define AOT_CPU_FEATURE_BMI2 0x200
+#define AOT_CPU_FEATURE_LZCNT 0x400
+#define AOT_CPU_FEATURE_MOVBE 0x800
+#define AOT_CPU_FEATURE_AVX512F 0x1000
+#define AOT_CPU_FEATURE_AVX512CD 0x2000
+#define AOT_CPU_FEATURE_AVX512BW 0x4000
+#define AOT_CPU_FEATURE_AVX512DQ 0x8000
+#define AOT_CPU_FEATURE_AVX512VL 0x10000
+#define AOT_CPU_FEATURE_AVX512VBMI 0x20000
+#define AOT_CPU_FEATURE_AVX512VNNI 0x40000
+
+/* Feature flags of the AOT code in the target info section */
+/* The functions keep the frame pointer, the callers of the native
+   frames can be walked with the frame records */
+#define AOT_FEATURE_FRAME_POINTER 0x1
+
+/* Whether the frame pointer of the target points to the frame record
+   {previous frame pointer, return address} */
+#if defined(BUILD_TARGET_X86_64) || defined(BUILD_TARGET_AMD_64) \
+    || defined(BUILD_TARGET_X86_32) || defined(BUILD_TARGET_AARCH64)
+#define AOT_FRAME_RECORD_SUPPORTED 1
+#endif
+
+/* Whether the functions are sorted by the code address at load time,
+   to look up the function of a native code address */
+#if WASM_ENABLE_DUMP_CALL_STACK != 0 || WASM_ENABLE_SAMPLING_PROFILER != 0 \
+    || WASM_ENABLE_LINUX_PERF != 0
+#define AOT_FUNC_CODE_RANGES_ENABLED 1
+#endif
+
+/* Layout of the profile data of an AOT module compiled by
+   wamrc --enable-pgo-instrument. It is an array of uint64 placed in the
+   ".data" section: a header of AOT_PGO_HEADER_COUNT items (magic, version,
+   hash of the wasm function bodies, counter count) followed by the
+   counters, in the order the compiler visits the instrumented sites:
+   one counter per function entry, two (taken, not taken) per if and
+   br_if, and AOT_PGO_INDIRECT_TARGET_NUM (target index + 1, count) pairs
+   plus an overflow counter per call_indirect. */
+#define AOT_PGO_MAGIC 0x4F47505F524D4157ULL /* "WAMR_PGO" */
+#define AOT_PGO_VERSION 1
+#define AOT_PGO_HEADER_COUNT 4
+#define AOT_PGO_INDIRECT_TARGET_NUM 4
+#define AOT_PGO_INDIRECT_SITE_COUNT (AOT_PGO_INDIRECT_TARGET_NUM * 2 + 1)
+
 typedef struct AOTObjectDataSection {
     char *name;
     uint8 *data;
@@ -110,6 +173,13 @@ typedef struct AOTUnwindInfo {
 #define PLT_ITEM_SIZE 12
 #endif
 
+typedef struct AOTFuncCodeRange {
+    /* the code address, with bits[0] of thumb function cleared */
+    uint8 *code;
+    /* the function index, not including the imported functions */
+    uint32 func_index;
+} AOTFuncCodeRange;
+
 typedef struct AOTModule {
     uint32 module_type;
 
@@ -162,6 +232,11 @@ typedef struct AOTModule {
     void **func_ptrs;
     /* function type indexes */
     uint32 *func_type_indexes;
+#ifdef AOT_FUNC_CODE_RANGES_ENABLED
+    /* the functions sorted by the code address, the code of a function
+       ends at the next function, NULL for JIT mode */
+    AOTFuncCodeRange *func_code_ranges;
+#endif
 
     /* export info */
     uint32 export_count;
@@ -231,6 +306,9 @@ typedef struct AOTModule {
     /* auxiliary stack size resolved */
     uint32 aux_stack_size;
 
+    /* features of the AOT code, AOT_FEATURE_XXX */
+    uint32 feature_flags;
+
     /* is jit mode or not */
     bool is_jit_mode;
 
@@ -251,6 +329,11 @@ typedef union {
     void *ptr;
 } AOTPointer;
 
+/* Size of the guard region reserved after the max pages of memory64,
+   the AOT code only checks the address against the max size when the
+   memarg offset and the access size are inside the guard region */
+#define AOT_MEMORY64_GUARD_SIZE (4 * (uint64)BH_GB)
+
 typedef union {
     uint64 u64;
     uint32 u32[2];
@@ -260,12 +343,17 @@ typedef struct AOTMemoryInstance {
     uint32 module_type;
     /* shared memory flag */
     bool is_shared;
+    /* memory64 flag, the max pages and a guard region are reserved
+       when the hardware bound check is enabled */
+    bool is_memory64;
 
     /* memory space info */
     uint32 num_bytes_per_page;
     uint32 cur_page_count;
     uint32 max_page_count;
-    uint32 memory_data_size;
+    /* make memory_data_size 8-byte aligned on 32-bit targets too */
+    uint32 _padding;
+    uint64 memory_data_size;
     AOTPointer memory_data;
     AOTPointer memory_data_end;
 
@@ -356,8 +444,15 @@ typedef struct AOTModuleInstance {
     uint32 _padding;
     /* store stacktrace information */
     AOTPointer frames;
+    /* count of the frames walked from the native stack when the AOT
+       code threw the exception, stored in frames */
+    uint32 native_frame_count;
+    uint32 _padding2;
+    /* whether each segment was dropped by data.drop or elem.drop, the
+       flags of the data segments are followed by the table segments */
+    AOTPointer seg_dropped;
     /* reserved */
-    uint32 reserved[6];
+    uint32 reserved[2];
 
    /*
     * +------------------------------+ <-- memories.ptr
@@ -389,8 +484,8 @@ typedef struct AOTTargetInfo {
     uint32 e_version;
     /* Processor-specific flags */
     uint32 e_flags;
-    /* Reserved */
-    uint32 reserved;
+    /* Features of the AOT code, AOT_FEATURE_XXX */
+    uint32 feature_flags;
     /* Arch name */
     char arch[16];
 } AOTTargetInfo;
@@ -490,6 +585,21 @@ aot_instantiate(AOTModule *module, bool is_sub_inst,
 void
 aot_deinstantiate(AOTModuleInstance *module_inst, bool is_sub_inst);
 
+#if WASM_ENABLE_INSTANCE_POOL != 0
+/**
+ * Reset an AOT module instance to the state right after instantiation.
+ *
+ * @param module_inst the AOT module instance to reset
+ * @param error_buf output of the error info
+ * @param error_buf_size the size of the error string
+ *
+ * @return true if success, false otherwise
+ */
+bool
+aot_reset_instance(AOTModuleInstance *module_inst,
+                   char *error_buf, uint32 error_buf_size);
+#endif
+
 /**
  * Lookup an exported function in the AOT module instance.
  *
@@ -646,7 +756,7 @@ aot_memset(void *s, int c, size_t n);
 #if WASM_ENABLE_BULK_MEMORY != 0
 bool
 aot_memory_init(AOTModuleInstance *module_inst, uint32 seg_index,
-                uint32 offset, uint32 len, uint32 dst);
+                uint32 offset, uint32 len, uint64 dst);
 
 bool
 aot_data_drop(AOTModuleInstance *module_inst, uint32 seg_index);
@@ -713,9 +823,56 @@ aot_free_frame(WASMExecEnv *exec_env);
 void
 aot_dump_call_stack(WASMExecEnv *exec_env);
 
+/**
+ * Get the index of the function whose code contains the address.
+ *
+ * @param module the AOT module
+ * @param addr the code address
+ *
+ * @return the function index including the imported functions,
+ *         or (uint32)-1 if the address isn't in the AOT code or the
+ *         functions aren't sorted by the code address at load time
+ */
+uint32
+aot_get_func_index_by_code_addr(const AOTModule *module, const void *addr);
+
+/**
+ * Walk the frame records of the AOT code compiled with
+ * wamrc --enable-frame-pointer, the walk stops at the first return
+ * address outside the AOT code. It doesn't allocate or lock, so it
+ * can be called in a signal handler.
+ *
+ * @param module the AOT module
+ * @param fp the frame pointer of the innermost frame to walk
+ * @param stack_bottom the lowest address of the frame records
+ * @param stack_top the address above the frame records, NULL if the
+ *        frame records are known to be valid
+ * @param func_indexes output of the function indexes of the callers,
+ *        the innermost first
+ * @param max_count the max count of the function indexes to output
+ *
+ * @return the count of the function indexes output
+ */
+uint32
+aot_walk_frame_pointers(const AOTModule *module, const uint8 *fp,
+                        const uint8 *stack_bottom, const uint8 *stack_top,
+                        uint32 *func_indexes, uint32 max_count);
+
 void
 aot_dump_perf_profiling(const AOTModuleInstance *module_inst);
 
+#if WASM_ENABLE_STATIC_PGO != 0
+void
+aot_pgo_record_call_target(uint64 *site_counters, uint32 func_idx);
+
+uint32
+aot_get_pgo_prof_data_size(const AOTModuleInstance *module_inst);
+
+uint32
+aot_dump_pgo_prof_data_to_buf(const AOTModuleInstance *module_inst,
+                              char *buf, uint32 len);
+#endif
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
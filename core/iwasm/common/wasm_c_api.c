@@ -3278,6 +3278,10 @@ interp_link_func(const wasm_instance_t *inst,
 
     imported_func_interp->u.function.call_conv_wasm_c_api = true;
     imported_func_interp->u.function.wasm_c_api_with_env = import->with_env;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    /* the callback isn't a registered native symbol */
+    imported_func_interp->u.function.call_stats = NULL;
+#endif
     if (import->with_env) {
         imported_func_interp->u.function.func_ptr_linked = import->u.cb_env.cb;
         imported_func_interp->u.function.attachment = import->u.cb_env.env;
@@ -3501,6 +3505,10 @@ aot_link_func(const wasm_instance_t *inst,
 
     import_aot_func->call_conv_wasm_c_api = true;
     import_aot_func->wasm_c_api_with_env = import->with_env;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    /* the callback isn't a registered native symbol */
+    import_aot_func->call_stats = NULL;
+#endif
     if (import->with_env) {
         import_aot_func->func_ptr_linked = import->u.cb_env.cb;
         import_aot_func->attachment = import->u.cb_env.env;
@@ -5,6 +5,7 @@
 
 #include "wasm_exec_env.h"
 #include "wasm_runtime_common.h"
+#include "wasm_metrics.h"
 #if WASM_ENABLE_INTERP != 0
 #include "../interpreter/wasm_runtime.h"
 #endif
@@ -16,6 +17,75 @@
 #include "../libraries/thread-mgr/thread_manager.h"
 #endif
 
+/**
+ * Allocate the exec env, the size of its accessible part is
+ * returned with p_commit_size.
+ */
+static WASMExecEnv *
+exec_env_alloc(uint32 total_size, uint32 *p_commit_size)
+{
+    WASMExecEnv *exec_env;
+#if WASM_STACK_USE_MMAP != 0
+    uint32 page_size = os_getpagesize();
+    uint64 map_size, commit_size;
+
+    if (total_size - offsetof(WASMExecEnv, wasm_stack.s.bottom)
+        >= WASM_STACK_MMAP_THRESHOLD) {
+        /* Reserve the whole WASM stack and a guard page after it */
+        map_size = ((uint64)total_size + page_size - 1) & ~(page_size - 1);
+        map_size += page_size;
+
+        if (!(exec_env = os_mmap(NULL, map_size, MMAP_PROT_NONE,
+                                 MMAP_MAP_NONE)))
+            return NULL;
+
+        /* Only make the head of the WASM stack accessible, the stack is
+           enlarged on demand by wasm_exec_env_grow_wasm_stack() */
+        commit_size = offsetof(WASMExecEnv, wasm_stack.s.bottom)
+                      + (uint64)WASM_STACK_INIT_COMMIT_SIZE;
+        commit_size = (commit_size + page_size - 1) & ~(page_size - 1);
+        if (commit_size > map_size - page_size)
+            commit_size = map_size - page_size;
+
+        if (os_mprotect(exec_env, commit_size,
+                        MMAP_PROT_READ | MMAP_PROT_WRITE) != 0) {
+            os_munmap(exec_env, map_size);
+            return NULL;
+        }
+
+        /* The mapping is zero filled, don't touch the stack pages
+           so that they are committed only when they are used */
+        exec_env->is_mmapped = true;
+        *p_commit_size = (uint32)commit_size;
+        return exec_env;
+    }
+#endif
+
+    if (!(exec_env = wasm_runtime_malloc(total_size)))
+        return NULL;
+
+    memset(exec_env, 0, total_size);
+    *p_commit_size = total_size;
+    return exec_env;
+}
+
+static void
+exec_env_free(WASMExecEnv *exec_env)
+{
+#if WASM_STACK_USE_MMAP != 0
+    if (exec_env->is_mmapped) {
+        uint32 page_size = os_getpagesize();
+        uint64 map_size = offsetof(WASMExecEnv, wasm_stack.s.bottom)
+                          + (uint64)exec_env->wasm_stack_size;
+
+        map_size = (map_size + page_size - 1) & ~(page_size - 1);
+        os_munmap(exec_env, map_size + page_size);
+        return;
+    }
+#endif
+    wasm_runtime_free(exec_env);
+}
+
 WASMExecEnv *
 wasm_exec_env_create_internal(struct WASMModuleInstanceCommon *module_inst,
                               uint32 stack_size)
@@ -23,12 +93,13 @@ wasm_exec_env_create_internal(struct WASMModuleInstanceCommon *module_inst,
     uint64 total_size = offsetof(WASMExecEnv, wasm_stack.s.bottom)
                         + (uint64)stack_size;
     WASMExecEnv *exec_env;
+    uint32 commit_size;
 
     if (total_size >= UINT32_MAX
-        || !(exec_env = wasm_runtime_malloc((uint32)total_size)))
+        || !(exec_env = exec_env_alloc((uint32)total_size, &commit_size)))
         return NULL;
 
-    memset(exec_env, 0, (uint32)total_size);
+    exec_env->wasm_stack_size = stack_size;
 
 #if WASM_ENABLE_AOT != 0
     if (!(exec_env->argv_buf = wasm_runtime_malloc(sizeof(uint32) * 64))) {
@@ -45,14 +116,15 @@ wasm_exec_env_create_internal(struct WASMModuleInstanceCommon *module_inst,
 #endif
 
     exec_env->module_inst = module_inst;
-    exec_env->wasm_stack_size = stack_size;
-    exec_env->wasm_stack.s.top_boundary =
-        exec_env->wasm_stack.s.bottom + stack_size;
+    exec_env->wasm_stack.s.top_boundary = commit_size < total_size
+        ? (uint8*)exec_env + commit_size
+        : exec_env->wasm_stack.s.bottom + stack_size;
     exec_env->wasm_stack.s.top = exec_env->wasm_stack.s.bottom;
 
 #if WASM_ENABLE_MEMORY_TRACING != 0
     wasm_runtime_dump_exec_env_mem_consumption(exec_env);
 #endif
+    METRICS_INC(exec_envs_created);
     return exec_env;
 
 #if WASM_ENABLE_THREAD_MGR != 0
@@ -64,7 +136,7 @@ fail2:
     wasm_runtime_free(exec_env->argv_buf);
 fail1:
 #endif
-    wasm_runtime_free(exec_env);
+    exec_env_free(exec_env);
     return NULL;
 }
 
@@ -78,7 +150,8 @@ wasm_exec_env_destroy_internal(WASMExecEnv *exec_env)
 #if WASM_ENABLE_AOT != 0
     wasm_runtime_free(exec_env->argv_buf);
 #endif
-    wasm_runtime_free(exec_env);
+    exec_env_free(exec_env);
+    METRICS_INC(exec_envs_destroyed);
 }
 
 WASMExecEnv *
@@ -137,6 +210,43 @@ wasm_exec_env_destroy(WASMExecEnv *exec_env)
     wasm_exec_env_destroy_internal(exec_env);
 }
 
+#if WASM_STACK_USE_MMAP != 0
+bool
+wasm_exec_env_grow_wasm_stack(WASMExecEnv *exec_env, uint32 size)
+{
+    uint8 *top_boundary = exec_env->wasm_stack.s.top_boundary;
+    uint8 *stack_end = exec_env->wasm_stack.s.bottom
+                       + exec_env->wasm_stack_size;
+    uint64 page_size = os_getpagesize();
+    uint64 commit_size, max_commit_size, required_size;
+
+    if (!exec_env->is_mmapped
+        || exec_env->wasm_stack.s.top + size > stack_end)
+        /* Reach the max size of the WASM stack */
+        return false;
+
+    /* Double the committed size to reduce the count of mprotect calls,
+       the committed part always starts from the exec env */
+    commit_size = (uint64)(top_boundary - (uint8*)exec_env) * 2;
+    required_size = (uint64)(exec_env->wasm_stack.s.top + size
+                             - (uint8*)exec_env);
+    max_commit_size = (uint64)(stack_end - (uint8*)exec_env);
+    if (commit_size < required_size)
+        commit_size = required_size;
+    commit_size = (commit_size + page_size - 1) & ~(page_size - 1);
+    if (commit_size > max_commit_size)
+        commit_size = max_commit_size;
+
+    if (os_mprotect(top_boundary,
+                    commit_size - (uint64)(top_boundary - (uint8*)exec_env),
+                    MMAP_PROT_READ | MMAP_PROT_WRITE) != 0)
+        return false;
+
+    exec_env->wasm_stack.s.top_boundary = (uint8*)exec_env + commit_size;
+    return true;
+}
+#endif
+
 WASMModuleInstanceCommon *
 wasm_exec_env_get_module_inst(WASMExecEnv *exec_env)
 {
@@ -187,3 +297,196 @@ wasm_exec_env_pop_jmpbuf(WASMExecEnv *exec_env)
 }
 #endif
 
+
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+typedef struct ExecEnvCache {
+    struct ExecEnvCache *next;
+    /* The cache is mainly accessed by its owner thread, the lock is to
+       sync with the thread which deinstantiates a module instance */
+    korp_mutex lock;
+    uint32 count;
+    WASMExecEnv *exec_envs[WASM_EXEC_ENV_CACHE_SIZE];
+} ExecEnvCache;
+
+/* The caches of all threads */
+static ExecEnvCache *exec_env_cache_list;
+static korp_mutex exec_env_cache_list_lock;
+/* Increased when the runtime is destroyed, the cache kept by
+   a thread with a different generation has been freed */
+static uint32 exec_env_cache_generation;
+
+static os_thread_local_attribute ExecEnvCache *exec_env_cache;
+static os_thread_local_attribute uint32 exec_env_cache_gen;
+
+bool
+wasm_exec_env_cache_init()
+{
+    if (os_mutex_init(&exec_env_cache_list_lock) != 0)
+        return false;
+
+    exec_env_cache_list = NULL;
+    return true;
+}
+
+static void
+exec_env_cache_free(ExecEnvCache *cache)
+{
+    uint32 i;
+
+    for (i = 0; i < cache->count; i++)
+        wasm_exec_env_destroy(cache->exec_envs[i]);
+    os_mutex_destroy(&cache->lock);
+    wasm_runtime_free(cache);
+}
+
+void
+wasm_exec_env_cache_destroy()
+{
+    ExecEnvCache *cache, *next;
+
+    os_mutex_lock(&exec_env_cache_list_lock);
+    cache = exec_env_cache_list;
+    while (cache) {
+        next = cache->next;
+        exec_env_cache_free(cache);
+        cache = next;
+    }
+    exec_env_cache_list = NULL;
+    exec_env_cache_generation++;
+    os_mutex_unlock(&exec_env_cache_list_lock);
+
+    os_mutex_destroy(&exec_env_cache_list_lock);
+}
+
+static ExecEnvCache *
+get_thread_cache(bool create)
+{
+    ExecEnvCache *cache = exec_env_cache;
+
+    if (cache && exec_env_cache_gen == exec_env_cache_generation)
+        return cache;
+
+    exec_env_cache = NULL;
+    if (!create)
+        return NULL;
+
+    if (!(cache = wasm_runtime_malloc(sizeof(ExecEnvCache))))
+        return NULL;
+
+    memset(cache, 0, sizeof(ExecEnvCache));
+    if (os_mutex_init(&cache->lock) != 0) {
+        wasm_runtime_free(cache);
+        return NULL;
+    }
+
+    os_mutex_lock(&exec_env_cache_list_lock);
+    cache->next = exec_env_cache_list;
+    exec_env_cache_list = cache;
+    os_mutex_unlock(&exec_env_cache_list_lock);
+
+    exec_env_cache = cache;
+    exec_env_cache_gen = exec_env_cache_generation;
+    return cache;
+}
+
+WASMExecEnv *
+wasm_exec_env_cache_get(struct WASMModuleInstanceCommon *module_inst,
+                        uint32 stack_size)
+{
+    ExecEnvCache *cache = get_thread_cache(false);
+    WASMExecEnv *exec_env = NULL;
+    uint32 i;
+
+    if (!cache)
+        return NULL;
+
+    os_mutex_lock(&cache->lock);
+    for (i = 0; i < cache->count; i++) {
+        if (cache->exec_envs[i]->module_inst == module_inst
+            && cache->exec_envs[i]->wasm_stack_size == stack_size) {
+            exec_env = cache->exec_envs[i];
+            cache->exec_envs[i] = cache->exec_envs[--cache->count];
+            break;
+        }
+    }
+    os_mutex_unlock(&cache->lock);
+
+    if (exec_env) {
+        exec_env->attachment = NULL;
+        exec_env->user_data = NULL;
+        exec_env->cur_frame = NULL;
+        exec_env->suspend_flags.flags = 0;
+        exec_env->wasm_stack.s.top = exec_env->wasm_stack.s.bottom;
+    }
+    return exec_env;
+}
+
+bool
+wasm_exec_env_cache_put(WASMExecEnv *exec_env)
+{
+    ExecEnvCache *cache = get_thread_cache(true);
+    bool ret = false;
+#if WASM_ENABLE_THREAD_MGR != 0
+    WASMCluster *cluster;
+#endif
+
+    if (!cache)
+        return false;
+
+    os_mutex_lock(&cache->lock);
+    if (cache->count < WASM_EXEC_ENV_CACHE_SIZE) {
+#if WASM_ENABLE_THREAD_MGR != 0
+        /* Terminate all sub-threads as wasm_exec_env_destroy does,
+           the exec env is kept in its own cluster */
+        if ((cluster = wasm_exec_env_get_cluster(exec_env)))
+            wasm_cluster_terminate_all_except_self(cluster, exec_env);
+#endif
+        cache->exec_envs[cache->count++] = exec_env;
+        ret = true;
+    }
+    os_mutex_unlock(&cache->lock);
+    return ret;
+}
+
+void
+wasm_exec_env_cache_flush()
+{
+    ExecEnvCache *cache = get_thread_cache(false), **p_cache;
+
+    if (!cache)
+        return;
+
+    os_mutex_lock(&exec_env_cache_list_lock);
+    p_cache = &exec_env_cache_list;
+    while (*p_cache != cache)
+        p_cache = &(*p_cache)->next;
+    *p_cache = cache->next;
+    os_mutex_unlock(&exec_env_cache_list_lock);
+
+    exec_env_cache_free(cache);
+    exec_env_cache = NULL;
+}
+
+void
+wasm_exec_env_cache_remove_module_inst(
+    struct WASMModuleInstanceCommon *module_inst)
+{
+    ExecEnvCache *cache;
+    uint32 i;
+
+    os_mutex_lock(&exec_env_cache_list_lock);
+    for (cache = exec_env_cache_list; cache; cache = cache->next) {
+        os_mutex_lock(&cache->lock);
+        for (i = 0; i < cache->count;) {
+            if (cache->exec_envs[i]->module_inst == module_inst) {
+                wasm_exec_env_destroy(cache->exec_envs[i]);
+                cache->exec_envs[i] = cache->exec_envs[--cache->count];
+            }
+            else
+                i++;
+        }
+        os_mutex_unlock(&cache->lock);
+    }
+    os_mutex_unlock(&exec_env_cache_list_lock);
+}
+#endif /* end of WASM_ENABLE_EXEC_ENV_CACHE */
@@ -22,6 +22,15 @@ struct WASMInterpFrame;
 typedef struct WASMCluster WASMCluster;
 #endif
 
+#if WASM_STACK_MMAP_THRESHOLD > 0 \
+    && (defined(BH_PLATFORM_LINUX) || defined(BH_PLATFORM_DARWIN) \
+        || defined(BH_PLATFORM_ANDROID))
+/* The pages of an anonymous mapping are committed on first touch */
+#define WASM_STACK_USE_MMAP 1
+#else
+#define WASM_STACK_USE_MMAP 0
+#endif
+
 #ifdef OS_ENABLE_HW_BOUND_CHECK
 typedef struct WASMJmpBuf {
     struct WASMJmpBuf *prev;
@@ -124,10 +133,17 @@ typedef struct WASMExecEnv {
     uint32 max_wasm_stack_used;
 #endif
 
+#if WASM_STACK_USE_MMAP != 0
+    /* Whether the exec env is allocated with os_mmap */
+    bool is_mmapped;
+#endif
+
     /* The WASM stack size */
     uint32 wasm_stack_size;
 
-    /* The WASM stack of current thread */
+    /* The WASM stack of current thread, top_boundary is less than
+       bottom + wasm_stack_size if only part of the WASM stack is
+       accessible, see wasm_exec_env_grow_wasm_stack() */
     union {
         uint64 __make_it_8_byte_aligned_;
 
@@ -158,6 +174,58 @@ wasm_exec_env_create(struct WASMModuleInstanceCommon *module_inst,
 void
 wasm_exec_env_destroy(WASMExecEnv *exec_env);
 
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+bool
+wasm_exec_env_cache_init();
+
+void
+wasm_exec_env_cache_destroy();
+
+/**
+ * Get an exec env of the module instance with the stack size from the
+ * cache of current thread.
+ *
+ * @return the exec env cached, NULL if not found
+ */
+WASMExecEnv *
+wasm_exec_env_cache_get(struct WASMModuleInstanceCommon *module_inst,
+                        uint32 stack_size);
+
+/**
+ * Put the exec env into the cache of current thread.
+ *
+ * @return true if success, false if the cache is full
+ */
+bool
+wasm_exec_env_cache_put(WASMExecEnv *exec_env);
+
+/**
+ * Destroy the exec envs cached by current thread.
+ */
+void
+wasm_exec_env_cache_flush();
+
+/**
+ * Destroy the exec envs of the module instance cached by all threads.
+ */
+void
+wasm_exec_env_cache_remove_module_inst(
+    struct WASMModuleInstanceCommon *module_inst);
+#endif
+
+#if WASM_STACK_USE_MMAP != 0
+/**
+ * Make more pages of the reserved WASM stack accessible.
+ *
+ * @param exec_env the current execution environment
+ * @param size the size required above the current stack top
+ *
+ * @return true if success, false if the WASM stack can't be enlarged
+ */
+bool
+wasm_exec_env_grow_wasm_stack(WASMExecEnv *exec_env, uint32 size);
+#endif
+
 /**
  * Allocate a WASM frame from the WASM stack.
  *
@@ -176,7 +244,11 @@ wasm_exec_env_alloc_wasm_frame(WASMExecEnv *exec_env, unsigned size)
 
     /* The outs area size cannot be larger than the frame size, so
        multiplying by 2 is enough. */
-    if (addr + size * 2 > exec_env->wasm_stack.s.top_boundary) {
+    if (addr + size * 2 > exec_env->wasm_stack.s.top_boundary
+#if WASM_STACK_USE_MMAP != 0
+        && !wasm_exec_env_grow_wasm_stack(exec_env, size * 2)
+#endif
+       ) {
         /* WASM stack overflow. */
         return NULL;
     }
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "bh_platform.h"
+#include "bh_log.h"
+#include "wasm_runtime_common.h"
+#if WASM_ENABLE_INTERP != 0
+#include "../interpreter/wasm_runtime.h"
+#endif
+#if WASM_ENABLE_AOT != 0
+#include "../aot/aot_runtime.h"
+#endif
+
+#if WASM_ENABLE_INSTANCE_POOL != 0
+
+typedef struct WASMInstancePoolEntry {
+    WASMModuleInstanceCommon *module_inst;
+    WASMExecEnv *exec_env;
+    /* Size of the default memory right after instantiation */
+    uint64 memory_data_size;
+    bool in_use;
+} WASMInstancePoolEntry;
+
+typedef struct WASMInstancePool {
+    WASMModuleCommon *module;
+    uint32 stack_size;
+    uint32 heap_size;
+    korp_mutex lock;
+    uint32 entry_count;
+    WASMInstancePoolEntry entries[1];
+} WASMInstancePool;
+
+static void
+set_error_buf(char *error_buf, uint32 error_buf_size, const char *string)
+{
+    if (error_buf != NULL) {
+        snprintf(error_buf, error_buf_size,
+                 "Create instance pool failed: %s", string);
+    }
+}
+
+static uint64
+get_memory_data_size(WASMModuleInstanceCommon *module_inst)
+{
+#if WASM_ENABLE_INTERP != 0
+    if (module_inst->module_type == Wasm_Module_Bytecode) {
+        WASMMemoryInstance *memory =
+            ((WASMModuleInstance*)module_inst)->default_memory;
+        return memory ? (uint64)memory->num_bytes_per_page
+                        * memory->cur_page_count
+                      : 0;
+    }
+#endif
+#if WASM_ENABLE_AOT != 0
+    if (module_inst->module_type == Wasm_Module_AoT) {
+        AOTModuleInstance *aot_inst = (AOTModuleInstance*)module_inst;
+        AOTMemoryInstance *memory = aot_inst->memories.ptr
+            ? ((AOTMemoryInstance**)aot_inst->memories.ptr)[0] : NULL;
+        return memory ? memory->memory_data_size : 0;
+    }
+#endif
+    return 0;
+}
+
+static bool
+reset_instance(WASMModuleInstanceCommon *module_inst,
+               char *error_buf, uint32 error_buf_size)
+{
+#if WASM_ENABLE_INTERP != 0
+    if (module_inst->module_type == Wasm_Module_Bytecode)
+        return wasm_reset_instance((WASMModuleInstance*)module_inst,
+                                   error_buf, error_buf_size);
+#endif
+#if WASM_ENABLE_AOT != 0
+    if (module_inst->module_type == Wasm_Module_AoT)
+        return aot_reset_instance((AOTModuleInstance*)module_inst,
+                                  error_buf, error_buf_size);
+#endif
+    return false;
+}
+
+static bool
+entry_init(WASMInstancePool *pool, WASMInstancePoolEntry *entry,
+           char *error_buf, uint32 error_buf_size)
+{
+    if (!(entry->module_inst =
+            wasm_runtime_instantiate(pool->module, pool->stack_size,
+                                     pool->heap_size,
+                                     error_buf, error_buf_size))) {
+        return false;
+    }
+
+    if (!(entry->exec_env =
+            wasm_runtime_create_exec_env(entry->module_inst,
+                                         pool->stack_size))) {
+        set_error_buf(error_buf, error_buf_size, "create exec env failed");
+        wasm_runtime_deinstantiate(entry->module_inst);
+        entry->module_inst = NULL;
+        return false;
+    }
+
+    entry->memory_data_size = get_memory_data_size(entry->module_inst);
+    entry->in_use = false;
+    return true;
+}
+
+static void
+entry_destroy(WASMInstancePoolEntry *entry)
+{
+    if (entry->exec_env) {
+        wasm_runtime_destroy_exec_env(entry->exec_env);
+        entry->exec_env = NULL;
+    }
+    if (entry->module_inst) {
+        wasm_runtime_deinstantiate(entry->module_inst);
+        entry->module_inst = NULL;
+    }
+}
+
+WASMInstancePool *
+wasm_runtime_instance_pool_create(WASMModuleCommon *module,
+                                  uint32 pool_size,
+                                  uint32 stack_size, uint32 heap_size,
+                                  char *error_buf, uint32 error_buf_size)
+{
+    WASMInstancePool *pool;
+    uint64 total_size;
+    uint32 i;
+
+    if (!module || pool_size == 0) {
+        set_error_buf(error_buf, error_buf_size, "invalid parameter");
+        return NULL;
+    }
+
+    total_size = offsetof(WASMInstancePool, entries)
+                 + sizeof(WASMInstancePoolEntry) * (uint64)pool_size;
+    if (total_size >= UINT32_MAX
+        || !(pool = wasm_runtime_malloc((uint32)total_size))) {
+        set_error_buf(error_buf, error_buf_size, "allocate memory failed");
+        return NULL;
+    }
+
+    memset(pool, 0, (uint32)total_size);
+    pool->module = module;
+    pool->stack_size = stack_size;
+    pool->heap_size = heap_size;
+
+    if (os_mutex_init(&pool->lock) != 0) {
+        set_error_buf(error_buf, error_buf_size, "init lock failed");
+        wasm_runtime_free(pool);
+        return NULL;
+    }
+
+    for (i = 0; i < pool_size; i++) {
+        if (!entry_init(pool, &pool->entries[i], error_buf, error_buf_size)) {
+            pool->entry_count = i;
+            wasm_runtime_instance_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    pool->entry_count = pool_size;
+
+    LOG_VERBOSE("Instance pool created with %u instances", pool_size);
+    return pool;
+}
+
+void
+wasm_runtime_instance_pool_destroy(WASMInstancePool *pool)
+{
+    uint32 i;
+
+    if (!pool)
+        return;
+
+    for (i = 0; i < pool->entry_count; i++) {
+        bh_assert(!pool->entries[i].in_use);
+        entry_destroy(&pool->entries[i]);
+    }
+
+    os_mutex_destroy(&pool->lock);
+    wasm_runtime_free(pool);
+}
+
+WASMModuleInstanceCommon *
+wasm_runtime_instance_pool_acquire(WASMInstancePool *pool,
+                                   WASMExecEnv **p_exec_env)
+{
+    WASMInstancePoolEntry *entry = NULL;
+    uint32 i;
+
+    os_mutex_lock(&pool->lock);
+    for (i = 0; i < pool->entry_count; i++) {
+        if (pool->entries[i].module_inst && !pool->entries[i].in_use) {
+            entry = &pool->entries[i];
+            entry->in_use = true;
+            break;
+        }
+    }
+    os_mutex_unlock(&pool->lock);
+
+    if (!entry)
+        return NULL;
+
+    /* The exec env may be used by a thread other than the one
+       created it, refresh the native thread info */
+    wasm_exec_env_set_thread_info(entry->exec_env);
+    if (p_exec_env)
+        *p_exec_env = entry->exec_env;
+    return entry->module_inst;
+}
+
+void
+wasm_runtime_instance_pool_release(WASMInstancePool *pool,
+                                   WASMModuleInstanceCommon *module_inst)
+{
+    WASMInstancePoolEntry *entry = NULL, new_entry;
+    char error_buf[128];
+    uint32 i;
+
+    /* The slots of the other entries may be re-instantiated by other
+       threads concurrently, only access them with the lock held */
+    os_mutex_lock(&pool->lock);
+    for (i = 0; i < pool->entry_count; i++) {
+        if (pool->entries[i].module_inst == module_inst) {
+            entry = &pool->entries[i];
+            break;
+        }
+    }
+    os_mutex_unlock(&pool->lock);
+
+    bh_assert(entry && entry->in_use);
+    if (!entry)
+        return;
+
+    /* The entry is still marked as in use, so the instance can be reset
+       without holding the lock. An instance whose memory was enlarged
+       can't be reset in place, re-instantiate it instead, the new
+       instance is published with the lock held */
+    new_entry = *entry;
+    if (get_memory_data_size(module_inst) != entry->memory_data_size
+        || !reset_instance(module_inst, error_buf, sizeof(error_buf))) {
+        LOG_VERBOSE("Re-instantiate the pooled instance");
+        entry_destroy(&new_entry);
+        if (!entry_init(pool, &new_entry, error_buf, sizeof(error_buf))) {
+            /* The slot stays empty and is skipped by acquire */
+            LOG_WARNING("Re-instantiate the pooled instance failed: %s",
+                        error_buf);
+        }
+    }
+
+    os_mutex_lock(&pool->lock);
+    *entry = new_entry;
+    entry->in_use = false;
+    os_mutex_unlock(&pool->lock);
+}
+
+#endif /* end of WASM_ENABLE_INSTANCE_POOL */
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "wasm_linux_perf.h"
+#include "bh_log.h"
+
+#if WASM_ENABLE_LINUX_PERF != 0
+
+#include <sys/syscall.h>
+
+/*
+ * The jitdump format is described in tools/perf/Documentation/
+ * jitdump-specification.txt of the Linux kernel source tree.
+ */
+#define JITDUMP_MAGIC 0x4A695444
+#define JITDUMP_VERSION 1
+#define JITDUMP_CODE_LOAD 0
+
+#if defined(BUILD_TARGET_X86_64) || defined(BUILD_TARGET_AMD_64)
+#define JITDUMP_ELF_MACH 62 /* EM_X86_64 */
+#elif defined(BUILD_TARGET_X86_32)
+#define JITDUMP_ELF_MACH 3 /* EM_386 */
+#elif defined(BUILD_TARGET_AARCH64)
+#define JITDUMP_ELF_MACH 183 /* EM_AARCH64 */
+#elif defined(BUILD_TARGET_ARM) || defined(BUILD_TARGET_ARM_VFP) \
+      || defined(BUILD_TARGET_THUMB) || defined(BUILD_TARGET_THUMB_VFP)
+#define JITDUMP_ELF_MACH 40 /* EM_ARM */
+#elif defined(BUILD_TARGET_MIPS)
+#define JITDUMP_ELF_MACH 8 /* EM_MIPS */
+#elif defined(BUILD_TARGET_XTENSA)
+#define JITDUMP_ELF_MACH 94 /* EM_XTENSA */
+#else
+#define JITDUMP_ELF_MACH 243 /* EM_RISCV */
+#endif
+
+typedef struct JitDumpHeader {
+    uint32 magic;
+    uint32 version;
+    uint32 total_size;
+    uint32 elf_mach;
+    uint32 pad1;
+    uint32 pid;
+    uint64 timestamp;
+    uint64 flags;
+} JitDumpHeader;
+
+typedef struct JitDumpCodeLoad {
+    uint32 id;
+    uint32 total_size;
+    uint64 timestamp;
+    uint32 pid;
+    uint32 tid;
+    uint64 vma;
+    uint64 code_addr;
+    uint64 code_size;
+    uint64 code_index;
+    /* followed by the function name ending with '\0'
+       and the code bytes */
+} JitDumpCodeLoad;
+
+static korp_mutex perf_lock;
+static FILE *perf_map_file;
+static int jitdump_fd = -1;
+/* The marker mapping of the jitdump file, perf record finds the file
+   by its mmap event */
+static void *jitdump_marker;
+static uint64 jitdump_code_index;
+
+/* perf record -k mono takes the timestamps with the same clock */
+static uint64
+get_timestamp()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+static bool
+write_all(int fd, const void *buf, size_t size)
+{
+    const uint8 *p = buf;
+    ssize_t ret;
+
+    while (size > 0) {
+        if ((ret = write(fd, p, size)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += ret;
+        size -= (size_t)ret;
+    }
+    return true;
+}
+
+static bool
+jitdump_open()
+{
+    JitDumpHeader header = { 0 };
+    char file_name[64];
+
+    snprintf(file_name, sizeof(file_name), "/tmp/jit-%d.dump", (int)getpid());
+    if ((jitdump_fd = open(file_name, O_CREAT | O_TRUNC | O_RDWR, 0666)) < 0) {
+        LOG_ERROR("Open %s failed: %s", file_name, strerror(errno));
+        return false;
+    }
+
+    jitdump_marker = mmap(NULL, (size_t)getpagesize(), PROT_READ | PROT_EXEC,
+                          MAP_PRIVATE, jitdump_fd, 0);
+    if (jitdump_marker == MAP_FAILED) {
+        LOG_ERROR("Map %s failed: %s", file_name, strerror(errno));
+        jitdump_marker = NULL;
+        goto fail;
+    }
+
+    header.magic = JITDUMP_MAGIC;
+    header.version = JITDUMP_VERSION;
+    header.total_size = sizeof(JitDumpHeader);
+    header.elf_mach = JITDUMP_ELF_MACH;
+    header.pid = (uint32)getpid();
+    header.timestamp = get_timestamp();
+    if (!write_all(jitdump_fd, &header, sizeof(header))) {
+        LOG_ERROR("Write %s failed: %s", file_name, strerror(errno));
+        goto fail;
+    }
+    return true;
+
+fail:
+    if (jitdump_marker) {
+        munmap(jitdump_marker, (size_t)getpagesize());
+        jitdump_marker = NULL;
+    }
+    close(jitdump_fd);
+    jitdump_fd = -1;
+    return false;
+}
+
+static void
+jitdump_add_code(const void *code, uint64 code_size, const char *name)
+{
+    JitDumpCodeLoad record = { 0 };
+    uint32 name_len = (uint32)strlen(name) + 1;
+    uint64 total_size = sizeof(JitDumpCodeLoad) + name_len + code_size;
+
+    if (total_size > UINT32_MAX)
+        return;
+
+    record.id = JITDUMP_CODE_LOAD;
+    record.total_size = (uint32)total_size;
+    record.timestamp = get_timestamp();
+    record.pid = (uint32)getpid();
+    record.tid = (uint32)syscall(SYS_gettid);
+    record.vma = record.code_addr = (uint64)(uintptr_t)code;
+    record.code_size = code_size;
+    record.code_index = jitdump_code_index++;
+
+    if (!write_all(jitdump_fd, &record, sizeof(record))
+        || !write_all(jitdump_fd, name, name_len)
+        || !write_all(jitdump_fd, code, (size_t)code_size)) {
+        LOG_WARNING("Write jitdump record failed: %s", strerror(errno));
+    }
+}
+
+bool
+wasm_linux_perf_init(bool enable_perf_map, bool enable_jitdump)
+{
+    char file_name[64];
+
+    if (!enable_perf_map && !enable_jitdump)
+        return true;
+
+    if (os_mutex_init(&perf_lock) != 0)
+        return false;
+
+    if (enable_perf_map) {
+        snprintf(file_name, sizeof(file_name), "/tmp/perf-%d.map",
+                 (int)getpid());
+        if (!(perf_map_file = fopen(file_name, "w"))) {
+            LOG_ERROR("Open %s failed: %s", file_name, strerror(errno));
+            goto fail;
+        }
+    }
+
+    if (enable_jitdump && !jitdump_open())
+        goto fail;
+
+    return true;
+
+fail:
+    wasm_linux_perf_destroy();
+    return false;
+}
+
+void
+wasm_linux_perf_destroy()
+{
+    if (!perf_map_file && jitdump_fd < 0)
+        return;
+
+    /* The files are kept for perf to read them after the process exits */
+    if (perf_map_file) {
+        fclose(perf_map_file);
+        perf_map_file = NULL;
+    }
+    if (jitdump_marker) {
+        munmap(jitdump_marker, (size_t)getpagesize());
+        jitdump_marker = NULL;
+    }
+    if (jitdump_fd >= 0) {
+        close(jitdump_fd);
+        jitdump_fd = -1;
+    }
+    jitdump_code_index = 0;
+    os_mutex_destroy(&perf_lock);
+}
+
+bool
+wasm_linux_perf_enabled()
+{
+    return perf_map_file || jitdump_fd >= 0 ? true : false;
+}
+
+void
+wasm_linux_perf_add_code(const void *code, uint64 code_size,
+                         const char *name)
+{
+    if (!wasm_linux_perf_enabled() || code_size == 0)
+        return;
+
+    os_mutex_lock(&perf_lock);
+    if (perf_map_file) {
+        fprintf(perf_map_file, "%lx %lx %s\n", (unsigned long)(uintptr_t)code,
+                (unsigned long)code_size, name);
+        /* Flush each entry since perf top reads the map while running */
+        fflush(perf_map_file);
+    }
+    if (jitdump_fd >= 0)
+        jitdump_add_code(code, code_size, name);
+    os_mutex_unlock(&perf_lock);
+}
+
+#endif /* end of WASM_ENABLE_LINUX_PERF != 0 */
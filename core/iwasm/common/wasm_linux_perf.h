@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _WASM_LINUX_PERF_H
+#define _WASM_LINUX_PERF_H
+
+#include "bh_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if WASM_ENABLE_LINUX_PERF != 0
+
+/**
+ * Start emitting the native code of the wasm functions for the Linux
+ * perf tool: the perf map /tmp/perf-<pid>.map, which perf report and
+ * perf top use to symbolize the anonymous executable memory, and/or
+ * the jitdump file /tmp/jit-<pid>.dump with the code bytes, which
+ * perf inject --jit merges into the samples recorded.
+ *
+ * @param enable_perf_map whether to emit the perf map
+ * @param enable_jitdump whether to emit the jitdump file
+ *
+ * @return true if success, false otherwise
+ */
+bool
+wasm_linux_perf_init(bool enable_perf_map, bool enable_jitdump);
+
+/**
+ * Close the perf map and the jitdump file.
+ */
+void
+wasm_linux_perf_destroy();
+
+/**
+ * Whether the perf map or the jitdump file is emitted.
+ */
+bool
+wasm_linux_perf_enabled();
+
+/**
+ * Emit the native code of a function loaded or compiled, it may be
+ * called from the compilation threads of the JIT.
+ *
+ * @param code the start address of the native code
+ * @param code_size the size of the native code
+ * @param name the name of the function
+ */
+void
+wasm_linux_perf_add_code(const void *code, uint64 code_size,
+                         const char *name);
+
+#endif /* end of WASM_ENABLE_LINUX_PERF != 0 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of _WASM_LINUX_PERF_H */
@@ -80,6 +80,14 @@ wasm_runtime_memory_destroy()
     memory_mode = MEMORY_MODE_UNKNOWN;
 }
 
+bool
+wasm_runtime_memory_pool_get_info(mem_alloc_info_t *info)
+{
+    if (memory_mode == MEMORY_MODE_POOL)
+        return mem_allocator_get_alloc_info(pool_allocator, info);
+    return false;
+}
+
 unsigned
 wasm_runtime_memory_pool_size()
 {
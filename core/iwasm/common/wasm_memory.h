@@ -20,6 +20,13 @@ wasm_runtime_memory_init(mem_alloc_type_t mem_alloc_type,
 void
 wasm_runtime_memory_destroy();
 
+struct mem_alloc_info_t;
+
+/* Get the usage of the runtime memory pool, return false if the
+   runtime doesn't allocate memory with a pool */
+bool
+wasm_runtime_memory_pool_get_info(struct mem_alloc_info_t *info);
+
 #ifdef __cplusplus
 }
 #endif
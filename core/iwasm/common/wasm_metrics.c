@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "wasm_metrics.h"
+#include "wasm_runtime_common.h"
+#include "wasm_memory.h"
+#include "mem_alloc.h"
+#if WASM_ENABLE_INTERP != 0
+#include "../interpreter/wasm_runtime.h"
+#endif
+#if WASM_ENABLE_AOT != 0
+#include "../aot/aot_runtime.h"
+#endif
+#if WASM_ENABLE_THREAD_MGR != 0
+#include "../libraries/thread-mgr/thread_manager.h"
+#endif
+
+#if WASM_ENABLE_METRICS != 0
+
+/*
+ * The event counters are kept per thread and only written by their
+ * thread without locks, they are accessed with relaxed atomic loads
+ * and stores since a snapshot reads them from another thread. The
+ * registry links them so that a snapshot sums them up, and the
+ * counters of a thread are folded into retired_counters when the
+ * thread exits. A snapshot may
+ * miss the increments in flight, which is fine for metrics scraped
+ * periodically. The gauges, e.g. the memory pages and the app heap
+ * usage, are read from the registered module instances when the
+ * snapshot is taken, so that the hot paths aren't instrumented.
+ */
+
+typedef struct MetricsThreadNode {
+    struct MetricsThreadNode *next;
+    WASMMetricsCounters counters;
+} MetricsThreadNode;
+
+typedef struct MetricsRegistry {
+    bool inited;
+    korp_mutex lock;
+    MetricsThreadNode *threads;
+    /* counters of the threads which have exited */
+    WASMMetricsCounters retired_counters;
+    /* module instances created by wasm_runtime_instantiate */
+    WASMModuleInstanceCommon **instances;
+    uint32 instance_count;
+    uint32 instance_capacity;
+} MetricsRegistry;
+
+static MetricsRegistry registry;
+
+os_thread_local_attribute WASMMetricsCounters *wasm_metrics_thread_counters;
+os_thread_local_attribute uint32 wasm_metrics_thread_epoch;
+/* Increased when the registry is initialized or destroyed, so that the
+   threads re-register after the runtime is initialized again */
+uint32 wasm_metrics_epoch;
+os_thread_local_attribute bool wasm_metrics_spreading_exception;
+
+static const char *trap_kind_names[WASM_TRAP_KIND_NUM] = {
+    "unreachable", "out_of_bounds_memory", "out_of_bounds_table",
+    "indirect_call_type_mismatch", "integer_overflow",
+    "integer_divide_by_zero", "invalid_conversion", "stack_overflow",
+    "out_of_memory", "unaligned_atomic", "other"
+};
+
+typedef struct TrapKindMessage {
+    const char *message;
+    wasm_trap_kind_t kind;
+} TrapKindMessage;
+
+static const TrapKindMessage trap_kind_messages[] = {
+    { "unreachable", WASM_TRAP_UNREACHABLE },
+    { "out of bounds memory access", WASM_TRAP_OUT_OF_BOUNDS_MEMORY },
+    { "out of bounds table access", WASM_TRAP_OUT_OF_BOUNDS_TABLE },
+    { "undefined element", WASM_TRAP_OUT_OF_BOUNDS_TABLE },
+    { "uninitialized element", WASM_TRAP_OUT_OF_BOUNDS_TABLE },
+    { "invalid function index", WASM_TRAP_OUT_OF_BOUNDS_TABLE },
+    { "indirect call type mismatch", WASM_TRAP_INDIRECT_CALL_TYPE_MISMATCH },
+    { "integer overflow", WASM_TRAP_INTEGER_OVERFLOW },
+    { "integer divide by zero", WASM_TRAP_INTEGER_DIVIDE_BY_ZERO },
+    { "invalid conversion to integer", WASM_TRAP_INVALID_CONVERSION },
+    { "native stack overflow", WASM_TRAP_STACK_OVERFLOW },
+    { "wasm operand stack overflow", WASM_TRAP_STACK_OVERFLOW },
+    { "wasm auxiliary stack overflow", WASM_TRAP_STACK_OVERFLOW },
+    { "wasm auxiliary stack underflow", WASM_TRAP_STACK_OVERFLOW },
+    { "allocate memory failed", WASM_TRAP_OUT_OF_MEMORY },
+    { "out of memory", WASM_TRAP_OUT_OF_MEMORY },
+    { "unaligned atomic", WASM_TRAP_UNALIGNED_ATOMIC },
+};
+
+bool
+wasm_metrics_init()
+{
+    if (os_mutex_init(&registry.lock) != 0)
+        return false;
+    registry.inited = true;
+    wasm_metrics_epoch++;
+    return true;
+}
+
+void
+wasm_metrics_destroy()
+{
+    MetricsThreadNode *node, *next;
+
+    if (!registry.inited)
+        return;
+
+    for (node = registry.threads; node; node = next) {
+        next = node->next;
+        wasm_runtime_free(node);
+    }
+    if (registry.instances)
+        wasm_runtime_free(registry.instances);
+    os_mutex_destroy(&registry.lock);
+    memset(&registry, 0, sizeof(MetricsRegistry));
+    wasm_metrics_epoch++;
+}
+
+WASMMetricsCounters *
+wasm_metrics_register_thread()
+{
+    MetricsThreadNode *node;
+
+    if (!registry.inited
+        || !(node = wasm_runtime_malloc(sizeof(MetricsThreadNode))))
+        return NULL;
+
+    memset(node, 0, sizeof(MetricsThreadNode));
+    os_mutex_lock(&registry.lock);
+    node->next = registry.threads;
+    registry.threads = node;
+    os_mutex_unlock(&registry.lock);
+
+    wasm_metrics_thread_counters = &node->counters;
+    wasm_metrics_thread_epoch = wasm_metrics_epoch;
+    return &node->counters;
+}
+
+static void
+add_counters(WASMMetricsCounters *dst, const WASMMetricsCounters *src)
+{
+    uint32 i;
+
+    /* src may be the counters of a running thread */
+#define LOAD_COUNTER(field) __atomic_load_n(&src->field, __ATOMIC_RELAXED)
+    dst->host_calls += LOAD_COUNTER(host_calls);
+    for (i = 0; i < WASM_TRAP_KIND_NUM; i++)
+        dst->traps[i] += LOAD_COUNTER(traps[i]);
+    dst->atomic_waits += LOAD_COUNTER(atomic_waits);
+    dst->atomic_wait_timeouts += LOAD_COUNTER(atomic_wait_timeouts);
+    dst->atomic_notifies += LOAD_COUNTER(atomic_notifies);
+    dst->exec_envs_created += LOAD_COUNTER(exec_envs_created);
+    dst->exec_envs_destroyed += LOAD_COUNTER(exec_envs_destroyed);
+#undef LOAD_COUNTER
+}
+
+void
+wasm_metrics_retire_thread()
+{
+    MetricsThreadNode *node, **p_node;
+
+    if (!registry.inited
+        || wasm_metrics_thread_epoch != wasm_metrics_epoch
+        || !wasm_metrics_thread_counters)
+        return;
+
+    node = (MetricsThreadNode *)((uint8 *)wasm_metrics_thread_counters
+                                 - offsetof(MetricsThreadNode, counters));
+
+    os_mutex_lock(&registry.lock);
+    for (p_node = &registry.threads; *p_node; p_node = &(*p_node)->next) {
+        if (*p_node == node) {
+            *p_node = node->next;
+            add_counters(&registry.retired_counters, &node->counters);
+            break;
+        }
+    }
+    os_mutex_unlock(&registry.lock);
+
+    wasm_runtime_free(node);
+    wasm_metrics_thread_counters = NULL;
+    wasm_metrics_thread_epoch = 0;
+}
+
+void
+wasm_metrics_count_trap(const char *exception)
+{
+    wasm_trap_kind_t kind = WASM_TRAP_OTHER;
+    uint32 i;
+
+    /* The exit of the wasi app isn't a trap, and the trap spread to
+       the other threads of a cluster has been counted */
+    if (wasm_metrics_spreading_exception
+        || !strcmp(exception, "wasi proc exit"))
+        return;
+
+    for (i = 0; i < sizeof(trap_kind_messages) / sizeof(TrapKindMessage);
+         i++) {
+        if (!strcmp(exception, trap_kind_messages[i].message)) {
+            kind = trap_kind_messages[i].kind;
+            break;
+        }
+    }
+    METRICS_INC(traps[kind]);
+}
+
+void
+wasm_metrics_add_instance(WASMModuleInstanceCommon *module_inst)
+{
+    WASMModuleInstanceCommon **instances;
+    uint32 capacity;
+
+    if (!registry.inited)
+        return;
+
+    os_mutex_lock(&registry.lock);
+    if (registry.instance_count == registry.instance_capacity) {
+        capacity = registry.instance_capacity
+                   ? registry.instance_capacity * 2 : 16;
+        if (!(instances = wasm_runtime_malloc(
+                  sizeof(WASMModuleInstanceCommon *) * capacity))) {
+            /* the instance isn't reported */
+            os_mutex_unlock(&registry.lock);
+            return;
+        }
+        if (registry.instances) {
+            bh_memcpy_s(instances,
+                        sizeof(WASMModuleInstanceCommon *) * capacity,
+                        registry.instances,
+                        sizeof(WASMModuleInstanceCommon *)
+                        * registry.instance_count);
+            wasm_runtime_free(registry.instances);
+        }
+        registry.instances = instances;
+        registry.instance_capacity = capacity;
+    }
+    registry.instances[registry.instance_count++] = module_inst;
+    os_mutex_unlock(&registry.lock);
+}
+
+void
+wasm_metrics_remove_instance(WASMModuleInstanceCommon *module_inst)
+{
+    uint32 i;
+
+    if (!registry.inited)
+        return;
+
+    os_mutex_lock(&registry.lock);
+    for (i = 0; i < registry.instance_count; i++) {
+        if (registry.instances[i] == module_inst) {
+            registry.instances[i] =
+                registry.instances[--registry.instance_count];
+            break;
+        }
+    }
+    os_mutex_unlock(&registry.lock);
+}
+
+static void
+add_memory_metrics(wasm_runtime_metrics_t *metrics,
+                   uint32 num_bytes_per_page, uint32 cur_page_count,
+                   void *heap_handle)
+{
+    mem_alloc_info_t info;
+
+    metrics->memory_pages += cur_page_count;
+    metrics->memory_bytes += (uint64)num_bytes_per_page * cur_page_count;
+
+    if (heap_handle && mem_allocator_get_alloc_info(heap_handle, &info)) {
+        metrics->app_heap_size += info.total_size;
+        metrics->app_heap_used += info.total_size - info.total_free_size;
+        metrics->app_heap_highmark += info.highmark_size;
+    }
+}
+
+static void
+add_instance_metrics(wasm_runtime_metrics_t *metrics,
+                     WASMModuleInstanceCommon *module_inst)
+{
+    uint32 i;
+
+#if WASM_ENABLE_INTERP != 0
+    if (module_inst->module_type == Wasm_Module_Bytecode) {
+        WASMModuleInstance *wasm_inst = (WASMModuleInstance *)module_inst;
+        for (i = 0; i < wasm_inst->memory_count; i++) {
+            WASMMemoryInstance *memory = wasm_inst->memories[i];
+            add_memory_metrics(metrics, memory->num_bytes_per_page,
+                               memory->cur_page_count, memory->heap_handle);
+        }
+    }
+#endif
+#if WASM_ENABLE_AOT != 0
+    if (module_inst->module_type == Wasm_Module_AoT) {
+        AOTModuleInstance *aot_inst = (AOTModuleInstance *)module_inst;
+        for (i = 0; i < aot_inst->memory_count; i++) {
+            AOTMemoryInstance *memory =
+                ((AOTMemoryInstance **)aot_inst->memories.ptr)[i];
+            add_memory_metrics(metrics, memory->num_bytes_per_page,
+                               memory->cur_page_count,
+                               memory->heap_handle.ptr);
+        }
+    }
+#endif
+    (void)i;
+}
+
+void
+wasm_runtime_get_metrics(wasm_runtime_metrics_t *metrics)
+{
+    WASMMetricsCounters counters = { 0 };
+    MetricsThreadNode *node;
+    mem_alloc_info_t info;
+    uint32 i;
+
+    memset(metrics, 0, sizeof(wasm_runtime_metrics_t));
+    if (!registry.inited)
+        return;
+
+    os_mutex_lock(&registry.lock);
+    add_counters(&counters, &registry.retired_counters);
+    for (node = registry.threads; node; node = node->next)
+        add_counters(&counters, &node->counters);
+
+    metrics->instance_count = registry.instance_count;
+    for (i = 0; i < registry.instance_count; i++)
+        add_instance_metrics(metrics, registry.instances[i]);
+    os_mutex_unlock(&registry.lock);
+
+    if (wasm_runtime_memory_pool_get_info(&info)) {
+        metrics->pool_size = info.total_size;
+        metrics->pool_free = info.total_free_size;
+        metrics->pool_highmark = info.highmark_size;
+        metrics->pool_largest_free = info.largest_free_size;
+    }
+
+    /* the exec envs may be destroyed by other threads */
+    if (counters.exec_envs_created > counters.exec_envs_destroyed)
+        metrics->exec_env_count = (uint32)(counters.exec_envs_created
+                                           - counters.exec_envs_destroyed);
+
+#if WASM_ENABLE_THREAD_MGR != 0
+    metrics->cluster_count =
+        wasm_cluster_get_thread_nums(NULL, 0, &metrics->thread_count,
+                                     &metrics->max_cluster_thread_count);
+#endif
+
+    metrics->host_calls = counters.host_calls;
+    for (i = 0; i < WASM_TRAP_KIND_NUM; i++)
+        metrics->traps[i] = counters.traps[i];
+    metrics->atomic_waits = counters.atomic_waits;
+    metrics->atomic_wait_timeouts = counters.atomic_wait_timeouts;
+    metrics->atomic_notifies = counters.atomic_notifies;
+}
+
+const char *
+wasm_runtime_get_trap_kind_name(wasm_trap_kind_t kind)
+{
+    if ((uint32)kind >= WASM_TRAP_KIND_NUM)
+        return NULL;
+    return trap_kind_names[kind];
+}
+
+typedef struct MetricsWriter {
+    char *buf;
+    uint32 size;
+    /* length of the whole output, may be larger than size */
+    uint32 len;
+} MetricsWriter;
+
+static void
+metrics_printf(MetricsWriter *writer, const char *format, ...)
+{
+    va_list args;
+    char *buf = NULL;
+    uint32 size = 0;
+    int n;
+
+    if (writer->buf && writer->len < writer->size) {
+        buf = writer->buf + writer->len;
+        size = writer->size - writer->len;
+    }
+
+    va_start(args, format);
+    n = vsnprintf(buf, size, format, args);
+    va_end(args);
+
+    if (n > 0)
+        writer->len += (uint32)n;
+}
+
+#if WASM_ENABLE_THREAD_MGR != 0
+static void
+write_cluster_threads(MetricsWriter *writer, uint32 cluster_count)
+{
+    uint32 *thread_nums = NULL, i;
+
+    /* the clusters may be created or destroyed meanwhile */
+    if (cluster_count > 0
+        && (thread_nums = wasm_runtime_malloc(sizeof(uint32)
+                                              * cluster_count)))
+        cluster_count = wasm_cluster_get_thread_nums(thread_nums,
+                                                     cluster_count,
+                                                     NULL, NULL);
+
+    metrics_printf(writer, ", \"per_cluster\": [");
+    for (i = 0; thread_nums && i < cluster_count; i++)
+        metrics_printf(writer, "%s%u", i > 0 ? ", " : "", thread_nums[i]);
+    metrics_printf(writer, "]");
+
+    if (thread_nums)
+        wasm_runtime_free(thread_nums);
+}
+#endif
+
+uint32
+wasm_runtime_dump_metrics_to_buf(char *buf, uint32 len)
+{
+    MetricsWriter writer = { buf, len, 0 };
+    wasm_runtime_metrics_t metrics;
+    uint32 i;
+
+    wasm_runtime_get_metrics(&metrics);
+
+    metrics_printf(&writer, "{\n  \"instances\": %u,\n",
+                   metrics.instance_count);
+    metrics_printf(&writer,
+                   "  \"memory\": {\"pages\": %"PRIu64", "
+                   "\"bytes\": %"PRIu64"},\n",
+                   metrics.memory_pages, metrics.memory_bytes);
+    metrics_printf(&writer,
+                   "  \"app_heap\": {\"size\": %"PRIu64", "
+                   "\"used\": %"PRIu64", \"highmark\": %"PRIu64"},\n",
+                   metrics.app_heap_size, metrics.app_heap_used,
+                   metrics.app_heap_highmark);
+    /* the fragmentation is the part of the free memory which can't
+       be allocated at once */
+    metrics_printf(&writer,
+                   "  \"pool\": {\"size\": %u, \"free\": %u, "
+                   "\"highmark\": %u, \"largest_free\": %u, "
+                   "\"fragmentation\": %.3f},\n",
+                   metrics.pool_size, metrics.pool_free,
+                   metrics.pool_highmark, metrics.pool_largest_free,
+                   metrics.pool_free > 0
+                   ? 1.0 - (double)metrics.pool_largest_free
+                           / metrics.pool_free
+                   : 0.0);
+    metrics_printf(&writer, "  \"exec_envs\": %u,\n",
+                   metrics.exec_env_count);
+    metrics_printf(&writer,
+                   "  \"threads\": {\"clusters\": %u, \"threads\": %u, "
+                   "\"max_per_cluster\": %u",
+                   metrics.cluster_count, metrics.thread_count,
+                   metrics.max_cluster_thread_count);
+#if WASM_ENABLE_THREAD_MGR != 0
+    write_cluster_threads(&writer, metrics.cluster_count);
+#endif
+    metrics_printf(&writer, "},\n");
+    metrics_printf(&writer, "  \"host_calls\": %"PRIu64",\n",
+                   metrics.host_calls);
+    metrics_printf(&writer, "  \"traps\": {");
+    for (i = 0; i < WASM_TRAP_KIND_NUM; i++)
+        metrics_printf(&writer, "%s\"%s\": %"PRIu64, i > 0 ? ", " : "",
+                       trap_kind_names[i], metrics.traps[i]);
+    metrics_printf(&writer, "},\n");
+    metrics_printf(&writer,
+                   "  \"atomic\": {\"waits\": %"PRIu64", "
+                   "\"wait_timeouts\": %"PRIu64", "
+                   "\"notifies\": %"PRIu64"}\n}\n",
+                   metrics.atomic_waits, metrics.atomic_wait_timeouts,
+                   metrics.atomic_notifies);
+
+    return writer.len;
+}
+
+#endif /* end of WASM_ENABLE_METRICS != 0 */
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _WASM_METRICS_H
+#define _WASM_METRICS_H
+
+#include "bh_platform.h"
+#include "wasm_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if WASM_ENABLE_METRICS != 0
+
+struct WASMModuleInstanceCommon;
+
+/* The event counters of a thread */
+typedef struct WASMMetricsCounters {
+    uint64 host_calls;
+    uint64 traps[WASM_TRAP_KIND_NUM];
+    uint64 atomic_waits;
+    uint64 atomic_wait_timeouts;
+    uint64 atomic_notifies;
+    uint64 exec_envs_created;
+    uint64 exec_envs_destroyed;
+} WASMMetricsCounters;
+
+extern os_thread_local_attribute WASMMetricsCounters
+    *wasm_metrics_thread_counters;
+extern os_thread_local_attribute uint32 wasm_metrics_thread_epoch;
+extern uint32 wasm_metrics_epoch;
+/* Set while current thread spreads an exception to the other threads
+   of its cluster, so that a trap is only counted where it is raised */
+extern os_thread_local_attribute bool wasm_metrics_spreading_exception;
+
+bool
+wasm_metrics_init();
+
+void
+wasm_metrics_destroy();
+
+/**
+ * Allocate the counters of current thread and add them to the
+ * registry, return NULL if the metrics aren't initialized.
+ */
+WASMMetricsCounters *
+wasm_metrics_register_thread();
+
+/**
+ * Fold the counters of current thread into the counters of the exited
+ * threads and free them, called when the thread exits.
+ */
+void
+wasm_metrics_retire_thread();
+
+/**
+ * Count a trap by the exception message, e.g. "unreachable".
+ */
+void
+wasm_metrics_count_trap(const char *exception);
+
+void
+wasm_metrics_add_instance(struct WASMModuleInstanceCommon *module_inst);
+
+void
+wasm_metrics_remove_instance(struct WASMModuleInstanceCommon *module_inst);
+
+/* The counters are only written by their thread, the counters
+   registered in a previous initialization of the runtime are stale */
+static inline WASMMetricsCounters *
+wasm_metrics_get_thread_counters()
+{
+    if (wasm_metrics_thread_epoch == wasm_metrics_epoch)
+        return wasm_metrics_thread_counters;
+    return wasm_metrics_register_thread();
+}
+
+/* A counter is only written by its thread but read by the thread
+   taking a snapshot, so it is accessed with relaxed atomic loads and
+   stores, which don't need a locked read-modify-write */
+#define METRICS_INC(field) do {                                     \
+    WASMMetricsCounters *_counters = wasm_metrics_get_thread_counters(); \
+    if (_counters)                                                  \
+        __atomic_store_n(&_counters->field,                         \
+                         __atomic_load_n(&_counters->field,         \
+                                         __ATOMIC_RELAXED) + 1,     \
+                         __ATOMIC_RELAXED);                         \
+  } while (0)
+
+#else
+
+#define METRICS_INC(field) (void)0
+
+#endif /* end of WASM_ENABLE_METRICS != 0 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of _WASM_METRICS_H */
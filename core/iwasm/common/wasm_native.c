@@ -192,9 +192,9 @@ quick_sort_symbols(NativeSymbol* native_symbols, int left, int right)
 }
 #endif /* end of ENABLE_QUICKSORT */
 
-static void *
-lookup_symbol(NativeSymbol *native_symbols, uint32 n_native_symbols,
-              const char *symbol, const char **p_signature, void **p_attachment)
+static int
+lookup_symbol_index(NativeSymbol *native_symbols, uint32 n_native_symbols,
+                    const char *symbol)
 {
     int low = 0, mid, ret;
     int high = (int32)n_native_symbols - 1;
@@ -202,18 +202,29 @@ lookup_symbol(NativeSymbol *native_symbols, uint32 n_native_symbols,
     while (low <= high) {
         mid = (low + high) / 2;
         ret = strcmp(symbol, native_symbols[mid].symbol);
-        if (ret == 0) {
-            *p_signature = native_symbols[mid].signature;
-            *p_attachment = native_symbols[mid].attachment;
-            return native_symbols[mid].func_ptr;
-        }
+        if (ret == 0)
+            return mid;
         else if (ret < 0)
             high = mid - 1;
         else
             low = mid + 1;
     }
 
-    return NULL;
+    return -1;
+}
+
+static void *
+lookup_symbol(NativeSymbol *native_symbols, uint32 n_native_symbols,
+              const char *symbol, const char **p_signature, void **p_attachment)
+{
+    int idx = lookup_symbol_index(native_symbols, n_native_symbols, symbol);
+
+    if (idx < 0)
+        return NULL;
+
+    *p_signature = native_symbols[idx].signature;
+    *p_attachment = native_symbols[idx].attachment;
+    return native_symbols[idx].func_ptr;
 }
 
 void*
@@ -293,6 +304,20 @@ register_natives(const char *module_name,
     node->n_native_symbols = n_native_symbols;
     node->call_conv_raw = call_conv_raw;
 
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    node->call_stats = NULL;
+    if (n_native_symbols > 0) {
+        uint64 size = sizeof(WASMNativeCallStats) * (uint64)n_native_symbols;
+
+        if (size >= UINT32_MAX
+            || !(node->call_stats = wasm_runtime_malloc((uint32)size))) {
+            wasm_runtime_free(node);
+            return false;
+        }
+        memset(node->call_stats, 0, (uint32)size);
+    }
+#endif
+
     /* Add to list head */
     node->next = g_native_symbols_list;
     g_native_symbols_list = node;
@@ -413,9 +438,157 @@ wasm_native_destroy()
     node = g_native_symbols_list;
     while (node) {
         node_next = node->next;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        if (node->call_stats)
+            wasm_runtime_free(node->call_stats);
+#endif
         wasm_runtime_free(node);
         node = node_next;
     }
 
     g_native_symbols_list = NULL;
 }
+
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+WASMNativeCallStats *
+wasm_native_lookup_call_stats(const char *module_name,
+                              const char *field_name)
+{
+    NativeSymbolsNode *node = g_native_symbols_list;
+    int idx;
+
+    while (node) {
+        if (!strcmp(node->module_name, module_name)) {
+            if ((idx = lookup_symbol_index(node->native_symbols,
+                                           node->n_native_symbols,
+                                           field_name)) >= 0
+                || (field_name[0] == '_'
+                    && (idx = lookup_symbol_index(node->native_symbols,
+                                                  node->n_native_symbols,
+                                                  field_name + 1)) >= 0))
+                return node->call_stats + idx;
+        }
+        node = node->next;
+    }
+
+    return NULL;
+}
+
+uint64
+wasm_native_call_stats_now()
+{
+#if defined(CLOCK_MONOTONIC) && !defined(BH_PLATFORM_LINUX_SGX)
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+#endif
+    return os_time_get_boot_microsecond() * 1000;
+}
+
+#if defined(__GNUC__)
+#define STATS_ADD(p, v) __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#else
+/* some updates of the calls at the same time may be lost */
+#define STATS_ADD(p, v) (*(p) += (v))
+#endif
+
+void
+wasm_native_call_stats_add(WASMNativeCallStats *stats, uint64 begin_ns)
+{
+    uint64 time_ns = wasm_native_call_stats_now() - begin_ns;
+    uint64 max_time_ns, n = time_ns;
+    uint32 bucket = 0;
+
+    while ((n >>= 1) && bucket < NATIVE_CALL_STATS_BUCKET_NUM - 1)
+        bucket++;
+
+    STATS_ADD(&stats->call_count, 1);
+    STATS_ADD(&stats->total_time_ns, time_ns);
+    STATS_ADD(&stats->histogram[bucket], 1);
+
+#if defined(__GNUC__)
+    max_time_ns = __atomic_load_n(&stats->max_time_ns, __ATOMIC_RELAXED);
+    while (time_ns > max_time_ns
+           && !__atomic_compare_exchange_n(&stats->max_time_ns, &max_time_ns,
+                                           time_ns, true, __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+        ;
+#else
+    max_time_ns = stats->max_time_ns;
+    if (time_ns > max_time_ns)
+        stats->max_time_ns = time_ns;
+#endif
+}
+
+typedef struct StatsWriter {
+    char *buf;
+    uint32 size;
+    /* length of the whole output, may be larger than size */
+    uint32 len;
+} StatsWriter;
+
+static void
+stats_printf(StatsWriter *writer, const char *format, ...)
+{
+    va_list args;
+    char *buf = NULL;
+    uint32 size = 0;
+    int n;
+
+    if (writer->buf && writer->len < writer->size) {
+        buf = writer->buf + writer->len;
+        size = writer->size - writer->len;
+    }
+
+    va_start(args, format);
+    n = vsnprintf(buf, size, format, args);
+    va_end(args);
+
+    if (n > 0)
+        writer->len += (uint32)n;
+}
+
+uint32
+wasm_runtime_dump_native_call_stats_to_buf(char *buf, uint32 len)
+{
+    StatsWriter writer = { buf, len, 0 };
+    NativeSymbolsNode *node;
+    WASMNativeCallStats *stats;
+    uint32 i, j, count = 0;
+    bool first;
+
+    stats_printf(&writer, "{\n  \"natives\": [");
+    for (node = g_native_symbols_list; node; node = node->next) {
+        for (i = 0; node->call_stats && i < node->n_native_symbols; i++) {
+            stats = node->call_stats + i;
+            if (!stats->call_count)
+                continue;
+
+            stats_printf(&writer,
+                         "%s\n    {\"module\": \"%s\", \"symbol\": \"%s\", "
+                         "\"calls\": %"PRIu64", \"total_ns\": %"PRIu64", "
+                         "\"avg_ns\": %"PRIu64", \"max_ns\": %"PRIu64", "
+                         "\"histogram\": {",
+                         count++ > 0 ? "," : "", node->module_name,
+                         node->native_symbols[i].symbol, stats->call_count,
+                         stats->total_time_ns,
+                         stats->total_time_ns / stats->call_count,
+                         stats->max_time_ns);
+            /* the key is the lower bound of the bucket in ns */
+            for (j = 0, first = true; j < NATIVE_CALL_STATS_BUCKET_NUM; j++) {
+                if (!stats->histogram[j])
+                    continue;
+                stats_printf(&writer, "%s\"%"PRIu64"\": %"PRIu64,
+                             first ? "" : ", ", j > 0 ? (uint64)1 << j : 0,
+                             stats->histogram[j]);
+                first = false;
+            }
+            stats_printf(&writer, "}}");
+        }
+    }
+    stats_printf(&writer, "%s]\n}\n", count > 0 ? "\n  " : "");
+
+    return writer.len;
+}
+#endif /* end of WASM_ENABLE_NATIVE_CALL_STATS != 0 */
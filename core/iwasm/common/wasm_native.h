@@ -20,8 +20,27 @@ typedef struct NativeSymbolsNode {
     NativeSymbol *native_symbols;
     uint32 n_native_symbols;
     bool call_conv_raw;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    /* the call stats of each native symbol, in the order of the
+       sorted native symbols */
+    struct WASMNativeCallStats *call_stats;
+#endif
 } NativeSymbolsNode, *NativeSymbolsList;
 
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+/* The latency of the calls falling in [2^i, 2^(i+1)) ns are counted in
+   histogram[i], and the ones longer than that of the last bucket are
+   counted in the last bucket */
+#define NATIVE_CALL_STATS_BUCKET_NUM 32
+
+typedef struct WASMNativeCallStats {
+    uint64 call_count;
+    uint64 total_time_ns;
+    uint64 max_time_ns;
+    uint64 histogram[NATIVE_CALL_STATS_BUCKET_NUM];
+} WASMNativeCallStats;
+#endif
+
 /**
  * Lookup global variable of a given import global
  * from libc builtin globals
@@ -64,6 +83,31 @@ wasm_native_register_natives_raw(const char *module_name,
                                  NativeSymbol *native_symbols,
                                  uint32 n_native_symbols);
 
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+/**
+ * Lookup the call stats of a registered native symbol, the lookup
+ * is the same as wasm_native_resolve_symbol()
+ *
+ * @return the call stats if the symbol is found, NULL otherwise
+ */
+WASMNativeCallStats *
+wasm_native_lookup_call_stats(const char *module_name,
+                              const char *field_name);
+
+/**
+ * Get the current time in nanoseconds to time a native call
+ */
+uint64
+wasm_native_call_stats_now();
+
+/**
+ * Add a native call which began at begin_ns to the call stats, the
+ * stats may be updated by several threads at the same time
+ */
+void
+wasm_native_call_stats_add(WASMNativeCallStats *stats, uint64 begin_ns);
+#endif
+
 bool
 wasm_native_init();
 
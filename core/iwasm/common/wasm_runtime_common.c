@@ -21,6 +21,15 @@
 #if WASM_ENABLE_SHARED_MEMORY != 0
 #include "wasm_shared_memory.h"
 #endif
+#if WASM_ENABLE_LINUX_PERF != 0
+#include "wasm_linux_perf.h"
+#endif
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+#include "wasm_sampling_profiler.h"
+#endif
+#include "wasm_startup_timing.h"
+#include "wasm_metrics.h"
+#include "wasm_usdt.h"
 #include "../common/wasm_c_api_internal.h"
 
 #if WASM_ENABLE_MULTI_MODULE != 0
@@ -60,6 +69,38 @@ static void
 wasm_externref_map_destroy();
 #endif /* WASM_ENABLE_REF_TYPES */
 
+/* Whether to map linear memory and AOT code with huge pages */
+static bool huge_page_enabled = false;
+
+#if WASM_ENABLE_AOT != 0 && WASM_ENABLE_JIT != 0
+/* conflicting declaration between aot_export.h and aot.h */
+bool
+aot_compile_wasm_file_init();
+
+void
+aot_compile_wasm_file_destroy();
+
+uint8 *
+aot_compile_wasm_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                      uint32 opt_level, uint32 size_level,
+                      char *error_buf, uint32 error_buf_size,
+                      uint32 *p_aot_file_size);
+
+uint8 *
+aot_lookup_cached_aot_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                           uint32 opt_level, uint32 size_level,
+                           uint32 *p_aot_file_size);
+
+bool
+aot_compile_wasm_file_in_background(const uint8 *wasm_file_buf,
+                                    uint32 wasm_file_size,
+                                    uint32 opt_level, uint32 size_level);
+
+/* Directory of the on-disk AOT code cache, NULL if disabled */
+static char *aot_cache_dir = NULL;
+static bool aot_cache_compile_in_background = false;
+#endif
+
 static void
 set_error_buf(char *error_buf, uint32 error_buf_size, const char *string)
 {
@@ -136,9 +177,39 @@ wasm_runtime_env_init()
     }
 #endif
 
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+    if (!wasm_exec_env_cache_init()) {
+        goto fail8;
+    }
+#endif
+
+#if WASM_ENABLE_METRICS != 0
+    if (!wasm_metrics_init()) {
+        goto fail9;
+    }
+#endif
+
+#if WASM_ENABLE_ASYNC_LOG != 0
+    if (!bh_log_async_start()) {
+        goto fail10;
+    }
+#endif
+
     return true;
 
+#if WASM_ENABLE_ASYNC_LOG != 0
+fail10:
+#endif
+#if WASM_ENABLE_METRICS != 0
+    wasm_metrics_destroy();
+fail9:
+#endif
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+    wasm_exec_env_cache_destroy();
+fail8:
+#endif
 #if WASM_ENABLE_REF_TYPES != 0
+    wasm_externref_map_destroy();
 fail7:
 #endif
 #if WASM_ENABLE_AOT != 0
@@ -174,7 +245,7 @@ wasm_runtime_exec_env_check(WASMExecEnv *exec_env)
     return exec_env
            && exec_env->module_inst
            && exec_env->wasm_stack_size > 0
-           && exec_env->wasm_stack.s.top_boundary ==
+           && exec_env->wasm_stack.s.top_boundary <=
                 exec_env->wasm_stack.s.bottom + exec_env->wasm_stack_size
            && exec_env->wasm_stack.s.top <= exec_env->wasm_stack.s.top_boundary;
 }
@@ -196,6 +267,29 @@ wasm_runtime_init()
 void
 wasm_runtime_destroy()
 {
+#if WASM_ENABLE_AOT != 0 && WASM_ENABLE_JIT != 0
+    if (aot_cache_dir) {
+        /* wait for the background compilations and free the
+           AOT files loaded from the cache */
+        aot_compile_wasm_file_destroy();
+        wasm_runtime_free(aot_cache_dir);
+        aot_cache_dir = NULL;
+    }
+    aot_cache_compile_in_background = false;
+#endif
+
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+    wasm_exec_env_cache_destroy();
+#endif
+
+#if WASM_ENABLE_LINUX_PERF != 0
+    wasm_linux_perf_destroy();
+#endif
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_destroy();
+#endif
+
 #if WASM_ENABLE_REF_TYPES != 0
     wasm_externref_map_destroy();
 #endif
@@ -223,10 +317,22 @@ wasm_runtime_destroy()
     thread_manager_destroy();
 #endif
 
+#if WASM_ENABLE_METRICS != 0
+    wasm_metrics_destroy();
+#endif
+
     wasm_native_destroy();
+
+#if WASM_ENABLE_ASYNC_LOG != 0
+    /* print the logs queued */
+    bh_log_async_stop();
+#endif
+
     bh_platform_destroy();
 
     wasm_runtime_memory_destroy();
+
+    huge_page_enabled = false;
 }
 
 bool
@@ -253,9 +359,90 @@ wasm_runtime_full_init(RuntimeInitArgs *init_args)
     wasm_cluster_set_max_thread_num(init_args->max_thread_num);
 #endif
 
+    huge_page_enabled = init_args->enable_huge_page;
+
+#if WASM_ENABLE_LINUX_PERF != 0
+    if (!wasm_linux_perf_init(init_args->enable_perf_map,
+                              init_args->enable_jitdump)) {
+        wasm_runtime_destroy();
+        return false;
+    }
+#endif
+
+#if WASM_ENABLE_AOT != 0 && WASM_ENABLE_JIT != 0
+    if (init_args->aot_cache_dir && init_args->aot_cache_dir[0] != '\0') {
+        uint32 len = (uint32)strlen(init_args->aot_cache_dir) + 1;
+
+        if (!(aot_cache_dir = wasm_runtime_malloc(len))) {
+            wasm_runtime_destroy();
+            return false;
+        }
+        bh_memcpy_s(aot_cache_dir, len, init_args->aot_cache_dir, len);
+
+        if (!aot_compile_wasm_file_init()) {
+            wasm_runtime_destroy();
+            return false;
+        }
+        aot_cache_compile_in_background =
+            init_args->aot_cache_compile_in_background;
+    }
+#endif
+
     return true;
 }
 
+bool
+wasm_runtime_is_huge_page_enabled()
+{
+    return huge_page_enabled;
+}
+
+#if WASM_ENABLE_AOT != 0 && WASM_ENABLE_JIT != 0
+const char *
+wasm_runtime_get_aot_cache_dir()
+{
+    return aot_cache_dir;
+}
+
+/* Load the wasm file with the on-disk AOT code cache */
+static WASMModuleCommon *
+load_with_aot_cache(const uint8 *buf, uint32 size,
+                    char *error_buf, uint32 error_buf_size)
+{
+    uint8 *aot_file_buf = NULL;
+    uint32 aot_file_size;
+
+#if WASM_ENABLE_INTERP != 0
+    if (aot_cache_compile_in_background
+        && !(aot_file_buf = aot_lookup_cached_aot_file(buf, size, 3, 3,
+                                                       &aot_file_size))) {
+        /* Run with the interpreter until the AOT file is cached */
+        if (!aot_compile_wasm_file_in_background(buf, size, 3, 3)) {
+            LOG_WARNING("warning: failed to compile the AOT file "
+                        "in background");
+        }
+        return (WASMModuleCommon*)
+               wasm_load(buf, size, error_buf, error_buf_size);
+    }
+#endif
+
+    if (!aot_file_buf) {
+        STARTUP_TIMING_BEGIN(WASM_STARTUP_COMPILE);
+        aot_file_buf = aot_compile_wasm_file(buf, size, 3, 3,
+                                             error_buf, error_buf_size,
+                                             &aot_file_size);
+        STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
+        if (!aot_file_buf)
+            return NULL;
+    }
+
+    /* The AOT file buffer is kept until the runtime is destroyed */
+    return (WASMModuleCommon*)
+           aot_load_from_aot_file(aot_file_buf, aot_file_size,
+                                  error_buf, error_buf_size);
+}
+#endif
+
 PackageType
 get_package_type(const uint8 *buf, uint32 size)
 {
@@ -646,17 +833,25 @@ register_module_with_null_name(WASMModuleCommon *module_common,
 #endif
 }
 
-WASMModuleCommon *
-wasm_runtime_load(const uint8 *buf, uint32 size,
-                  char *error_buf, uint32 error_buf_size)
+static WASMModuleCommon *
+runtime_load(const uint8 *buf, uint32 size,
+             char *error_buf, uint32 error_buf_size)
 {
     WASMModuleCommon *module_common = NULL;
 
     if (get_package_type(buf, size) == Wasm_Module_Bytecode) {
 #if WASM_ENABLE_AOT != 0 && WASM_ENABLE_JIT != 0
         AOTModule *aot_module;
-        WASMModule *module = wasm_load(buf, size, error_buf, error_buf_size);
-        if (!module)
+        WASMModule *module;
+
+        if (aot_cache_dir) {
+            module_common = load_with_aot_cache(buf, size,
+                                                error_buf, error_buf_size);
+            return register_module_with_null_name(module_common,
+                                                  error_buf, error_buf_size);
+        }
+
+        if (!(module = wasm_load(buf, size, error_buf, error_buf_size)))
             return NULL;
 
         if (!(aot_module = aot_convert_wasm_module(module,
@@ -694,8 +889,22 @@ wasm_runtime_load(const uint8 *buf, uint32 size,
 }
 
 WASMModuleCommon *
-wasm_runtime_load_from_sections(WASMSection *section_list, bool is_aot,
-                                char *error_buf, uint32_t error_buf_size)
+wasm_runtime_load(const uint8 *buf, uint32 size,
+                  char *error_buf, uint32 error_buf_size)
+{
+    WASMModuleCommon *module_common;
+
+    USDT_PROBE2(module_load_begin, buf, size);
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_LOAD);
+    module_common = runtime_load(buf, size, error_buf, error_buf_size);
+    STARTUP_TIMING_END(WASM_STARTUP_LOAD);
+    USDT_PROBE1(module_load_end, module_common);
+    return module_common;
+}
+
+static WASMModuleCommon *
+runtime_load_from_sections(WASMSection *section_list, bool is_aot,
+                           char *error_buf, uint32_t error_buf_size)
 {
     WASMModuleCommon *module_common;
 
@@ -723,6 +932,22 @@ wasm_runtime_load_from_sections(WASMSection *section_list, bool is_aot,
     return NULL;
 }
 
+WASMModuleCommon *
+wasm_runtime_load_from_sections(WASMSection *section_list, bool is_aot,
+                                char *error_buf, uint32_t error_buf_size)
+{
+    WASMModuleCommon *module_common;
+
+    /* The size of the sections isn't known here */
+    USDT_PROBE2(module_load_begin, section_list, 0);
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_LOAD);
+    module_common = runtime_load_from_sections(section_list, is_aot,
+                                               error_buf, error_buf_size);
+    STARTUP_TIMING_END(WASM_STARTUP_LOAD);
+    USDT_PROBE1(module_load_end, module_common);
+    return module_common;
+}
+
 void
 wasm_runtime_unload(WASMModuleCommon *module)
 {
@@ -734,6 +959,8 @@ wasm_runtime_unload(WASMModuleCommon *module)
     return;
 #endif
 
+    USDT_PROBE1(module_unload, module);
+
 #if WASM_ENABLE_INTERP != 0
     if (module->module_type == Wasm_Module_Bytecode) {
         wasm_unload((WASMModule*)module);
@@ -749,10 +976,10 @@ wasm_runtime_unload(WASMModuleCommon *module)
 #endif
 }
 
-WASMModuleInstanceCommon *
-wasm_runtime_instantiate_internal(WASMModuleCommon *module, bool is_sub_inst,
-                                  uint32 stack_size, uint32 heap_size,
-                                  char *error_buf, uint32 error_buf_size)
+static WASMModuleInstanceCommon *
+runtime_instantiate(WASMModuleCommon *module, bool is_sub_inst,
+                    uint32 stack_size, uint32 heap_size,
+                    char *error_buf, uint32 error_buf_size)
 {
 #if WASM_ENABLE_INTERP != 0
     if (module->module_type == Wasm_Module_Bytecode)
@@ -773,6 +1000,30 @@ wasm_runtime_instantiate_internal(WASMModuleCommon *module, bool is_sub_inst,
     return NULL;
 }
 
+WASMModuleInstanceCommon *
+wasm_runtime_instantiate_internal(WASMModuleCommon *module, bool is_sub_inst,
+                                  uint32 stack_size, uint32 heap_size,
+                                  char *error_buf, uint32 error_buf_size)
+{
+    WASMModuleInstanceCommon *module_inst;
+
+    USDT_PROBE1(instantiate_begin, module);
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_INSTANTIATE);
+    module_inst = runtime_instantiate(module, is_sub_inst,
+                                      stack_size, heap_size,
+                                      error_buf, error_buf_size);
+    STARTUP_TIMING_END(WASM_STARTUP_INSTANTIATE);
+    USDT_PROBE2(instantiate_end, module, module_inst);
+
+#if WASM_ENABLE_METRICS != 0
+    /* The sub instances of the threads share the memory of their
+       parent instance */
+    if (module_inst && !is_sub_inst)
+        wasm_metrics_add_instance(module_inst);
+#endif
+    return module_inst;
+}
+
 WASMModuleInstanceCommon *
 wasm_runtime_instantiate(WASMModuleCommon *module,
                          uint32 stack_size, uint32 heap_size,
@@ -787,6 +1038,22 @@ void
 wasm_runtime_deinstantiate_internal(WASMModuleInstanceCommon *module_inst,
                                     bool is_sub_inst)
 {
+    USDT_PROBE1(deinstantiate, module_inst);
+
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+    wasm_exec_env_cache_remove_module_inst(module_inst);
+#endif
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    /* The samples refer to the functions of the instance */
+    wasm_sampling_profiler_drain();
+#endif
+
+#if WASM_ENABLE_METRICS != 0
+    if (!is_sub_inst)
+        wasm_metrics_remove_instance(module_inst);
+#endif
+
 #if WASM_ENABLE_INTERP != 0
     if (module_inst->module_type == Wasm_Module_Bytecode) {
         wasm_deinstantiate((WASMModuleInstance*)module_inst, is_sub_inst);
@@ -811,12 +1078,22 @@ WASMExecEnv *
 wasm_runtime_create_exec_env(WASMModuleInstanceCommon *module_inst,
                              uint32 stack_size)
 {
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+    WASMExecEnv *exec_env;
+
+    if ((exec_env = wasm_exec_env_cache_get(module_inst, stack_size)))
+        return exec_env;
+#endif
     return wasm_exec_env_create(module_inst, stack_size);
 }
 
 void
 wasm_runtime_destroy_exec_env(WASMExecEnv *exec_env)
 {
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+    if (wasm_exec_env_cache_put(exec_env))
+        return;
+#endif
     wasm_exec_env_destroy(exec_env);
 }
 
@@ -834,6 +1111,14 @@ wasm_runtime_init_thread_env()
 void
 wasm_runtime_destroy_thread_env()
 {
+#if WASM_ENABLE_EXEC_ENV_CACHE != 0
+    wasm_exec_env_cache_flush();
+#endif
+
+#if WASM_ENABLE_METRICS != 0
+    wasm_metrics_retire_thread();
+#endif
+
 #if WASM_ENABLE_AOT != 0
 #ifdef OS_ENABLE_HW_BOUND_CHECK
     aot_signal_destroy();
@@ -1021,6 +1306,60 @@ wasm_runtime_dump_perf_profiling(WASMModuleInstanceCommon *module_inst)
 }
 #endif
 
+#if WASM_ENABLE_STATIC_PGO != 0
+uint32
+wasm_runtime_get_pgo_prof_data_size(WASMModuleInstanceCommon *module_inst)
+{
+#if WASM_ENABLE_AOT != 0
+    if (module_inst->module_type == Wasm_Module_AoT) {
+        return aot_get_pgo_prof_data_size((AOTModuleInstance*)module_inst);
+    }
+#endif
+    return 0;
+}
+
+uint32
+wasm_runtime_dump_pgo_prof_data_to_buf(WASMModuleInstanceCommon *module_inst,
+                                       char *buf, uint32 len)
+{
+#if WASM_ENABLE_AOT != 0
+    if (module_inst->module_type == Wasm_Module_AoT) {
+        return aot_dump_pgo_prof_data_to_buf((AOTModuleInstance*)module_inst,
+                                             buf, len);
+    }
+#endif
+    return 0;
+}
+#endif
+
+uint32
+wasm_runtime_get_exec_profile_size(WASMModuleInstanceCommon *module_inst)
+{
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    if (module_inst->module_type == Wasm_Module_Bytecode) {
+        return wasm_get_exec_profile_size((WASMModuleInstance*)module_inst);
+    }
+#endif
+    (void)module_inst;
+    return 0;
+}
+
+uint32
+wasm_runtime_dump_exec_profile_to_buf(WASMModuleInstanceCommon *module_inst,
+                                      char *buf, uint32 len)
+{
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    if (module_inst->module_type == Wasm_Module_Bytecode) {
+        return wasm_dump_exec_profile_to_buf((WASMModuleInstance*)module_inst,
+                                             buf, len);
+    }
+#endif
+    (void)module_inst;
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
 WASMModuleInstanceCommon *
 wasm_runtime_get_module_inst(WASMExecEnv *exec_env)
 {
@@ -1140,6 +1479,9 @@ wasm_runtime_call_wasm(WASMExecEnv *exec_env,
                        uint32 argc, uint32 argv[])
 {
     bool ret = false;
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    WASMSamplingContext prev_sampling_ctx;
+#endif
 
     if (!wasm_runtime_exec_env_check(exec_env)) {
         LOG_ERROR("Invalid exec env stack info.");
@@ -1150,6 +1492,12 @@ wasm_runtime_call_wasm(WASMExecEnv *exec_env,
     wasm_runtime_prepare_call_function(exec_env, function);
 #endif
 
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_enter(exec_env, &prev_sampling_ctx);
+#endif
+
+    USDT_PROBE3(call_wasm_begin, exec_env, function, argc);
+
 #if WASM_ENABLE_INTERP != 0
     if (exec_env->module_inst->module_type == Wasm_Module_Bytecode)
         ret = wasm_call_function(exec_env,
@@ -1163,6 +1511,12 @@ wasm_runtime_call_wasm(WASMExecEnv *exec_env,
                                  argc, argv);
 #endif
 
+    USDT_PROBE3(call_wasm_end, exec_env, function, ret);
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_leave(&prev_sampling_ctx);
+#endif
+
 #if WASM_ENABLE_REF_TYPES != 0
     wasm_runtime_finalize_call_function(exec_env, function, ret, argv);
 #endif
@@ -3319,6 +3673,11 @@ wasm_runtime_call_indirect(WASMExecEnv *exec_env,
                            uint32_t element_indices,
                            uint32_t argc, uint32_t argv[])
 {
+    bool ret = false;
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    WASMSamplingContext prev_sampling_ctx;
+#endif
+
     if (!wasm_runtime_exec_env_check(exec_env)) {
         LOG_ERROR("Invalid exec env stack info.");
         return false;
@@ -3328,15 +3687,23 @@ wasm_runtime_call_indirect(WASMExecEnv *exec_env,
        exec_env->native_stack_boundary must have been set, we don't set
        it again */
 
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_enter(exec_env, &prev_sampling_ctx);
+#endif
+
 #if WASM_ENABLE_INTERP != 0
     if (exec_env->module_inst->module_type == Wasm_Module_Bytecode)
-        return wasm_call_indirect(exec_env, 0, element_indices, argc, argv);
+        ret = wasm_call_indirect(exec_env, 0, element_indices, argc, argv);
 #endif
 #if WASM_ENABLE_AOT != 0
     if (exec_env->module_inst->module_type == Wasm_Module_AoT)
-        return aot_call_indirect(exec_env, 0, element_indices, argc, argv);
+        ret = aot_call_indirect(exec_env, 0, element_indices, argc, argv);
 #endif
-    return false;
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_leave(&prev_sampling_ctx);
+#endif
+    return ret;
 }
 
 static void
@@ -4117,6 +4484,8 @@ wasm_runtime_invoke_c_api_native(WASMModuleInstanceCommon *module_inst,
         goto fail;
     }
 
+    /* The callbacks of wasm-c-api don't get the exec env */
+    USDT_PROBE2(host_call_begin, NULL, func_ptr);
     if (!with_env) {
         wasm_func_callback_t callback = (wasm_func_callback_t)func_ptr;
         trap = callback(params, results);
@@ -4126,6 +4495,7 @@ wasm_runtime_invoke_c_api_native(WASMModuleInstanceCommon *module_inst,
           (wasm_func_callback_with_env_t)func_ptr;
         trap = callback(wasm_c_api_env, params, results);
     }
+    USDT_PROBE3(host_call_end, NULL, func_ptr, trap == NULL);
 
     if (trap) {
         if (trap->message->data) {
@@ -356,6 +356,16 @@ wasm_runtime_full_init(RuntimeInitArgs *init_args);
 WASM_RUNTIME_API_EXTERN void
 wasm_runtime_destroy(void);
 
+/* Internal API */
+bool
+wasm_runtime_is_huge_page_enabled();
+
+#if WASM_ENABLE_AOT != 0 && WASM_ENABLE_JIT != 0
+/* Internal API */
+const char *
+wasm_runtime_get_aot_cache_dir();
+#endif
+
 /* See wasm_export.h for description */
 WASM_RUNTIME_API_EXTERN PackageType
 get_package_type(const uint8 *buf, uint32 size);
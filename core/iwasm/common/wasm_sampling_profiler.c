@@ -0,0 +1,618 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _GNU_SOURCE
+/* for the register indexes of ucontext_t */
+#define _GNU_SOURCE
+#endif
+
+#include "wasm_sampling_profiler.h"
+#include "wasm_runtime_common.h"
+#include "bh_hashmap.h"
+#include "bh_log.h"
+#include "../interpreter/wasm.h"
+#if WASM_ENABLE_INTERP != 0
+#include "../interpreter/wasm_runtime.h"
+#include "../interpreter/wasm_interp.h"
+#endif
+#if WASM_ENABLE_AOT != 0
+#include "../aot/aot_runtime.h"
+#endif
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+
+#include <ucontext.h>
+
+/*
+ * A SIGPROF driven sampling profiler: the signal is delivered to the
+ * threads consuming CPU time at the sampling frequency, the handler
+ * walks the wasm stack of the thread and records it into a slot of a
+ * fixed ring buffer without taking any lock. A background thread moves
+ * the samples recorded into the profile, which maps the folded stacks,
+ * e.g. "main;foo;bar", to their sample counts, and writes the profile
+ * when it is requested.
+ */
+
+#define SLOT_EMPTY 0
+#define SLOT_WRITING 1
+#define SLOT_READY 2
+
+#define FUNC_INDEX_UNKNOWN UINT32_MAX
+
+/* Interval of the background thread to drain the samples, in ms */
+#define DRAIN_INTERVAL_MS 100
+
+typedef struct SampleFrame {
+    WASMModuleInstanceCommon *module_inst;
+    uint32 func_index;
+} SampleFrame;
+
+typedef struct SampleSlot {
+    uint32 state;
+    uint32 depth;
+    /* the innermost frame first */
+    SampleFrame frames[WASM_SAMPLING_PROFILER_MAX_DEPTH];
+} SampleSlot;
+
+typedef struct SamplingProfiler {
+    /* whether the mutex and the semaphore are initialized */
+    bool initialized;
+    /* the fields below accessed by the signal handler are atomic */
+    uint32 running;
+    uint32 active_handlers;
+    uint32 write_pos;
+    uint32 dump_requested;
+    uint64 dropped_count;
+    SampleSlot *slots;
+    uint32 slot_count;
+
+    struct sigaction old_action;
+
+    /* lock of the profile, taken when draining and dumping */
+    korp_mutex lock;
+    /* folded stack -> sample count */
+    HashMap *profile;
+    uint64 sample_count;
+    char *profile_file;
+
+    /* wakes up the background thread, sem_post is async-signal-safe */
+    sem_t sem;
+    korp_tid thread;
+    bool thread_exit;
+} SamplingProfiler;
+
+static SamplingProfiler profiler;
+
+/* The wasm call being executed by current thread, it is touched
+   before the thread is sampled, so accessing it in the signal
+   handler doesn't allocate the TLS block */
+static os_thread_local_attribute WASMSamplingContext sampling_ctx;
+
+void
+wasm_sampling_profiler_enter(WASMExecEnv *exec_env,
+                             WASMSamplingContext *prev_ctx)
+{
+    *prev_ctx = sampling_ctx;
+    sampling_ctx.native_stack_top = (uint8 *)prev_ctx;
+    /* set after the stack top, the signal handler may interrupt */
+    __atomic_store_n(&sampling_ctx.exec_env, exec_env, __ATOMIC_RELEASE);
+}
+
+void
+wasm_sampling_profiler_leave(const WASMSamplingContext *prev_ctx)
+{
+    __atomic_store_n(&sampling_ctx.exec_env, NULL, __ATOMIC_RELEASE);
+    sampling_ctx.native_stack_top = prev_ctx->native_stack_top;
+    __atomic_store_n(&sampling_ctx.exec_env, prev_ctx->exec_env,
+                     __ATOMIC_RELEASE);
+}
+
+#if WASM_ENABLE_INTERP != 0
+static uint32
+walk_interp_frames(WASMExecEnv *exec_env, SampleFrame *frames)
+{
+    WASMModuleInstance *module_inst =
+        (WASMModuleInstance *)exec_env->module_inst;
+    WASMInterpFrame *frame = exec_env->cur_frame, *prev_frame;
+    WASMFunctionInstance *func;
+    uint8 *stack_bottom = exec_env->wasm_stack.s.bottom;
+    uint8 *stack_top = exec_env->wasm_stack.s.top_boundary;
+    uint32 depth = 0;
+
+    /* The frames are in the wasm stack, the newer frames are at the
+       higher addresses, check them in case that the signal interrupts
+       the pushing or popping of a frame */
+    while (frame && depth < WASM_SAMPLING_PROFILER_MAX_DEPTH
+           && (uint8 *)frame >= stack_bottom
+           && (uint8 *)frame + sizeof(WASMInterpFrame) <= stack_top) {
+        if ((func = frame->function)) {
+            frames[depth].module_inst =
+                (WASMModuleInstanceCommon *)module_inst;
+            /* the function of another module instance imported isn't
+               resolved */
+            frames[depth].func_index =
+                func >= module_inst->functions
+                        && func < module_inst->functions
+                                      + module_inst->function_count
+                    ? (uint32)(func - module_inst->functions)
+                    : FUNC_INDEX_UNKNOWN;
+            depth++;
+        }
+        prev_frame = frame->prev_frame;
+        if (prev_frame >= frame)
+            break;
+        frame = prev_frame;
+    }
+    return depth;
+}
+#endif
+
+#if WASM_ENABLE_AOT != 0
+static uint32
+walk_aot_frames(WASMExecEnv *exec_env, void *ucontext, SampleFrame *frames)
+{
+    WASMModuleInstanceCommon *module_inst = exec_env->module_inst;
+    AOTModule *module =
+        (AOTModule *)((AOTModuleInstance *)module_inst)->aot_module.ptr;
+    AOTFrame *frame = (AOTFrame *)exec_env->cur_frame, *prev_frame;
+    uint8 *stack_bottom = exec_env->wasm_stack.s.bottom;
+    uint8 *stack_top = exec_env->wasm_stack.s.top_boundary;
+    uintptr_t pc = 0, fp = 0, sp = 0;
+    uint32 func_indexes[WASM_SAMPLING_PROFILER_MAX_DEPTH];
+    uint32 depth = 0, count, func_index, i;
+
+    if (frame) {
+        /* The AOT code compiled with the aux stack frames pushes an
+           AOTFrame for each function called */
+        while (frame && depth < WASM_SAMPLING_PROFILER_MAX_DEPTH
+               && (uint8 *)frame >= stack_bottom
+               && (uint8 *)frame + sizeof(AOTFrame) <= stack_top) {
+            frames[depth].module_inst = module_inst;
+            frames[depth].func_index = frame->func_index;
+            depth++;
+            prev_frame = frame->prev_frame;
+            if (prev_frame >= frame)
+                break;
+            frame = prev_frame;
+        }
+        return depth;
+    }
+
+#if defined(BUILD_TARGET_X86_64) || defined(BUILD_TARGET_AMD_64)
+    pc = (uintptr_t)((ucontext_t *)ucontext)->uc_mcontext.gregs[REG_RIP];
+    fp = (uintptr_t)((ucontext_t *)ucontext)->uc_mcontext.gregs[REG_RBP];
+    sp = (uintptr_t)((ucontext_t *)ucontext)->uc_mcontext.gregs[REG_RSP];
+#elif defined(BUILD_TARGET_AARCH64)
+    pc = (uintptr_t)((ucontext_t *)ucontext)->uc_mcontext.pc;
+    fp = (uintptr_t)((ucontext_t *)ucontext)->uc_mcontext.regs[29];
+    sp = (uintptr_t)((ucontext_t *)ucontext)->uc_mcontext.sp;
+#else
+    (void)ucontext;
+#endif
+
+    /* The function code of JIT mode isn't known */
+    if ((func_index = aot_get_func_index_by_code_addr(module, (void *)pc))
+        == (uint32)-1)
+        return 0;
+
+    frames[depth].module_inst = module_inst;
+    frames[depth].func_index = func_index;
+    depth++;
+
+    /* The callers are walked with the frame records if the AOT code
+       keeps the frame pointer, the records read must be in the native
+       stack of the wasm call */
+    count = aot_walk_frame_pointers(module, (uint8 *)fp, (uint8 *)sp,
+                                    sampling_ctx.native_stack_top,
+                                    func_indexes,
+                                    WASM_SAMPLING_PROFILER_MAX_DEPTH - depth);
+    for (i = 0; i < count; i++, depth++) {
+        frames[depth].module_inst = module_inst;
+        frames[depth].func_index = func_indexes[i];
+    }
+    return depth;
+}
+#endif
+
+static void
+take_sample(WASMExecEnv *exec_env, void *ucontext)
+{
+    SampleSlot *slot;
+    uint32 pos, state = SLOT_EMPTY, depth = 0;
+
+    pos = __atomic_fetch_add(&profiler.write_pos, 1, __ATOMIC_RELAXED);
+    slot = profiler.slots + pos % profiler.slot_count;
+    /* The slot isn't drained yet if the buffer is full */
+    if (!__atomic_compare_exchange_n(&slot->state, &state, SLOT_WRITING,
+                                     false, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&profiler.dropped_count, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+#if WASM_ENABLE_INTERP != 0
+    if (exec_env->module_inst->module_type == Wasm_Module_Bytecode)
+        depth = walk_interp_frames(exec_env, slot->frames);
+#endif
+#if WASM_ENABLE_AOT != 0
+    if (exec_env->module_inst->module_type == Wasm_Module_AoT)
+        depth = walk_aot_frames(exec_env, ucontext, slot->frames);
+#endif
+    (void)ucontext;
+
+    if (depth == 0) {
+        slot->frames[0].module_inst = exec_env->module_inst;
+        slot->frames[0].func_index = FUNC_INDEX_UNKNOWN;
+        depth = 1;
+    }
+    slot->depth = depth;
+    __atomic_store_n(&slot->state, SLOT_READY, __ATOMIC_RELEASE);
+}
+
+static void
+sigprof_handler(int sig, siginfo_t *info, void *ucontext)
+{
+    int saved_errno = errno;
+    WASMExecEnv *exec_env;
+
+    (void)sig;
+    (void)info;
+
+    __atomic_add_fetch(&profiler.active_handlers, 1, __ATOMIC_SEQ_CST);
+    /* The samples of the threads not running wasm code are ignored */
+    if (__atomic_load_n(&profiler.running, __ATOMIC_SEQ_CST)
+        && (exec_env = __atomic_load_n(&sampling_ctx.exec_env,
+                                       __ATOMIC_ACQUIRE)))
+        take_sample(exec_env, ucontext);
+    __atomic_sub_fetch(&profiler.active_handlers, 1, __ATOMIC_SEQ_CST);
+
+    errno = saved_errno;
+}
+
+static const char *
+get_func_name(const SampleFrame *frame)
+{
+    uint32 func_index = frame->func_index, i;
+
+#if WASM_ENABLE_INTERP != 0
+    if (frame->module_inst->module_type == Wasm_Module_Bytecode) {
+        WASMModuleInstance *module_inst =
+            (WASMModuleInstance *)frame->module_inst;
+        WASMFunctionInstance *func = module_inst->functions + func_index;
+
+        if (func->is_import_func)
+            return func->u.func_import->field_name;
+#if WASM_ENABLE_CUSTOM_NAME_SECTION != 0
+        if (func->u.func->field_name)
+            return func->u.func->field_name;
+#endif
+        for (i = 0; i < module_inst->export_func_count; i++) {
+            if (module_inst->export_functions[i].function == func)
+                return module_inst->export_functions[i].name;
+        }
+    }
+#endif
+#if WASM_ENABLE_AOT != 0
+    if (frame->module_inst->module_type == Wasm_Module_AoT) {
+        AOTModule *module = (AOTModule *)((AOTModuleInstance *)
+                                          frame->module_inst)->aot_module.ptr;
+
+        if (func_index < module->import_func_count)
+            return module->import_funcs[func_index].func_name;
+        for (i = 0; i < module->export_count; i++) {
+            if (module->exports[i].kind == EXPORT_KIND_FUNC
+                && module->exports[i].index == func_index)
+                return module->exports[i].name;
+        }
+    }
+#endif
+    return NULL;
+}
+
+/* Append the sample to the profile, profiler.lock must be held */
+static void
+add_sample_to_profile(const SampleSlot *slot)
+{
+    char folded[WASM_SAMPLING_PROFILER_MAX_DEPTH * 48], *key;
+    uint32 len = 0, key_len, i;
+    const SampleFrame *frame;
+    const char *name;
+    void *count, *old_count;
+    int n;
+
+    /* The folded stack starts with the outermost frame */
+    for (i = slot->depth; i > 0 && len < sizeof(folded) - 1; i--) {
+        frame = slot->frames + i - 1;
+        name = frame->func_index != FUNC_INDEX_UNKNOWN
+                   ? get_func_name(frame) : "[unknown]";
+        if (name)
+            n = snprintf(folded + len, sizeof(folded) - len, "%s%s",
+                         i < slot->depth ? ";" : "", name);
+        else
+            n = snprintf(folded + len, sizeof(folded) - len, "%s$f%u",
+                         i < slot->depth ? ";" : "", frame->func_index);
+        if (n < 0)
+            break;
+        len += (uint32)n;
+    }
+    if (len > sizeof(folded) - 1)
+        len = sizeof(folded) - 1;
+    folded[len] = '\0';
+
+    profiler.sample_count++;
+    if ((count = bh_hash_map_find(profiler.profile, folded))) {
+        bh_hash_map_update(profiler.profile, folded,
+                           (void *)((uintptr_t)count + 1), &old_count);
+        return;
+    }
+
+    key_len = len + 1;
+    if (!(key = wasm_runtime_malloc(key_len)))
+        return;
+    bh_memcpy_s(key, key_len, folded, key_len);
+    if (!bh_hash_map_insert(profiler.profile, key, (void *)(uintptr_t)1))
+        wasm_runtime_free(key);
+}
+
+/* Move the samples recorded into the profile, profiler.lock must be
+   held */
+static void
+drain_samples()
+{
+    SampleSlot *slot;
+    uint32 i;
+
+    for (i = 0; i < profiler.slot_count; i++) {
+        slot = profiler.slots + i;
+        if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) == SLOT_READY) {
+            add_sample_to_profile(slot);
+            __atomic_store_n(&slot->state, SLOT_EMPTY, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+static void
+write_folded_stack(void *key, void *value, void *user_data)
+{
+    fprintf((FILE *)user_data, "%s %lu\n", (char *)key,
+            (unsigned long)(uintptr_t)value);
+}
+
+/* Write the profile, profiler.lock must be held */
+static bool
+write_profile(const char *file_path)
+{
+    FILE *file;
+
+    if (!(file = fopen(file_path, "w"))) {
+        LOG_ERROR("Open profile file %s failed: %s",
+                  file_path, strerror(errno));
+        return false;
+    }
+    bh_hash_map_traverse(profiler.profile, write_folded_stack, file);
+    fclose(file);
+
+    LOG_VERBOSE("Sampling profile written to %s, %lu samples, "
+                "%lu samples dropped", file_path,
+                (unsigned long)profiler.sample_count,
+                (unsigned long)__atomic_load_n(&profiler.dropped_count,
+                                               __ATOMIC_RELAXED));
+    return true;
+}
+
+static void *
+profiler_thread_routine(void *arg)
+{
+    struct timespec ts;
+
+    (void)arg;
+    while (!profiler.thread_exit) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += DRAIN_INTERVAL_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        sem_timedwait(&profiler.sem, &ts);
+
+        os_mutex_lock(&profiler.lock);
+        drain_samples();
+        if (__atomic_exchange_n(&profiler.dump_requested, 0,
+                                __ATOMIC_ACQ_REL)
+            && profiler.profile_file)
+            write_profile(profiler.profile_file);
+        os_mutex_unlock(&profiler.lock);
+    }
+    return NULL;
+}
+
+static void
+destroy_profile()
+{
+    if (profiler.profile) {
+        bh_hash_map_destroy(profiler.profile);
+        profiler.profile = NULL;
+    }
+    if (profiler.profile_file) {
+        wasm_runtime_free(profiler.profile_file);
+        profiler.profile_file = NULL;
+    }
+    profiler.sample_count = 0;
+    profiler.dropped_count = 0;
+}
+
+bool
+wasm_runtime_start_sampling_profiler(uint32_t frequency,
+                                     const char *profile_file)
+{
+    struct sigaction sig_act;
+    struct itimerval timer = { 0 };
+    uint64 total_size;
+    uint32 len;
+
+    if (!profiler.initialized) {
+        if (os_mutex_init(&profiler.lock) != 0)
+            return false;
+        if (sem_init(&profiler.sem, 0, 0) != 0) {
+            os_mutex_destroy(&profiler.lock);
+            return false;
+        }
+        profiler.initialized = true;
+    }
+
+    if (profiler.slots) {
+        LOG_ERROR("Sampling profiler is already started");
+        return false;
+    }
+
+    if (frequency == 0)
+        frequency = WASM_SAMPLING_PROFILER_DEFAULT_FREQUENCY;
+    if (frequency > 1000000)
+        frequency = 1000000;
+
+    /* Start a new profile */
+    destroy_profile();
+    if (!(profiler.profile =
+              bh_hash_map_create(256, false, (HashFunc)wasm_string_hash,
+                                 (KeyEqualFunc)wasm_string_equal,
+                                 wasm_runtime_free, NULL)))
+        return false;
+
+    if (profile_file) {
+        len = (uint32)strlen(profile_file) + 1;
+        if (!(profiler.profile_file = wasm_runtime_malloc(len)))
+            goto fail;
+        bh_memcpy_s(profiler.profile_file, len, profile_file, len);
+    }
+
+    profiler.slot_count = WASM_SAMPLING_PROFILER_SLOT_COUNT;
+    total_size = sizeof(SampleSlot) * (uint64)profiler.slot_count;
+    if (total_size >= UINT32_MAX
+        || !(profiler.slots = wasm_runtime_malloc((uint32)total_size)))
+        goto fail;
+    memset(profiler.slots, 0, (uint32)total_size);
+    profiler.write_pos = 0;
+
+    profiler.thread_exit = false;
+    if (os_thread_create(&profiler.thread, profiler_thread_routine, NULL,
+                         APP_THREAD_STACK_SIZE_DEFAULT) != 0) {
+        LOG_ERROR("Create sampling profiler thread failed");
+        goto fail;
+    }
+
+    memset(&sig_act, 0, sizeof(sig_act));
+    sig_act.sa_sigaction = sigprof_handler;
+    sig_act.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sig_act.sa_mask);
+    sigaction(SIGPROF, &sig_act, &profiler.old_action);
+
+    __atomic_store_n(&profiler.running, 1, __ATOMIC_SEQ_CST);
+
+    /* The CPU time consumed by all the threads of the process */
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = (suseconds_t)(1000000 / frequency);
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        LOG_ERROR("Set profiling timer failed: %s", strerror(errno));
+        wasm_runtime_stop_sampling_profiler();
+        return false;
+    }
+
+    LOG_VERBOSE("Sampling profiler started, frequency %u Hz", frequency);
+    return true;
+
+fail:
+    if (profiler.slots) {
+        wasm_runtime_free(profiler.slots);
+        profiler.slots = NULL;
+    }
+    destroy_profile();
+    return false;
+}
+
+void
+wasm_runtime_stop_sampling_profiler()
+{
+    struct itimerval timer = { 0 };
+
+    if (!profiler.slots)
+        return;
+
+    setitimer(ITIMER_PROF, &timer, NULL);
+    __atomic_store_n(&profiler.running, 0, __ATOMIC_SEQ_CST);
+    /* Wait for the signal handlers running in the other threads */
+    while (__atomic_load_n(&profiler.active_handlers, __ATOMIC_SEQ_CST))
+        sched_yield();
+
+    /* A pending SIGPROF terminates the process by default, so ignore
+       it instead of restoring the default action */
+    if (profiler.old_action.sa_handler == SIG_DFL
+        && !(profiler.old_action.sa_flags & SA_SIGINFO))
+        profiler.old_action.sa_handler = SIG_IGN;
+    sigaction(SIGPROF, &profiler.old_action, NULL);
+
+    profiler.thread_exit = true;
+    sem_post(&profiler.sem);
+    os_thread_join(profiler.thread, NULL);
+
+    /* Keep the profile for the later dump */
+    os_mutex_lock(&profiler.lock);
+    drain_samples();
+    os_mutex_unlock(&profiler.lock);
+
+    wasm_runtime_free(profiler.slots);
+    profiler.slots = NULL;
+}
+
+bool
+wasm_runtime_dump_sampling_profile(const char *file_path)
+{
+    bool ret;
+
+    if (!profiler.initialized || !profiler.profile)
+        return false;
+
+    os_mutex_lock(&profiler.lock);
+    if (profiler.slots)
+        drain_samples();
+    ret = write_profile(file_path);
+    os_mutex_unlock(&profiler.lock);
+    return ret;
+}
+
+void
+wasm_runtime_request_sampling_profile_dump()
+{
+    if (__atomic_load_n(&profiler.running, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&profiler.dump_requested, 1, __ATOMIC_SEQ_CST);
+        sem_post(&profiler.sem);
+    }
+}
+
+void
+wasm_sampling_profiler_drain()
+{
+    if (!profiler.slots)
+        return;
+
+    os_mutex_lock(&profiler.lock);
+    drain_samples();
+    os_mutex_unlock(&profiler.lock);
+}
+
+void
+wasm_sampling_profiler_destroy()
+{
+    if (!profiler.initialized)
+        return;
+
+    wasm_runtime_stop_sampling_profiler();
+    destroy_profile();
+    sem_destroy(&profiler.sem);
+    os_mutex_destroy(&profiler.lock);
+    profiler.initialized = false;
+}
+
+#endif /* end of WASM_ENABLE_SAMPLING_PROFILER != 0 */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _WASM_SAMPLING_PROFILER_H
+#define _WASM_SAMPLING_PROFILER_H
+
+#include "bh_platform.h"
+#include "wasm_exec_env.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+
+/* The wasm call being executed by current thread, the samples taken
+   in the thread are the wasm stacks of the exec env */
+typedef struct WASMSamplingContext {
+    WASMExecEnv *exec_env;
+    /* The native stack address at the entry of the wasm call, the
+       native frames of the wasm functions are below it */
+    uint8 *native_stack_top;
+} WASMSamplingContext;
+
+/**
+ * Set the wasm call being executed by current thread when entering
+ * a wasm function from the native code.
+ *
+ * @param exec_env the exec env of the call
+ * @param prev_ctx output of the previous context of current thread,
+ *        which must be a local variable of the caller, since its address
+ *        is taken as the native stack top of the call
+ */
+void
+wasm_sampling_profiler_enter(WASMExecEnv *exec_env,
+                             WASMSamplingContext *prev_ctx);
+
+/**
+ * Restore the context of current thread when the wasm call returns.
+ */
+void
+wasm_sampling_profiler_leave(const WASMSamplingContext *prev_ctx);
+
+/**
+ * Aggregate the samples taken into the profile, it must be called
+ * before a module instance is destroyed, since the samples refer to
+ * the functions of the instances.
+ */
+void
+wasm_sampling_profiler_drain();
+
+/**
+ * Stop the profiler and free its resources when destroying the runtime.
+ */
+void
+wasm_sampling_profiler_destroy();
+
+#endif /* end of WASM_ENABLE_SAMPLING_PROFILER != 0 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of _WASM_SAMPLING_PROFILER_H */
@@ -5,6 +5,8 @@
 
 #include "bh_log.h"
 #include "wasm_shared_memory.h"
+#include "wasm_metrics.h"
+#include "wasm_usdt.h"
 
 static bh_list shared_memory_list_head;
 static bh_list *const shared_memory_list = &shared_memory_list_head;
@@ -370,6 +372,9 @@ wasm_runtime_atomic_wait(WASMModuleInstanceCommon *module, void *address,
 
     os_mutex_unlock(&wait_info->wait_list_lock);
 
+    METRICS_INC(atomic_waits);
+    USDT_PROBE2(atomic_wait_begin, address, timeout);
+
     /* condition wait start */
     os_mutex_lock(&wait_node->wait_lock);
 
@@ -395,6 +400,10 @@ wasm_runtime_atomic_wait(WASMModuleInstanceCommon *module, void *address,
 
     release_wait_info(wait_map, wait_info, address);
 
+    if (is_timeout)
+        METRICS_INC(atomic_wait_timeouts);
+    USDT_PROBE2(atomic_wait_end, address, is_timeout);
+
     (void)check_ret;
     return is_timeout ? 2 : 0;
 }
@@ -406,10 +415,14 @@ wasm_runtime_atomic_notify(WASMModuleInstanceCommon *module,
     uint32 notify_result;
     AtomicWaitInfo *wait_info;
 
+    METRICS_INC(atomic_notifies);
+
     /* Nobody wait on this address */
     wait_info = acquire_wait_info(address, false);
-    if (!wait_info)
+    if (!wait_info) {
+        USDT_PROBE3(atomic_notify, address, count, 0);
         return 0;
+    }
 
     os_mutex_lock(&wait_info->wait_list_lock);
     notify_result = notify_wait_list(wait_info->wait_list, count);
@@ -417,5 +430,6 @@ wasm_runtime_atomic_notify(WASMModuleInstanceCommon *module,
 
     release_wait_info(wait_map, wait_info, address);
 
+    USDT_PROBE3(atomic_notify, address, count, notify_result);
     return notify_result;
 }
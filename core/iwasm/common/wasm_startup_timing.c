@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "wasm_startup_timing.h"
+
+#if WASM_ENABLE_STARTUP_TIMING != 0
+
+typedef struct StartupTiming {
+    uint64 time_us[WASM_STARTUP_PHASE_NUM];
+    uint32 count[WASM_STARTUP_PHASE_NUM];
+    /* begin time of the outermost run of the phase being timed */
+    uint64 begin_us[WASM_STARTUP_PHASE_NUM];
+    /* nesting depth of the phase being timed */
+    uint32 depth[WASM_STARTUP_PHASE_NUM];
+} StartupTiming;
+
+/* The phases are run synchronously in the thread calling the load and
+   instantiate APIs, so the timing is kept per thread without locks */
+static os_thread_local_attribute StartupTiming startup_timing;
+
+static const char *phase_names[WASM_STARTUP_PHASE_NUM] = {
+    "load", "parse", "validate", "compile", "relocate",
+    "instantiate", "init", "wasi init", "start functions"
+};
+
+void
+wasm_startup_timing_begin(wasm_startup_phase_t phase)
+{
+    bh_assert(phase < WASM_STARTUP_PHASE_NUM);
+    if (startup_timing.depth[phase]++ == 0)
+        startup_timing.begin_us[phase] = os_time_get_boot_microsecond();
+}
+
+void
+wasm_startup_timing_end(wasm_startup_phase_t phase)
+{
+    bh_assert(phase < WASM_STARTUP_PHASE_NUM);
+    bh_assert(startup_timing.depth[phase] > 0);
+    if (--startup_timing.depth[phase] == 0) {
+        startup_timing.time_us[phase] +=
+            os_time_get_boot_microsecond() - startup_timing.begin_us[phase];
+        startup_timing.count[phase]++;
+    }
+}
+
+/* The time of the parent phase not spent in its child phases */
+static uint64
+remaining_time(const wasm_startup_timing_t *timing,
+               wasm_startup_phase_t parent,
+               wasm_startup_phase_t first_child,
+               wasm_startup_phase_t last_child)
+{
+    uint64 children = 0;
+    uint32 i;
+
+    for (i = first_child; i <= last_child; i++)
+        children += timing->time_us[i];
+    return timing->time_us[parent] > children
+           ? timing->time_us[parent] - children : 0;
+}
+
+void
+wasm_runtime_get_startup_timing(wasm_startup_timing_t *timing)
+{
+    bh_memcpy_s(timing->time_us, sizeof(timing->time_us),
+                startup_timing.time_us, sizeof(startup_timing.time_us));
+    bh_memcpy_s(timing->count, sizeof(timing->count),
+                startup_timing.count, sizeof(startup_timing.count));
+
+    /* The parse and init phases aren't timed directly, they are
+       what remains of the load and instantiate phases */
+    timing->time_us[WASM_STARTUP_PARSE] =
+        remaining_time(timing, WASM_STARTUP_LOAD,
+                       WASM_STARTUP_VALIDATE, WASM_STARTUP_RELOCATE);
+    timing->count[WASM_STARTUP_PARSE] = timing->count[WASM_STARTUP_LOAD];
+    timing->time_us[WASM_STARTUP_INIT] =
+        remaining_time(timing, WASM_STARTUP_INSTANTIATE,
+                       WASM_STARTUP_WASI_INIT, WASM_STARTUP_START_FUNC);
+    timing->count[WASM_STARTUP_INIT] =
+        timing->count[WASM_STARTUP_INSTANTIATE];
+}
+
+void
+wasm_runtime_reset_startup_timing()
+{
+    /* Keep the phases being timed */
+    memset(startup_timing.time_us, 0, sizeof(startup_timing.time_us));
+    memset(startup_timing.count, 0, sizeof(startup_timing.count));
+}
+
+const char *
+wasm_runtime_get_startup_phase_name(wasm_startup_phase_t phase)
+{
+    if ((uint32)phase >= WASM_STARTUP_PHASE_NUM)
+        return NULL;
+    return phase_names[phase];
+}
+
+void
+wasm_runtime_dump_startup_timing()
+{
+    wasm_startup_timing_t timing;
+    uint32 i;
+
+    wasm_runtime_get_startup_timing(&timing);
+
+    os_printf("Startup timing:\n");
+    for (i = 0; i < WASM_STARTUP_PHASE_NUM; i++) {
+        bool is_total = (i == WASM_STARTUP_LOAD
+                         || i == WASM_STARTUP_INSTANTIATE);
+        /* the child phases are indented under their parents */
+        os_printf("  %s%-*s %10"PRIu64" us  (%u times)\n",
+                  is_total ? "" : "  ", is_total ? 20 : 18, phase_names[i],
+                  timing.time_us[i], timing.count[i]);
+    }
+}
+
+#endif /* end of WASM_ENABLE_STARTUP_TIMING != 0 */
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _WASM_STARTUP_TIMING_H
+#define _WASM_STARTUP_TIMING_H
+
+#include "bh_platform.h"
+#include "wasm_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if WASM_ENABLE_STARTUP_TIMING != 0
+
+/**
+ * Start timing a startup phase of current thread, the nested calls of
+ * the same phase, e.g. loading the sub modules of a module, are counted
+ * as a single run of the outermost one.
+ */
+void
+wasm_startup_timing_begin(wasm_startup_phase_t phase);
+
+/**
+ * Stop timing a startup phase of current thread.
+ */
+void
+wasm_startup_timing_end(wasm_startup_phase_t phase);
+
+#define STARTUP_TIMING_BEGIN(phase) wasm_startup_timing_begin(phase)
+#define STARTUP_TIMING_END(phase) wasm_startup_timing_end(phase)
+
+#else
+
+#define STARTUP_TIMING_BEGIN(phase) (void)0
+#define STARTUP_TIMING_END(phase) (void)0
+
+#endif /* end of WASM_ENABLE_STARTUP_TIMING != 0 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of _WASM_STARTUP_TIMING_H */
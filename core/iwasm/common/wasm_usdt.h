@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _WASM_USDT_H
+#define _WASM_USDT_H
+
+#include "bh_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if WASM_ENABLE_USDT != 0
+
+/*
+ * Static tracepoints of the "wamr" provider, which are a nop in the
+ * code and a note in the binary when no tracer is attached, e.g.
+ *   bpftrace -e 'usdt:./iwasm:wamr:trap { printf("%s\n", str(arg1)); }'
+ * The arguments must be integers or pointers.
+ */
+#include <sys/sdt.h>
+
+#define USDT_PROBE0(name) DTRACE_PROBE(wamr, name)
+#define USDT_PROBE1(name, a1) DTRACE_PROBE1(wamr, name, a1)
+#define USDT_PROBE2(name, a1, a2) DTRACE_PROBE2(wamr, name, a1, a2)
+#define USDT_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(wamr, name, a1, a2, a3)
+#define USDT_PROBE4(name, a1, a2, a3, a4) \
+    DTRACE_PROBE4(wamr, name, a1, a2, a3, a4)
+
+#else
+
+#define USDT_PROBE0(name) (void)0
+#define USDT_PROBE1(name, a1) (void)0
+#define USDT_PROBE2(name, a1, a2) (void)0
+#define USDT_PROBE3(name, a1, a2, a3) (void)0
+#define USDT_PROBE4(name, a1, a2, a3, a4) (void)0
+
+#endif /* end of WASM_ENABLE_USDT != 0 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of _WASM_USDT_H */
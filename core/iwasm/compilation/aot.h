@@ -83,6 +83,9 @@ typedef struct AOTTable {
   uint32 table_init_size;
   uint32 table_max_size;
   bool possible_grow;
+  /* whether the elements may be changed after instantiation,
+     only used by the compiler and not emitted to the AOT file */
+  bool possible_set;
 } AOTTable;
 
 /**
@@ -150,6 +153,10 @@ typedef struct AOTImportFunc {
   bool call_conv_raw;
   bool call_conv_wasm_c_api;
   bool wasm_c_api_with_env;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+  /* call stats of the registered native symbol */
+  struct WASMNativeCallStats *call_stats;
+#endif
 } AOTImportFunc;
 
 /**
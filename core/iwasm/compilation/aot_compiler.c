@@ -15,6 +15,7 @@
 #include "aot_emit_function.h"
 #include "aot_emit_parametric.h"
 #include "aot_emit_table.h"
+#include "aot_emit_pgo.h"
 #include "simd/simd_access_lanes.h"
 #include "simd/simd_bitmask_extracts.h"
 #include "simd/simd_bit_shifts.h"
@@ -99,6 +100,21 @@ read_leb(const uint8 *buf, const uint8 *buf_end,
   res = (int64)res64;                               \
 } while (0)
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* The memarg offset of memory64 is u64 */
+#define read_leb_mem_offset(p, p_end, res) do {                 \
+  uint32 off = 0;                                               \
+  uint64 res64;                                                 \
+  if (!read_leb(p, p_end, &off, is_memory64 ? 64 : 32,          \
+                false, &res64))                                 \
+    return false;                                               \
+  p += off;                                                     \
+  res = res64;                                                  \
+} while (0)
+#else
+#define read_leb_mem_offset read_leb_uint32
+#endif
+
 #define COMPILE_ATOMIC_RMW(OP, NAME)                            \
   case WASM_OP_ATOMIC_RMW_I32_##NAME:                           \
     bytes = 4;                                                  \
@@ -144,7 +160,8 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
   uint16 result_count;
   uint32 br_depth, *br_depths, br_count;
   uint32 func_idx, type_idx, mem_idx, local_idx, global_idx, i;
-  uint32 bytes = 4, align, offset;
+  uint32 bytes = 4, align;
+  uint64 offset;
   uint32 type_index;
   bool sign = true;
   int32 i32_const;
@@ -152,12 +169,21 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
   float32 f32_const;
   float64 f64_const;
   AOTFuncType *func_type = NULL;
+#if WASM_ENABLE_MEMORY64 != 0
+  bool is_memory64 = comp_ctx->comp_data->memory_count > 0
+                     && (comp_ctx->comp_data->memories[0].memory_flags
+                         & MEMORY64_FLAG);
+#endif
 
   /* Start to translate the opcodes */
   LLVMPositionBuilderAtEnd(comp_ctx->builder,
                            func_ctx->block_stack.block_list_head
                                    ->llvm_entry_block);
+
+  if (!aot_pgo_emit_func_entry(comp_ctx, func_ctx))
+    return false;
   while (frame_ip < frame_ip_end) {
+    func_ctx->frame_ip = frame_ip;
     opcode = *frame_ip++;
     switch (opcode) {
       case WASM_OP_UNREACHABLE:
@@ -482,7 +508,7 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
         sign = (opcode == WASM_OP_I32_LOAD16_S) ? true : false;
     op_i32_load:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_i32_load(comp_ctx, func_ctx, align, offset,
                                      bytes, sign, false))
           return false;
@@ -508,7 +534,7 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
         sign = (opcode == WASM_OP_I64_LOAD32_S) ? true : false;
     op_i64_load:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_i64_load(comp_ctx, func_ctx, align, offset,
                                      bytes, sign, false))
           return false;
@@ -516,14 +542,14 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
 
       case WASM_OP_F32_LOAD:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_f32_load(comp_ctx, func_ctx, align, offset))
           return false;
         break;
 
       case WASM_OP_F64_LOAD:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_f64_load(comp_ctx, func_ctx, align, offset))
           return false;
         break;
@@ -538,7 +564,7 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
         bytes = 2;
     op_i32_store:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_i32_store(comp_ctx, func_ctx, align,
                                       offset, bytes, false))
           return false;
@@ -557,7 +583,7 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
         bytes = 4;
     op_i64_store:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_i64_store(comp_ctx, func_ctx, align,
                                       offset, bytes, false))
           return false;
@@ -565,14 +591,14 @@ aot_compile_func(AOTCompContext *comp_ctx, uint32 func_index)
 
       case WASM_OP_F32_STORE:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_f32_store(comp_ctx, func_ctx, align, offset))
           return false;
         break;
 
       case WASM_OP_F64_STORE:
         read_leb_uint32(frame_ip, frame_ip_end, align);
-        read_leb_uint32(frame_ip, frame_ip_end, offset);
+        read_leb_mem_offset(frame_ip, frame_ip_end, offset);
         if (!aot_compile_op_f64_store(comp_ctx, func_ctx, align, offset))
           return false;
         break;
@@ -1243,7 +1269,7 @@ build_atomic_rmw:
           case SIMD_v128_load:
           {
             read_leb_uint32(frame_ip, frame_ip_end, align);
-            read_leb_uint32(frame_ip, frame_ip_end, offset);
+            read_leb_mem_offset(frame_ip, frame_ip_end, offset);
             if (!aot_compile_simd_v128_load(comp_ctx, func_ctx, align, offset))
               return false;
             break;
@@ -1257,7 +1283,7 @@ build_atomic_rmw:
           case SIMD_i64x2_load32x2_u:
           {
             read_leb_uint32(frame_ip, frame_ip_end, align);
-            read_leb_uint32(frame_ip, frame_ip_end, offset);
+            read_leb_mem_offset(frame_ip, frame_ip_end, offset);
             if (!aot_compile_simd_load_extend(comp_ctx, func_ctx,
                                               opcode, align, offset))
               return false;
@@ -1270,7 +1296,7 @@ build_atomic_rmw:
           case SIMD_v64x2_load_splat:
           {
             read_leb_uint32(frame_ip, frame_ip_end, align);
-            read_leb_uint32(frame_ip, frame_ip_end, offset);
+            read_leb_mem_offset(frame_ip, frame_ip_end, offset);
             if (!aot_compile_simd_load_splat(comp_ctx, func_ctx,
                                              opcode, align, offset))
               return false;
@@ -1280,7 +1306,7 @@ build_atomic_rmw:
           case SIMD_v128_store:
           {
             read_leb_uint32(frame_ip, frame_ip_end, align);
-            read_leb_uint32(frame_ip, frame_ip_end, offset);
+            read_leb_mem_offset(frame_ip, frame_ip_end, offset);
             if (!aot_compile_simd_v128_store(comp_ctx, func_ctx, align, offset))
               return false;
             break;
@@ -2045,6 +2071,16 @@ aot_compile_wasm(AOTCompContext *comp_ctx)
   bool ret;
   uint32 i;
 
+#if WASM_ENABLE_MEMORY64 != 0
+  /* The i64 addresses of memory64 are checked with 64-bit arithmetic */
+  if (comp_ctx->comp_data->memory_count > 0
+      && (comp_ctx->comp_data->memories[0].memory_flags & MEMORY64_FLAG)
+      && comp_ctx->pointer_size != sizeof(uint64)) {
+    aot_set_last_error("memory64 is only supported on 64-bit targets.");
+    return false;
+  }
+#endif
+
   bh_print_time("Begin to compile WASM bytecode to LLVM IR");
 
   for (i = 0; i < comp_ctx->func_ctx_count; i++)
@@ -2064,6 +2100,9 @@ aot_compile_wasm(AOTCompContext *comp_ctx)
   errno = 0;
 #endif
 
+  if (!aot_pgo_finalize(comp_ctx))
+      return false;
+
   bh_print_time("Begin to verify LLVM module");
 
   ret = LLVMVerifyModule(comp_ctx->module, LLVMPrintMessageAction, &msg);
@@ -2076,6 +2115,39 @@ aot_compile_wasm(AOTCompContext *comp_ctx)
       LLVMDisposeMessage(msg);
   }
 
+  /* The functions are optimized separately when emitting their
+     object files */
+  if (comp_ctx->incremental_cache_dir)
+      return true;
+
+#if WASM_ENABLE_LAZY_JIT != 0
+  if (comp_ctx->lazy_jit) {
+      char *err = NULL;
+      LLVMModuleRef module = comp_ctx->module;
+      LLVMContextRef context = comp_ctx->context;
+
+      bh_print_time("Begin to add LLVM module to lazy JIT");
+
+      /* The functions are optimized and compiled by the lazy JIT on
+         their first calls, the module and context are owned by it
+         from now on even if adding fails */
+      comp_ctx->module = NULL;
+      comp_ctx->context = NULL;
+      if (aot_lazy_jit_add_module(comp_ctx->lazy_jit, module, context,
+                                  &err) != 0) {
+          if (err) {
+              aot_set_last_error_v("add LLVM module to lazy JIT failed: %s.",
+                                   err);
+              LLVMDisposeMessage(err);
+          }
+          else
+              aot_set_last_error("add LLVM module to lazy JIT failed.");
+          return false;
+      }
+      return true;
+  }
+#endif
+
   bh_print_time("Begin to run function optimization passes");
 
   if (comp_ctx->optimize) {
@@ -2085,6 +2157,11 @@ aot_compile_wasm(AOTCompContext *comp_ctx)
                                      comp_ctx->func_ctxes[i]->func);
   }
 
+  if (comp_ctx->optimize && comp_ctx->module_pass_mgr) {
+      bh_print_time("Begin to run module optimization passes");
+      LLVMRunPassManager(comp_ctx->module_pass_mgr, comp_ctx->module);
+  }
+
   return true;
 }
 
@@ -2143,9 +2220,24 @@ typedef struct AOTFileMap {
     struct AOTFileMap *next;
 } AOTFileMap;
 
+typedef struct AOTCompileTask {
+    uint8 *wasm_file_buf;
+    uint32 wasm_file_size;
+    uint32 opt_level;
+    uint32 size_level;
+} AOTCompileTask;
+
+/* Stack size of the thread compiling the wasm file in background */
+#define AOT_COMPILE_THREAD_STACK_SIZE (8 * 1024 * 1024)
+
 static bool aot_compile_wasm_file_inited = false;
 static AOTFileMap *aot_file_maps = NULL;
+/* Lock of the file maps and the background compile task number */
 static korp_mutex aot_file_map_lock;
+/* Serialize the compilations of the wasm files */
+static korp_mutex aot_compile_lock;
+static uint32 aot_compile_task_num = 0;
+static korp_cond aot_compile_task_cond;
 
 bool
 aot_compile_wasm_file_init()
@@ -2158,7 +2250,19 @@ aot_compile_wasm_file_init()
         return false;
     }
 
+    if (BHT_OK != os_mutex_init(&aot_compile_lock)) {
+        os_mutex_destroy(&aot_file_map_lock);
+        return false;
+    }
+
+    if (BHT_OK != os_cond_init(&aot_compile_task_cond)) {
+        os_mutex_destroy(&aot_compile_lock);
+        os_mutex_destroy(&aot_file_map_lock);
+        return false;
+    }
+
     aot_file_maps = NULL;
+    aot_compile_task_num = 0;
     aot_compile_wasm_file_inited = true;
     return true;
 }
@@ -2166,12 +2270,20 @@ aot_compile_wasm_file_init()
 void
 aot_compile_wasm_file_destroy()
 {
-    AOTFileMap *file_map = aot_file_maps, *file_map_next;
+    AOTFileMap *file_map, *file_map_next;
 
     if (!aot_compile_wasm_file_inited) {
         return;
     }
 
+    /* Wait until the background compilations finish */
+    os_mutex_lock(&aot_file_map_lock);
+    while (aot_compile_task_num > 0) {
+        os_cond_wait(&aot_compile_task_cond, &aot_file_map_lock);
+    }
+    os_mutex_unlock(&aot_file_map_lock);
+
+    file_map = aot_file_maps;
     while (file_map) {
         file_map_next = file_map->next;
 
@@ -2183,6 +2295,8 @@ aot_compile_wasm_file_destroy()
     }
 
     aot_file_maps = NULL;
+    os_cond_destroy(&aot_compile_task_cond);
+    os_mutex_destroy(&aot_compile_lock);
     os_mutex_destroy(&aot_file_map_lock);
     aot_compile_wasm_file_inited = false;
 }
@@ -2196,83 +2310,85 @@ set_error_buf(char *error_buf, uint32 error_buf_size, const char *string)
     }
 }
 
-uint8*
-aot_compile_wasm_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
-                      uint32 opt_level, uint32 size_level,
-                      char *error_buf, uint32 error_buf_size,
-                      uint32 *p_aot_file_size)
+static void
+init_compile_option(AOTCompOption *option,
+                    uint32 opt_level, uint32 size_level)
 {
-    WASMModule *wasm_module = NULL;
-    AOTCompData *comp_data = NULL;
-    AOTCompContext *comp_ctx = NULL;
-    RuntimeInitArgs init_args;
-    AOTCompOption option = { 0 };
-    AOTFileMap *file_map = NULL, *file_map_next;
-    uint8 *wasm_file_buf_cloned = NULL;
-    uint8 *aot_file_buf = NULL;
-    uint32 aot_file_size;
-
-    option.is_jit_mode = false;
-    option.opt_level = opt_level;
-    option.size_level = size_level;
-    option.output_format = AOT_FORMAT_FILE;
+    /* clear the paddings too as the option is hashed as the
+       key of the on-disk AOT code cache */
+    memset(option, 0, sizeof(AOTCompOption));
+
+    option->is_jit_mode = false;
+    option->opt_level = opt_level;
+    option->size_level = size_level;
+    option->output_format = AOT_FORMAT_FILE;
     /* default value, enable or disable depends on the platform */
-    option.bounds_checks = 2;
-    option.enable_aux_stack_check = true;
+    option->bounds_checks = 2;
+    option->enable_aux_stack_check = true;
 #if WASM_ENABLE_BULK_MEMORY != 0
-    option.enable_bulk_memory = true;
+    option->enable_bulk_memory = true;
 #endif
 #if WASM_ENABLE_THREAD_MGR != 0
-    option.enable_thread_mgr = true;
+    option->enable_thread_mgr = true;
 #endif
 #if WASM_ENABLE_TAIL_CALL != 0
-  option.enable_tail_call = true;
+    option->enable_tail_call = true;
 #endif
 #if WASM_ENABLE_SIMD != 0
-  option.enable_simd = true;
+    option->enable_simd = true;
 #endif
 #if WASM_ENABLE_REF_TYPES != 0
-    option.enable_ref_types = true;
+    option->enable_ref_types = true;
 #endif
 #if (WASM_ENABLE_PERF_PROFILING != 0) || (WASM_ENABLE_DUMP_CALL_STACK != 0)
-    option.enable_aux_stack_frame = true;
+    option->enable_aux_stack_frame = true;
 #endif
+}
 
-#if WASM_ENABLE_REF_TYPES != 0
-    wasm_set_ref_types_flag(option.enable_ref_types);
-#endif
-
-    memset(&init_args, 0, sizeof(RuntimeInitArgs));
-
-    init_args.mem_alloc_type = Alloc_With_Allocator;
-    init_args.mem_alloc_option.allocator.malloc_func = malloc;
-    init_args.mem_alloc_option.allocator.realloc_func = realloc;
-    init_args.mem_alloc_option.allocator.free_func = free;
-
-    os_mutex_lock(&aot_file_map_lock);
+/* Lookup the file maps, the caller should hold aot_file_map_lock */
+static AOTFileMap *
+find_aot_file_map(const uint8 *wasm_file_buf, uint32 wasm_file_size)
+{
+    AOTFileMap *file_map = aot_file_maps;
 
-    /* lookup the file maps */
-    file_map = aot_file_maps;
     while (file_map) {
-        file_map_next = file_map->next;
-
         if (wasm_file_size == file_map->wasm_file_size
             && memcmp(wasm_file_buf, file_map->wasm_file_buf,
                       wasm_file_size) == 0) {
-            os_mutex_unlock(&aot_file_map_lock);
-            /* found */
-            *p_aot_file_size = file_map->aot_file_size;
-            return file_map->aot_file_buf;
+            return file_map;
         }
+        file_map = file_map->next;
+    }
+    return NULL;
+}
 
-        file_map = file_map_next;
+/* Add the AOT file into the file maps, the AOT file buffer is
+   owned by the file maps on success, and is freed on failure */
+static uint8 *
+add_aot_file_map(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                 uint8 *aot_file_buf, uint32 aot_file_size,
+                 char *error_buf, uint32 error_buf_size,
+                 uint32 *p_aot_file_size)
+{
+    AOTFileMap *file_map;
+    uint8 *wasm_file_buf_cloned;
+
+    os_mutex_lock(&aot_file_map_lock);
+
+    if ((file_map = find_aot_file_map(wasm_file_buf, wasm_file_size))) {
+        /* added by another thread */
+        os_mutex_unlock(&aot_file_map_lock);
+        wasm_runtime_free(aot_file_buf);
+        *p_aot_file_size = file_map->aot_file_size;
+        return file_map->aot_file_buf;
     }
 
-    /* not found, initialize file map and clone wasm file */
-    if (!(file_map = wasm_runtime_malloc(sizeof(AOTFileMap)))
-        || !(wasm_file_buf_cloned = wasm_runtime_malloc(wasm_file_size))) {
-        set_error_buf(error_buf, error_buf_size, "allocate memory failed");
-        goto fail1;
+    if (!(file_map = wasm_runtime_malloc(sizeof(AOTFileMap)))) {
+        goto fail;
+    }
+    if (!(wasm_file_buf_cloned = wasm_runtime_malloc(wasm_file_size))) {
+        wasm_runtime_free(file_map);
+        goto fail;
     }
 
     bh_memcpy_s(wasm_file_buf_cloned, wasm_file_size,
@@ -2280,10 +2396,427 @@ aot_compile_wasm_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
     memset(file_map, 0, sizeof(AOTFileMap));
     file_map->wasm_file_buf = wasm_file_buf_cloned;
     file_map->wasm_file_size = wasm_file_size;
+    file_map->aot_file_buf = aot_file_buf;
+    file_map->aot_file_size = aot_file_size;
+    file_map->next = aot_file_maps;
+    aot_file_maps = file_map;
+
+    os_mutex_unlock(&aot_file_map_lock);
+
+    *p_aot_file_size = aot_file_size;
+    return aot_file_buf;
+
+fail:
+    os_mutex_unlock(&aot_file_map_lock);
+    wasm_runtime_free(aot_file_buf);
+    set_error_buf(error_buf, error_buf_size, "allocate memory failed");
+    return NULL;
+}
+
+/* SHA-256 context, the digest of the wasm file and all that the AOT
+   code depends on is the key of the on-disk AOT code cache */
+typedef struct SHA256Context {
+    uint32 state[8];
+    uint64 length;
+    uint8 block[64];
+    uint32 block_size;
+} SHA256Context;
+
+#define SHA256_DIGEST_SIZE 32
+
+static const uint32 sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void
+sha256_transform(SHA256Context *ctx, const uint8 *block)
+{
+    uint32 w[64], v[8], s0, s1, t1, t2, i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = ((uint32)block[i * 4] << 24) | ((uint32)block[i * 4 + 1] << 16)
+               | ((uint32)block[i * 4 + 2] << 8) | (uint32)block[i * 4 + 3];
+    }
+    for (i = 16; i < 64; i++) {
+        s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18)
+             ^ (w[i - 15] >> 3);
+        s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19)
+             ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    for (i = 0; i < 8; i++)
+        v[i] = ctx->state[i];
+
+    for (i = 0; i < 64; i++) {
+        t1 = v[7]
+             + (SHA256_ROTR(v[4], 6) ^ SHA256_ROTR(v[4], 11)
+                ^ SHA256_ROTR(v[4], 25))
+             + ((v[4] & v[5]) ^ (~v[4] & v[6])) + sha256_k[i] + w[i];
+        t2 = (SHA256_ROTR(v[0], 2) ^ SHA256_ROTR(v[0], 13)
+              ^ SHA256_ROTR(v[0], 22))
+             + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = v[3] + t1;
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = t1 + t2;
+    }
+
+    for (i = 0; i < 8; i++)
+        ctx->state[i] += v[i];
+}
+
+static void
+sha256_init(SHA256Context *ctx)
+{
+    static const uint32 init_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memset(ctx, 0, sizeof(SHA256Context));
+    bh_memcpy_s(ctx->state, sizeof(ctx->state),
+                init_state, sizeof(init_state));
+}
+
+static void
+sha256_update(SHA256Context *ctx, const void *buf, uint32 size)
+{
+    const uint8 *p = (const uint8 *)buf, *p_end = p + size;
+    uint32 n;
+
+    ctx->length += size;
+    while (p < p_end) {
+        n = 64 - ctx->block_size;
+        if (n > (uint32)(p_end - p))
+            n = (uint32)(p_end - p);
+        bh_memcpy_s(ctx->block + ctx->block_size, 64 - ctx->block_size,
+                    p, n);
+        ctx->block_size += n;
+        p += n;
+        if (ctx->block_size == 64) {
+            sha256_transform(ctx, ctx->block);
+            ctx->block_size = 0;
+        }
+    }
+}
+
+static void
+sha256_final(SHA256Context *ctx, uint8 digest[SHA256_DIGEST_SIZE])
+{
+    uint64 bit_length = ctx->length * 8;
+    uint8 padding[72] = { 0x80 };
+    uint32 padding_size, i;
+
+    /* pad to 56 bytes modulo 64 and append the big-endian bit length */
+    padding_size = ctx->block_size < 56 ? 56 - ctx->block_size
+                                        : 120 - ctx->block_size;
+    for (i = 0; i < 8; i++)
+        padding[padding_size + i] = (uint8)(bit_length >> (56 - i * 8));
+    sha256_update(ctx, padding, padding_size + 8);
+
+    for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+        digest[i] = (uint8)(ctx->state[i / 4] >> (24 - (i % 4) * 8));
+}
+
+/* Header of the AOT file in the on-disk AOT code cache, the digest is
+   checked before the AOT file is loaded, so that an AOT file compiled
+   from another wasm file or with other options is never loaded even
+   if the file names collide */
+typedef struct AOTCacheFileHeader {
+    uint32 magic;
+    uint32 aot_file_size;
+    uint8 digest[SHA256_DIGEST_SIZE];
+} AOTCacheFileHeader;
+
+/* "wacc" */
+#define AOT_CACHE_FILE_MAGIC 0x63636177
+
+#ifndef BH_PLATFORM_WINDOWS
+/* The AOT files in the cache are loaded as native code, refuse the
+   directory or file which can be changed by other users */
+static bool
+check_aot_cache_file_stat(const struct stat *st, const char *path)
+{
+    if (st->st_uid != geteuid()
+        || (st->st_mode & (S_IWGRP | S_IWOTH))) {
+        LOG_WARNING("warning: AOT code cache %s is ignored since it is "
+                    "owned by another user or writable by group or others",
+                    path);
+        return false;
+    }
+    return true;
+}
+#endif
+
+/* Get the digest of the wasm file and all that the AOT code depends
+   on: the compile options, the host CPU and the layout of the runtime
+   data structures accessed by the AOT code, and the path of the AOT
+   file in the on-disk AOT code cache, which is named by the digest */
+static bool
+get_aot_cache_file_path(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                        const AOTCompOption *option,
+                        uint8 digest[SHA256_DIGEST_SIZE],
+                        char *buf, uint32 buf_size)
+{
+#if WASM_ENABLE_JIT != 0
+    const char *cache_dir = wasm_runtime_get_aot_cache_dir();
+#else
+    const char *cache_dir = NULL;
+#endif
+    uint32 runtime_info[] = { AOT_CURRENT_VERSION,
+                              (uint32)sizeof(AOTModuleInstance),
+                              (uint32)sizeof(AOTMemoryInstance),
+                              (uint32)sizeof(WASMExecEnv) };
+    SHA256Context ctx;
+    char *host_cpu, *host_features, *p;
+    uint32 i;
+    int ret;
+#ifndef BH_PLATFORM_WINDOWS
+    struct stat st;
+#endif
+
+    if (!cache_dir) {
+        return false;
+    }
+
+#ifndef BH_PLATFORM_WINDOWS
+    if (stat(cache_dir, &st) != 0 || !S_ISDIR(st.st_mode)
+        || !check_aot_cache_file_stat(&st, cache_dir)) {
+        return false;
+    }
+#endif
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, &wasm_file_size, (uint32)sizeof(uint32));
+    sha256_update(&ctx, wasm_file_buf, wasm_file_size);
+    sha256_update(&ctx, option, (uint32)sizeof(AOTCompOption));
+    sha256_update(&ctx, runtime_info, (uint32)sizeof(runtime_info));
+
+    /* the strings are terminated with '\0' in the digest to separate
+       the CPU name from the features */
+    if ((host_cpu = LLVMGetHostCPUName())) {
+        sha256_update(&ctx, host_cpu, (uint32)strlen(host_cpu) + 1);
+        LLVMDisposeMessage(host_cpu);
+    }
+    if ((host_features = LLVMGetHostCPUFeatures())) {
+        sha256_update(&ctx, host_features,
+                      (uint32)strlen(host_features) + 1);
+        LLVMDisposeMessage(host_features);
+    }
+    sha256_final(&ctx, digest);
+
+    ret = snprintf(buf, buf_size, "%s/", cache_dir);
+    if (ret <= 0 || (uint32)ret + SHA256_DIGEST_SIZE * 2 + 5 > buf_size) {
+        return false;
+    }
+    p = buf + ret;
+    for (i = 0; i < SHA256_DIGEST_SIZE; i++, p += 2)
+        snprintf(p, 3, "%02x", digest[i]);
+    bh_memcpy_s(p, 5, ".aot", 5);
+    return true;
+}
+
+static uint8 *
+read_cached_aot_file(const char *file_path,
+                     const uint8 digest[SHA256_DIGEST_SIZE],
+                     uint32 *p_aot_file_size)
+{
+    FILE *file;
+    long file_size;
+    uint32 magic, version;
+    uint8 *aot_file_buf = NULL;
+    AOTCacheFileHeader header;
+#ifndef BH_PLATFORM_WINDOWS
+    struct stat st;
+#endif
+
+    if (!(file = fopen(file_path, "rb"))) {
+        return NULL;
+    }
+
+#ifndef BH_PLATFORM_WINDOWS
+    if (fstat(fileno(file), &st) != 0
+        || !check_aot_cache_file_stat(&st, file_path)) {
+        goto fail;
+    }
+#endif
+
+    if (fseek(file, 0, SEEK_END) != 0
+        || (file_size = ftell(file)) < (long)sizeof(AOTCacheFileHeader) + 8
+        || (uint64)file_size >= UINT32_MAX
+        || fseek(file, 0, SEEK_SET) != 0
+        || fread(&header, 1, sizeof(header), file) != sizeof(header)) {
+        goto fail;
+    }
+
+    /* check the digest of the wasm file and the options, and ignore
+       the files left by an older runtime */
+    if (header.magic != AOT_CACHE_FILE_MAGIC
+        || header.aot_file_size
+           != (uint32)file_size - (uint32)sizeof(AOTCacheFileHeader)
+        || memcmp(header.digest, digest, SHA256_DIGEST_SIZE) != 0
+        || !(aot_file_buf = wasm_runtime_malloc(header.aot_file_size))) {
+        goto fail;
+    }
+
+    if (fread(aot_file_buf, 1, header.aot_file_size, file)
+        != header.aot_file_size) {
+        goto fail;
+    }
+
+    bh_memcpy_s(&magic, sizeof(uint32), aot_file_buf, sizeof(uint32));
+    bh_memcpy_s(&version, sizeof(uint32), aot_file_buf + 4, sizeof(uint32));
+    if (magic != AOT_MAGIC_NUMBER || version != AOT_CURRENT_VERSION) {
+        goto fail;
+    }
+
+    fclose(file);
+    *p_aot_file_size = header.aot_file_size;
+    return aot_file_buf;
+
+fail:
+    if (aot_file_buf)
+        wasm_runtime_free(aot_file_buf);
+    fclose(file);
+    return NULL;
+}
+
+static void
+store_cached_aot_file(const char *file_path,
+                      const uint8 digest[SHA256_DIGEST_SIZE],
+                      const uint8 *aot_file_buf, uint32 aot_file_size)
+{
+    char tmp_file_path[512];
+    uint64 tmp_id = (uint64)(uintptr_t)os_self_thread()
+                    ^ os_time_get_boot_microsecond();
+    AOTCacheFileHeader header;
+    FILE *file;
+    bool ret;
+    int n;
+
+    n = snprintf(tmp_file_path, sizeof(tmp_file_path), "%s.%08x%08x.tmp",
+                 file_path, (uint32)(tmp_id >> 32), (uint32)tmp_id);
+    if (n <= 0 || (uint32)n >= sizeof(tmp_file_path)
+        || !(file = fopen(tmp_file_path, "wb"))) {
+        LOG_WARNING("warning: failed to store AOT file to cache %s",
+                    file_path);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = AOT_CACHE_FILE_MAGIC;
+    header.aot_file_size = aot_file_size;
+    bh_memcpy_s(header.digest, SHA256_DIGEST_SIZE,
+                digest, SHA256_DIGEST_SIZE);
+
+    ret = fwrite(&header, 1, sizeof(header), file) == sizeof(header)
+          && fwrite(aot_file_buf, 1, aot_file_size, file) == aot_file_size;
+    ret = (fclose(file) == 0) && ret;
+
+    /* write to a temporary file and then rename it, so that the other
+       processes sharing the cache never read a partial AOT file */
+    if (!ret || rename(tmp_file_path, file_path) != 0) {
+        LOG_WARNING("warning: failed to store AOT file to cache %s",
+                    file_path);
+        remove(tmp_file_path);
+    }
+}
+
+/* Lookup the AOT file compiled from the wasm file in the file maps
+   and then in the on-disk AOT code cache */
+static uint8 *
+lookup_aot_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                const AOTCompOption *option, uint32 *p_aot_file_size)
+{
+    AOTFileMap *file_map;
+    char file_path[512];
+    uint8 digest[SHA256_DIGEST_SIZE];
+    uint8 *aot_file_buf;
+    uint32 aot_file_size;
+
+    os_mutex_lock(&aot_file_map_lock);
+    if ((file_map = find_aot_file_map(wasm_file_buf, wasm_file_size))) {
+        os_mutex_unlock(&aot_file_map_lock);
+        *p_aot_file_size = file_map->aot_file_size;
+        return file_map->aot_file_buf;
+    }
+    os_mutex_unlock(&aot_file_map_lock);
+
+    if (!get_aot_cache_file_path(wasm_file_buf, wasm_file_size, option,
+                                 digest, file_path, sizeof(file_path))
+        || !(aot_file_buf = read_cached_aot_file(file_path, digest,
+                                                 &aot_file_size))) {
+        return NULL;
+    }
+
+    return add_aot_file_map(wasm_file_buf, wasm_file_size,
+                            aot_file_buf, aot_file_size,
+                            NULL, 0, p_aot_file_size);
+}
+
+uint8*
+aot_lookup_cached_aot_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                           uint32 opt_level, uint32 size_level,
+                           uint32 *p_aot_file_size)
+{
+    AOTCompOption option;
+
+    init_compile_option(&option, opt_level, size_level);
+    return lookup_aot_file(wasm_file_buf, wasm_file_size,
+                           &option, p_aot_file_size);
+}
+
+uint8*
+aot_compile_wasm_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                      uint32 opt_level, uint32 size_level,
+                      char *error_buf, uint32 error_buf_size,
+                      uint32 *p_aot_file_size)
+{
+    WASMModule *wasm_module = NULL;
+    AOTCompData *comp_data = NULL;
+    AOTCompContext *comp_ctx = NULL;
+    AOTCompOption option;
+    char file_path[512];
+    uint8 digest[SHA256_DIGEST_SIZE];
+    uint8 *aot_file_buf = NULL;
+    uint32 aot_file_size;
+
+    init_compile_option(&option, opt_level, size_level);
+
+#if WASM_ENABLE_REF_TYPES != 0
+    wasm_set_ref_types_flag(option.enable_ref_types);
+#endif
+
+    os_mutex_lock(&aot_compile_lock);
+
+    /* lookup the file maps and the on-disk cache, the AOT file may
+       have been compiled by another thread when waiting for the lock */
+    if ((aot_file_buf = lookup_aot_file(wasm_file_buf, wasm_file_size,
+                                        &option, p_aot_file_size))) {
+        os_mutex_unlock(&aot_compile_lock);
+        return aot_file_buf;
+    }
 
     /* load WASM module */
     if (!(wasm_module = wasm_load(wasm_file_buf, wasm_file_size,
-                                  error_buf, sizeof(error_buf)))) {
+                                  error_buf, error_buf_size))) {
         goto fail1;
     }
 
@@ -2308,17 +2841,16 @@ aot_compile_wasm_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
         goto fail4;
     }
 
-    file_map->aot_file_buf = aot_file_buf;
-    file_map->aot_file_size = aot_file_size;
-
-    if (!aot_file_maps)
-        aot_file_maps = file_map;
-    else {
-        file_map->next = aot_file_maps;
-        aot_file_maps = file_map;
+    if (get_aot_cache_file_path(wasm_file_buf, wasm_file_size, &option,
+                                digest, file_path, sizeof(file_path))) {
+        store_cached_aot_file(file_path, digest,
+                              aot_file_buf, aot_file_size);
     }
 
-    *p_aot_file_size = aot_file_size;
+    aot_file_buf = add_aot_file_map(wasm_file_buf, wasm_file_size,
+                                    aot_file_buf, aot_file_size,
+                                    error_buf, error_buf_size,
+                                    p_aot_file_size);
 
 fail4:
     /* Destroy compiler context */
@@ -2329,14 +2861,73 @@ fail3:
 fail2:
     wasm_unload(wasm_module);
 fail1:
-    if (!aot_file_buf) {
-        if (wasm_file_buf_cloned)
-            wasm_runtime_free(wasm_file_buf_cloned);
-        if (file_map)
-            wasm_runtime_free(file_map);
+    os_mutex_unlock(&aot_compile_lock);
+
+    return aot_file_buf;
+}
+
+static void *
+aot_compile_task_routine(void *arg)
+{
+    AOTCompileTask *task = (AOTCompileTask *)arg;
+    char error_buf[128];
+    uint32 aot_file_size;
+
+    if (!aot_compile_wasm_file(task->wasm_file_buf, task->wasm_file_size,
+                               task->opt_level, task->size_level,
+                               error_buf, sizeof(error_buf),
+                               &aot_file_size)) {
+        LOG_WARNING("warning: compile wasm file in background failed: %s",
+                    error_buf);
     }
 
+    wasm_runtime_free(task->wasm_file_buf);
+    wasm_runtime_free(task);
+
+    os_mutex_lock(&aot_file_map_lock);
+    aot_compile_task_num--;
+    os_cond_signal(&aot_compile_task_cond);
     os_mutex_unlock(&aot_file_map_lock);
+    return NULL;
+}
 
-    return aot_file_buf;
+bool
+aot_compile_wasm_file_in_background(const uint8 *wasm_file_buf,
+                                    uint32 wasm_file_size,
+                                    uint32 opt_level, uint32 size_level)
+{
+    AOTCompileTask *task;
+    korp_tid tid;
+
+    if (!(task = wasm_runtime_malloc(sizeof(AOTCompileTask)))) {
+        return false;
+    }
+
+    if (!(task->wasm_file_buf = wasm_runtime_malloc(wasm_file_size))) {
+        wasm_runtime_free(task);
+        return false;
+    }
+
+    bh_memcpy_s(task->wasm_file_buf, wasm_file_size,
+                wasm_file_buf, wasm_file_size);
+    task->wasm_file_size = wasm_file_size;
+    task->opt_level = opt_level;
+    task->size_level = size_level;
+
+    os_mutex_lock(&aot_file_map_lock);
+    aot_compile_task_num++;
+    os_mutex_unlock(&aot_file_map_lock);
+
+    if (os_thread_create(&tid, aot_compile_task_routine, task,
+                         AOT_COMPILE_THREAD_STACK_SIZE) != BHT_OK) {
+        os_mutex_lock(&aot_file_map_lock);
+        aot_compile_task_num--;
+        os_mutex_unlock(&aot_file_map_lock);
+        wasm_runtime_free(task->wasm_file_buf);
+        wasm_runtime_free(task);
+        return false;
+    }
+
+    os_thread_detach(tid);
+    return true;
 }
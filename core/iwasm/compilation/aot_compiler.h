@@ -373,6 +373,11 @@ aot_emit_aot_file_buf(AOTCompContext *comp_ctx,
                       AOTCompData *comp_data,
                       uint32 *p_aot_file_size);
 
+bool
+aot_emit_fat_aot_file(AOTCompData *comp_data, AOTCompOption *option,
+                      char **target_cpus, uint32 target_cpu_count,
+                      const char *file_name);
+
 bool
 aot_emit_object_file(AOTCompContext *comp_ctx, char *file_name);
 
@@ -382,6 +387,21 @@ aot_compile_wasm_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
                       char *error_buf, uint32 error_buf_size,
                       uint32 *p_aot_file_size);
 
+/* Lookup the AOT file compiled from the wasm file by
+   aot_compile_wasm_file, in memory or in the on-disk AOT
+   code cache, return NULL if it isn't compiled yet */
+uint8*
+aot_lookup_cached_aot_file(const uint8 *wasm_file_buf, uint32 wasm_file_size,
+                           uint32 opt_level, uint32 size_level,
+                           uint32 *p_aot_file_size);
+
+/* Compile the wasm file with aot_compile_wasm_file in a
+   background thread */
+bool
+aot_compile_wasm_file_in_background(const uint8 *wasm_file_buf,
+                                    uint32 wasm_file_size,
+                                    uint32 opt_level, uint32 size_level);
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -62,6 +62,13 @@ typedef struct AOTObjectData {
     AOTSymbolList symbol_list;
     AOTRelocationGroup *relocation_groups;
     uint32 relocation_group_count;
+
+    /* The object files of the functions merged into this one when
+       compiling incrementally, the text, literal and data sections
+       are owned by the merged object, and the binary is borrowed
+       from the first function object */
+    struct AOTObjectData **func_objs;
+    uint32 func_obj_count;
 } AOTObjectData;
 
 #if 0
@@ -992,7 +999,7 @@ aot_emit_target_info_section(uint8 *buf, uint8 *buf_end, uint32 *p_offset,
     EMIT_U16(target_info->e_machine);
     EMIT_U32(target_info->e_version);
     EMIT_U32(target_info->e_flags);
-    EMIT_U32(target_info->reserved);
+    EMIT_U32(target_info->feature_flags);
     EMIT_BUF(target_info->arch, sizeof(target_info->arch));
 
     if (offset - *p_offset != section_size + sizeof(uint32) * 2) {
@@ -1694,6 +1701,9 @@ aot_resolve_target_info(AOTCompContext *comp_ctx, AOTObjectData *obj_data)
     strncpy(obj_data->target_info.arch, comp_ctx->target_arch,
             sizeof(obj_data->target_info.arch));
 
+    if (comp_ctx->enable_frame_pointer)
+        obj_data->target_info.feature_flags |= AOT_FEATURE_FRAME_POINTER;
+
     return true;
 }
 
@@ -1831,7 +1841,7 @@ aot_resolve_functions(AOTCompContext *comp_ctx, AOTObjectData *obj_data)
 {
     AOTObjectFunc *func;
     LLVMSymbolIteratorRef sym_itr;
-    char *name, *prefix = AOT_FUNC_PREFIX;
+    char *name, *name_end, *prefix = AOT_FUNC_PREFIX;
     uint32 func_index, total_size;
 
     /* allocate memory for aot function */
@@ -1853,8 +1863,11 @@ aot_resolve_functions(AOTCompContext *comp_ctx, AOTObjectData *obj_data)
     while (!LLVMObjectFileIsSymbolIteratorAtEnd(obj_data->binary, sym_itr)) {
         if ((name = (char *)LLVMGetSymbolName(sym_itr))
             && str_starts_with(name, prefix)) {
-            func_index = (uint32)atoi(name + strlen(prefix));
-            if (func_index < obj_data->func_count) {
+            /* Skip the functions outlined from the aot functions, e.g.
+               "aot_func#1.cold.1" created by hot/cold splitting */
+            func_index = (uint32)strtoul(name + strlen(prefix), &name_end, 10);
+            if (*name_end == '\0'
+                && func_index < obj_data->func_count) {
                 func = obj_data->funcs + func_index;
                 func->func_name = name;
                 func->text_offset = LLVMGetSymbolAddress(sym_itr);
@@ -2137,10 +2150,27 @@ destroy_relocation_symbol_list(AOTSymbolList *symbol_list)
 static void
 aot_obj_data_destroy(AOTObjectData *obj_data)
 {
-    if (obj_data->binary)
-        LLVMDisposeBinary(obj_data->binary);
-    if (obj_data->mem_buf)
-        LLVMDisposeMemoryBuffer(obj_data->mem_buf);
+    uint32 i;
+
+    if (obj_data->func_objs) {
+        if (obj_data->text)
+            wasm_runtime_free(obj_data->text);
+        if (obj_data->literal)
+            wasm_runtime_free(obj_data->literal);
+        for (i = 0; i < obj_data->data_sections_count; i++)
+            if (obj_data->data_sections[i].data)
+                wasm_runtime_free(obj_data->data_sections[i].data);
+        for (i = 0; i < obj_data->func_obj_count; i++)
+            if (obj_data->func_objs[i])
+                aot_obj_data_destroy(obj_data->func_objs[i]);
+        wasm_runtime_free(obj_data->func_objs);
+    }
+    else {
+        if (obj_data->binary)
+            LLVMDisposeBinary(obj_data->binary);
+        if (obj_data->mem_buf)
+            LLVMDisposeMemoryBuffer(obj_data->mem_buf);
+    }
     if (obj_data->funcs)
         wasm_runtime_free(obj_data->funcs);
     if (obj_data->data_sections)
@@ -2153,32 +2183,23 @@ aot_obj_data_destroy(AOTObjectData *obj_data)
     wasm_runtime_free(obj_data);
 }
 
+/* Create the object data from the object file in the memory buffer,
+   which is owned by the object data on success */
 static AOTObjectData *
-aot_obj_data_create(AOTCompContext *comp_ctx)
+aot_obj_data_create_from_mem_buf(AOTCompContext *comp_ctx,
+                                 LLVMMemoryBufferRef mem_buf,
+                                 bool is_func_obj)
 {
     char *err = NULL;
     AOTObjectData *obj_data;
 
-    bh_print_time("Begin to emit object file to buffer");
-
     if (!(obj_data = wasm_runtime_malloc(sizeof(AOTObjectData)))) {
         aot_set_last_error("allocate memory failed.");
-        return false;
+        LLVMDisposeMemoryBuffer(mem_buf);
+        return NULL;
     }
     memset(obj_data, 0, sizeof(AOTObjectData));
-
-    if (LLVMTargetMachineEmitToMemoryBuffer(comp_ctx->target_machine,
-                                            comp_ctx->module,
-                                            LLVMObjectFile,
-                                            &err,
-                                            &obj_data->mem_buf) != 0) {
-        if (err) {
-            LLVMDisposeMessage(err);
-            err = NULL;
-        }
-        aot_set_last_error("llvm emit to memory buffer failed.");
-        goto fail;
-    }
+    obj_data->mem_buf = mem_buf;
 
     if (!(obj_data->binary =
                 LLVMCreateBinary(obj_data->mem_buf, NULL, &err))) {
@@ -2190,24 +2211,614 @@ aot_obj_data_create(AOTCompContext *comp_ctx)
         goto fail;
     }
 
-    bh_print_time("Begin to resolve object file info");
-
-    /* resolve target info/text/relocations/functions */
+    /* resolve target info/text/relocations/functions, the function
+       of a function object is resolved when merging */
     if (!aot_resolve_target_info(comp_ctx, obj_data)
         || !aot_resolve_text(obj_data)
         || !aot_resolve_literal(obj_data)
         || !aot_resolve_object_data_sections(obj_data)
         || !aot_resolve_object_relocation_groups(obj_data)
-        || !aot_resolve_functions(comp_ctx, obj_data))
+        || (!is_func_obj && !aot_resolve_functions(comp_ctx, obj_data)))
+        goto fail;
+
+    return obj_data;
+
+fail:
+    aot_obj_data_destroy(obj_data);
+    return NULL;
+}
+
+/* Implemented in aot_llvm_extra.cpp */
+LLVMModuleRef
+aot_clone_func_module(LLVMModuleRef module, LLVMValueRef func);
+
+/* FNV-1a hash */
+static uint64
+hash_string(uint64 hash, const char *str)
+{
+    while (*str) {
+        hash ^= (uint8)*str++;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* Get the path of the function object in the incremental compilation
+   cache, which is named by the hash of the function's unoptimized
+   module, containing all that the function depends on, and of the
+   options to optimize it and generate the code */
+static bool
+get_func_obj_file_path(AOTCompContext *comp_ctx, LLVMModuleRef module,
+                       char *buf, uint32 buf_size)
+{
+    char *ir, *triple, *cpu, *features, options[128];
+    uint64 hash = 0xcbf29ce484222325ULL;
+    uint32 ir_size;
+    int ret;
+
+    snprintf(options, sizeof(options), "%s-%u-%u-%u-%d-%d-%d",
+             LLVM_VERSION_STRING, AOT_CURRENT_VERSION,
+             comp_ctx->opt_level, comp_ctx->size_level,
+             comp_ctx->optimize, comp_ctx->enable_thread_mgr,
+             comp_ctx->pgo_prof_counters ? 1 : 0);
+    hash = hash_string(hash, options);
+
+    triple = LLVMGetTargetMachineTriple(comp_ctx->target_machine);
+    cpu = LLVMGetTargetMachineCPU(comp_ctx->target_machine);
+    features = LLVMGetTargetMachineFeatureString(comp_ctx->target_machine);
+    if (triple) {
+        hash = hash_string(hash, triple);
+        LLVMDisposeMessage(triple);
+    }
+    if (cpu) {
+        hash = hash_string(hash, cpu);
+        LLVMDisposeMessage(cpu);
+    }
+    if (features) {
+        hash = hash_string(hash, features);
+        LLVMDisposeMessage(features);
+    }
+
+    if (!(ir = LLVMPrintModuleToString(module))) {
+        aot_set_last_error("llvm print module to string failed.");
+        return false;
+    }
+    hash = hash_string(hash, ir);
+    ir_size = (uint32)strlen(ir);
+    LLVMDisposeMessage(ir);
+
+    ret = snprintf(buf, buf_size, "%s/%08x%08x-%x.o",
+                   comp_ctx->incremental_cache_dir,
+                   (uint32)(hash >> 32), (uint32)hash, ir_size);
+    if (ret <= 0 || (uint32)ret >= buf_size) {
+        aot_set_last_error("incremental cache path is too long.");
+        return false;
+    }
+    return true;
+}
+
+static bool
+store_func_obj_file(const char *file_path, LLVMMemoryBufferRef mem_buf)
+{
+    char tmp_file_path[512];
+    uint64 tmp_id = (uint64)(uintptr_t)os_self_thread()
+                    ^ os_time_get_boot_microsecond();
+    size_t size = LLVMGetBufferSize(mem_buf);
+    FILE *file;
+    bool ret;
+    int n;
+
+    n = snprintf(tmp_file_path, sizeof(tmp_file_path), "%s.%08x%08x.tmp",
+                 file_path, (uint32)(tmp_id >> 32), (uint32)tmp_id);
+    if (n <= 0 || (uint32)n >= sizeof(tmp_file_path)
+        || !(file = fopen(tmp_file_path, "wb"))) {
+        aot_set_last_error("create file in incremental cache failed.");
+        return false;
+    }
+
+    ret = fwrite(LLVMGetBufferStart(mem_buf), 1, size, file) == size;
+    ret = (fclose(file) == 0) && ret;
+
+    /* write to a temporary file and then rename it, so that the
+       compilations sharing the cache never read a partial file */
+    if (!ret || rename(tmp_file_path, file_path) != 0) {
+        remove(tmp_file_path);
+        aot_set_last_error("write file to incremental cache failed.");
+        return false;
+    }
+    return true;
+}
+
+/* Get the object file of a function from the incremental compilation
+   cache, or optimize and compile the function alone and store its
+   object file into the cache if it isn't found */
+static LLVMMemoryBufferRef
+emit_func_obj_to_mem_buf(AOTCompContext *comp_ctx, uint32 func_index)
+{
+    LLVMValueRef func = comp_ctx->func_ctxes[func_index]->func;
+    LLVMModuleRef module;
+    LLVMPassManagerRef pass_mgr;
+    LLVMMemoryBufferRef mem_buf = NULL;
+    char file_path[512], *err = NULL;
+    const char *func_name;
+    size_t func_name_len;
+
+    if (!(module = aot_clone_func_module(comp_ctx->module, func))) {
+        aot_set_last_error("clone function module failed.");
+        return NULL;
+    }
+
+    if (!get_func_obj_file_path(comp_ctx, module,
+                                file_path, sizeof(file_path)))
+        goto fail;
+
+    if (LLVMCreateMemoryBufferWithContentsOfFile(file_path,
+                                                 &mem_buf, &err) == 0) {
+        /* found in cache */
+        LLVMDisposeModule(module);
+        return mem_buf;
+    }
+    if (err) {
+        LLVMDisposeMessage(err);
+        err = NULL;
+    }
+
+    if (comp_ctx->optimize) {
+        func_name = LLVMGetValueName2(func, &func_name_len);
+        if (!(pass_mgr = aot_create_func_pass_mgr(comp_ctx, module)))
+            goto fail;
+        LLVMInitializeFunctionPassManager(pass_mgr);
+        LLVMRunFunctionPassManager(pass_mgr,
+                                   LLVMGetNamedFunction(module, func_name));
+        LLVMFinalizeFunctionPassManager(pass_mgr);
+        LLVMDisposePassManager(pass_mgr);
+
+        if (comp_ctx->module_pass_mgr)
+            LLVMRunPassManager(comp_ctx->module_pass_mgr, module);
+    }
+
+    if (LLVMTargetMachineEmitToMemoryBuffer(comp_ctx->target_machine,
+                                            module, LLVMObjectFile,
+                                            &err, &mem_buf) != 0) {
+        if (err) {
+            LLVMDisposeMessage(err);
+            err = NULL;
+        }
+        aot_set_last_error("llvm emit to memory buffer failed.");
+        goto fail;
+    }
+
+    if (!store_func_obj_file(file_path, mem_buf)) {
+        LLVMDisposeMemoryBuffer(mem_buf);
+        mem_buf = NULL;
+    }
+
+fail:
+    LLVMDisposeModule(module);
+    return mem_buf;
+}
+
+/* Alignment of each function object's sections in the merged sections */
+static uint32
+get_merged_section_align(const char *section_name)
+{
+    uint32 align = 16;
+
+    /* ".rodata.cst32" of AVX constants requires 32-byte alignment */
+    if (str_starts_with(section_name, ".rodata.cst"))
+        align = (uint32)atoi(section_name + strlen(".rodata.cst"));
+    return align > 16 ? align : 16;
+}
+
+static AOTObjectDataSection *
+find_object_data_section(AOTObjectData *obj_data, const char *name)
+{
+    uint32 i;
+
+    for (i = 0; i < obj_data->data_sections_count; i++)
+        if (!strcmp(obj_data->data_sections[i].name, name))
+            return obj_data->data_sections + i;
+    return NULL;
+}
+
+static AOTRelocationGroup *
+find_relocation_group(AOTObjectData *obj_data, const char *name)
+{
+    uint32 i;
+
+    for (i = 0; i < obj_data->relocation_group_count; i++)
+        if (!strcmp(obj_data->relocation_groups[i].section_name, name))
+            return obj_data->relocation_groups + i;
+    return NULL;
+}
+
+/* Offsets of the sections of the function objects in the merged object */
+typedef struct AOTFuncObjOffsets {
+    uint32 text;
+    uint32 literal;
+    /* of each data section in the function object */
+    uint32 *data;
+} AOTFuncObjOffsets;
+
+/* Get the offset of the section in the merged object to add to the
+   symbol address of the relocations referring the section */
+static bool
+get_func_obj_section_offset(AOTObjectData *func_obj,
+                            AOTFuncObjOffsets *offsets,
+                            const char *section_name, uint32 *p_offset)
+{
+    AOTObjectDataSection *data_section;
+
+    if (!strcmp(section_name, ".text"))
+        *p_offset = offsets->text;
+    else if (!strcmp(section_name, ".literal"))
+        *p_offset = offsets->literal;
+    else if ((data_section =
+                find_object_data_section(func_obj, section_name)))
+        *p_offset = offsets->data[data_section - func_obj->data_sections];
+    else
+        return false;
+    return true;
+}
+
+static bool
+resolve_func_obj_function(AOTObjectData *func_obj, const char *func_name,
+                          AOTObjectFunc *func)
+{
+    LLVMSymbolIteratorRef sym_itr;
+    const char *name;
+    bool found = false;
+
+    if (!(sym_itr = LLVMObjectFileCopySymbolIterator(func_obj->binary))) {
+        aot_set_last_error("llvm get symbol iterator failed.");
+        return false;
+    }
+    while (!LLVMObjectFileIsSymbolIteratorAtEnd(func_obj->binary, sym_itr)) {
+        if ((name = LLVMGetSymbolName(sym_itr))
+            && !strcmp(name, func_name)) {
+            func->func_name = (char *)name;
+            func->text_offset = LLVMGetSymbolAddress(sym_itr);
+            found = true;
+            break;
+        }
+        LLVMMoveToNextSymbol(sym_itr);
+    }
+    LLVMDisposeSymbolIterator(sym_itr);
+
+    if (!found)
+        aot_set_last_error("function not found in its object file.");
+    return found;
+}
+
+/* Lay out the sections of the function objects in the merged object,
+   the data sections of the same name are merged into one */
+static bool
+layout_merged_sections(AOTObjectData *obj_data, AOTFuncObjOffsets *offsets)
+{
+    AOTObjectData *func_obj;
+    AOTObjectDataSection *data_section, *merged_section;
+    uint32 i, j, align, count = 0;
+    uint64 size;
+
+    for (i = 0; i < obj_data->func_obj_count; i++)
+        count += obj_data->func_objs[i]->data_sections_count;
+
+    if (count > 0) {
+        size = (uint64)sizeof(AOTObjectDataSection) * count;
+        if (size >= UINT32_MAX
+            || !(obj_data->data_sections = wasm_runtime_malloc((uint32)size))) {
+            aot_set_last_error("allocate memory for data sections failed.");
+            return false;
+        }
+        memset(obj_data->data_sections, 0, (uint32)size);
+    }
+
+    for (i = 0; i < obj_data->func_obj_count; i++) {
+        func_obj = obj_data->func_objs[i];
+
+        offsets[i].text = align_uint(obj_data->text_size, 16);
+        obj_data->text_size = offsets[i].text + func_obj->text_size;
+        offsets[i].literal = align_uint(obj_data->literal_size, 16);
+        obj_data->literal_size = offsets[i].literal + func_obj->literal_size;
+
+        for (j = 0; j < func_obj->data_sections_count; j++) {
+            data_section = func_obj->data_sections + j;
+            if (!(merged_section =
+                    find_object_data_section(obj_data, data_section->name))) {
+                merged_section = obj_data->data_sections
+                                 + obj_data->data_sections_count++;
+                merged_section->name = data_section->name;
+            }
+            align = get_merged_section_align(data_section->name);
+            offsets[i].data[j] = align_uint(merged_section->size, align);
+            merged_section->size = offsets[i].data[j] + data_section->size;
+        }
+    }
+    return true;
+}
+
+static bool
+merge_func_obj_sections(AOTObjectData *obj_data, AOTFuncObjOffsets *offsets)
+{
+    AOTObjectData *func_obj;
+    AOTObjectDataSection *data_section, *merged_section;
+    uint32 i, j;
+
+    if (obj_data->text_size > 0
+        && !(obj_data->text = wasm_runtime_malloc(obj_data->text_size))) {
+        aot_set_last_error("allocate memory for text section failed.");
+        return false;
+    }
+    if (obj_data->literal_size > 0
+        && !(obj_data->literal = wasm_runtime_malloc(obj_data->literal_size))) {
+        aot_set_last_error("allocate memory for literal section failed.");
+        return false;
+    }
+    for (i = 0; i < obj_data->data_sections_count; i++) {
+        merged_section = obj_data->data_sections + i;
+        if (merged_section->size > 0
+            && !(merged_section->data =
+                    wasm_runtime_malloc(merged_section->size))) {
+            aot_set_last_error("allocate memory for data section failed.");
+            return false;
+        }
+        /* zero the paddings */
+        if (merged_section->data)
+            memset(merged_section->data, 0, merged_section->size);
+    }
+    if (obj_data->text)
+        memset(obj_data->text, 0, obj_data->text_size);
+    if (obj_data->literal)
+        memset(obj_data->literal, 0, obj_data->literal_size);
+
+    for (i = 0; i < obj_data->func_obj_count; i++) {
+        func_obj = obj_data->func_objs[i];
+
+        if (func_obj->text_size > 0)
+            bh_memcpy_s((uint8 *)obj_data->text + offsets[i].text,
+                        obj_data->text_size - offsets[i].text,
+                        func_obj->text, func_obj->text_size);
+        if (func_obj->literal_size > 0)
+            bh_memcpy_s((uint8 *)obj_data->literal + offsets[i].literal,
+                        obj_data->literal_size - offsets[i].literal,
+                        func_obj->literal, func_obj->literal_size);
+
+        for (j = 0; j < func_obj->data_sections_count; j++) {
+            data_section = func_obj->data_sections + j;
+            merged_section = find_object_data_section(obj_data,
+                                                      data_section->name);
+            if (data_section->size > 0)
+                bh_memcpy_s(merged_section->data + offsets[i].data[j],
+                            merged_section->size - offsets[i].data[j],
+                            data_section->data, data_section->size);
+        }
+    }
+    return true;
+}
+
+static bool
+merge_func_obj_relocations(AOTObjectData *obj_data,
+                           AOTFuncObjOffsets *offsets)
+{
+    AOTObjectData *func_obj;
+    AOTRelocationGroup *group, *merged_group;
+    AOTRelocation *relocation, *merged_relocation;
+    uint32 i, j, k, count = 0, section_offset, symbol_offset;
+    uint64 size;
+
+    for (i = 0; i < obj_data->func_obj_count; i++)
+        count += obj_data->func_objs[i]->relocation_group_count;
+
+    if (count == 0)
+        return true;
+
+    size = (uint64)sizeof(AOTRelocationGroup) * count;
+    if (size >= UINT32_MAX
+        || !(obj_data->relocation_groups =
+                wasm_runtime_malloc((uint32)size))) {
+        aot_set_last_error("allocate memory for relocation groups failed.");
+        return false;
+    }
+    memset(obj_data->relocation_groups, 0, (uint32)size);
+
+    /* count the relocations of each merged group */
+    for (i = 0; i < obj_data->func_obj_count; i++) {
+        func_obj = obj_data->func_objs[i];
+        for (j = 0; j < func_obj->relocation_group_count; j++) {
+            group = func_obj->relocation_groups + j;
+            /* The addends of the REL relocations are in the section
+               contents, which are arch-specific to adjust */
+            if (!str_starts_with(group->section_name, ".rela.")) {
+                aot_set_last_error("incremental compilation isn't supported "
+                                   "for the target.");
+                return false;
+            }
+            if (!(merged_group =
+                    find_relocation_group(obj_data, group->section_name))) {
+                merged_group = obj_data->relocation_groups
+                               + obj_data->relocation_group_count++;
+                merged_group->section_name = group->section_name;
+            }
+            merged_group->relocation_count += group->relocation_count;
+        }
+    }
+
+    for (i = 0; i < obj_data->relocation_group_count; i++) {
+        merged_group = obj_data->relocation_groups + i;
+        size = (uint64)sizeof(AOTRelocation) * merged_group->relocation_count;
+        if (size >= UINT32_MAX
+            || !(merged_group->relocations =
+                    wasm_runtime_malloc((uint32)size))) {
+            aot_set_last_error("allocate memory for relocations failed.");
+            return false;
+        }
+        /* refilled below */
+        merged_group->relocation_count = 0;
+    }
+
+    for (i = 0; i < obj_data->func_obj_count; i++) {
+        func_obj = obj_data->func_objs[i];
+        for (j = 0; j < func_obj->relocation_group_count; j++) {
+            group = func_obj->relocation_groups + j;
+            merged_group = find_relocation_group(obj_data,
+                                                 group->section_name);
+
+            /* ".rela.text" relocates ".text" and so on */
+            if (!get_func_obj_section_offset(func_obj, offsets + i,
+                                             group->section_name
+                                             + strlen(".rela"),
+                                             &section_offset)) {
+                aot_set_last_error("invalid relocation section.");
+                return false;
+            }
+
+            relocation = group->relocations;
+            for (k = 0; k < group->relocation_count; k++, relocation++) {
+                merged_relocation = merged_group->relocations
+                                    + merged_group->relocation_count++;
+                *merged_relocation = *relocation;
+                merged_relocation->relocation_offset += section_offset;
+                /* The relocations referring the sections of the function
+                   object, e.g. the constants in ".rodata.cst16", are
+                   moved together with the sections */
+                if (get_func_obj_section_offset(func_obj, offsets + i,
+                                                relocation->symbol_name,
+                                                &symbol_offset))
+                    merged_relocation->relocation_addend += symbol_offset;
+            }
+        }
+    }
+    return true;
+}
+
+/* Compile the functions separately with the incremental compilation
+   cache, and merge their object files into one */
+static AOTObjectData *
+aot_obj_data_create_incremental(AOTCompContext *comp_ctx)
+{
+    AOTObjectData *obj_data, *func_obj;
+    AOTFuncObjOffsets *offsets = NULL;
+    LLVMMemoryBufferRef mem_buf;
+    uint32 func_count = comp_ctx->comp_data->func_count;
+    uint32 i, data_count = 0, *data_offsets = NULL;
+    uint64 size;
+    char func_name[48];
+
+    bh_print_time("Begin to emit function object files incrementally");
+
+    if (!(obj_data = wasm_runtime_malloc(sizeof(AOTObjectData)))) {
+        aot_set_last_error("allocate memory failed.");
+        return NULL;
+    }
+    memset(obj_data, 0, sizeof(AOTObjectData));
+
+    size = (uint64)sizeof(AOTObjectData *) * func_count;
+    if (size >= UINT32_MAX
+        || !(obj_data->func_objs = wasm_runtime_malloc((uint32)size))) {
+        aot_set_last_error("allocate memory failed.");
+        goto fail;
+    }
+    memset(obj_data->func_objs, 0, (uint32)size);
+
+    size = (uint64)sizeof(AOTObjectFunc) * func_count;
+    if (size >= UINT32_MAX
+        || !(obj_data->funcs = wasm_runtime_malloc((uint32)size))) {
+        aot_set_last_error("allocate memory for functions failed.");
+        goto fail;
+    }
+    memset(obj_data->funcs, 0, (uint32)size);
+    obj_data->func_count = func_count;
+
+    for (i = 0; i < func_count; i++) {
+        if (!(mem_buf = emit_func_obj_to_mem_buf(comp_ctx, i))
+            || !(func_obj = obj_data->func_objs[i] =
+                    aot_obj_data_create_from_mem_buf(comp_ctx, mem_buf,
+                                                     true)))
+            goto fail;
+        obj_data->func_obj_count++;
+        data_count += func_obj->data_sections_count;
+    }
+
+    bh_print_time("Begin to merge function object files");
+
+    /* The binary is only used to get the object file's format */
+    func_obj = obj_data->func_objs[0];
+    obj_data->binary = func_obj->binary;
+    obj_data->target_info = func_obj->target_info;
+
+    size = (uint64)sizeof(AOTFuncObjOffsets) * func_count;
+    if (size >= UINT32_MAX
+        || !(offsets = wasm_runtime_malloc((uint32)size))
+        || (data_count > 0
+            && !(data_offsets =
+                    wasm_runtime_malloc(sizeof(uint32) * data_count)))) {
+        aot_set_last_error("allocate memory failed.");
+        goto fail;
+    }
+    data_count = 0;
+    for (i = 0; i < func_count; i++) {
+        offsets[i].data = data_offsets + data_count;
+        data_count += obj_data->func_objs[i]->data_sections_count;
+    }
+
+    if (!layout_merged_sections(obj_data, offsets)
+        || !merge_func_obj_sections(obj_data, offsets)
+        || !merge_func_obj_relocations(obj_data, offsets))
         goto fail;
 
+    for (i = 0; i < func_count; i++) {
+        func_obj = obj_data->func_objs[i];
+        snprintf(func_name, sizeof(func_name), "%s%d", AOT_FUNC_PREFIX, i);
+        if (!resolve_func_obj_function(func_obj, func_name,
+                                       obj_data->funcs + i))
+            goto fail;
+        obj_data->funcs[i].text_offset += offsets[i].text;
+    }
+
+    wasm_runtime_free(offsets);
+    if (data_offsets)
+        wasm_runtime_free(data_offsets);
     return obj_data;
 
 fail:
+    if (offsets)
+        wasm_runtime_free(offsets);
+    if (data_offsets)
+        wasm_runtime_free(data_offsets);
     aot_obj_data_destroy(obj_data);
     return NULL;
 }
 
+static AOTObjectData *
+aot_obj_data_create(AOTCompContext *comp_ctx)
+{
+    char *err = NULL;
+    LLVMMemoryBufferRef mem_buf;
+
+    if (comp_ctx->incremental_cache_dir
+        && comp_ctx->comp_data->func_count > 0)
+        return aot_obj_data_create_incremental(comp_ctx);
+
+    bh_print_time("Begin to emit object file to buffer");
+
+    if (LLVMTargetMachineEmitToMemoryBuffer(comp_ctx->target_machine,
+                                            comp_ctx->module,
+                                            LLVMObjectFile,
+                                            &err,
+                                            &mem_buf) != 0) {
+        if (err) {
+            LLVMDisposeMessage(err);
+            err = NULL;
+        }
+        aot_set_last_error("llvm emit to memory buffer failed.");
+        return NULL;
+    }
+
+    bh_print_time("Begin to resolve object file info");
+
+    return aot_obj_data_create_from_mem_buf(comp_ctx, mem_buf, false);
+}
+
 uint8*
 aot_emit_aot_file_buf(AOTCompContext *comp_ctx,
                       AOTCompData *comp_data,
@@ -2297,3 +2908,180 @@ fail1:
 
     return ret;
 }
+
+/* Implemented in aot_llvm_extra.cpp */
+bool
+aot_check_target_feature(LLVMTargetMachineRef target_machine,
+                         const char *feature);
+
+/* The LLVM names of the AOT_CPU_FEATURE_* flags */
+static const struct {
+    uint32 flag;
+    const char *name;
+} aot_cpu_features[] = {
+    { AOT_CPU_FEATURE_SSSE3, "ssse3" },
+    { AOT_CPU_FEATURE_SSE4_1, "sse4.1" },
+    { AOT_CPU_FEATURE_SSE4_2, "sse4.2" },
+    { AOT_CPU_FEATURE_POPCNT, "popcnt" },
+    { AOT_CPU_FEATURE_AVX, "avx" },
+    { AOT_CPU_FEATURE_AVX2, "avx2" },
+    { AOT_CPU_FEATURE_FMA, "fma" },
+    { AOT_CPU_FEATURE_F16C, "f16c" },
+    { AOT_CPU_FEATURE_BMI, "bmi" },
+    { AOT_CPU_FEATURE_BMI2, "bmi2" },
+    { AOT_CPU_FEATURE_LZCNT, "lzcnt" },
+    { AOT_CPU_FEATURE_MOVBE, "movbe" },
+    { AOT_CPU_FEATURE_AVX512F, "avx512f" },
+    { AOT_CPU_FEATURE_AVX512CD, "avx512cd" },
+    { AOT_CPU_FEATURE_AVX512BW, "avx512bw" },
+    { AOT_CPU_FEATURE_AVX512DQ, "avx512dq" },
+    { AOT_CPU_FEATURE_AVX512VL, "avx512vl" },
+    { AOT_CPU_FEATURE_AVX512VBMI, "avx512vbmi" },
+    { AOT_CPU_FEATURE_AVX512VNNI, "avx512vnni" },
+};
+
+static uint32
+get_target_cpu_features(AOTCompContext *comp_ctx)
+{
+    uint32 features = 0, i;
+
+    for (i = 0; i < sizeof(aot_cpu_features) / sizeof(aot_cpu_features[0]);
+         i++) {
+        if (aot_check_target_feature(comp_ctx->target_machine,
+                                     aot_cpu_features[i].name))
+            features |= aot_cpu_features[i].flag;
+    }
+    return features;
+}
+
+static bool
+aot_emit_cpu_variants_section(uint8 *buf, uint8 *buf_end, uint32 *p_offset,
+                              uint8 **aot_files, uint32 *aot_file_sizes,
+                              uint32 *cpu_features, uint32 variant_count)
+{
+    uint32 offset = *p_offset, section_size, i;
+
+    EMIT_U8('\0');
+    EMIT_U8('a');
+    EMIT_U8('o');
+    EMIT_U8('t');
+    EMIT_U32(AOT_CURRENT_VERSION);
+
+    section_size = (uint32)(buf_end - buf) - offset - sizeof(uint32) * 2;
+    EMIT_U32(AOT_SECTION_TYPE_CPU_VARIANTS);
+    EMIT_U32(section_size);
+
+    EMIT_U32(variant_count);
+    for (i = 0; i < variant_count; i++) {
+        EMIT_U32(cpu_features[i]);
+        EMIT_U32(aot_file_sizes[i]);
+        EMIT_BUF(aot_files[i], aot_file_sizes[i]);
+        offset = align_uint(offset, 4);
+    }
+
+    *p_offset = offset;
+    return true;
+}
+
+bool
+aot_emit_fat_aot_file(AOTCompData *comp_data, AOTCompOption *option,
+                      char **target_cpus, uint32 target_cpu_count,
+                      const char *file_name)
+{
+    AOTCompOption variant_option = *option;
+    AOTCompContext *comp_ctx;
+    uint8 *aot_files[AOT_CPU_VARIANT_MAX_NUM] = { 0 }, *buf = NULL;
+    uint32 aot_file_sizes[AOT_CPU_VARIANT_MAX_NUM];
+    uint32 cpu_features[AOT_CPU_VARIANT_MAX_NUM];
+    uint32 offset = 0, i, j;
+    uint64 total_size;
+    bool ret = false, is_x86;
+    char buf_err[128];
+    FILE *file;
+
+    if (target_cpu_count == 0 || target_cpu_count > AOT_CPU_VARIANT_MAX_NUM) {
+        aot_set_last_error("invalid CPU variant count.");
+        return false;
+    }
+
+    /* magic, version, section type, section size and variant count */
+    total_size = sizeof(uint32) * 5;
+
+    for (i = 0; i < target_cpu_count; i++) {
+        variant_option.target_cpu = target_cpus[i];
+
+        if (!(comp_ctx = aot_create_comp_context(comp_data,
+                                                 &variant_option)))
+            goto fail;
+
+        is_x86 = !strncmp(comp_ctx->target_arch, "x86_64", 6)
+                 || !strncmp(comp_ctx->target_arch, "i386", 4);
+        if (is_x86) {
+            cpu_features[i] = get_target_cpu_features(comp_ctx);
+            if (aot_compile_wasm(comp_ctx))
+                aot_files[i] = aot_emit_aot_file_buf(comp_ctx, comp_data,
+                                                     &aot_file_sizes[i]);
+        }
+        aot_destroy_comp_context(comp_ctx);
+
+        if (!is_x86) {
+            aot_set_last_error("fat AOT file is only supported for "
+                               "x86 targets.");
+            goto fail;
+        }
+        if (!aot_files[i])
+            goto fail;
+
+        for (j = 0; j < i; j++) {
+            if (cpu_features[j] == cpu_features[i]) {
+                snprintf(buf_err, sizeof(buf_err),
+                         "CPU variants %s and %s require the same "
+                         "CPU features.", target_cpus[j], target_cpus[i]);
+                aot_set_last_error(buf_err);
+                goto fail;
+            }
+        }
+
+        total_size += sizeof(uint32) * 2 + align_uint(aot_file_sizes[i], 4);
+    }
+
+    if (total_size >= UINT32_MAX
+        || !(buf = wasm_runtime_malloc((uint32)total_size))) {
+        aot_set_last_error("allocate memory failed.");
+        goto fail;
+    }
+    memset(buf, 0, (uint32)total_size);
+
+    if (!aot_emit_cpu_variants_section(buf, buf + total_size, &offset,
+                                       aot_files, aot_file_sizes,
+                                       cpu_features, target_cpu_count))
+        goto fail;
+
+    if (offset != total_size) {
+        aot_set_last_error("emit fat aot file failed.");
+        goto fail;
+    }
+
+    /* write buffer to file */
+    if (!(file = fopen(file_name, "wb"))) {
+        aot_set_last_error("open or create aot file failed.");
+        goto fail;
+    }
+    if (!fwrite(buf, (uint32)total_size, 1, file)) {
+        aot_set_last_error("write to aot file failed.");
+        fclose(file);
+        goto fail;
+    }
+    fclose(file);
+
+    ret = true;
+
+fail:
+    if (buf)
+        wasm_runtime_free(buf);
+    for (i = 0; i < target_cpu_count; i++) {
+        if (aot_files[i])
+            wasm_runtime_free(aot_files[i]);
+    }
+    return ret;
+}
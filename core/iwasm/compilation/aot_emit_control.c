@@ -5,6 +5,7 @@
 
 #include "aot_emit_control.h"
 #include "aot_emit_exception.h"
+#include "aot_emit_pgo.h"
 #include "../aot/aot_runtime.h"
 #include "../interpreter/wasm_loader.h"
 
@@ -66,6 +67,13 @@ format_block_name(char *name, uint32 name_size,
     }                                                       \
   } while (0)
 
+/* Condition br of wasm if and br_if, profiled by the static PGO */
+#define BUILD_PROFILED_COND_BR(value_if, block_then, block_else) do {   \
+    if (!aot_pgo_build_cond_br(comp_ctx, func_ctx, value_if,            \
+                               block_then, block_else))                 \
+      goto fail;                                                        \
+  } while (0)
+
 #define SET_BUILDER_POS(llvm_block) \
     LLVMPositionBuilderAtEnd(comp_ctx->builder, llvm_block)
 
@@ -159,8 +167,6 @@ handle_next_reachable_block(AOTCompContext *comp_ctx,
     uint32 i;
     AOTFuncType *func_type;
 
-    aot_checked_addr_list_destroy(func_ctx);
-
     bh_assert(block);
 
     if (block->label_type == LABEL_TYPE_IF
@@ -173,6 +179,7 @@ handle_next_reachable_block(AOTCompContext *comp_ctx,
         for (i = 0; i < block->param_count; i++)
             PUSH(block->else_param_phis[i], block->param_types[i]);
         SET_BUILDER_POS(block->llvm_else_block);
+        aot_checked_addr_list_del_in_block(func_ctx);
         *p_frame_ip = block->wasm_code_else + 1;
         return true;
     }
@@ -191,6 +198,7 @@ handle_next_reachable_block(AOTCompContext *comp_ctx,
                 *p_frame_ip = block->wasm_code_else + 1;
                 /* Push back the block */
                 aot_block_stack_push(&func_ctx->block_stack, block);
+                aot_checked_addr_list_del_in_block(func_ctx);
                 return true;
             }
             else if (block->llvm_end_block) {
@@ -206,12 +214,14 @@ handle_next_reachable_block(AOTCompContext *comp_ctx,
     }
 
     if (!block) {
+        aot_checked_addr_list_destroy(func_ctx);
         *p_frame_ip = frame_ip + 1;
         return true;
     }
 
     *p_frame_ip = block->wasm_code_end + 1;
     SET_BUILDER_POS(block->llvm_end_block);
+    aot_checked_addr_list_del_in_block(func_ctx);
 
     /* Pop block, push its return value, and destroy the block */
     block = aot_block_stack_pop(&func_ctx->block_stack);
@@ -431,7 +441,8 @@ aot_compile_op_block(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         /* Start to translate the block */
         SET_BUILDER_POS(block->llvm_entry_block);
         if (label_type == LABEL_TYPE_LOOP)
-            aot_checked_addr_list_destroy(func_ctx);
+            aot_checked_addr_list_enter_loop(func_ctx, *p_frame_ip,
+                                             block->wasm_code_end);
     }
     else if (label_type == LABEL_TYPE_IF) {
         POP_COND(value);
@@ -456,13 +467,13 @@ aot_compile_op_block(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                 CREATE_BLOCK(block->llvm_else_block, name);
                 MOVE_BLOCK_AFTER(block->llvm_else_block, block->llvm_entry_block);
                 /* Create condition br IR */
-                BUILD_COND_BR(value, block->llvm_entry_block,
-                              block->llvm_else_block);
+                BUILD_PROFILED_COND_BR(value, block->llvm_entry_block,
+                                       block->llvm_else_block);
             }
             else {
                 /* Create condition br IR */
-                BUILD_COND_BR(value, block->llvm_entry_block,
-                              block->llvm_end_block);
+                BUILD_PROFILED_COND_BR(value, block->llvm_entry_block,
+                                       block->llvm_end_block);
                 block->is_reachable = true;
             }
             if (!push_aot_block_to_stack_and_pass_params(comp_ctx, func_ctx, block))
@@ -577,7 +588,7 @@ aot_compile_op_else(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         for (i = 0; i < block->param_count; i++)
             PUSH(block->else_param_phis[i], block->param_types[i]);
         SET_BUILDER_POS(block->llvm_else_block);
-        aot_checked_addr_list_destroy(func_ctx);
+        aot_checked_addr_list_del_in_block(func_ctx);
         return true;
     }
 
@@ -824,8 +835,8 @@ aot_compile_op_br_if(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                 values = NULL;
             }
 
-            BUILD_COND_BR(value_cmp, block_dst->llvm_entry_block,
-                          llvm_else_block);
+            BUILD_PROFILED_COND_BR(value_cmp, block_dst->llvm_entry_block,
+                                   llvm_else_block);
 
             /* Move builder to else block */
             SET_BUILDER_POS(llvm_else_block);
@@ -869,8 +880,8 @@ aot_compile_op_br_if(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             }
 
             /* Condition jump to end block */
-            BUILD_COND_BR(value_cmp, block_dst->llvm_end_block,
-                          llvm_else_block);
+            BUILD_PROFILED_COND_BR(value_cmp, block_dst->llvm_end_block,
+                                   llvm_else_block);
 
             /* Move builder to else block */
             SET_BUILDER_POS(llvm_else_block);
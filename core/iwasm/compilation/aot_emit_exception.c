@@ -6,12 +6,10 @@
 #include "aot_emit_exception.h"
 #include "../aot/aot_runtime.h"
 
-bool
-aot_emit_exception(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                   int32 exception_id,
-                   bool is_cond_br,
-                   LLVMValueRef cond_br_if,
-                   LLVMBasicBlockRef cond_br_else_block)
+static bool
+emit_exception(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+               int32 exception_id, bool is_cond_br, LLVMValueRef cond,
+               bool throw_if_cond, LLVMBasicBlockRef next_block)
 {
     LLVMBasicBlockRef block_curr = LLVMGetInsertBlock(comp_ctx->builder);
     LLVMValueRef exce_id = I32_CONST((uint32)exception_id), func_const, func;
@@ -110,14 +108,28 @@ aot_emit_exception(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         }
     }
     else {
+        LLVMValueRef cond_br;
+
         /* Create condition br */
-        if (!LLVMBuildCondBr(comp_ctx->builder, cond_br_if,
-                             func_ctx->got_exception_block, cond_br_else_block)) {
+        if (!(cond_br = LLVMBuildCondBr(comp_ctx->builder, cond,
+                                        throw_if_cond
+                                        ? func_ctx->got_exception_block
+                                        : next_block,
+                                        throw_if_cond
+                                        ? next_block
+                                        : func_ctx->got_exception_block))) {
             aot_set_last_error("llvm build cond br failed.");
             return false;
         }
-        /* Start to translate the else block */
-        LLVMPositionBuilderAtEnd(comp_ctx->builder, cond_br_else_block);
+        /* Exceptions are rare, mark the branch to got_exception block as
+           unlikely, so that the optimizer moves the checks off the hot
+           paths, e.g. the loop passes may hoist or eliminate them */
+        if (!aot_set_cond_br_weights(comp_ctx, cond_br,
+                                     throw_if_cond ? 1 : 2000,
+                                     throw_if_cond ? 2000 : 1))
+            return false;
+        /* Start to translate the next block */
+        LLVMPositionBuilderAtEnd(comp_ctx->builder, next_block);
     }
 
     return true;
@@ -125,3 +137,23 @@ fail:
     return false;
 }
 
+bool
+aot_emit_exception(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                   int32 exception_id,
+                   bool is_cond_br,
+                   LLVMValueRef cond_br_if,
+                   LLVMBasicBlockRef cond_br_else_block)
+{
+    return emit_exception(comp_ctx, func_ctx, exception_id, is_cond_br,
+                          cond_br_if, true, cond_br_else_block);
+}
+
+bool
+aot_emit_exception_unless(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                          int32 exception_id,
+                          LLVMValueRef cond_br_succ,
+                          LLVMBasicBlockRef cond_br_succ_block)
+{
+    return emit_exception(comp_ctx, func_ctx, exception_id, true,
+                          cond_br_succ, false, cond_br_succ_block);
+}
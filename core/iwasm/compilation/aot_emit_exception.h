@@ -19,6 +19,14 @@ aot_emit_exception(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                    LLVMValueRef cond_br_if,
                    LLVMBasicBlockRef cond_br_else_block);
 
+/* Throw the exception if cond_br_succ is false, otherwise continue with
+   cond_br_succ_block */
+bool
+aot_emit_exception_unless(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                          int32 exception_id,
+                          LLVMValueRef cond_br_succ,
+                          LLVMBasicBlockRef cond_br_succ_block);
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
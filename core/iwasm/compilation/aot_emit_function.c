@@ -7,6 +7,7 @@
 #include "aot_emit_exception.h"
 #include "aot_emit_control.h"
 #include "aot_emit_table.h"
+#include "aot_emit_pgo.h"
 #include "../aot/aot_runtime.h"
 
 #define ADD_BASIC_BLOCK(block, name) do {                           \
@@ -742,6 +743,278 @@ call_aot_call_indirect_func(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
     return true;
 }
 
+static bool
+add_indirect_call_results(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                          LLVMValueRef value_ret, LLVMValueRef *param_values,
+                          uint32 func_param_count, uint32 func_result_count,
+                          LLVMValueRef *result_phis,
+                          LLVMBasicBlockRef block_return)
+{
+    LLVMBasicBlockRef block_curr;
+    LLVMValueRef ext_ret;
+    char buf[32];
+    uint32 i;
+
+    /* Check whether exception was thrown when executing the function */
+    if (!check_exception_thrown(comp_ctx, func_ctx))
+        return false;
+
+    if (func_result_count > 0) {
+        block_curr = LLVMGetInsertBlock(comp_ctx->builder);
+
+        /* Push the first result to stack */
+        LLVMAddIncoming(result_phis[0], &value_ret, &block_curr, 1);
+
+        /* Load extra result from its address and push to stack */
+        for (i = 1; i < func_result_count; i++) {
+            snprintf(buf, sizeof(buf), "ext_ret%d", i - 1);
+            if (!(ext_ret = LLVMBuildLoad(comp_ctx->builder,
+                                          param_values[func_param_count + i],
+                                          buf))) {
+                aot_set_last_error("llvm build load failed.");
+                return false;
+            }
+            LLVMAddIncoming(result_phis[i], &ext_ret, &block_curr, 1);
+        }
+    }
+
+    if (!LLVMBuildBr(comp_ctx->builder, block_return)) {
+        aot_set_last_error("llvm build br failed.");
+        return false;
+    }
+    return true;
+}
+
+/* Max number of distinct functions that a devirtualized call_indirect
+   calls directly, the others use the generic path */
+#define DEVIRT_MAX_TARGET_NUM 16
+
+typedef struct CallIndirectDevirt {
+    LLVMValueRef switch_inst;
+    uint32 target_num;
+    uint32 target_func_indexes[DEVIRT_MAX_TARGET_NUM];
+    uint32 target_case_counts[DEVIRT_MAX_TARGET_NUM];
+    LLVMBasicBlockRef target_blocks[DEVIRT_MAX_TARGET_NUM];
+} CallIndirectDevirt;
+
+/* Whether the table element can be called directly by call_indirect,
+   return the index of the target in devirt, or -1 if it can't */
+static int32
+get_devirt_target(AOTCompContext *comp_ctx, const CallIndirectDevirt *devirt,
+                  uint32 func_idx, uint32 type_idx)
+{
+    AOTCompData *comp_data = comp_ctx->comp_data;
+    uint32 i;
+
+    if (func_idx == NULL_REF
+        || func_idx < comp_data->import_func_count
+        || func_idx - comp_data->import_func_count >= comp_data->func_count
+        || wasm_get_smallest_type_idx(
+             comp_data->func_types, comp_data->func_type_count,
+             comp_data->funcs[func_idx - comp_data->import_func_count]
+               ->func_type_index) != type_idx)
+        return -1;
+
+    for (i = 0; i < devirt->target_num; i++) {
+        if (devirt->target_func_indexes[i] == func_idx)
+            return (int32)i;
+    }
+    return (int32)devirt->target_num;
+}
+
+/* Switch over the elements of the immutable table, jump to a direct call
+   block for each element whose function is known, and to the generic
+   path (table size, null element and type check) for the others */
+static bool
+build_call_indirect_switch(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                           uint32 tbl_idx, uint32 type_idx,
+                           LLVMValueRef elem_idx, CallIndirectDevirt *devirt)
+{
+    uint32 *func_indexes = comp_ctx->devirt_tbl_func_indexes[tbl_idx];
+    uint32 table_size = comp_ctx->comp_data->tables[tbl_idx].table_init_size;
+    uint32 case_count = 0, i;
+    int32 target;
+    LLVMBasicBlockRef block_generic;
+    LLVMValueRef case_value;
+    char buf[32];
+
+    memset(devirt, 0, sizeof(CallIndirectDevirt));
+
+    /* Collect the distinct target functions */
+    for (i = 0; i < table_size; i++) {
+        target = get_devirt_target(comp_ctx, devirt, func_indexes[i],
+                                   type_idx);
+        if (target < 0)
+            continue;
+        if ((uint32)target == devirt->target_num) {
+            if (devirt->target_num == DEVIRT_MAX_TARGET_NUM) {
+                /* Too many targets, use the generic path only */
+                devirt->target_num = 0;
+                return true;
+            }
+            devirt->target_func_indexes[devirt->target_num++] =
+                func_indexes[i];
+        }
+        devirt->target_case_counts[target]++;
+        case_count++;
+    }
+
+    if (devirt->target_num == 0)
+        return true;
+
+    if (!(block_generic =
+            LLVMAppendBasicBlockInContext(comp_ctx->context, func_ctx->func,
+                                          "call_indirect_generic"))) {
+        aot_set_last_error("llvm add basic block failed.");
+        return false;
+    }
+    LLVMMoveBasicBlockAfter(block_generic,
+                            LLVMGetInsertBlock(comp_ctx->builder));
+
+    for (i = 0; i < devirt->target_num; i++) {
+        snprintf(buf, sizeof(buf), "call_func%d",
+                 devirt->target_func_indexes[i]);
+        if (!(devirt->target_blocks[i] =
+                LLVMAppendBasicBlockInContext(comp_ctx->context,
+                                              func_ctx->func, buf))) {
+            aot_set_last_error("llvm add basic block failed.");
+            return false;
+        }
+    }
+
+    if (!(devirt->switch_inst = LLVMBuildSwitch(comp_ctx->builder, elem_idx,
+                                                block_generic, case_count))) {
+        aot_set_last_error("llvm build switch failed.");
+        return false;
+    }
+
+    for (i = 0; i < table_size; i++) {
+        target = get_devirt_target(comp_ctx, devirt, func_indexes[i],
+                                   type_idx);
+        if (target < 0)
+            continue;
+        if (!(case_value = I32_CONST(i))) {
+            aot_set_last_error("llvm build const failed.");
+            return false;
+        }
+        LLVMAddCase(devirt->switch_inst, case_value,
+                    devirt->target_blocks[target]);
+    }
+
+    LLVMPositionBuilderAtEnd(comp_ctx->builder, block_generic);
+    return true;
+}
+
+/* Set the weights of the switch cases from the call_indirect target
+   mostly called in the profile data */
+static bool
+set_call_indirect_switch_weights(AOTCompContext *comp_ctx,
+                                 const CallIndirectDevirt *devirt,
+                                 uint32 tbl_idx, uint32 type_idx,
+                                 uint32 hot_func_idx, uint32 weight_hot,
+                                 uint32 weight_other)
+{
+    uint32 *func_indexes = comp_ctx->devirt_tbl_func_indexes[tbl_idx];
+    uint32 table_size = comp_ctx->comp_data->tables[tbl_idx].table_init_size;
+    uint32 case_count = 0, hot_case_count = 0, *weights, i, j;
+    int32 target;
+    bool ret;
+
+    for (i = 0; i < devirt->target_num; i++) {
+        case_count += devirt->target_case_counts[i];
+        if (devirt->target_func_indexes[i] == hot_func_idx)
+            hot_case_count = devirt->target_case_counts[i];
+    }
+
+    if (hot_case_count == 0)
+        return true;
+
+    /* The first weight is for the default destination */
+    if (!(weights = wasm_runtime_malloc(sizeof(uint32)
+                                        * (case_count + 1)))) {
+        aot_set_last_error("allocate memory failed.");
+        return false;
+    }
+
+    weight_hot /= hot_case_count;
+    weight_other /= case_count - hot_case_count + 1;
+
+    weights[0] = weight_other;
+    for (i = 0, j = 1; i < table_size; i++) {
+        target = get_devirt_target(comp_ctx, devirt, func_indexes[i],
+                                   type_idx);
+        if (target < 0)
+            continue;
+        weights[j++] = func_indexes[i] == hot_func_idx
+                       ? weight_hot : weight_other;
+    }
+
+    ret = aot_set_switch_weights(comp_ctx, devirt->switch_inst, weights,
+                                 case_count + 1);
+    wasm_runtime_free(weights);
+    return ret;
+}
+
+/* Translate the direct call blocks of the switch */
+static bool
+compile_call_indirect_targets(AOTCompContext *comp_ctx,
+                              AOTFuncContext *func_ctx,
+                              const CallIndirectDevirt *devirt,
+                              LLVMValueRef *param_values,
+                              uint32 total_param_count,
+                              uint32 func_param_count,
+                              uint32 func_result_count,
+                              LLVMValueRef *result_phis,
+                              LLVMBasicBlockRef block_return)
+{
+    AOTFuncContext *callee_ctx;
+    AOTFunc *callee;
+    LLVMValueRef value_ret;
+    uint32 i;
+
+    for (i = 0; i < devirt->target_num; i++) {
+        callee_ctx = comp_ctx->func_ctxes[devirt->target_func_indexes[i]
+                                          - comp_ctx->comp_data
+                                              ->import_func_count];
+        callee = callee_ctx->aot_func;
+
+        LLVMMoveBasicBlockBefore(devirt->target_blocks[i], block_return);
+        LLVMPositionBuilderAtEnd(comp_ctx->builder, devirt->target_blocks[i]);
+
+#if WASM_ENABLE_THREAD_MGR != 0
+        /* Insert suspend check point */
+        if (comp_ctx->enable_thread_mgr) {
+            if (!check_suspend_flags(comp_ctx, func_ctx))
+                return false;
+        }
+#endif
+
+        if (comp_ctx->enable_bound_check
+            && !check_stack_boundary(comp_ctx, func_ctx,
+                                     callee->param_cell_num
+                                     + callee->local_cell_num + 1))
+            return false;
+
+        if (!(value_ret = LLVMBuildCall(comp_ctx->builder, callee_ctx->func,
+                                        param_values, total_param_count,
+                                        func_result_count > 0
+                                        ? "ret" : ""))) {
+            aot_set_last_error("llvm build call failed.");
+            return false;
+        }
+
+        LLVMSetInstructionCallConv(
+          value_ret, LLVMGetFunctionCallConv(callee_ctx->func));
+
+        if (!add_indirect_call_results(comp_ctx, func_ctx, value_ret,
+                                       param_values, func_param_count,
+                                       func_result_count, result_phis,
+                                       block_return))
+            return false;
+    }
+    return true;
+}
+
 bool
 aot_compile_op_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                              uint32 type_idx, uint32 tbl_idx)
@@ -751,7 +1024,7 @@ aot_compile_op_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
     LLVMValueRef ftype_idx_ptr, ftype_idx, ftype_idx_const;
     LLVMValueRef cmp_elem_idx, cmp_func_idx, cmp_ftype_idx;
     LLVMValueRef func, func_ptr, table_size_const;
-    LLVMValueRef ext_ret_offset, ext_ret_ptr, ext_ret, res;
+    LLVMValueRef ext_ret_offset, ext_ret_ptr, res;
     LLVMValueRef *param_values = NULL, *value_rets = NULL;
     LLVMValueRef *result_phis = NULL, value_ret, import_func_count;
     LLVMTypeRef *param_types = NULL, ret_type;
@@ -760,9 +1033,13 @@ aot_compile_op_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
     LLVMBasicBlockRef check_elem_idx_succ, check_ftype_idx_succ;
     LLVMBasicBlockRef check_func_idx_succ, block_return, block_curr;
     LLVMBasicBlockRef block_call_import, block_call_non_import;
-    LLVMValueRef offset;
+    LLVMBasicBlockRef block_call_target, block_call_other;
+    LLVMValueRef offset, cmp_target, cond_br;
     uint32 total_param_count, func_param_count, func_result_count;
     uint32 ext_cell_num, param_cell_num, i, j;
+    uint32 target_func_idx, weight_target, weight_other;
+    uint32 hot_func_idx = (uint32)-1;
+    CallIndirectDevirt devirt = { 0 };
     uint8 wasm_ret_type, *wasm_ret_types;
     uint64 total_size;
     char buf[32];
@@ -792,6 +1069,15 @@ aot_compile_op_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
 
     POP_I32(elem_idx);
 
+    /* Call the functions of the immutable table directly, the extra
+       results' addresses are prepared in the generic path only */
+    if (comp_ctx->enable_call_indirect_devirt
+        && comp_ctx->devirt_tbl_func_indexes[tbl_idx]
+        && func_result_count <= 1
+        && !build_call_indirect_switch(comp_ctx, func_ctx, tbl_idx, type_idx,
+                                       elem_idx, &devirt))
+        goto fail;
+
     /* get the cur size of the table instance */
     if (!(offset = I32_CONST(get_tbl_inst_offset(comp_ctx, func_ctx, tbl_idx)
                              + offsetof(AOTTableInstance, cur_size)))) {
@@ -938,6 +1224,17 @@ aot_compile_op_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                              true, cmp_ftype_idx, check_ftype_idx_succ)))
         goto fail;
 
+    if (!aot_pgo_call_indirect(comp_ctx, func_ctx, func_idx, type_idx,
+                               &target_func_idx, &weight_target,
+                               &weight_other))
+        goto fail;
+
+    if (devirt.target_num > 0) {
+        /* The target is called directly by the switch already */
+        hot_func_idx = target_func_idx;
+        target_func_idx = (uint32)-1;
+    }
+
     /* Initialize parameter types of the LLVM function */
     total_param_count = 1 + func_param_count;
 
@@ -1160,6 +1457,61 @@ aot_compile_op_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                                  + 16))
         goto fail;
 
+    if (target_func_idx != (uint32)-1) {
+        /* Call the target mostly called by the profile data directly,
+           so that it can be inlined, and call the others indirectly */
+        block_call_target =
+            LLVMAppendBasicBlockInContext(comp_ctx->context, func_ctx->func,
+                                          "call_target");
+        block_call_other =
+            LLVMAppendBasicBlockInContext(comp_ctx->context, func_ctx->func,
+                                          "call_other");
+        if (!block_call_target || !block_call_other) {
+            aot_set_last_error("llvm add basic block failed.");
+            goto fail;
+        }
+        LLVMMoveBasicBlockAfter(block_call_target, block_call_non_import);
+        LLVMMoveBasicBlockAfter(block_call_other, block_call_target);
+
+        if (!(cmp_target = LLVMBuildICmp(comp_ctx->builder, LLVMIntEQ,
+                                         func_idx, I32_CONST(target_func_idx),
+                                         "cmp_target"))) {
+            aot_set_last_error("llvm build icmp failed.");
+            goto fail;
+        }
+
+        if (!(cond_br = LLVMBuildCondBr(comp_ctx->builder, cmp_target,
+                                        block_call_target, block_call_other))) {
+            aot_set_last_error("llvm build cond br failed.");
+            goto fail;
+        }
+
+        if (!aot_set_cond_br_weights(comp_ctx, cond_br,
+                                     weight_target, weight_other))
+            goto fail;
+
+        LLVMPositionBuilderAtEnd(comp_ctx->builder, block_call_target);
+
+        func = comp_ctx->func_ctxes[target_func_idx
+                                    - comp_ctx->comp_data->import_func_count]
+                   ->func;
+        if (!(value_ret = LLVMBuildCall(comp_ctx->builder, func,
+                                        param_values, total_param_count,
+                                        func_result_count > 0
+                                        ? "ret" : ""))) {
+            aot_set_last_error("llvm build call failed.");
+            goto fail;
+        }
+
+        if (!add_indirect_call_results(comp_ctx, func_ctx, value_ret,
+                                       param_values, func_param_count,
+                                       func_result_count, result_phis,
+                                       block_return))
+            goto fail;
+
+        LLVMPositionBuilderAtEnd(comp_ctx->builder, block_call_other);
+    }
+
     /* Load function pointer */
     if (!(func_ptr = LLVMBuildInBoundsGEP(comp_ctx->builder, func_ctx->func_ptrs,
                                           &func_idx, 1, "func_ptr_tmp"))) {
@@ -1194,32 +1546,24 @@ aot_compile_op_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         goto fail;
     }
 
-    /* Check whether exception was thrown when executing the function */
-    if (!check_exception_thrown(comp_ctx, func_ctx))
+    if (!add_indirect_call_results(comp_ctx, func_ctx, value_ret,
+                                   param_values, func_param_count,
+                                   func_result_count, result_phis,
+                                   block_return))
         goto fail;
 
-    if (func_result_count > 0) {
-        block_curr = LLVMGetInsertBlock(comp_ctx->builder);
-
-        /* Push the first result to stack */
-        LLVMAddIncoming(result_phis[0], &value_ret, &block_curr, 1);
-
-        /* Load extra result from its address and push to stack */
-        for (i = 1; i < func_result_count; i++) {
-            snprintf(buf, sizeof(buf), "ext_ret%d", i - 1);
-            if (!(ext_ret = LLVMBuildLoad(comp_ctx->builder,
-                                          param_values[func_param_count + i],
-                                          buf))) {
-                aot_set_last_error("llvm build load failed.");
-                goto fail;
-            }
-            LLVMAddIncoming(result_phis[i], &ext_ret, &block_curr, 1);
-        }
-    }
+    if (devirt.target_num > 0) {
+        if (!compile_call_indirect_targets(comp_ctx, func_ctx, &devirt,
+                                           param_values, total_param_count,
+                                           func_param_count, func_result_count,
+                                           result_phis, block_return))
+            goto fail;
 
-    if (!LLVMBuildBr(comp_ctx->builder, block_return)) {
-        aot_set_last_error("llvm build br failed.");
-        goto fail;
+        if (hot_func_idx != (uint32)-1
+            && !set_call_indirect_switch_weights(comp_ctx, &devirt, tbl_idx,
+                                                 type_idx, hot_func_idx,
+                                                 weight_target, weight_other))
+            goto fail;
     }
 
     /* Translate function return block */
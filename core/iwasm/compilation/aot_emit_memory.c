@@ -6,6 +6,7 @@
 #include "aot_emit_memory.h"
 #include "aot_emit_exception.h"
 #include "../aot/aot_runtime.h"
+#include "../interpreter/wasm_opcode.h"
 
 #define BUILD_ICMP(op, left, right, res, name) do {     \
     if (!(res = LLVMBuildICmp(comp_ctx->builder, op,    \
@@ -35,6 +36,63 @@
 #define SET_BUILD_POS(block)    \
     LLVMPositionBuilderAtEnd(comp_ctx->builder, block)
 
+#if WASM_ENABLE_MEMORY64 != 0
+static bool
+is_memory64(AOTCompContext *comp_ctx)
+{
+    return comp_ctx->comp_data->memory_count > 0
+           && (comp_ctx->comp_data->memories[0].memory_flags
+               & MEMORY64_FLAG);
+}
+
+/* The page count of AOT memory is uint32, clamp an i64 value which
+   is passed to the runtime as uint32, e.g. the delta of memory.grow,
+   to UINT32_MAX, so that a larger value still fails */
+static LLVMValueRef
+clamp_mem_offset(AOTCompContext *comp_ctx, LLVMValueRef offset)
+{
+    LLVMValueRef u32_max = I64_CONST(UINT32_MAX), cmp, res;
+
+    CHECK_LLVM_CONST(u32_max);
+
+    BUILD_ICMP(LLVMIntUGT, offset, u32_max, cmp, "offset_gt_u32_max");
+    if (!(res = LLVMBuildSelect(comp_ctx->builder, cmp, u32_max, offset,
+                                "offset_clamped"))
+        || !(res = LLVMBuildTrunc(comp_ctx->builder, res, I32_TYPE,
+                                  "offset_i32"))) {
+        aot_set_last_error("llvm build select or trunc failed.");
+        goto fail;
+    }
+    return res;
+fail:
+    return NULL;
+}
+
+/* Pop an address or a length, which is i64 for memory64 and is
+   checked against the memory size with 64-bit arithmetic */
+#define POP_MEM_OFFSET(v) do {                          \
+    if (is_memory64(comp_ctx))                          \
+        POP_I64(v);                                     \
+    else                                                \
+        POP_I32(v);                                     \
+  } while (0)
+
+/* Pop a page count which is passed to the runtime */
+#define POP_MEM_OFFSET_U32(v) do {                      \
+    if (is_memory64(comp_ctx)) {                        \
+        POP_I64(v);                                     \
+        if (!(v = clamp_mem_offset(comp_ctx, v)))       \
+            goto fail;                                  \
+    }                                                   \
+    else                                                \
+        POP_I32(v);                                     \
+  } while (0)
+#else
+#define is_memory64(comp_ctx) false
+#define POP_MEM_OFFSET(v) POP_I32(v)
+#define POP_MEM_OFFSET_U32(v) POP_I32(v)
+#endif /* end of WASM_ENABLE_MEMORY64 */
+
 static LLVMValueRef
 get_memory_check_bound(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                        uint32 bytes)
@@ -70,24 +128,166 @@ get_memory_check_bound(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         aot_set_last_error("llvm build load failed.");
         return NULL;
     }
+    aot_set_tbaa(comp_ctx, mem_check_bound, AOT_TBAA_MEMORY_INFO);
     return mem_check_bound;
 }
 
+static bool
+read_leb_uint64(uint8 **p_buf, uint8 *buf_end, uint64 *p_result)
+{
+    uint8 *buf = *p_buf;
+    uint64 result = 0;
+    uint32 shift = 0;
+    uint8 byte;
+
+    do {
+        if (buf >= buf_end || shift >= 64)
+            return false;
+        byte = *buf++;
+        result |= (uint64)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    *p_buf = buf;
+    *p_result = result;
+    return true;
+}
+
+static bool
+is_load_opcode(uint8 opcode)
+{
+    return opcode >= WASM_OP_I32_LOAD && opcode <= WASM_OP_I64_LOAD32_U;
+}
+
+/* Access size of i32.load to i64.load32_u */
+static const uint8 load_bytes[] = { 4, 8, 4, 8, 1, 1, 2, 2, 1, 1, 2, 2, 4, 4 };
+
+/* Numeric opcodes which don't trap and have no immediates */
+static bool
+is_non_trapping_numeric_opcode(uint8 opcode)
+{
+    if (opcode < WASM_OP_I32_EQZ || opcode > WASM_OP_I64_EXTEND32_S)
+        return false;
+
+    return !((opcode >= WASM_OP_I32_DIV_S && opcode <= WASM_OP_I32_REM_U)
+             || (opcode >= WASM_OP_I64_DIV_S && opcode <= WASM_OP_I64_REM_U)
+             || (opcode >= WASM_OP_I32_TRUNC_S_F32
+                 && opcode <= WASM_OP_I32_TRUNC_U_F64)
+             || (opcode >= WASM_OP_I64_TRUNC_S_F32
+                 && opcode <= WASM_OP_I64_TRUNC_U_F64));
+}
+
+#define MAX_ADJACENT_ACCESS_SCAN_COUNT 64
+
+/**
+ * Get the end offset of the loads from the same local that follow the
+ * current load in straight-line code, e.g. the loads of the fields of a
+ * struct. Checking the farthest end once at the first load covers them
+ * all. Only the opcodes which can't change the memory, can't branch and
+ * can't trap (except the out of bounds trap of other loads) may appear
+ * between them, so trapping earlier at the first load is not observable.
+ */
+static uint64
+get_adjacent_load_end(AOTFuncContext *func_ctx, uint32 local_idx,
+                      uint32 offset, uint32 bytes)
+{
+    uint8 *p = func_ctx->frame_ip, *p_end;
+    uint64 end = (uint64)offset + bytes, idx, offset1;
+    uint32 i, bytes1;
+    uint8 opcode;
+
+    if (!p || !is_load_opcode(*p))
+        return end;
+
+    p_end = func_ctx->aot_func->code + func_ctx->aot_func->code_size;
+    p++;
+    /* Skip align and offset of current load */
+    if (!read_leb_uint64(&p, p_end, &idx)
+        || !read_leb_uint64(&p, p_end, &idx))
+        return end;
+
+    for (i = 0; i < MAX_ADJACENT_ACCESS_SCAN_COUNT && p < p_end; i++) {
+        opcode = *p++;
+
+        if (is_load_opcode(opcode)) {
+            if (!read_leb_uint64(&p, p_end, &idx)
+                || !read_leb_uint64(&p, p_end, &offset1))
+                return end;
+            continue;
+        }
+
+        switch (opcode) {
+            case WASM_OP_GET_LOCAL:
+                if (!read_leb_uint64(&p, p_end, &idx))
+                    return end;
+                if (idx == local_idx && p < p_end && is_load_opcode(*p)) {
+                    bytes1 = load_bytes[*p - WASM_OP_I32_LOAD];
+                    p++;
+                    if (!read_leb_uint64(&p, p_end, &idx)
+                        || !read_leb_uint64(&p, p_end, &offset1))
+                        return end;
+                    if (offset1 <= UINT32_MAX && offset1 + bytes1 > end)
+                        end = offset1 + bytes1;
+                }
+                break;
+            case WASM_OP_SET_LOCAL:
+            case WASM_OP_TEE_LOCAL:
+                if (!read_leb_uint64(&p, p_end, &idx) || idx == local_idx)
+                    return end;
+                break;
+            case WASM_OP_GET_GLOBAL:
+            case WASM_OP_I32_CONST:
+            case WASM_OP_I64_CONST:
+                if (!read_leb_uint64(&p, p_end, &idx))
+                    return end;
+                break;
+            case WASM_OP_F32_CONST:
+                p += sizeof(float32);
+                break;
+            case WASM_OP_F64_CONST:
+                p += sizeof(float64);
+                break;
+            case WASM_OP_DROP:
+            case WASM_OP_SELECT:
+            case WASM_OP_DROP_64:
+            case WASM_OP_SELECT_64:
+                break;
+            default:
+                if (!is_non_trapping_numeric_opcode(opcode))
+                    return end;
+                break;
+        }
+    }
+
+    return end;
+}
+
 static LLVMValueRef
 get_memory_curr_page_count(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx);
 
 LLVMValueRef
 aot_check_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                          uint32 offset, uint32 bytes)
+                          uint64 offset, uint32 bytes)
 {
-    LLVMValueRef offset_const = I32_CONST(offset);
+    LLVMValueRef offset_const;
     LLVMValueRef addr, maddr, offset1, cmp1, cmp2, cmp;
-    LLVMValueRef mem_base_addr, mem_check_bound;
+    LLVMValueRef mem_base_addr, mem_check_bound, check_offset, check_addr;
+    LLVMValueRef mem_max_size = func_ctx->mem_info[0].mem_max_size;
     LLVMBasicBlockRef block_curr = LLVMGetInsertBlock(comp_ctx->builder);
     LLVMBasicBlockRef check_succ;
     AOTValue *aot_value;
+    uint64 check_end, check_offset_value = offset;
     uint32 local_idx_of_aot_value = 0;
     bool is_target_64bit, is_local_of_aot_value = false;
+    bool is_addr64 = is_memory64(comp_ctx);
+    /* The runtime reserves the max size of memory64 and a guard region
+       after it, if the address isn't larger than the max size and the
+       offset is inside the guard region, the access out of bounds hits
+       the inaccessible pages and is caught by the signal handler, only
+       the address is checked against the max size. Otherwise the i64
+       address may exceed the reserved space and is checked by software */
+    bool check_max_size_only = is_addr64 && mem_max_size
+                               && offset <= AOT_MEMORY64_GUARD_SIZE - bytes;
 #if WASM_ENABLE_SHARED_MEMORY != 0
     bool is_shared_memory =
         comp_ctx->comp_data->memories[0].memory_flags & 0x02;
@@ -96,6 +296,8 @@ aot_check_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
     is_target_64bit = (comp_ctx->pointer_size == sizeof(uint64))
                       ? true : false;
 
+    offset_const = is_target_64bit ? I64_CONST(offset)
+                                   : I32_CONST((uint32)offset);
     CHECK_LLVM_CONST(offset_const);
 
     /* Get memory base address and memory data size */
@@ -114,31 +316,34 @@ aot_check_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed.");
             goto fail;
         }
+        aot_set_tbaa(comp_ctx, mem_base_addr, AOT_TBAA_MEMORY_INFO);
     }
 
     aot_value = func_ctx->block_stack.block_list_end->value_stack.value_list_end;
     if (aot_value) {
-        /* aot_value is freed in the following POP_I32(addr),
+        /* aot_value is freed in the following POP_MEM_OFFSET(addr),
            so save its fields here for further use */
         is_local_of_aot_value = aot_value->is_local;
         local_idx_of_aot_value = aot_value->local_idx;
     }
 
-    POP_I32(addr);
+    POP_MEM_OFFSET(addr);
 
     /* return addres directly if constant offset and inside memory space */
     if (LLVMIsConstant(addr)) {
-        uint64 mem_offset = (uint64)LLVMConstIntGetZExtValue(addr)
-                             + (uint64)offset;
+        uint64 addr_value = (uint64)LLVMConstIntGetZExtValue(addr);
+        uint64 mem_offset = addr_value + (uint64)offset;
         uint32 num_bytes_per_page =
                 comp_ctx->comp_data->memories[0].num_bytes_per_page;
         uint32 init_page_count =
                 comp_ctx->comp_data->memories[0].mem_init_page_count;
-        uint64 mem_data_size = num_bytes_per_page * init_page_count;
+        uint64 mem_data_size = (uint64)num_bytes_per_page * init_page_count;
 
-        if (mem_offset + bytes <= mem_data_size) {
+        if (mem_offset >= addr_value /* integer overflow */
+            && mem_offset + bytes <= mem_data_size) {
             /* inside memory space */
-            offset1 = I32_CONST((uint32)mem_offset);
+            offset1 = is_target_64bit ? I64_CONST(mem_offset)
+                                      : I32_CONST((uint32)mem_offset);
             CHECK_LLVM_CONST(offset1);
             if (!(maddr = LLVMBuildInBoundsGEP(comp_ctx->builder, mem_base_addr,
                                                &offset1, 1, "maddr"))) {
@@ -149,11 +354,9 @@ aot_check_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         }
     }
 
-    if (is_target_64bit) {
-        if (!(offset_const = LLVMBuildZExt(comp_ctx->builder, offset_const,
-                                           I64_TYPE, "offset_i64"))
-            || !(addr = LLVMBuildZExt(comp_ctx->builder, addr,
-                                      I64_TYPE, "addr_i64"))) {
+    if (is_target_64bit && !is_addr64) {
+        if (!(addr = LLVMBuildZExt(comp_ctx->builder, addr,
+                                   I64_TYPE, "addr_i64"))) {
             aot_set_last_error("llvm build zero extend failed.");
             goto fail;
         }
@@ -162,10 +365,24 @@ aot_check_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
     /* offset1 = offset + addr; */
     BUILD_OP(Add, offset_const, addr, offset1, "offset1");
 
-    if (comp_ctx->enable_bound_check
-        && !(is_local_of_aot_value
-             && aot_checked_addr_list_find(func_ctx, local_idx_of_aot_value,
-                                           offset, bytes))) {
+    if (check_max_size_only) {
+        ADD_BASIC_BLOCK(check_succ, "check_succ");
+        LLVMMoveBasicBlockAfter(check_succ, block_curr);
+
+        BUILD_ICMP(LLVMIntULE, addr, mem_max_size, cmp, "cmp_max_size");
+        if (!aot_emit_exception_unless(comp_ctx, func_ctx,
+                                       EXCE_OUT_OF_BOUNDS_MEMORY_ACCESS,
+                                       cmp, check_succ)) {
+            goto fail;
+        }
+
+        SET_BUILD_POS(check_succ);
+    }
+    else if ((comp_ctx->enable_bound_check || is_addr64)
+             && !(is_local_of_aot_value
+                  && aot_checked_addr_list_find(func_ctx,
+                                                local_idx_of_aot_value,
+                                                offset, bytes))) {
         uint32 init_page_count =
                 comp_ctx->comp_data->memories[0].mem_init_page_count;
         if (init_page_count == 0) {
@@ -192,31 +409,64 @@ aot_check_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             goto fail;
         }
 
-        if (is_target_64bit) {
-            BUILD_ICMP(LLVMIntUGT, offset1, mem_check_bound, cmp, "cmp");
+        /* Check the following loads from the same local together */
+        check_addr = offset1;
+        if (is_local_of_aot_value && offset <= UINT32_MAX) {
+            check_end = get_adjacent_load_end(func_ctx, local_idx_of_aot_value,
+                                              (uint32)offset, bytes);
+            if (check_end - bytes <= UINT32_MAX)
+                check_offset_value = check_end - bytes;
         }
-        else {
-            /* Check integer overflow */
-            BUILD_ICMP(LLVMIntULT, offset1, addr, cmp1, "cmp1");
-            BUILD_ICMP(LLVMIntUGT, offset1, mem_check_bound, cmp2, "cmp2");
-            BUILD_OP(Or, cmp1, cmp2, cmp, "cmp");
+        if (check_offset_value != offset) {
+            check_offset = is_target_64bit
+                           ? I64_CONST(check_offset_value)
+                           : I32_CONST(check_offset_value);
+            CHECK_LLVM_CONST(check_offset);
+            BUILD_OP(Add, check_offset, addr, check_addr, "check_addr");
         }
 
         /* Add basic blocks */
         ADD_BASIC_BLOCK(check_succ, "check_succ");
         LLVMMoveBasicBlockAfter(check_succ, block_curr);
 
-        if (!aot_emit_exception(comp_ctx, func_ctx,
-                                EXCE_OUT_OF_BOUNDS_MEMORY_ACCESS,
-                                true, cmp, check_succ)) {
-            goto fail;
+        if (is_target_64bit) {
+            /* Build the in bounds condition check_addr < bound + 1 rather
+               than the out of bounds condition, it is the form of range
+               check that the inductive range check elimination pass
+               recognizes to remove the checks of the induction variable
+               based accesses from loops */
+            BUILD_OP(Add, mem_check_bound, I64_CONST(1), mem_check_bound,
+                     "mem_check_bound_1");
+            BUILD_ICMP(LLVMIntULT, check_addr, mem_check_bound, cmp, "cmp");
+            if (is_addr64) {
+                /* Check integer overflow of the i64 address, offset1
+                   doesn't overflow if check_addr doesn't */
+                BUILD_ICMP(LLVMIntUGE, check_addr, addr, cmp1, "cmp1");
+                BUILD_OP(And, cmp, cmp1, cmp, "cmp_no_overflow");
+            }
+            if (!aot_emit_exception_unless(comp_ctx, func_ctx,
+                                           EXCE_OUT_OF_BOUNDS_MEMORY_ACCESS,
+                                           cmp, check_succ)) {
+                goto fail;
+            }
+        }
+        else {
+            /* Check integer overflow */
+            BUILD_ICMP(LLVMIntULT, check_addr, addr, cmp1, "cmp1");
+            BUILD_ICMP(LLVMIntUGT, check_addr, mem_check_bound, cmp2, "cmp2");
+            BUILD_OP(Or, cmp1, cmp2, cmp, "cmp");
+            if (!aot_emit_exception(comp_ctx, func_ctx,
+                                    EXCE_OUT_OF_BOUNDS_MEMORY_ACCESS,
+                                    true, cmp, check_succ)) {
+                goto fail;
+            }
         }
 
         SET_BUILD_POS(check_succ);
 
         if (is_local_of_aot_value) {
             if (!aot_checked_addr_list_add(func_ctx, local_idx_of_aot_value,
-                                           offset, bytes))
+                                           check_offset_value, bytes))
                 goto fail;
         }
     }
@@ -247,6 +497,7 @@ fail:
         goto fail;                                          \
     }                                                       \
     LLVMSetAlignment(value, 1);                             \
+    aot_set_tbaa(comp_ctx, value, AOT_TBAA_LINEAR_MEMORY);  \
   } while (0)
 
 #define BUILD_TRUNC(value, data_type) do {                  \
@@ -264,6 +515,7 @@ fail:
         goto fail;                                          \
     }                                                       \
     LLVMSetAlignment(res, 1);                               \
+    aot_set_tbaa(comp_ctx, res, AOT_TBAA_LINEAR_MEMORY);    \
   } while (0)
 
 #define BUILD_SIGN_EXT(dst_type) do {                       \
@@ -334,6 +586,7 @@ fail:
     LLVMSetAlignment(value, 1 << align);                                \
     LLVMSetVolatile(value, true);                                       \
     LLVMSetOrdering(value, LLVMAtomicOrderingSequentiallyConsistent);   \
+    aot_set_tbaa(comp_ctx, value, AOT_TBAA_LINEAR_MEMORY);              \
   } while (0)
 
 #define BUILD_ATOMIC_STORE(align) do {                                  \
@@ -348,12 +601,13 @@ fail:
     LLVMSetAlignment(res, 1 << align);                                  \
     LLVMSetVolatile(res, true);                                         \
     LLVMSetOrdering(res, LLVMAtomicOrderingSequentiallyConsistent);     \
+    aot_set_tbaa(comp_ctx, res, AOT_TBAA_LINEAR_MEMORY);                \
   } while (0)
 #endif
 
 bool
 aot_compile_op_i32_load(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                        uint32 align, uint32 offset, uint32 bytes,
+                        uint32 align, uint64 offset, uint32 bytes,
                         bool sign, bool atomic)
 {
     LLVMValueRef maddr, value = NULL;
@@ -405,7 +659,7 @@ fail:
 
 bool
 aot_compile_op_i64_load(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                        uint32 align, uint32 offset, uint32 bytes,
+                        uint32 align, uint64 offset, uint32 bytes,
                         bool sign, bool atomic)
 {
     LLVMValueRef maddr, value = NULL;
@@ -460,7 +714,7 @@ fail:
 
 bool
 aot_compile_op_f32_load(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                        uint32 align, uint32 offset)
+                        uint32 align, uint64 offset)
 {
     LLVMValueRef maddr, value;
 
@@ -477,7 +731,7 @@ fail:
 
 bool
 aot_compile_op_f64_load(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                        uint32 align, uint32 offset)
+                        uint32 align, uint64 offset)
 {
     LLVMValueRef maddr, value;
 
@@ -494,7 +748,7 @@ fail:
 
 bool
 aot_compile_op_i32_store(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                         uint32 align, uint32 offset, uint32 bytes, bool atomic)
+                         uint32 align, uint64 offset, uint32 bytes, bool atomic)
 {
     LLVMValueRef maddr, value;
 
@@ -533,7 +787,7 @@ fail:
 
 bool
 aot_compile_op_i64_store(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                         uint32 align, uint32 offset, uint32 bytes, bool atomic)
+                         uint32 align, uint64 offset, uint32 bytes, bool atomic)
 {
     LLVMValueRef maddr, value;
 
@@ -576,7 +830,7 @@ fail:
 
 bool
 aot_compile_op_f32_store(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                         uint32 align, uint32 offset)
+                         uint32 align, uint64 offset)
 {
     LLVMValueRef maddr, value;
 
@@ -594,7 +848,7 @@ fail:
 
 bool
 aot_compile_op_f64_store(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
-                         uint32 align, uint32 offset)
+                         uint32 align, uint64 offset)
 {
     LLVMValueRef maddr, value;
 
@@ -626,6 +880,7 @@ get_memory_curr_page_count(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx)
             aot_set_last_error("llvm build load failed.");
             goto fail;
         }
+        aot_set_tbaa(comp_ctx, mem_size, AOT_TBAA_MEMORY_INFO);
     }
 
     return mem_size;
@@ -638,9 +893,22 @@ aot_compile_op_memory_size(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx)
 {
     LLVMValueRef mem_size = get_memory_curr_page_count(comp_ctx, func_ctx);
 
-    if (mem_size)
-        PUSH_I32(mem_size);
-    return mem_size ? true : false;
+    if (!mem_size)
+        return false;
+
+#if WASM_ENABLE_MEMORY64 != 0
+    if (is_memory64(comp_ctx)) {
+        if (!(mem_size = LLVMBuildZExt(comp_ctx->builder, mem_size,
+                                       I64_TYPE, "mem_size_i64"))) {
+            aot_set_last_error("llvm build zero extend failed.");
+            return false;
+        }
+        PUSH_I64(mem_size);
+        return true;
+    }
+#endif
+    PUSH_I32(mem_size);
+    return true;
 fail:
     return false;
 }
@@ -655,7 +923,7 @@ aot_compile_op_memory_grow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx)
     if (!mem_size)
         return false;
 
-    POP_I32(delta);
+    POP_MEM_OFFSET_U32(delta);
 
     /* Function type of aot_enlarge_memory() */
     param_types[0] = INT8_PTR_TYPE;
@@ -709,6 +977,20 @@ aot_compile_op_memory_grow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx)
         return false;
     }
 
+#if WASM_ENABLE_MEMORY64 != 0
+    if (is_memory64(comp_ctx)) {
+        /* -1 is sign extended, the previous page count is less than
+           2^31 (WASM_MEMORY64_MAX_PAGES), so it is also extended
+           correctly */
+        if (!(ret_value = LLVMBuildSExt(comp_ctx->builder, ret_value,
+                                        I64_TYPE, "mem_grow_ret_i64"))) {
+            aot_set_last_error("llvm build sign extend failed.");
+            return false;
+        }
+        PUSH_I64(ret_value);
+        return true;
+    }
+#endif
     PUSH_I32(ret_value);
     return true;
 fail:
@@ -722,7 +1004,7 @@ static LLVMValueRef
 check_bulk_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                            LLVMValueRef offset, LLVMValueRef bytes)
 {
-    LLVMValueRef maddr, max_addr, cmp;
+    LLVMValueRef maddr, max_addr, cmp, cmp1;
     LLVMValueRef mem_base_addr;
     LLVMBasicBlockRef block_curr = LLVMGetInsertBlock(comp_ctx->builder);
     LLVMBasicBlockRef check_succ;
@@ -747,6 +1029,7 @@ check_bulk_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed.");
             goto fail;
         }
+        aot_set_tbaa(comp_ctx, mem_base_addr, AOT_TBAA_MEMORY_INFO);
     }
 
     /* return addres directly if constant offset and inside memory space */
@@ -757,8 +1040,9 @@ check_bulk_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                 comp_ctx->comp_data->memories[0].num_bytes_per_page;
         uint32 init_page_count =
                 comp_ctx->comp_data->memories[0].mem_init_page_count;
-        uint32 mem_data_size = num_bytes_per_page * init_page_count;
+        uint64 mem_data_size = (uint64)num_bytes_per_page * init_page_count;
         if (mem_data_size > 0
+            && mem_offset + mem_len >= mem_offset /* integer overflow */
             && mem_offset + mem_len <= mem_data_size) {
             /* inside memory space */
             /* maddr = mem_base_addr + moffset */
@@ -783,18 +1067,25 @@ check_bulk_memory_overflow(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed.");
             goto fail;
         }
+        aot_set_tbaa(comp_ctx, mem_size, AOT_TBAA_MEMORY_INFO);
     }
 
     ADD_BASIC_BLOCK(check_succ, "check_succ");
     LLVMMoveBasicBlockAfter(check_succ, block_curr);
 
-    offset = LLVMBuildZExt(comp_ctx->builder, offset, I64_TYPE, "extend_offset");
-    bytes = LLVMBuildZExt(comp_ctx->builder, bytes, I64_TYPE, "extend_len");
-    mem_size = LLVMBuildZExt(comp_ctx->builder, mem_size, I64_TYPE, "extend_size");
+    if (!is_memory64(comp_ctx)) {
+        offset = LLVMBuildZExt(comp_ctx->builder, offset, I64_TYPE, "extend_offset");
+        bytes = LLVMBuildZExt(comp_ctx->builder, bytes, I64_TYPE, "extend_len");
+    }
 
     BUILD_OP(Add, offset, bytes, max_addr, "max_addr");
     BUILD_ICMP(LLVMIntUGT, max_addr, mem_size, cmp,
                "cmp_max_mem_addr");
+    if (is_memory64(comp_ctx)) {
+        /* Check integer overflow of the i64 address and length */
+        BUILD_ICMP(LLVMIntULT, max_addr, offset, cmp1, "cmp_overflow");
+        BUILD_OP(Or, cmp, cmp1, cmp, "cmp_oob");
+    }
     if (!aot_emit_exception(comp_ctx, func_ctx,
                             EXCE_OUT_OF_BOUNDS_MEMORY_ACCESS,
                             true, cmp, check_succ)) {
@@ -826,13 +1117,20 @@ aot_compile_op_memory_init(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
 
     POP_I32(len);
     POP_I32(offset);
-    POP_I32(dst);
+    /* The dst is passed as uint64 since memory64 may exceed 4GB */
+    POP_MEM_OFFSET(dst);
+    if (!is_memory64(comp_ctx)
+        && !(dst = LLVMBuildZExt(comp_ctx->builder, dst, I64_TYPE,
+                                 "dst_i64"))) {
+        aot_set_last_error("llvm build zero extend failed.");
+        goto fail;
+    }
 
     param_types[0] = INT8_PTR_TYPE;
     param_types[1] = I32_TYPE;
     param_types[2] = I32_TYPE;
     param_types[3] = I32_TYPE;
-    param_types[4] = I32_TYPE;
+    param_types[4] = I64_TYPE;
     ret_type = INT8_TYPE;
 
     GET_AOT_FUNCTION(aot_memory_init, 5);
@@ -912,9 +1210,9 @@ aot_compile_op_memory_copy(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx)
 {
     LLVMValueRef src, dst, src_addr, dst_addr, len, res;
 
-    POP_I32(len);
-    POP_I32(src);
-    POP_I32(dst);
+    POP_MEM_OFFSET(len);
+    POP_MEM_OFFSET(src);
+    POP_MEM_OFFSET(dst);
 
     if (!(src_addr =
             check_bulk_memory_overflow(comp_ctx, func_ctx, src, len)))
@@ -939,9 +1237,9 @@ aot_compile_op_memory_fill(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx)
 {
     LLVMValueRef val, dst, dst_addr, len, res;
 
-    POP_I32(len);
+    POP_MEM_OFFSET(len);
     POP_I32(val);
-    POP_I32(dst);
+    POP_MEM_OFFSET(dst);
 
     if (!(dst_addr =
             check_bulk_memory_overflow(comp_ctx, func_ctx, dst, len)))
@@ -965,7 +1263,7 @@ bool
 aot_compile_op_atomic_rmw(AOTCompContext *comp_ctx,
                           AOTFuncContext *func_ctx,
                           uint8 atomic_op, uint8 op_type,
-                          uint32 align, uint32 offset,
+                          uint32 align, uint64 offset,
                           uint32 bytes)
 {
     LLVMValueRef maddr, value, result;
@@ -1011,6 +1309,7 @@ aot_compile_op_atomic_rmw(AOTCompContext *comp_ctx,
     }
 
     LLVMSetVolatile(result, true);
+    aot_set_tbaa(comp_ctx, result, AOT_TBAA_LINEAR_MEMORY);
 
     if (op_type == VALUE_TYPE_I32) {
         if (!(result = LLVMBuildZExt(comp_ctx->builder, result,
@@ -1036,7 +1335,7 @@ bool
 aot_compile_op_atomic_cmpxchg(AOTCompContext *comp_ctx,
                               AOTFuncContext *func_ctx,
                               uint8 op_type, uint32 align,
-                              uint32 offset, uint32 bytes)
+                              uint64 offset, uint32 bytes)
 {
     LLVMValueRef maddr, value, expect, result;
 
@@ -1090,6 +1389,7 @@ aot_compile_op_atomic_cmpxchg(AOTCompContext *comp_ctx,
     }
 
     LLVMSetVolatile(result, true);
+    aot_set_tbaa(comp_ctx, result, AOT_TBAA_LINEAR_MEMORY);
 
     /* CmpXchg return {i32, i1} structure,
         we need to extrack the previous_value from the structure */
@@ -1122,7 +1422,7 @@ fail:
 bool
 aot_compile_op_atomic_wait(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                            uint8 op_type, uint32 align,
-                           uint32 offset, uint32 bytes)
+                           uint64 offset, uint32 bytes)
 {
     LLVMValueRef maddr, value, timeout, expect, cmp;
     LLVMValueRef param_values[5], ret_value, func, is_wait64;
@@ -1208,7 +1508,7 @@ fail:
 bool
 aot_compiler_op_atomic_notify(AOTCompContext *comp_ctx,
                               AOTFuncContext *func_ctx,
-                              uint32 align, uint32 offset, uint32 bytes)
+                              uint32 align, uint64 offset, uint32 bytes)
 {
     LLVMValueRef maddr, value, count;
     LLVMValueRef param_values[3], ret_value, func;
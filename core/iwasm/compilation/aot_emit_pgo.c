@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) 2019 Intel Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "aot_emit_pgo.h"
+#include "../aot/aot_runtime.h"
+
+void
+aot_set_func_entry_count(LLVMValueRef func, uint64 count);
+
+void
+aot_set_profile_summary(LLVMModuleRef module,
+                        const uint64 *counts, uint32 count_num);
+
+static uint64
+get_module_hash(const AOTCompData *comp_data)
+{
+    /* FNV-1a hash of the function bodies, the counters are numbered in
+       the order the sites are compiled, so the profile data can only be
+       used to compile the same code */
+    uint64 hash = 0xCBF29CE484222325ULL;
+    const uint64 prime = 0x100000001B3ULL;
+    AOTFunc *func;
+    uint32 i, j;
+
+    for (i = 0; i < comp_data->func_count; i++) {
+        func = comp_data->funcs[i];
+        hash = (hash ^ func->func_type_index) * prime;
+        for (j = 0; j < func->code_size; j++)
+            hash = (hash ^ func->code[j]) * prime;
+    }
+    return hash;
+}
+
+bool
+aot_pgo_init(AOTCompContext *comp_ctx, aot_comp_option_t option)
+{
+    uint64 *prof_data = (uint64 *)option->pgo_prof_data;
+    uint32 prof_data_count = option->pgo_prof_data_size / sizeof(uint64);
+
+    if (!option->enable_pgo_instrument && !prof_data)
+        return true;
+
+    if (option->enable_pgo_instrument && prof_data) {
+        aot_set_last_error("can't instrument the code and use the "
+                           "profile data at the same time.");
+        return false;
+    }
+
+    comp_ctx->pgo_module_hash = get_module_hash(comp_ctx->comp_data);
+
+    if (prof_data) {
+        if (option->pgo_prof_data_size % sizeof(uint64) != 0
+            || prof_data_count < AOT_PGO_HEADER_COUNT
+            || prof_data[0] != AOT_PGO_MAGIC
+            || prof_data[1] != AOT_PGO_VERSION
+            || prof_data[3] != prof_data_count - AOT_PGO_HEADER_COUNT) {
+            aot_set_last_error("invalid profile data.");
+            return false;
+        }
+        if (prof_data[2] != comp_ctx->pgo_module_hash) {
+            aot_set_last_error("the profile data doesn't match "
+                               "the wasm file.");
+            return false;
+        }
+        comp_ctx->pgo_prof_counters = prof_data + AOT_PGO_HEADER_COUNT;
+        comp_ctx->pgo_prof_counter_count =
+            prof_data_count - AOT_PGO_HEADER_COUNT;
+        if (comp_ctx->pgo_prof_counter_count > 0) {
+            if (!(comp_ctx->pgo_prof_exec_counters = wasm_runtime_malloc(
+                      sizeof(bool) * comp_ctx->pgo_prof_counter_count))) {
+                aot_set_last_error("allocate memory failed.");
+                return false;
+            }
+            memset(comp_ctx->pgo_prof_exec_counters, 0,
+                   sizeof(bool) * comp_ctx->pgo_prof_counter_count);
+        }
+        return true;
+    }
+
+    /* The counter count is unknown until all the functions are compiled,
+       refer to the counters with a placeholder global until then */
+    if (!(comp_ctx->pgo_counters =
+            LLVMAddGlobal(comp_ctx->module,
+                          LLVMInt64TypeInContext(comp_ctx->context),
+                          "aot_pgo_counters_placeholder"))) {
+        aot_set_last_error("add LLVM global failed.");
+        return false;
+    }
+    comp_ctx->enable_pgo_instrument = true;
+    return true;
+}
+
+static bool
+set_profile_summary(AOTCompContext *comp_ctx)
+{
+    uint64 *counts, size;
+    uint32 count_num = 0, i;
+
+    /* Summarize the execution counts like the instrumented profile of
+       clang, so that the profile summary info of LLVM can tell the hot
+       and cold functions and blocks */
+    size = sizeof(uint64) * (uint64)comp_ctx->pgo_prof_counter_count;
+    if (size >= UINT32_MAX
+        || !(counts = wasm_runtime_malloc((uint32)size + 1))) {
+        aot_set_last_error("allocate memory failed.");
+        return false;
+    }
+
+    for (i = 0; i < comp_ctx->pgo_prof_counter_count; i++) {
+        if (comp_ctx->pgo_prof_exec_counters[i])
+            counts[count_num++] = comp_ctx->pgo_prof_counters[i];
+    }
+
+    aot_set_profile_summary(comp_ctx->module, counts, count_num);
+    wasm_runtime_free(counts);
+    return true;
+}
+
+bool
+aot_pgo_finalize(AOTCompContext *comp_ctx)
+{
+    LLVMValueRef *values, init, global, base, indices[2];
+    LLVMTypeRef array_type;
+    uint32 count, i;
+    uint64 size;
+
+    if (comp_ctx->pgo_prof_counters) {
+        if (comp_ctx->pgo_counter_count != comp_ctx->pgo_prof_counter_count) {
+            aot_set_last_error("the profile data doesn't match "
+                               "the wasm file.");
+            return false;
+        }
+        return set_profile_summary(comp_ctx);
+    }
+
+    if (!comp_ctx->enable_pgo_instrument)
+        return true;
+
+    count = AOT_PGO_HEADER_COUNT + comp_ctx->pgo_counter_count;
+    size = sizeof(LLVMValueRef) * (uint64)count;
+    if (size >= UINT32_MAX
+        || !(values = wasm_runtime_malloc((uint32)size))) {
+        aot_set_last_error("allocate memory failed.");
+        return false;
+    }
+
+    values[0] = I64_CONST(AOT_PGO_MAGIC);
+    values[1] = I64_CONST(AOT_PGO_VERSION);
+    values[2] = I64_CONST(comp_ctx->pgo_module_hash);
+    values[3] = I64_CONST(comp_ctx->pgo_counter_count);
+    for (i = AOT_PGO_HEADER_COUNT; i < count; i++)
+        values[i] = I64_CONST(0);
+
+    init = LLVMConstArray(I64_TYPE, values, count);
+    wasm_runtime_free(values);
+
+    /* The counters are updated in place, put them in the writable
+       ".data" section where the runtime finds them by the magic */
+    if (!init
+        || !(array_type = LLVMArrayType(I64_TYPE, count))
+        || !(global = LLVMAddGlobal(comp_ctx->module, array_type,
+                                    "aot_pgo_counters"))) {
+        aot_set_last_error("add LLVM global failed.");
+        return false;
+    }
+    LLVMSetInitializer(global, init);
+    LLVMSetLinkage(global, LLVMInternalLinkage);
+    LLVMSetSection(global, ".data");
+    LLVMSetAlignment(global, sizeof(uint64));
+
+    indices[0] = I32_CONST(0);
+    indices[1] = I32_CONST(0);
+    if (!(base = LLVMConstInBoundsGEP(global, indices, 2))) {
+        aot_set_last_error("llvm build const gep failed.");
+        return false;
+    }
+
+    LLVMReplaceAllUsesWith(comp_ctx->pgo_counters, base);
+    LLVMDeleteGlobal(comp_ctx->pgo_counters);
+    comp_ctx->pgo_counters = global;
+    return true;
+}
+
+static uint32
+alloc_counters(AOTCompContext *comp_ctx, uint32 count, bool is_exec_counter)
+{
+    uint32 index = comp_ctx->pgo_counter_count, i;
+
+    if (comp_ctx->pgo_prof_exec_counters && is_exec_counter) {
+        for (i = index; i < index + count
+                        && i < comp_ctx->pgo_prof_counter_count; i++)
+            comp_ctx->pgo_prof_exec_counters[i] = true;
+    }
+
+    comp_ctx->pgo_counter_count += count;
+    return index;
+}
+
+static uint64
+get_prof_counter(AOTCompContext *comp_ctx, uint32 index)
+{
+    /* The counter count is checked in aot_pgo_finalize */
+    if (index >= comp_ctx->pgo_prof_counter_count)
+        return 0;
+    return comp_ctx->pgo_prof_counters[index];
+}
+
+static LLVMValueRef
+get_counter_ptr(AOTCompContext *comp_ctx, LLVMValueRef index)
+{
+    LLVMValueRef counter_ptr, offset;
+
+    if (!(offset = I32_CONST(AOT_PGO_HEADER_COUNT))
+        || !(index = LLVMBuildAdd(comp_ctx->builder, index, offset,
+                                  "counter_idx"))
+        || !(counter_ptr = LLVMBuildInBoundsGEP(comp_ctx->builder,
+                                                comp_ctx->pgo_counters,
+                                                &index, 1, "counter_ptr"))) {
+        aot_set_last_error("llvm build gep failed.");
+        return NULL;
+    }
+    return counter_ptr;
+}
+
+static bool
+increase_counter(AOTCompContext *comp_ctx, LLVMValueRef index)
+{
+    LLVMValueRef counter_ptr, counter;
+
+    if (!(counter_ptr = get_counter_ptr(comp_ctx, index)))
+        return false;
+
+    if (!(counter = LLVMBuildLoad(comp_ctx->builder, counter_ptr, "counter"))
+        || !(counter = LLVMBuildAdd(comp_ctx->builder, counter, I64_CONST(1),
+                                    "counter"))
+        || !LLVMBuildStore(comp_ctx->builder, counter, counter_ptr)) {
+        aot_set_last_error("llvm build counter increment failed.");
+        return false;
+    }
+    return true;
+}
+
+/* Scale the counts to the 32-bit branch weights, a path never run keeps
+   the zero weight, so that it is cold even if the function is called
+   only a few times, and the hot/cold splitting can outline it */
+static void
+get_branch_weights(uint64 count1, uint64 count2,
+                   uint32 *p_weight1, uint32 *p_weight2)
+{
+    uint64 max_count = count1 > count2 ? count1 : count2;
+    uint64 scale = max_count / UINT32_MAX + 1;
+
+    *p_weight1 = (uint32)(count1 / scale);
+    *p_weight2 = (uint32)(count2 / scale);
+}
+
+bool
+aot_pgo_emit_func_entry(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx)
+{
+    LLVMAttributeRef attr;
+    uint32 index;
+    uint64 count;
+
+    if (comp_ctx->enable_pgo_instrument) {
+        index = alloc_counters(comp_ctx, 1, true);
+        return increase_counter(comp_ctx, I32_CONST(index));
+    }
+
+    if (comp_ctx->pgo_prof_counters) {
+        index = alloc_counters(comp_ctx, 1, true);
+        count = get_prof_counter(comp_ctx, index);
+        aot_set_func_entry_count(func_ctx->func, count);
+        if (count == 0) {
+            /* Optimize the function never called for size, the hot/cold
+               splitting also moves the paths calling it out of line */
+            if (!(attr = LLVMCreateEnumAttribute(
+                      comp_ctx->context,
+                      LLVMGetEnumAttributeKindForName("cold", 4), 0))) {
+                aot_set_last_error("create LLVM attribute failed.");
+                return false;
+            }
+            LLVMAddAttributeAtIndex(func_ctx->func,
+                                    LLVMAttributeFunctionIndex, attr);
+        }
+        /* Keep the functions in ".text" which is the only code section
+           supported by the AOT file, otherwise the code generator may
+           put them to ".text.hot" or ".text.unlikely" by the profile */
+        LLVMSetSection(func_ctx->func, ".text");
+    }
+    return true;
+}
+
+bool
+aot_pgo_build_cond_br(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                      LLVMValueRef cond, LLVMBasicBlockRef block_then,
+                      LLVMBasicBlockRef block_else)
+{
+    LLVMValueRef cond_br, index;
+    uint32 base = 0, weight_then, weight_else;
+    uint64 count_then, count_else;
+
+    if (comp_ctx->enable_pgo_instrument || comp_ctx->pgo_prof_counters)
+        base = alloc_counters(comp_ctx, 2, true);
+
+    if (comp_ctx->enable_pgo_instrument) {
+        /* Counter base + 0 for the taken branch, base + 1 for the other */
+        if (!(index = LLVMBuildSelect(comp_ctx->builder, cond,
+                                      I32_CONST(base), I32_CONST(base + 1),
+                                      "cond_counter_idx"))) {
+            aot_set_last_error("llvm build select failed.");
+            return false;
+        }
+        if (!increase_counter(comp_ctx, index))
+            return false;
+    }
+
+    if (!(cond_br = LLVMBuildCondBr(comp_ctx->builder, cond,
+                                    block_then, block_else))) {
+        aot_set_last_error("llvm build cond br failed.");
+        return false;
+    }
+
+    if (comp_ctx->pgo_prof_counters) {
+        count_then = get_prof_counter(comp_ctx, base);
+        count_else = get_prof_counter(comp_ctx, base + 1);
+        if (count_then || count_else) {
+            get_branch_weights(count_then, count_else,
+                               &weight_then, &weight_else);
+            if (!aot_set_cond_br_weights(comp_ctx, cond_br,
+                                         weight_then, weight_else))
+                return false;
+        }
+    }
+
+    (void)func_ctx;
+    return true;
+}
+
+static bool
+call_record_call_target(AOTCompContext *comp_ctx, uint32 base,
+                        LLVMValueRef func_idx)
+{
+    LLVMTypeRef param_types[2], func_type;
+    LLVMValueRef func, param_values[2];
+    char *func_name = "aot_pgo_record_call_target";
+
+    param_types[0] = INT64_PTR_TYPE;
+    param_types[1] = I32_TYPE;
+    if (!(func_type = LLVMFunctionType(VOID_TYPE, param_types, 2, false))) {
+        aot_set_last_error("llvm add function type failed.");
+        return false;
+    }
+
+    /* The instrumentation is only supported in AOT mode */
+    if (!(func = LLVMGetNamedFunction(comp_ctx->module, func_name))
+        && !(func = LLVMAddFunction(comp_ctx->module, func_name, func_type))) {
+        aot_set_last_error("add LLVM function failed.");
+        return false;
+    }
+
+    if (!(param_values[0] = get_counter_ptr(comp_ctx, I32_CONST(base))))
+        return false;
+    param_values[1] = func_idx;
+
+    if (!LLVMBuildCall(comp_ctx->builder, func, param_values, 2, "")) {
+        aot_set_last_error("llvm build call failed.");
+        return false;
+    }
+    return true;
+}
+
+bool
+aot_pgo_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                      LLVMValueRef func_idx, uint32 type_idx,
+                      uint32 *p_target_func_idx,
+                      uint32 *p_weight_target, uint32 *p_weight_other)
+{
+    AOTCompData *comp_data = comp_ctx->comp_data;
+    AOTFunc *func;
+    uint64 count, total = 0, max_count = 0, target = 0;
+    uint32 base, i;
+
+    *p_target_func_idx = (uint32)-1;
+
+    if (!comp_ctx->enable_pgo_instrument && !comp_ctx->pgo_prof_counters)
+        return true;
+
+    base = alloc_counters(comp_ctx, AOT_PGO_INDIRECT_SITE_COUNT, false);
+
+    if (comp_ctx->enable_pgo_instrument)
+        return call_record_call_target(comp_ctx, base, func_idx);
+
+    for (i = 0; i < AOT_PGO_INDIRECT_TARGET_NUM; i++) {
+        count = get_prof_counter(comp_ctx, base + i * 2 + 1);
+        if (count > max_count) {
+            max_count = count;
+            target = get_prof_counter(comp_ctx, base + i * 2);
+        }
+        total += count;
+    }
+    total += get_prof_counter(comp_ctx, base + AOT_PGO_INDIRECT_TARGET_NUM * 2);
+
+    /* Promote the target called by at least half of the calls, which
+       must be a wasm function of the expected type, the others are
+       checked and called as before */
+    if (target == 0 || max_count * 2 < total
+        || target - 1 < comp_data->import_func_count
+        || target - 1 - comp_data->import_func_count >= comp_data->func_count)
+        return true;
+
+    func = comp_data->funcs[target - 1 - comp_data->import_func_count];
+    if (wasm_get_smallest_type_idx(comp_data->func_types,
+                                   comp_data->func_type_count,
+                                   func->func_type_index) != type_idx)
+        return true;
+
+    *p_target_func_idx = (uint32)(target - 1);
+    get_branch_weights(max_count, total - max_count,
+                       p_weight_target, p_weight_other);
+
+    (void)func_ctx;
+    return true;
+}
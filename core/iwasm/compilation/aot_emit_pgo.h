@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2019 Intel Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _AOT_EMIT_PGO_H_
+#define _AOT_EMIT_PGO_H_
+
+#include "aot_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool
+aot_pgo_init(AOTCompContext *comp_ctx, aot_comp_option_t option);
+
+bool
+aot_pgo_finalize(AOTCompContext *comp_ctx);
+
+bool
+aot_pgo_emit_func_entry(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx);
+
+/* Build the conditional branch of if and br_if, count its directions
+   when instrumenting, or set its branch weights from the profile */
+bool
+aot_pgo_build_cond_br(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                      LLVMValueRef cond, LLVMBasicBlockRef block_then,
+                      LLVMBasicBlockRef block_else);
+
+/* Record the target of call_indirect when instrumenting, or get the
+   dominant target from the profile, *p_target_func_idx is set to -1
+   if there is no such target */
+bool
+aot_pgo_call_indirect(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
+                      LLVMValueRef func_idx, uint32 type_idx,
+                      uint32 *p_target_func_idx,
+                      uint32 *p_weight_target, uint32 *p_weight_other);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* end of _AOT_EMIT_PGO_H_ */
@@ -25,6 +25,25 @@ get_local_type(AOTFuncContext *func_ctx, uint32 local_idx)
            : aot_func->local_types[local_idx - param_count];
 }
 
+/* The values of the local pushed to the value stack before it is set
+   don't hold the new value of the local anymore */
+static void
+clear_local_of_values(AOTFuncContext *func_ctx, uint32 local_idx)
+{
+    AOTBlock *block = func_ctx->block_stack.block_list_head;
+    AOTValue *aot_value;
+
+    while (block) {
+        aot_value = block->value_stack.value_list_head;
+        while (aot_value) {
+            if (aot_value->is_local && aot_value->local_idx == local_idx)
+                aot_value->is_local = false;
+            aot_value = aot_value->next;
+        }
+        block = block->next;
+    }
+}
+
 bool
 aot_compile_op_get_local(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                          uint32 local_idx)
@@ -71,6 +90,7 @@ aot_compile_op_set_local(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         return false;
     }
 
+    clear_local_of_values(func_ctx, local_idx);
     aot_checked_addr_list_del(func_ctx, local_idx);
     return true;
 
@@ -99,6 +119,7 @@ aot_compile_op_tee_local(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
     }
 
     PUSH(value, type);
+    clear_local_of_values(func_ctx, local_idx);
     aot_checked_addr_list_del(func_ctx, local_idx);
     return true;
 
@@ -178,6 +199,7 @@ compile_global(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         }
         /* All globals' data is 4-byte aligned */
         LLVMSetAlignment(global, 4);
+        aot_set_tbaa(comp_ctx, global, AOT_TBAA_GLOBAL);
         PUSH(global, global_type);
     }
     else {
@@ -244,6 +266,7 @@ compile_global(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
         }
         /* All globals' data is 4-byte aligned */
         LLVMSetAlignment(res, 4);
+        aot_set_tbaa(comp_ctx, res, AOT_TBAA_GLOBAL);
     }
 
     return true;
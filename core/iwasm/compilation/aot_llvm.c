@@ -6,8 +6,12 @@
 #include "aot_llvm.h"
 #include "aot_compiler.h"
 #include "aot_emit_exception.h"
+#include "aot_emit_pgo.h"
 #include "../aot/aot_runtime.h"
-
+#include "../interpreter/wasm_opcode.h"
+#if WASM_ENABLE_LINUX_PERF != 0
+#include "../common/wasm_linux_perf.h"
+#endif
 
 LLVMTypeRef
 wasm_type_to_llvm_type(AOTLLVMTypes *llvm_types, uint8 wasm_type)
@@ -97,6 +101,21 @@ aot_add_llvm_func(AOTCompContext *comp_ctx, AOTFuncType *aot_func_type,
         goto fail;
     }
 
+    /* Keep the frame pointer so that the stack walkers can walk the
+       callers of the native frames without the auxiliary frames */
+    if (comp_ctx->enable_frame_pointer) {
+        LLVMAttributeRef attr_frame_pointer =
+            LLVMCreateStringAttribute(comp_ctx->context,
+                                      "frame-pointer", 13, "all", 3);
+        if (!attr_frame_pointer) {
+            aot_set_last_error("create LLVM attribute failed.");
+            func = NULL;
+            goto fail;
+        }
+        LLVMAddAttributeAtIndex(func, LLVMAttributeFunctionIndex,
+                                attr_frame_pointer);
+    }
+
     j = 0;
     local_value = LLVMGetParam(func, j++);
     LLVMSetValueName(local_value, "exec_env");
@@ -174,6 +193,71 @@ fail:
     return NULL;
 }
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* Load an uint32 field placed before memory_data of the memory instance */
+static LLVMValueRef
+load_memory_inst_u32(AOTCompContext *comp_ctx, LLVMValueRef mem_info_base,
+                     uint32 field_offset, const char *name)
+{
+    LLVMValueRef offset, value;
+
+    offset = I32_CONST(field_offset
+                       - (uint32)offsetof(AOTMemoryInstance, memory_data.ptr));
+    if (!offset) {
+        aot_set_last_error("create llvm const failed.");
+        return NULL;
+    }
+    if (!(value = LLVMBuildInBoundsGEP(comp_ctx->builder, mem_info_base,
+                                       &offset, 1, name))
+        || !(value = LLVMBuildBitCast(comp_ctx->builder, value,
+                                      INT32_PTR_TYPE, name))) {
+        aot_set_last_error("llvm build gep or bit cast failed");
+        return NULL;
+    }
+    if (!(value = LLVMBuildLoad(comp_ctx->builder, value, name))) {
+        aot_set_last_error("llvm build load failed");
+        return NULL;
+    }
+    aot_set_tbaa(comp_ctx, value, AOT_TBAA_MEMORY_INFO);
+    return value;
+}
+
+/**
+ * Load the max size of memory64, the space of the max size and a guard
+ * region is reserved by the runtime when the memory is instantiated,
+ * and the max page count and the page size are never changed after that
+ */
+static LLVMValueRef
+load_memory64_max_size(AOTCompContext *comp_ctx, LLVMValueRef mem_info_base)
+{
+    LLVMValueRef max_page_count, num_bytes_per_page, max_size;
+
+    if (!(max_page_count =
+            load_memory_inst_u32(comp_ctx, mem_info_base,
+                                 offsetof(AOTMemoryInstance, max_page_count),
+                                 "max_page_count"))
+        || !(num_bytes_per_page =
+            load_memory_inst_u32(comp_ctx, mem_info_base,
+                                 offsetof(AOTMemoryInstance,
+                                          num_bytes_per_page),
+                                 "num_bytes_per_page")))
+        return NULL;
+
+    if (!(max_page_count = LLVMBuildZExt(comp_ctx->builder, max_page_count,
+                                         I64_TYPE, "max_page_count_i64"))
+        || !(num_bytes_per_page =
+                LLVMBuildZExt(comp_ctx->builder, num_bytes_per_page,
+                              I64_TYPE, "num_bytes_per_page_i64"))
+        || !(max_size = LLVMBuildNUWMul(comp_ctx->builder, max_page_count,
+                                        num_bytes_per_page,
+                                        "mem_max_size"))) {
+        aot_set_last_error("llvm build zext or mul failed");
+        return NULL;
+    }
+    return max_size;
+}
+#endif /* end of WASM_ENABLE_MEMORY64 */
+
 static bool
 create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
                    LLVMTypeRef int8_ptr_type, uint32 func_index)
@@ -237,6 +321,7 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, shared_mem_addr, AOT_TBAA_MEMORY_INFO);
         if (!(shared_mem_addr =
                 LLVMBuildBitCast(comp_ctx->builder,
                                  shared_mem_addr, int8_ptr_type,
@@ -250,6 +335,7 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, shared_mem_addr, AOT_TBAA_MEMORY_INFO);
         offset = I32_CONST(offsetof(AOTMemoryInstance, memory_data.ptr));
         if (!(func_ctx->mem_info[0].mem_base_addr =
                 LLVMBuildInBoundsGEP(comp_ctx->builder, shared_mem_addr,
@@ -320,7 +406,7 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
     if (!(func_ctx->mem_info[0].mem_data_size_addr =
                 LLVMBuildBitCast(comp_ctx->builder,
                                  func_ctx->mem_info[0].mem_data_size_addr,
-                                 INT32_PTR_TYPE, "mem_data_size_ptr"))) {
+                                 INT64_PTR_TYPE, "mem_data_size_ptr"))) {
         aot_set_last_error("llvm build bit cast failed");
         return false;
     }
@@ -332,6 +418,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_base_addr,
+                     AOT_TBAA_MEMORY_INFO);
         if (!(func_ctx->mem_info[0].mem_cur_page_count_addr =
                     LLVMBuildLoad(comp_ctx->builder,
                                   func_ctx->mem_info[0].mem_cur_page_count_addr,
@@ -339,6 +427,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_cur_page_count_addr,
+                     AOT_TBAA_MEMORY_INFO);
         if (!(func_ctx->mem_info[0].mem_data_size_addr =
                     LLVMBuildLoad(comp_ctx->builder,
                                   func_ctx->mem_info[0].mem_data_size_addr,
@@ -346,6 +436,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_data_size_addr,
+                     AOT_TBAA_MEMORY_INFO);
     }
 #if WASM_ENABLE_SHARED_MEMORY != 0
     else if (is_shared_memory) {
@@ -358,6 +450,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_base_addr,
+                     AOT_TBAA_MEMORY_INFO);
     }
 #endif
 
@@ -388,6 +482,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_bound_check_1byte,
+                     AOT_TBAA_MEMORY_INFO);
     }
 
     offset = I32_CONST(offsetof(AOTMemoryInstance, mem_bound_check_2bytes)
@@ -413,6 +509,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_bound_check_2bytes,
+                     AOT_TBAA_MEMORY_INFO);
     }
 
     offset = I32_CONST(offsetof(AOTMemoryInstance, mem_bound_check_4bytes)
@@ -438,6 +536,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_bound_check_4bytes,
+                     AOT_TBAA_MEMORY_INFO);
     }
 
     offset = I32_CONST(offsetof(AOTMemoryInstance, mem_bound_check_8bytes)
@@ -463,6 +563,8 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_bound_check_8bytes,
+                     AOT_TBAA_MEMORY_INFO);
     }
 
     offset = I32_CONST(offsetof(AOTMemoryInstance, mem_bound_check_16bytes)
@@ -488,8 +590,20 @@ create_memory_info(AOTCompContext *comp_ctx, AOTFuncContext *func_ctx,
             aot_set_last_error("llvm build load failed");
             return false;
         }
+        aot_set_tbaa(comp_ctx, func_ctx->mem_info[0].mem_bound_check_16bytes,
+                     AOT_TBAA_MEMORY_INFO);
     }
 
+#if WASM_ENABLE_MEMORY64 != 0
+    if (!comp_ctx->enable_bound_check
+        && comp_ctx->pointer_size == sizeof(uint64)
+        && comp_ctx->comp_data->memory_count > 0
+        && (comp_ctx->comp_data->memories[0].memory_flags & MEMORY64_FLAG)
+        && !(func_ctx->mem_info[0].mem_max_size =
+                load_memory64_max_size(comp_ctx, mem_info_base)))
+        return false;
+#endif
+
     return true;
 }
 
@@ -652,6 +766,7 @@ aot_create_func_context(AOTCompData *comp_data, AOTCompContext *comp_ctx,
         aot_set_last_error("llvm build load failed");
         goto fail;
     }
+    aot_set_tbaa(comp_ctx, func_ctx->aot_inst, AOT_TBAA_EXEC_ENV);
 
     /* Get argv buffer address */
     if (!(argv_buf_addr =
@@ -678,6 +793,7 @@ aot_create_func_context(AOTCompData *comp_data, AOTCompContext *comp_ctx,
         aot_set_last_error("llvm build load failed");
         goto fail;
     }
+    aot_set_tbaa(comp_ctx, func_ctx->argv_buf, AOT_TBAA_EXEC_ENV);
 
     /* Get native stack boundary address */
     if (!(stack_bound_addr =
@@ -693,6 +809,7 @@ aot_create_func_context(AOTCompData *comp_data, AOTCompContext *comp_ctx,
         aot_set_last_error("llvm build load failed");
         goto fail;
     }
+    aot_set_tbaa(comp_ctx, func_ctx->native_stack_bound, AOT_TBAA_EXEC_ENV);
 
     /* Get aux stack boundary address */
     if (!(aux_stack_bound_addr =
@@ -717,6 +834,7 @@ aot_create_func_context(AOTCompData *comp_data, AOTCompContext *comp_ctx,
         aot_set_last_error("llvm build load failed");
         goto fail;
     }
+    aot_set_tbaa(comp_ctx, func_ctx->aux_stack_bound, AOT_TBAA_EXEC_ENV);
 
     /* Get aux stack bottom address */
     if (!(aux_stack_bottom_addr =
@@ -740,6 +858,7 @@ aot_create_func_context(AOTCompData *comp_data, AOTCompContext *comp_ctx,
         aot_set_last_error("llvm build load failed");
         goto fail;
     }
+    aot_set_tbaa(comp_ctx, func_ctx->aux_stack_bottom, AOT_TBAA_EXEC_ENV);
 
     for (i = 0; i < aot_func_type->param_count; i++, j++) {
         snprintf(local_name, sizeof(local_name), "l%d", i);
@@ -1172,13 +1291,265 @@ WAMRCreateMCJITCompilerForModule(LLVMExecutionEngineRef *OutJIT,
 
 void LLVMAddPromoteMemoryToRegisterPass(LLVMPassManagerRef PM);
 
+void
+aot_add_function_inlining_pass(LLVMPassManagerRef pass_mgr,
+                               unsigned threshold);
+
+void
+aot_add_irce_pass(LLVMPassManagerRef pass_mgr);
+
+void
+aot_add_hot_cold_splitting_pass(LLVMPassManagerRef pass_mgr);
+
+static const char *tbaa_region_names[] = {
+    "wasm linear memory",
+    "wasm memory info",
+    "wasm global",
+    "wasm exec env",
+};
+
+/* Create a scalar TBAA type for each region under a common root, and
+   the access tag of the type at offset 0 */
+static bool
+create_tbaa_tags(AOTCompContext *comp_ctx)
+{
+    LLVMValueRef root_name, root, values[3], type;
+    uint32 i;
+
+    bh_assert(sizeof(tbaa_region_names) / sizeof(tbaa_region_names[0])
+              == AOT_TBAA_REGION_COUNT);
+
+    comp_ctx->tbaa_kind_id =
+        LLVMGetMDKindIDInContext(comp_ctx->context, "tbaa", 4);
+
+    if (!(root_name = LLVMMDStringInContext(comp_ctx->context,
+                                            "wamr tbaa root", 14))
+        || !(root = LLVMMDNodeInContext(comp_ctx->context, &root_name, 1)))
+        goto fail;
+
+    for (i = 0; i < AOT_TBAA_REGION_COUNT; i++) {
+        values[0] = LLVMMDStringInContext(comp_ctx->context,
+                                          tbaa_region_names[i],
+                                          (uint32)strlen(tbaa_region_names[i]));
+        values[1] = root;
+        values[2] = I64_ZERO;
+        if (!values[0]
+            || !(type = LLVMMDNodeInContext(comp_ctx->context, values, 3)))
+            goto fail;
+
+        values[0] = values[1] = type;
+        if (!(comp_ctx->tbaa_tags[i] =
+                    LLVMMDNodeInContext(comp_ctx->context, values, 3)))
+            goto fail;
+    }
+    return true;
+
+fail:
+    aot_set_last_error("create LLVM TBAA metadata failed.");
+    return false;
+}
+
+LLVMPassManagerRef
+aot_create_func_pass_mgr(AOTCompContext *comp_ctx, LLVMModuleRef module)
+{
+    LLVMPassManagerRef pass_mgr;
+
+    if (!(pass_mgr = LLVMCreateFunctionPassManagerForModule(module))) {
+        aot_set_last_error("create LLVM pass manager failed.");
+        return NULL;
+    }
+
+    /* Provide the target info to the cost models, e.g. the vector
+       width for the loop vectorizer, and use the TBAA metadata of the
+       regions in the alias analysis */
+    LLVMAddAnalysisPasses(comp_ctx->target_machine, pass_mgr);
+    LLVMAddTypeBasedAliasAnalysisPass(pass_mgr);
+    LLVMAddBasicAliasAnalysisPass(pass_mgr);
+
+    LLVMAddPromoteMemoryToRegisterPass(pass_mgr);
+    LLVMAddInstructionCombiningPass(pass_mgr);
+    LLVMAddCFGSimplificationPass(pass_mgr);
+    LLVMAddJumpThreadingPass(pass_mgr);
+#if LLVM_VERSION_MAJOR < 12
+    LLVMAddConstantPropagationPass(pass_mgr);
+#endif
+    LLVMAddIndVarSimplifyPass(pass_mgr);
+
+    if (!comp_ctx->is_jit_mode) {
+        LLVMAddLoopRotatePass(pass_mgr);
+        LLVMAddLoopUnswitchPass(pass_mgr);
+        LLVMAddInstructionCombiningPass(pass_mgr);
+        LLVMAddCFGSimplificationPass(pass_mgr);
+        if (!comp_ctx->enable_thread_mgr) {
+            /* These two passes may destroy the volatile semantics,
+                disable them when building as multi-thread mode */
+            LLVMAddGVNPass(pass_mgr);
+            LLVMAddLICMPass(pass_mgr);
+        }
+        aot_add_irce_pass(pass_mgr);
+        LLVMAddLoopVectorizePass(pass_mgr);
+        LLVMAddSLPVectorizePass(pass_mgr);
+        LLVMAddInstructionCombiningPass(pass_mgr);
+        LLVMAddCFGSimplificationPass(pass_mgr);
+    }
+    return pass_mgr;
+}
+
+/* Inline thresholds of the module pass pipeline for size level 0 to 3,
+   which are the same as clang's -O3, -O2, -Os and -Oz */
+static const unsigned inline_thresholds[] = { 250, 225, 50, 25 };
+
+static bool
+create_module_pass_mgr(AOTCompContext *comp_ctx, uint32 size_level,
+                       bool enable_thread_mgr)
+{
+    LLVMPassManagerRef pass_mgr;
+
+    if (!(pass_mgr = comp_ctx->module_pass_mgr = LLVMCreatePassManager())) {
+        aot_set_last_error("create LLVM module pass manager failed.");
+        return false;
+    }
+
+    if (size_level > 3)
+        size_level = 3;
+
+    LLVMAddAnalysisPasses(comp_ctx->target_machine, pass_mgr);
+    LLVMAddTypeBasedAliasAnalysisPass(pass_mgr);
+    LLVMAddBasicAliasAnalysisPass(pass_mgr);
+
+    /* Propagate the constant arguments and infer the function attributes,
+       e.g. readonly and nounwind, to help the inliner and the later
+       optimizations of the callers */
+    LLVMAddIPSCCPPass(pass_mgr);
+    LLVMAddFunctionAttrsPass(pass_mgr);
+    aot_add_function_inlining_pass(pass_mgr, inline_thresholds[size_level]);
+    LLVMAddGlobalDCEPass(pass_mgr);
+
+    /* Clean up the inlined code */
+    LLVMAddInstructionCombiningPass(pass_mgr);
+    LLVMAddCFGSimplificationPass(pass_mgr);
+    if (!enable_thread_mgr) {
+        /* GVN may destroy the volatile semantics, disable it when
+           building as multi-thread mode */
+        LLVMAddGVNPass(pass_mgr);
+    }
+    LLVMAddDeadStoreEliminationPass(pass_mgr);
+    LLVMAddInstructionCombiningPass(pass_mgr);
+    LLVMAddCFGSimplificationPass(pass_mgr);
+
+    /* Outline the cold paths found by the profile data from the hot
+       functions to make them smaller */
+    if (comp_ctx->pgo_prof_counters)
+        aot_add_hot_cold_splitting_pass(pass_mgr);
+    return true;
+}
+
+/* Tables larger than this are not analyzed for call_indirect
+   devirtualization to limit the compiler memory usage */
+#define DEVIRT_TABLE_MAX_SIZE (1024 * 1024)
+
+static bool
+is_table_exported(const WASMModule *module, uint32 tbl_idx)
+{
+    uint32 i;
+
+    for (i = 0; i < module->export_count; i++) {
+        if (module->exports[i].kind == EXPORT_KIND_TABLE
+            && module->exports[i].index == tbl_idx)
+            return true;
+    }
+    return false;
+}
+
+/* Get the elements of the table after instantiation, return NULL if they
+   can't be known at compile time or may be changed at runtime */
+static uint32 *
+get_immutable_table_elems(AOTCompData *comp_data, uint32 tbl_idx)
+{
+    AOTTable *table = comp_data->tables + tbl_idx;
+    AOTTableInitData *init_data;
+    uint32 *func_indexes, offset, i;
+    uint64 size;
+
+    /* The imported and exported tables may be changed by others,
+       and table.set/init/copy/fill/grow may change the local ones */
+    if (tbl_idx < comp_data->wasm_module->import_table_count
+        || is_table_exported(comp_data->wasm_module, tbl_idx)
+        || table->possible_set || table->possible_grow
+        || table->table_init_size == 0
+        || table->table_init_size > DEVIRT_TABLE_MAX_SIZE)
+        return NULL;
+
+    size = sizeof(uint32) * (uint64)table->table_init_size;
+    if (!(func_indexes = wasm_runtime_malloc((uint32)size))) {
+        return NULL;
+    }
+    /* Set all elements to -1 to mark them as uninitialized elements */
+    memset(func_indexes, 0xFF, (uint32)size);
+
+    /* Apply the active element segments like table_instantiate does */
+    for (i = 0; i < comp_data->table_init_data_count; i++) {
+        init_data = comp_data->table_init_data_list[i];
+
+#if WASM_ENABLE_REF_TYPES != 0
+        if (!wasm_elem_is_active(init_data->mode))
+            continue;
+#endif
+        if (init_data->table_index != tbl_idx)
+            continue;
+
+        offset = (uint32)init_data->offset.u.i32;
+        if (init_data->offset.init_expr_type != INIT_EXPR_TYPE_I32_CONST
+            || offset > table->table_init_size
+            || init_data->func_index_count
+                 > table->table_init_size - offset) {
+            wasm_runtime_free(func_indexes);
+            return NULL;
+        }
+
+        bh_memcpy_s(func_indexes + offset,
+                    (table->table_init_size - offset) * sizeof(uint32),
+                    init_data->func_indexes,
+                    init_data->func_index_count * sizeof(uint32));
+    }
+
+    return func_indexes;
+}
+
+static bool
+init_call_indirect_devirt(AOTCompContext *comp_ctx)
+{
+    AOTCompData *comp_data = comp_ctx->comp_data;
+    uint64 size;
+    uint32 i;
+
+    if (comp_data->table_count == 0)
+        return true;
+
+    size = sizeof(uint32 *) * (uint64)comp_data->table_count;
+    if (size >= UINT32_MAX
+        || !(comp_ctx->devirt_tbl_func_indexes =
+               wasm_runtime_malloc((uint32)size))) {
+        aot_set_last_error("allocate memory failed.");
+        return false;
+    }
+    memset(comp_ctx->devirt_tbl_func_indexes, 0, (uint32)size);
+
+    for (i = 0; i < comp_data->table_count; i++)
+        comp_ctx->devirt_tbl_func_indexes[i] =
+            get_immutable_table_elems(comp_data, i);
+    return true;
+}
+
 AOTCompContext *
 aot_create_comp_context(AOTCompData *comp_data,
                         aot_comp_option_t option)
 {
     AOTCompContext *comp_ctx, *ret = NULL;
     /*LLVMTypeRef elem_types[8];*/
+#if WASM_ENABLE_LAZY_JIT == 0
     struct LLVMMCJITCompilerOptions jit_options;
+#endif
     LLVMTargetRef target;
     char *triple = NULL, *triple_norm, *arch, *abi;
     char *cpu = NULL, *features, buf[128];
@@ -1237,16 +1608,75 @@ aot_create_comp_context(AOTCompData *comp_data,
     if (option->enable_aux_stack_frame)
         comp_ctx->enable_aux_stack_frame = true;
 
+    if (option->enable_frame_pointer)
+        comp_ctx->enable_frame_pointer = true;
+
     if (option->enable_aux_stack_check)
         comp_ctx->enable_aux_stack_check = true;
 
+    if (!option->is_jit_mode
+        && !aot_pgo_init(comp_ctx, option))
+        goto fail;
+
+    /* The profile data should record the targets of all the
+       call_indirect, don't devirtualize them when instrumenting */
+    if (option->enable_call_indirect_devirt
+        && !comp_ctx->enable_pgo_instrument
+        && !comp_ctx->enable_aux_stack_frame) {
+        comp_ctx->enable_call_indirect_devirt = true;
+        if (!init_call_indirect_devirt(comp_ctx))
+            goto fail;
+    }
+
+    if (option->incremental_cache_dir && !option->is_jit_mode) {
+        /* The counters of the profile data are allocated across
+           the whole module, the functions can't be compiled
+           separately */
+        if (comp_ctx->enable_pgo_instrument) {
+            aot_set_last_error("incremental compilation isn't supported "
+                               "when instrumenting for PGO.");
+            goto fail;
+        }
+        comp_ctx->incremental_cache_dir = option->incremental_cache_dir;
+    }
+
     if (option->is_jit_mode) {
         char *triple_jit = NULL;
 
+#if WASM_ENABLE_LAZY_JIT != 0
+        /* Create ORC lazy JIT, the functions are compiled on their
+           first calls, possibly in the compile threads */
+        void *event_listener = NULL;
+
+#if WASM_ENABLE_LINUX_PERF != 0
+        if (wasm_linux_perf_enabled()
+            && !(event_listener = comp_ctx->linux_perf_listener =
+                   aot_create_linux_perf_listener(comp_ctx))) {
+            aot_set_last_error("create JIT event listener failed.");
+            goto fail;
+        }
+#endif
+        if (aot_create_lazy_jit(&comp_ctx->lazy_jit,
+                                &comp_ctx->target_machine, comp_ctx,
+                                WASM_LAZY_JIT_COMPILE_THREAD_NUM,
+                                event_listener, &err) != 0) {
+            if (err) {
+                aot_set_last_error_v("create LLVM lazy JIT compiler "
+                                     "failed: %s.", err);
+                LLVMDisposeMessage(err);
+                err = NULL;
+            }
+            else
+                aot_set_last_error("create LLVM lazy JIT compiler failed.");
+            goto fail;
+        }
+        comp_ctx->is_jit_mode = true;
+#else
         /* Create LLVM execution engine */
         LLVMInitializeMCJITCompilerOptions(&jit_options, sizeof(jit_options));
         jit_options.OptLevel = LLVMCodeGenLevelAggressive;
         jit_options.EnableFastISel = true;
+        jit_options.NoFramePointerElim = comp_ctx->enable_frame_pointer;
         /*jit_options.CodeModel = LLVMCodeModelSmall;*/
         if (WAMRCreateMCJITCompilerForModule
                 (&comp_ctx->exec_engine, comp_ctx->module,
@@ -1261,6 +1691,18 @@ aot_create_comp_context(AOTCompData *comp_data,
         comp_ctx->is_jit_mode = true;
         comp_ctx->target_machine =
                 LLVMGetExecutionEngineTargetMachine(comp_ctx->exec_engine);
+#if WASM_ENABLE_LINUX_PERF != 0
+        if (wasm_linux_perf_enabled()) {
+            if (!(comp_ctx->linux_perf_listener =
+                    aot_create_linux_perf_listener(comp_ctx))) {
+                aot_set_last_error("create JIT event listener failed.");
+                goto fail;
+            }
+            aot_register_jit_event_listener(comp_ctx->exec_engine,
+                                            comp_ctx->linux_perf_listener);
+        }
+#endif
+#endif
 #ifndef OS_ENABLE_HW_BOUND_CHECK
         comp_ctx->enable_bound_check = true;
 #else
@@ -1276,6 +1718,9 @@ aot_create_comp_context(AOTCompData *comp_data,
         /* Save target arch */
         get_target_arch_from_triple(triple_jit, comp_ctx->target_arch,
                                     sizeof(comp_ctx->target_arch));
+#if WASM_ENABLE_LAZY_JIT != 0
+        LLVMSetTarget(comp_ctx->module, triple_jit);
+#endif
         LLVMDisposeMessage(triple_jit);
     }
     else {
@@ -1284,8 +1729,8 @@ aot_create_comp_context(AOTCompData *comp_data,
         abi = option->target_abi;
         cpu = option->target_cpu;
         features = option->cpu_features;
-        opt_level = option->opt_level;
-        size_level = option->size_level;
+        opt_level = comp_ctx->opt_level = option->opt_level;
+        size_level = comp_ctx->size_level = option->size_level;
 
         if (arch) {
             /* Add default sub-arch if not specified */
@@ -1518,44 +1963,35 @@ aot_create_comp_context(AOTCompData *comp_data,
         goto fail;
     }
     comp_ctx->pointer_size = LLVMPointerSize(target_data_ref);
+#if WASM_ENABLE_LAZY_JIT != 0
+    /* The lazy JIT requires the data layout of the module to match
+       the one of its target machines */
+    if (comp_ctx->lazy_jit)
+        LLVMSetModuleDataLayout(comp_ctx->module, target_data_ref);
+#endif
     LLVMDisposeTargetData(target_data_ref);
 
     comp_ctx->optimize = true;
     if (option->output_format == AOT_LLVMIR_UNOPT_FILE)
         comp_ctx->optimize = false;
 
-    if (!(comp_ctx->pass_mgr = LLVMCreateFunctionPassManagerForModule
-                (comp_ctx->module))) {
-        aot_set_last_error("create LLVM pass manager failed.");
-        goto fail;
-    }
-
-    LLVMAddPromoteMemoryToRegisterPass(comp_ctx->pass_mgr);
-    LLVMAddInstructionCombiningPass(comp_ctx->pass_mgr);
-    LLVMAddCFGSimplificationPass(comp_ctx->pass_mgr);
-    LLVMAddJumpThreadingPass(comp_ctx->pass_mgr);
-#if LLVM_VERSION_MAJOR < 12
-    LLVMAddConstantPropagationPass(comp_ctx->pass_mgr);
+#if WASM_ENABLE_LAZY_JIT != 0
+    /* The lazy JIT optimizes each function when compiling it, the
+       module is split and freed after the IR is generated */
+    if (!comp_ctx->lazy_jit)
 #endif
-    LLVMAddIndVarSimplifyPass(comp_ctx->pass_mgr);
-
-    if (!option->is_jit_mode) {
-        LLVMAddLoopRotatePass(comp_ctx->pass_mgr);
-        LLVMAddLoopUnswitchPass(comp_ctx->pass_mgr);
-        LLVMAddInstructionCombiningPass(comp_ctx->pass_mgr);
-        LLVMAddCFGSimplificationPass(comp_ctx->pass_mgr);
-        if (!option->enable_thread_mgr) {
-            /* These two passes may destroy the volatile semantics,
-                disable them when building as multi-thread mode */
-            LLVMAddGVNPass(comp_ctx->pass_mgr);
-            LLVMAddLICMPass(comp_ctx->pass_mgr);
-        }
-        LLVMAddLoopVectorizePass(comp_ctx->pass_mgr);
-        LLVMAddSLPVectorizePass(comp_ctx->pass_mgr);
-        LLVMAddInstructionCombiningPass(comp_ctx->pass_mgr);
-        LLVMAddCFGSimplificationPass(comp_ctx->pass_mgr);
+    {
+        if (!(comp_ctx->pass_mgr =
+                    aot_create_func_pass_mgr(comp_ctx, comp_ctx->module)))
+            goto fail;
     }
 
+    if (!option->is_jit_mode
+        && comp_ctx->optimize
+        && !create_module_pass_mgr(comp_ctx, comp_ctx->size_level,
+                                   option->enable_thread_mgr))
+        goto fail;
+
     /* Create metadata for llvm float experimental constrained intrinsics */
     if (!(comp_ctx->fp_rounding_mode =
                 LLVMMDStringInContext(comp_ctx->context,
@@ -1579,6 +2015,9 @@ aot_create_comp_context(AOTCompData *comp_data,
         goto fail;
     }
 
+    if (!create_tbaa_tags(comp_ctx))
+        goto fail;
+
     /* set exec_env data type to int8** */
     comp_ctx->exec_env_type = comp_ctx->basic_types.int8_pptr_type;
 
@@ -1616,7 +2055,11 @@ aot_destroy_comp_context(AOTCompContext *comp_ctx)
     if (comp_ctx->pass_mgr)
         LLVMDisposePassManager(comp_ctx->pass_mgr);
 
-    if (comp_ctx->target_machine && !comp_ctx->is_jit_mode)
+    if (comp_ctx->module_pass_mgr)
+        LLVMDisposePassManager(comp_ctx->module_pass_mgr);
+
+    /* The target machine of MCJIT is owned by the execution engine */
+    if (comp_ctx->target_machine && !comp_ctx->exec_engine)
         LLVMDisposeTargetMachine(comp_ctx->target_machine);
 
     if (comp_ctx->builder)
@@ -1633,13 +2076,140 @@ aot_destroy_comp_context(AOTCompContext *comp_ctx)
     if (comp_ctx->context)
         LLVMContextDispose(comp_ctx->context);
 
+#if WASM_ENABLE_LAZY_JIT != 0
+    /* The LLVM module and context added to the lazy JIT are freed
+       when destroying it, comp_ctx->module and comp_ctx->context
+       were set to NULL when adding them */
+    if (comp_ctx->lazy_jit)
+        aot_destroy_lazy_jit(comp_ctx->lazy_jit);
+#endif
+
+#if WASM_ENABLE_LINUX_PERF != 0
+    /* The listener is used until the JIT is destroyed */
+    if (comp_ctx->linux_perf_listener)
+        aot_destroy_linux_perf_listener(comp_ctx->linux_perf_listener);
+#endif
+
     if (comp_ctx->func_ctxes)
         aot_destroy_func_contexts(comp_ctx->func_ctxes,
                                   comp_ctx->func_ctx_count);
 
+    if (comp_ctx->pgo_prof_exec_counters)
+        wasm_runtime_free(comp_ctx->pgo_prof_exec_counters);
+
+    if (comp_ctx->devirt_tbl_func_indexes) {
+        uint32 i;
+        for (i = 0; i < comp_ctx->comp_data->table_count; i++) {
+            if (comp_ctx->devirt_tbl_func_indexes[i])
+                wasm_runtime_free(comp_ctx->devirt_tbl_func_indexes[i]);
+        }
+        wasm_runtime_free(comp_ctx->devirt_tbl_func_indexes);
+    }
+
     wasm_runtime_free(comp_ctx);
 }
 
+bool
+aot_set_cond_br_weights(AOTCompContext *comp_ctx, LLVMValueRef cond_br,
+                        uint32 weight_if, uint32 weight_else)
+{
+    LLVMValueRef weights[3], md_node;
+    unsigned kind_id;
+
+    kind_id = LLVMGetMDKindIDInContext(comp_ctx->context, "prof", 4);
+    if (!(weights[0] = LLVMMDStringInContext(comp_ctx->context,
+                                             "branch_weights", 14))
+        || !(weights[1] = I32_CONST(weight_if))
+        || !(weights[2] = I32_CONST(weight_else))
+        || !(md_node = LLVMMDNodeInContext(comp_ctx->context, weights, 3))) {
+        aot_set_last_error("create LLVM metadata failed.");
+        return false;
+    }
+
+    LLVMSetMetadata(cond_br, kind_id, md_node);
+    return true;
+}
+
+bool
+aot_set_switch_weights(AOTCompContext *comp_ctx, LLVMValueRef switch_inst,
+                       const uint32 *weights, uint32 weight_count)
+{
+    LLVMValueRef *md_values, md_node = NULL;
+    uint64 total_size;
+    unsigned kind_id;
+    uint32 i;
+
+    total_size = sizeof(LLVMValueRef) * ((uint64)weight_count + 1);
+    if (total_size >= UINT32_MAX
+        || !(md_values = wasm_runtime_malloc((uint32)total_size))) {
+        aot_set_last_error("allocate memory failed.");
+        return false;
+    }
+
+    kind_id = LLVMGetMDKindIDInContext(comp_ctx->context, "prof", 4);
+    if (!(md_values[0] = LLVMMDStringInContext(comp_ctx->context,
+                                               "branch_weights", 14)))
+        goto fail;
+    for (i = 0; i < weight_count; i++) {
+        if (!(md_values[i + 1] = I32_CONST(weights[i])))
+            goto fail;
+    }
+    md_node = LLVMMDNodeInContext(comp_ctx->context, md_values,
+                                  weight_count + 1);
+
+fail:
+    wasm_runtime_free(md_values);
+    if (!md_node) {
+        aot_set_last_error("create LLVM metadata failed.");
+        return false;
+    }
+
+    LLVMSetMetadata(switch_inst, kind_id, md_node);
+    return true;
+}
+
+#if WASM_ENABLE_LINUX_PERF != 0
+void
+aot_emit_linux_perf_func(AOTCompContext *comp_ctx, const char *symbol,
+                         const void *code, uint64 code_size)
+{
+    WASMModule *wasm_module = comp_ctx->comp_data->wasm_module;
+    const char *name = NULL, *p;
+    uint32 func_index = 0, i;
+
+    if (strncmp(symbol, AOT_FUNC_PREFIX, strlen(AOT_FUNC_PREFIX))) {
+        /* not a wasm function, e.g. a lazy compilation stub */
+        wasm_linux_perf_add_code(code, code_size, symbol);
+        return;
+    }
+
+    for (p = symbol + strlen(AOT_FUNC_PREFIX); *p >= '0' && *p <= '9'; p++)
+        func_index = func_index * 10 + (uint32)(*p - '0');
+
+    if (*p == '\0' && func_index < wasm_module->function_count) {
+#if WASM_ENABLE_CUSTOM_NAME_SECTION != 0
+        name = wasm_module->functions[func_index]->field_name;
+#endif
+        for (i = 0; !name && i < wasm_module->export_count; i++) {
+            if (wasm_module->exports[i].kind == EXPORT_KIND_FUNC
+                && wasm_module->exports[i].index
+                       == func_index + wasm_module->import_function_count)
+                name = wasm_module->exports[i].name;
+        }
+    }
+
+    wasm_linux_perf_add_code(code, code_size, name ? name : symbol);
+}
+#endif /* end of WASM_ENABLE_LINUX_PERF != 0 */
+
+void
+aot_set_tbaa(AOTCompContext *comp_ctx, LLVMValueRef inst,
+             AOTTBAARegion region)
+{
+    bh_assert(region < AOT_TBAA_REGION_COUNT);
+    LLVMSetMetadata(inst, comp_ctx->tbaa_kind_id, comp_ctx->tbaa_tags[region]);
+}
+
 void
 aot_value_stack_push(AOTValueStack *stack, AOTValue *value)
 {
@@ -1742,9 +2312,22 @@ aot_block_destroy(AOTBlock *block)
     wasm_runtime_free(block);
 }
 
+static uint32
+get_block_stack_depth(AOTFuncContext *func_ctx)
+{
+    AOTBlock *block = func_ctx->block_stack.block_list_end;
+    uint32 depth = 0;
+
+    while (block) {
+        depth++;
+        block = block->prev;
+    }
+    return depth;
+}
+
 bool
 aot_checked_addr_list_add(AOTFuncContext *func_ctx,
-                          uint32 local_idx, uint32 offset, uint32 bytes)
+                          uint32 local_idx, uint64 offset, uint32 bytes)
 {
     AOTCheckedAddr *node = func_ctx->checked_addr_list;
 
@@ -1756,6 +2339,7 @@ aot_checked_addr_list_add(AOTFuncContext *func_ctx,
     node->local_idx = local_idx;
     node->offset = offset;
     node->bytes = bytes;
+    node->block_depth = get_block_stack_depth(func_ctx);
 
     node->next = func_ctx->checked_addr_list;
     func_ctx->checked_addr_list = node;
@@ -1788,14 +2372,17 @@ aot_checked_addr_list_del(AOTFuncContext *func_ctx, uint32 local_idx)
 
 bool
 aot_checked_addr_list_find(AOTFuncContext *func_ctx,
-                           uint32 local_idx, uint32 offset, uint32 bytes)
+                           uint32 local_idx, uint64 offset, uint32 bytes)
 {
     AOTCheckedAddr *node = func_ctx->checked_addr_list;
 
     while (node) {
+        /* Only the upper bound is checked, so an access is in bounds
+           if it ends before the end of a checked access */
         if (node->local_idx == local_idx
-            && node->offset == offset
-            && node->bytes >= bytes) {
+            && offset <= UINT64_MAX - bytes
+            && node->offset <= UINT64_MAX - node->bytes
+            && node->offset + node->bytes >= offset + bytes) {
             return true;
         }
         node = node->next;
@@ -1804,6 +2391,63 @@ aot_checked_addr_list_find(AOTFuncContext *func_ctx,
     return false;
 }
 
+/* Remove the addresses checked inside the current block, called when
+   leaving the block or starting to translate its else branch. The
+   addresses checked before the block still dominate the code after it */
+void
+aot_checked_addr_list_del_in_block(AOTFuncContext *func_ctx)
+{
+    AOTCheckedAddr *node = func_ctx->checked_addr_list;
+    AOTCheckedAddr *node_prev = NULL, *node_next;
+    uint32 block_depth = get_block_stack_depth(func_ctx);
+
+    while (node) {
+        node_next = node->next;
+
+        if (node->block_depth >= block_depth) {
+            if (!node_prev)
+                func_ctx->checked_addr_list = node_next;
+            else
+                node_prev->next = node_next;
+            wasm_runtime_free(node);
+        }
+        else {
+            node_prev = node;
+        }
+
+        node = node_next;
+    }
+}
+
+/* Remove the addresses of the locals that may be set inside the loop
+   body, the others are still in bounds when jumping back to the loop
+   header since the linear memory never shrinks. Each 0x21/0x22 byte is
+   treated as local.set/local.tee, which may remove more addresses than
+   needed but never misses a set opcode */
+void
+aot_checked_addr_list_enter_loop(AOTFuncContext *func_ctx,
+                                 uint8 *frame_ip, uint8 *frame_ip_end)
+{
+    uint8 *p, *p_end;
+    uint32 local_idx, shift;
+
+    for (p = frame_ip; p < frame_ip_end && func_ctx->checked_addr_list; p++) {
+        if (*p != WASM_OP_SET_LOCAL && *p != WASM_OP_TEE_LOCAL)
+            continue;
+
+        local_idx = 0;
+        shift = 0;
+        p_end = p + 1;
+        while (p_end < frame_ip_end && shift < 32) {
+            local_idx |= (uint32)(*p_end & 0x7F) << shift;
+            shift += 7;
+            if (!(*p_end++ & 0x80))
+                break;
+        }
+        aot_checked_addr_list_del(func_ctx, local_idx);
+    }
+}
+
 void
 aot_checked_addr_list_destroy(AOTFuncContext *func_ctx)
 {
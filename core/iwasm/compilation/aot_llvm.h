@@ -14,6 +14,7 @@
 #include "llvm-c/Object.h"
 #include "llvm-c/ExecutionEngine.h"
 #include "llvm-c/Analysis.h"
+#include "llvm-c/Transforms/IPO.h"
 #include "llvm-c/Transforms/Utils.h"
 #include "llvm-c/Transforms/Scalar.h"
 #include "llvm-c/Transforms/Vectorize.h"
@@ -98,8 +99,10 @@ typedef struct AOTBlockStack {
 typedef struct AOTCheckedAddr {
   struct AOTCheckedAddr *next;
   uint32 local_idx;
-  uint32 offset;
+  uint64 offset;
   uint32 bytes;
+  /* Depth of the block stack when the address was checked */
+  uint32 block_depth;
 } AOTCheckedAddr, *AOTCheckedAddrList;
 
 typedef struct AOTMemInfo {
@@ -111,6 +114,10 @@ typedef struct AOTMemInfo {
   LLVMValueRef mem_bound_check_4bytes;
   LLVMValueRef mem_bound_check_8bytes;
   LLVMValueRef mem_bound_check_16bytes;
+  /* Max size of memory64 when the bound check is done by hardware,
+     the addresses not larger than it are covered by the reserved
+     space and the guard region */
+  LLVMValueRef mem_max_size;
 } AOTMemInfo;
 
 typedef struct AOTFuncContext {
@@ -133,6 +140,8 @@ typedef struct AOTFuncContext {
 
   bool mem_space_unchanged;
   AOTCheckedAddrList checked_addr_list;
+  /* Wasm opcode being translated */
+  uint8 *frame_ip;
 
   LLVMBasicBlockRef got_exception_block;
   LLVMBasicBlockRef func_return_block;
@@ -206,6 +215,25 @@ typedef struct AOTLLVMConsts {
     LLVMValueRef ref_null;
 } AOTLLVMConsts;
 
+/**
+ * The memory regions accessed by the AOT code, each region is given
+ * a distinct TBAA type, so that LLVM knows the accesses to different
+ * regions never alias, e.g. a store to the linear memory doesn't
+ * change the memory base address or the value of a global.
+ */
+typedef enum AOTTBAARegion {
+    /* The linear memory data */
+    AOT_TBAA_LINEAR_MEMORY = 0,
+    /* The memory base address, page count, data size and bound check
+       fields of the memory instance */
+    AOT_TBAA_MEMORY_INFO,
+    /* The global data of the module instance */
+    AOT_TBAA_GLOBAL,
+    /* The fields of the exec env */
+    AOT_TBAA_EXEC_ENV,
+    AOT_TBAA_REGION_COUNT
+} AOTTBAARegion;
+
 /**
  * Compiler context
  */
@@ -223,7 +251,16 @@ typedef struct AOTCompContext {
 
   /* LLVM execution engine required by JIT */
   LLVMExecutionEngineRef exec_engine;
+  /* ORC lazy JIT used instead of the execution engine when lazy JIT
+     is enabled, it owns the LLVM module and context after the module
+     is added */
+  void *lazy_jit;
   bool is_jit_mode;
+#if WASM_ENABLE_LINUX_PERF != 0
+  /* JIT event listener emitting the functions compiled for the
+     Linux perf tool */
+  void *linux_perf_listener;
+#endif
 
   /* Bulk memory feature */
   bool enable_bulk_memory;
@@ -240,6 +277,9 @@ typedef struct AOTCompContext {
   /* Generate auxiliary stack frame */
   bool enable_aux_stack_frame;
 
+  /* Keep the frame pointer in the functions */
+  bool enable_frame_pointer;
+
   /* Thread Manager */
   bool enable_thread_mgr;
 
@@ -255,12 +295,20 @@ typedef struct AOTCompContext {
   /* LLVM pass manager to optimize the JITed code */
   LLVMPassManagerRef pass_mgr;
 
+  /* LLVM module pass manager to run the inter-procedural
+     optimizations, e.g. inlining, across the wasm functions */
+  LLVMPassManagerRef module_pass_mgr;
+
   /* LLVM floating-point rounding mode metadata */
   LLVMValueRef fp_rounding_mode;
 
   /* LLVM floating-point exception behavior metadata */
   LLVMValueRef fp_exception_behavior;
 
+  /* LLVM TBAA metadata kind and the access tag of each region */
+  unsigned tbaa_kind_id;
+  LLVMValueRef tbaa_tags[AOT_TBAA_REGION_COUNT];
+
   /* LLVM data types */
   AOTLLVMTypes basic_types;
   LLVMTypeRef exec_env_type;
@@ -272,6 +320,34 @@ typedef struct AOTCompContext {
   /* Function contexts */
   AOTFuncContext **func_ctxes;
   uint32 func_ctx_count;
+
+  /* Static PGO: instrument the code to collect the profile data */
+  bool enable_pgo_instrument;
+  /* Static PGO: the counters global, a placeholder before all the
+     functions are compiled */
+  LLVMValueRef pgo_counters;
+  /* Static PGO: the counters of the profile data to optimize with */
+  uint64 *pgo_prof_counters;
+  uint32 pgo_prof_counter_count;
+  /* Static PGO: whether each counter counts the executions of a function
+     or a branch, the others record the call_indirect targets */
+  bool *pgo_prof_exec_counters;
+  /* Static PGO: count of the counters allocated by the sites so far */
+  uint32 pgo_counter_count;
+  uint64 pgo_module_hash;
+
+  /* Compile call_indirect on the immutable tables as direct calls */
+  bool enable_call_indirect_devirt;
+  /* The function indexes of each immutable table after instantiation,
+     NULL if the table may be changed at runtime */
+  uint32 **devirt_tbl_func_indexes;
+
+  uint32 opt_level;
+  uint32 size_level;
+
+  /* Directory caching the object file of each function, the functions
+     are optimized and compiled separately, NULL if disabled */
+  char *incremental_cache_dir;
 } AOTCompContext;
 
 enum {
@@ -294,11 +370,17 @@ typedef struct AOTCompOption{
     bool enable_ref_types;
     bool enable_aux_stack_check;
     bool enable_aux_stack_frame;
+    bool enable_frame_pointer;
     bool is_sgx_platform;
     uint32 opt_level;
     uint32 size_level;
     uint32 output_format;
     uint32 bounds_checks;
+    bool enable_pgo_instrument;
+    uint8 *pgo_prof_data;
+    uint32 pgo_prof_data_size;
+    bool enable_call_indirect_devirt;
+    char *incremental_cache_dir;
 } AOTCompOption, *aot_comp_option_t;
 
 AOTCompContext *
@@ -308,6 +390,54 @@ aot_create_comp_context(AOTCompData *comp_data,
 void
 aot_destroy_comp_context(AOTCompContext *comp_ctx);
 
+/* Create the function pass manager of the module to optimize
+   the functions */
+LLVMPassManagerRef
+aot_create_func_pass_mgr(AOTCompContext *comp_ctx, LLVMModuleRef module);
+
+#if WASM_ENABLE_LAZY_JIT != 0
+/* Create the lazy JIT, event_listener is the JIT event listener
+   notified of the objects compiled, or NULL */
+LLVMBool
+aot_create_lazy_jit(void **p_lazy_jit, LLVMTargetMachineRef *p_target_machine,
+                    AOTCompContext *comp_ctx,
+                    unsigned compile_thread_num, void *event_listener,
+                    char **p_err);
+
+/* Add the module to the lazy JIT, which takes the ownership of
+   the module and the context */
+LLVMBool
+aot_lazy_jit_add_module(void *lazy_jit, LLVMModuleRef module,
+                        LLVMContextRef context, char **p_err);
+
+/* Get the addresses of the lazy compilation stubs of the functions
+   named prefix + index, index from 0 to func_count - 1 */
+LLVMBool
+aot_lazy_jit_lookup_funcs(void *lazy_jit, const char *prefix,
+                          uint32 func_count, void **func_ptrs);
+
+void
+aot_destroy_lazy_jit(void *lazy_jit);
+#endif
+
+#if WASM_ENABLE_LINUX_PERF != 0
+/* Emit the function compiled by the JIT for the Linux perf tool,
+   named after the wasm function of the LLVM symbol */
+void
+aot_emit_linux_perf_func(AOTCompContext *comp_ctx, const char *symbol,
+                         const void *code, uint64 code_size);
+
+void *
+aot_create_linux_perf_listener(AOTCompContext *comp_ctx);
+
+void
+aot_destroy_linux_perf_listener(void *listener);
+
+void
+aot_register_jit_event_listener(LLVMExecutionEngineRef exec_engine,
+                                void *listener);
+#endif
+
 bool
 aot_compile_wasm(AOTCompContext *comp_ctx);
 
@@ -343,18 +473,37 @@ wasm_type_to_llvm_type(AOTLLVMTypes *llvm_types, uint8 wasm_type);
 
 bool
 aot_checked_addr_list_add(AOTFuncContext *func_ctx,
-                          uint32 local_idx, uint32 offset, uint32 bytes);
+                          uint32 local_idx, uint64 offset, uint32 bytes);
 
 void
 aot_checked_addr_list_del(AOTFuncContext *func_ctx, uint32 local_idx);
 
+void
+aot_checked_addr_list_del_in_block(AOTFuncContext *func_ctx);
+
+void
+aot_checked_addr_list_enter_loop(AOTFuncContext *func_ctx,
+                                 uint8 *frame_ip, uint8 *frame_ip_end);
+
 bool
 aot_checked_addr_list_find(AOTFuncContext *func_ctx,
-                           uint32 local_idx, uint32 offset, uint32 bytes);
+                           uint32 local_idx, uint64 offset, uint32 bytes);
 
 void
 aot_checked_addr_list_destroy(AOTFuncContext *func_ctx);
 
+bool
+aot_set_cond_br_weights(AOTCompContext *comp_ctx, LLVMValueRef cond_br,
+                        uint32 weight_if, uint32 weight_else);
+
+bool
+aot_set_switch_weights(AOTCompContext *comp_ctx, LLVMValueRef switch_inst,
+                       const uint32 *weights, uint32 weight_count);
+
+void
+aot_set_tbaa(AOTCompContext *comp_ctx, LLVMValueRef inst,
+             AOTTBAARegion region);
+
 bool
 aot_build_zero_function_ret(AOTCompContext *comp_ctx,
                             AOTFuncType *func_type);
@@ -14,13 +14,35 @@
 #include <llvm-c/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/GenericValue.h>
 #include <llvm/ExecutionEngine/JITEventListener.h>
+#if WASM_ENABLE_LAZY_JIT != 0
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#endif
 #include <llvm/ExecutionEngine/RTDyldMemoryManager.h>
+#if WASM_ENABLE_LAZY_JIT != 0 || WASM_ENABLE_LINUX_PERF != 0
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#endif
+#if WASM_ENABLE_LINUX_PERF != 0
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Object/SymbolSize.h>
+#endif
 #include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/ProfileSummary.h>
 #include <llvm/Support/ErrorHandling.h>
 #include <llvm/Target/CodeGenCWrappers.h>
 #include <llvm/Target/TargetOptions.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 using namespace llvm;
 
@@ -34,6 +56,73 @@ WAMRCreateMCJITCompilerForModule(LLVMExecutionEngineRef *OutJIT,
 extern "C" bool
 aot_check_simd_compatibility(const char *arch_c_str, const char *cpu_c_str);
 
+extern "C" bool
+aot_check_target_feature(LLVMTargetMachineRef target_machine,
+                         const char *feature);
+
+extern "C" void
+aot_add_function_inlining_pass(LLVMPassManagerRef pass_mgr,
+                               unsigned threshold);
+
+extern "C" void
+aot_add_irce_pass(LLVMPassManagerRef pass_mgr);
+
+extern "C" void
+aot_add_hot_cold_splitting_pass(LLVMPassManagerRef pass_mgr);
+
+extern "C" void
+aot_set_func_entry_count(LLVMValueRef func, uint64_t count);
+
+extern "C" void
+aot_set_profile_summary(LLVMModuleRef module,
+                        const uint64_t *counts, uint32_t count_num);
+
+extern "C" LLVMModuleRef
+aot_clone_func_module(LLVMModuleRef module, LLVMValueRef func);
+
+#if WASM_ENABLE_LAZY_JIT != 0
+struct AOTCompContext;
+
+extern "C" LLVMPassManagerRef
+aot_create_func_pass_mgr(struct AOTCompContext *comp_ctx,
+                         LLVMModuleRef module);
+
+extern "C" LLVMBool
+aot_create_lazy_jit(void **p_lazy_jit, LLVMTargetMachineRef *p_target_machine,
+                    struct AOTCompContext *comp_ctx,
+                    unsigned compile_thread_num, void *event_listener,
+                    char **p_err);
+
+extern "C" LLVMBool
+aot_lazy_jit_add_module(void *lazy_jit, LLVMModuleRef module,
+                        LLVMContextRef context, char **p_err);
+
+extern "C" LLVMBool
+aot_lazy_jit_lookup_funcs(void *lazy_jit, const char *prefix,
+                          uint32_t func_count, void **func_ptrs);
+
+extern "C" void
+aot_destroy_lazy_jit(void *lazy_jit);
+#endif
+
+#if WASM_ENABLE_LINUX_PERF != 0
+struct AOTCompContext;
+
+extern "C" void
+aot_emit_linux_perf_func(struct AOTCompContext *comp_ctx, const char *symbol,
+                         const void *code, uint64_t code_size);
+
+extern "C" void *
+aot_create_linux_perf_listener(struct AOTCompContext *comp_ctx);
+
+extern "C" void
+aot_destroy_linux_perf_listener(void *listener);
+
+extern "C" void
+aot_register_jit_event_listener(LLVMExecutionEngineRef exec_engine,
+                                void *listener);
+#endif
+
 LLVMBool
 WAMRCreateMCJITCompilerForModule(LLVMExecutionEngineRef *OutJIT,
                                  LLVMModuleRef M,
@@ -146,3 +235,498 @@ aot_check_simd_compatibility(const char *arch_c_str, const char *cpu_c_str)
 #endif /* WASM_ENABLE_SIMD */
 }
 
+void
+aot_add_function_inlining_pass(LLVMPassManagerRef pass_mgr,
+                               unsigned threshold)
+{
+    /* The C API of LLVMAddFunctionInliningPass doesn't allow to
+       set the inline threshold */
+    unwrap(pass_mgr)->add(createFunctionInliningPass(threshold));
+}
+
+void
+aot_add_irce_pass(LLVMPassManagerRef pass_mgr)
+{
+    /* Inductive range check elimination, which splits the iteration
+       space of a loop to remove the bound checks of the induction
+       variable based accesses from the main loop */
+    unwrap(pass_mgr)->add(createInductiveRangeCheckEliminationPass());
+}
+
+bool
+aot_check_target_feature(LLVMTargetMachineRef target_machine,
+                         const char *feature)
+{
+    const MCSubtargetInfo *subTargetInfo =
+      reinterpret_cast<TargetMachine *>(target_machine)->getMCSubtargetInfo();
+
+    if (subTargetInfo == nullptr) {
+        return false;
+    }
+    return subTargetInfo->checkFeatures(std::string("+") + feature);
+}
+
+void
+aot_add_hot_cold_splitting_pass(LLVMPassManagerRef pass_mgr)
+{
+    unwrap(pass_mgr)->add(createHotColdSplittingPass());
+}
+
+void
+aot_set_func_entry_count(LLVMValueRef func, uint64_t count)
+{
+    unwrap<Function>(func)->setEntryCount(count);
+}
+
+void
+aot_set_profile_summary(LLVMModuleRef module,
+                        const uint64_t *counts, uint32_t count_num)
+{
+    /* Cutoffs of the detailed summary, the same as ProfileSummaryBuilder
+       uses, in parts per million of the total count, except the last one
+       which is used to find the cold counts */
+    static const uint32_t cutoffs[] = {
+        10000,  100000, 200000, 300000, 400000, 500000, 600000, 700000,
+        800000, 900000, 950000, 990000, 999000, 999900, 999990
+    };
+    Module *M = unwrap(module);
+    std::vector<uint64_t> sorted_counts(counts, counts + count_num);
+    SummaryEntryVector detailed_summary;
+    uint64_t total_count = 0, max_count = 0, max_func_count = 0, sum = 0;
+    uint32_t num_funcs = 0;
+    size_t i = 0;
+
+    for (Function &F : *M) {
+        if (F.isDeclaration() || !F.getEntryCount())
+            continue;
+        max_func_count =
+            std::max(max_func_count, F.getEntryCount()->getCount());
+        num_funcs++;
+    }
+
+    std::sort(sorted_counts.begin(), sorted_counts.end(),
+              std::greater<uint64_t>());
+    for (uint64_t count : sorted_counts)
+        total_count += count;
+    if (!sorted_counts.empty())
+        max_count = sorted_counts[0];
+
+    for (uint32_t cutoff : cutoffs) {
+        double desired = (double)total_count * cutoff / 1000000;
+        while (i < sorted_counts.size() && (double)sum < desired)
+            sum += sorted_counts[i++];
+        detailed_summary.push_back(
+            { cutoff, i > 0 ? sorted_counts[i - 1] : max_count, (uint64_t)i });
+    }
+
+    /* Only regard the code never run as cold: a wasm function called
+       only a few times may still run a hot loop, which shouldn't be
+       marked cold and optimized for size by its entry count */
+    detailed_summary.push_back({ 999999, 0, (uint64_t)sorted_counts.size() });
+
+    ProfileSummary summary(ProfileSummary::PSK_Instr, detailed_summary,
+                           total_count, max_count, max_count, max_func_count,
+                           count_num, num_funcs);
+    M->setProfileSummary(summary.getMD(M->getContext()),
+                         ProfileSummary::PSK_Instr);
+}
+
+LLVMModuleRef
+aot_clone_func_module(LLVMModuleRef module, LLVMValueRef func)
+{
+    Function *F = unwrap<Function>(func);
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> M =
+        CloneModule(*unwrap(module), VMap,
+                    [F](const GlobalValue *GV) { return GV == F; });
+
+    /* Only keep the declarations used by the function, so that the
+       module is the same as long as the function and its callees'
+       types are unchanged */
+    for (auto it = M->begin(); it != M->end();) {
+        Function &G = *it++;
+        if (G.isDeclaration() && G.use_empty())
+            G.eraseFromParent();
+    }
+    for (auto it = M->global_begin(); it != M->global_end();) {
+        GlobalVariable &GV = *it++;
+        if (GV.isDeclaration() && GV.use_empty())
+            GV.eraseFromParent();
+    }
+    return wrap(M.release());
+}
+
+#if WASM_ENABLE_LAZY_JIT != 0
+static char *
+lazy_jit_error_message(Error err)
+{
+    return strdup(toString(std::move(err)).c_str());
+}
+
+LLVMBool
+aot_create_lazy_jit(void **p_lazy_jit, LLVMTargetMachineRef *p_target_machine,
+                    struct AOTCompContext *comp_ctx,
+                    unsigned compile_thread_num, void *event_listener,
+                    char **p_err)
+{
+    auto JTMB = orc::JITTargetMachineBuilder::detectHost();
+    if (!JTMB) {
+        *p_err = lazy_jit_error_message(JTMB.takeError());
+        return 1;
+    }
+    /* Same as the options of MCJIT */
+    JTMB->setCodeGenOptLevel(CodeGenOpt::Aggressive);
+    JTMB->getOptions().EnableFastISel = true;
+
+    /* The target machine used by the IR generation, the JIT creates
+       its own ones from the builder to compile the functions */
+    auto TM = JTMB->createTargetMachine();
+    if (!TM) {
+        *p_err = lazy_jit_error_message(TM.takeError());
+        return 1;
+    }
+
+    orc::LLLazyJITBuilder Builder;
+    Builder.setJITTargetMachineBuilder(std::move(*JTMB))
+      .setNumCompileThreads(compile_thread_num);
+    if (event_listener) {
+        /* Same as the default object linking layer, plus the listener
+           notified of the objects compiled */
+        Builder.setObjectLinkingLayerCreator(
+          [event_listener](orc::ExecutionSession &ES, const Triple &TT)
+            -> Expected<std::unique_ptr<orc::ObjectLayer>> {
+              (void)TT;
+              auto Layer = std::make_unique<orc::RTDyldObjectLinkingLayer>(
+                ES, []() { return std::make_unique<SectionMemoryManager>(); });
+              Layer->registerJITEventListener(
+                *(JITEventListener *)event_listener);
+              return std::move(Layer);
+          });
+    }
+    auto LazyJIT = Builder.create();
+    if (!LazyJIT) {
+        *p_err = lazy_jit_error_message(LazyJIT.takeError());
+        return 1;
+    }
+
+    /* Resolve the runtime and libc functions called by the code,
+       e.g. memcpy and fmod, from the current process */
+    auto Generator = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      (*LazyJIT)->getDataLayout().getGlobalPrefix());
+    if (!Generator) {
+        *p_err = lazy_jit_error_message(Generator.takeError());
+        return 1;
+    }
+    (*LazyJIT)->getMainJITDylib().addGenerator(std::move(*Generator));
+
+    /* The module is split into one module per function when it is
+       added, see aot_lazy_jit_add_module, so compile the whole module
+       of a function when it is called, instead of extracting the
+       function into another module, which costs time proportional to
+       the number of the functions at each first call */
+    (*LazyJIT)->getCompileOnDemandLayer().setPartitionFunction(
+      orc::CompileOnDemandLayer::compileWholeModule);
+
+    /* With compile threads, the JIT clones each module added into a new
+       context when looking up its functions so that the functions can
+       be compiled concurrently, which costs time proportional to the
+       size of all the modules before the first call. Instead clone the
+       module of a function into a new context when it is compiled, see
+       below */
+    bool CloneToNewContext = compile_thread_num > 0;
+    (*LazyJIT)->getCompileOnDemandLayer().setCloneToNewContextOnEmit(false);
+
+    /* Optimize each function when it is compiled on its first call,
+       the type of the responsibility argument differs between LLVM
+       versions, so take it with auto */
+    (*LazyJIT)->getIRTransformLayer().setTransform(
+      [comp_ctx, CloneToNewContext](
+        orc::ThreadSafeModule TSM,
+        const auto &R) -> Expected<orc::ThreadSafeModule> {
+          (void)R;
+          bool Ret = true;
+          if (CloneToNewContext)
+              TSM = orc::cloneToNewContext(TSM);
+          TSM.withModuleDo([&](Module &M) {
+              LLVMPassManagerRef PassMgr;
+
+              if (!(PassMgr = aot_create_func_pass_mgr(comp_ctx, wrap(&M)))) {
+                  Ret = false;
+                  return;
+              }
+              LLVMInitializeFunctionPassManager(PassMgr);
+              for (auto &F : M) {
+                  if (!F.isDeclaration())
+                      LLVMRunFunctionPassManager(PassMgr, wrap(&F));
+              }
+              LLVMFinalizeFunctionPassManager(PassMgr);
+              LLVMDisposePassManager(PassMgr);
+          });
+          if (!Ret)
+              return make_error<StringError>("create LLVM pass manager failed",
+                                             inconvertibleErrorCode());
+          return std::move(TSM);
+      });
+
+    *p_target_machine =
+      reinterpret_cast<LLVMTargetMachineRef>(TM->release());
+    *p_lazy_jit = LazyJIT->release();
+    return 0;
+}
+
+/* Collect the functions and global variables referred to by the
+   function */
+static void
+collect_func_refs(Function &F, SmallPtrSetImpl<GlobalValue *> &Refs)
+{
+    SmallPtrSet<Constant *, 16> Visited;
+    SmallVector<Constant *, 16> Worklist;
+
+    for (auto &BB : F) {
+        for (auto &I : BB) {
+            for (auto &Op : I.operands()) {
+                if (auto *C = dyn_cast<Constant>(Op))
+                    if (Visited.insert(C).second)
+                        Worklist.push_back(C);
+            }
+        }
+    }
+
+    while (!Worklist.empty()) {
+        Constant *C = Worklist.pop_back_val();
+        if (auto *GV = dyn_cast<GlobalValue>(C)) {
+            Refs.insert(GV);
+            continue;
+        }
+        for (auto &Op : C->operands()) {
+            if (auto *COp = dyn_cast<Constant>(Op))
+                if (Visited.insert(COp).second)
+                    Worklist.push_back(COp);
+        }
+    }
+}
+
+/* Move the function into a new module of the same context, in which
+   the functions and global variables referred to are declared */
+static std::unique_ptr<Module>
+move_func_to_module(Function &F)
+{
+    Module &M = *F.getParent();
+    auto NewM = std::make_unique<Module>(F.getName(), M.getContext());
+    SmallPtrSet<GlobalValue *, 16> Refs;
+    ValueToValueMapTy VMap;
+
+    NewM->setDataLayout(M.getDataLayout());
+    NewM->setTargetTriple(M.getTargetTriple());
+
+    Function *NewF = Function::Create(F.getFunctionType(), F.getLinkage(),
+                                      F.getAddressSpace(), F.getName(),
+                                      NewM.get());
+    NewF->copyAttributesFrom(&F);
+    VMap[&F] = NewF;
+
+    collect_func_refs(F, Refs);
+    for (auto *GV : Refs) {
+        if (GV == &F)
+            continue;
+        if (auto *Callee = dyn_cast<Function>(GV)) {
+            Function *Decl = Function::Create(
+              Callee->getFunctionType(), GlobalValue::ExternalLinkage,
+              Callee->getAddressSpace(), Callee->getName(), NewM.get());
+            Decl->copyAttributesFrom(Callee);
+            VMap[Callee] = Decl;
+        }
+        else if (auto *GVar = dyn_cast<GlobalVariable>(GV)) {
+            auto *Decl = new GlobalVariable(
+              *NewM, GVar->getValueType(), GVar->isConstant(),
+              GlobalValue::ExternalLinkage, nullptr, GVar->getName(), nullptr,
+              GVar->getThreadLocalMode(), GVar->getAddressSpace());
+            Decl->copyAttributesFrom(GVar);
+            VMap[GVar] = Decl;
+        }
+        else
+            return nullptr;
+    }
+
+    /* Move the arguments and the body instead of cloning them, which
+       is much faster, and then make the instructions refer to the
+       declarations in the new module */
+    NewF->stealArgumentListFrom(F);
+    NewF->getBasicBlockList().splice(NewF->end(), F.getBasicBlockList());
+    for (auto &BB : *NewF) {
+        for (auto &I : BB)
+            RemapInstruction(&I, VMap, RF_IgnoreMissingLocals);
+    }
+    return NewM;
+}
+
+LLVMBool
+aot_lazy_jit_add_module(void *lazy_jit, LLVMModuleRef module,
+                        LLVMContextRef context, char **p_err)
+{
+    orc::LLLazyJIT *LazyJIT = (orc::LLLazyJIT *)lazy_jit;
+    /* The JIT takes the ownership of both the module and the context,
+       the context must be destroyed after the modules */
+    orc::ThreadSafeContext TSCtx(std::unique_ptr<LLVMContext>(unwrap(context)));
+    std::unique_ptr<Module> M(unwrap(module));
+    std::vector<std::unique_ptr<Module>> FuncModules;
+
+    /* The functions and global variables defined are referred to by
+       name from the other modules */
+    for (auto &GV : M->global_values()) {
+        if (GV.isDeclaration())
+            continue;
+        if (!GV.hasName())
+            GV.setName("aot_jit_global");
+        if (GV.hasLocalLinkage()) {
+            GV.setLinkage(GlobalValue::ExternalLinkage);
+            GV.setVisibility(GlobalValue::HiddenVisibility);
+        }
+    }
+
+    /* Split the module into one module per function, so that the time
+       to compile a function on its first call doesn't depend on the
+       number of the functions */
+    for (auto &F : *M) {
+        if (F.isDeclaration())
+            continue;
+        auto FuncModule = move_func_to_module(F);
+        if (!FuncModule) {
+            *p_err = strdup("unsupported global value referred to");
+            return 1;
+        }
+        FuncModules.push_back(std::move(FuncModule));
+    }
+
+    for (auto &FuncModule : FuncModules) {
+        if (Error Err = LazyJIT->addLazyIRModule(
+              orc::ThreadSafeModule(std::move(FuncModule), TSCtx))) {
+            *p_err = lazy_jit_error_message(std::move(Err));
+            return 1;
+        }
+    }
+
+    /* The global variables left in the original module are emitted
+       when they are looked up */
+    for (auto &F : make_early_inc_range(*M))
+        F.eraseFromParent();
+    if (!M->global_empty()) {
+        if (Error Err = LazyJIT->addIRModule(
+              orc::ThreadSafeModule(std::move(M), TSCtx))) {
+            *p_err = lazy_jit_error_message(std::move(Err));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+LLVMBool
+aot_lazy_jit_lookup_funcs(void *lazy_jit, const char *prefix,
+                          uint32_t func_count, void **func_ptrs)
+{
+    orc::LLLazyJIT *LazyJIT = (orc::LLLazyJIT *)lazy_jit;
+    std::vector<orc::SymbolStringPtr> Names;
+    orc::SymbolLookupSet LookupSet;
+
+    /* Look up all the functions at once, looking up them one by one
+       costs much more time for a large module. The addresses got are
+       the lazy compilation stubs, a function is compiled when it is
+       called at the first time */
+    Names.reserve(func_count);
+    for (uint32_t i = 0; i < func_count; i++) {
+        Names.push_back(
+          LazyJIT->mangleAndIntern(std::string(prefix) + std::to_string(i)));
+        LookupSet.add(Names.back());
+    }
+
+    auto Syms = LazyJIT->getExecutionSession().lookup(
+      orc::makeJITDylibSearchOrder(&LazyJIT->getMainJITDylib()),
+      std::move(LookupSet));
+    if (!Syms) {
+        consumeError(Syms.takeError());
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < func_count; i++)
+        func_ptrs[i] = (void *)(uintptr_t)(*Syms)[Names[i]].getAddress();
+    return 0;
+}
+
+void
+aot_destroy_lazy_jit(void *lazy_jit)
+{
+    delete (orc::LLLazyJIT *)lazy_jit;
+}
+#endif /* end of WASM_ENABLE_LAZY_JIT != 0 */
+
+#if WASM_ENABLE_LINUX_PERF != 0
+/* Emit the functions of the objects compiled by the JIT for the Linux
+   perf tool, in the same way as the PerfJITEventListener of LLVM, which
+   isn't built unless LLVM is configured with LLVM_USE_PERF */
+class LinuxPerfJITEventListener : public JITEventListener
+{
+  public:
+    LinuxPerfJITEventListener(struct AOTCompContext *comp_ctx)
+      : CompCtx(comp_ctx)
+    {}
+
+    void notifyObjectLoaded(ObjectKey K, const object::ObjectFile &Obj,
+                            const RuntimeDyld::LoadedObjectInfo &L) override
+    {
+        (void)K;
+        /* The symbol addresses of the object for debug are the
+           addresses of the loaded code */
+        object::OwningBinary<object::ObjectFile> DebugObjOwner =
+          L.getObjectForDebug(Obj);
+        const object::ObjectFile &DebugObj =
+          DebugObjOwner.getBinary() ? *DebugObjOwner.getBinary() : Obj;
+
+        for (const auto &P : object::computeSymbolSizes(DebugObj)) {
+            object::SymbolRef Sym = P.first;
+            Expected<object::SymbolRef::Type> Type = Sym.getType();
+            if (!Type) {
+                consumeError(Type.takeError());
+                continue;
+            }
+            if (*Type != object::SymbolRef::ST_Function || P.second == 0)
+                continue;
+
+            Expected<StringRef> Name = Sym.getName();
+            Expected<uint64_t> Addr = Sym.getAddress();
+            if (!Name || !Addr) {
+                if (!Name)
+                    consumeError(Name.takeError());
+                if (!Addr)
+                    consumeError(Addr.takeError());
+                continue;
+            }
+            aot_emit_linux_perf_func(CompCtx, Name->str().c_str(),
+                                     (const void *)(uintptr_t)*Addr,
+                                     P.second);
+        }
+    }
+
+  private:
+    struct AOTCompContext *CompCtx;
+};
+
+void *
+aot_create_linux_perf_listener(struct AOTCompContext *comp_ctx)
+{
+    return new LinuxPerfJITEventListener(comp_ctx);
+}
+
+void
+aot_destroy_linux_perf_listener(void *listener)
+{
+    delete (LinuxPerfJITEventListener *)listener;
+}
+
+void
+aot_register_jit_event_listener(LLVMExecutionEngineRef exec_engine,
+                                void *listener)
+{
+    unwrap(exec_engine)->RegisterJITEventListener(
+      (JITEventListener *)listener);
+}
+#endif /* end of WASM_ENABLE_LINUX_PERF != 0 */
@@ -14,7 +14,7 @@ static LLVMValueRef
 simd_load(AOTCompContext *comp_ctx,
           AOTFuncContext *func_ctx,
           uint32 align,
-          uint32 offset,
+          uint64 offset,
           uint32 data_length,
           LLVMTypeRef ptr_type)
 {
@@ -38,6 +38,7 @@ simd_load(AOTCompContext *comp_ctx,
     }
 
     LLVMSetAlignment(data, 1);
+    aot_set_tbaa(comp_ctx, data, AOT_TBAA_LINEAR_MEMORY);
 
     return data;
 fail:
@@ -91,7 +92,7 @@ bool
 aot_compile_simd_v128_load(AOTCompContext *comp_ctx,
                            AOTFuncContext *func_ctx,
                            uint32 align,
-                           uint32 offset)
+                           uint64 offset)
 {
     LLVMValueRef result;
 
@@ -110,7 +111,7 @@ bool
 aot_compile_simd_v128_store(AOTCompContext *comp_ctx,
                             AOTFuncContext *func_ctx,
                             uint32 align,
-                            uint32 offset)
+                            uint64 offset)
 {
     LLVMValueRef maddr, value, result;
 
@@ -131,6 +132,7 @@ aot_compile_simd_v128_store(AOTCompContext *comp_ctx,
     }
 
     LLVMSetAlignment(result, 1);
+    aot_set_tbaa(comp_ctx, result, AOT_TBAA_LINEAR_MEMORY);
 
     return true;
 fail:
@@ -142,7 +144,7 @@ aot_compile_simd_load_extend(AOTCompContext *comp_ctx,
                              AOTFuncContext *func_ctx,
                              uint8 load_opcode,
                              uint32 align,
-                             uint32 offset)
+                             uint64 offset)
 {
     LLVMValueRef sub_vector, result;
     LLVMTypeRef sub_vector_type, vector_type;
@@ -242,7 +244,7 @@ aot_compile_simd_load_splat(AOTCompContext *comp_ctx,
                             AOTFuncContext *func_ctx,
                             uint8 load_opcode,
                             uint32 align,
-                            uint32 offset)
+                            uint64 offset)
 {
     LLVMValueRef element, result;
     LLVMTypeRef element_ptr_type, vector_type;
@@ -16,27 +16,27 @@ bool
 aot_compile_simd_v128_load(AOTCompContext *comp_ctx,
                            AOTFuncContext *func_ctx,
                            uint32 align,
-                           uint32 offset);
+                           uint64 offset);
 
 bool
 aot_compile_simd_v128_store(AOTCompContext *comp_ctx,
                             AOTFuncContext *func_ctx,
                             uint32 align,
-                            uint32 offset);
+                            uint64 offset);
 
 bool
 aot_compile_simd_load_extend(AOTCompContext *comp_ctx,
                              AOTFuncContext *func_ctx,
                              uint8 load_opcode,
                              uint32 align,
-                             uint32 offset);
+                             uint64 offset);
 
 bool
 aot_compile_simd_load_splat(AOTCompContext *comp_ctx,
                             AOTFuncContext *func_ctx,
                             uint8 load_opcode,
                             uint32 align,
-                            uint32 offset);
+                            uint64 offset);
 
 #ifdef __cplusplus
 } /* end of extern "C" */
@@ -46,11 +46,17 @@ typedef struct AOTCompOption{
     bool enable_ref_types;
     bool enable_aux_stack_check;
     bool enable_aux_stack_frame;
+    bool enable_frame_pointer;
     bool is_sgx_platform;
     uint32_t opt_level;
     uint32_t size_level;
     uint32_t output_format;
     uint32_t bounds_checks;
+    bool enable_pgo_instrument;
+    uint8_t *pgo_prof_data;
+    uint32_t pgo_prof_data_size;
+    bool enable_call_indirect_devirt;
+    char *incremental_cache_dir;
 } AOTCompOption, *aot_comp_option_t;
 
 aot_comp_context_t
@@ -74,6 +80,11 @@ aot_emit_aot_file(aot_comp_context_t comp_ctx,
                   aot_comp_data_t comp_data,
                   const char *file_name);
 
+bool
+aot_emit_fat_aot_file(aot_comp_data_t comp_data, aot_comp_option_t option,
+                      char **target_cpus, uint32_t target_cpu_count,
+                      const char *file_name);
+
 void
 aot_destroy_aot_file(uint8_t *aot_file);
 
@@ -86,6 +86,98 @@ typedef struct wasm_section_t {
 struct WASMExecEnv;
 typedef struct WASMExecEnv *wasm_exec_env_t;
 
+/* Pool of pre-instantiated module instances */
+struct WASMInstancePool;
+typedef struct WASMInstancePool *wasm_instance_pool_t;
+
+/* Phases of loading and instantiating a module */
+typedef enum {
+    /* wasm_runtime_load, including the load phases below */
+    WASM_STARTUP_LOAD = 0,
+    /* the load time not spent in the phases below, mainly parsing
+       the sections */
+    WASM_STARTUP_PARSE,
+    /* validating the function bodies, which also pre-compiles them
+       for the fast interpreter */
+    WASM_STARTUP_VALIDATE,
+    /* compiling the functions with the baseline JIT or LLVM JIT */
+    WASM_STARTUP_COMPILE,
+    /* applying the relocations of the AOT code */
+    WASM_STARTUP_RELOCATE,
+    /* wasm_runtime_instantiate, including the instantiation
+       phases below */
+    WASM_STARTUP_INSTANTIATE,
+    /* the instantiation time not spent in the phases below, mainly
+       creating and initializing the memories, tables and globals */
+    WASM_STARTUP_INIT,
+    /* initializing the WASI context */
+    WASM_STARTUP_WASI_INIT,
+    /* executing __post_instantiate, the start function and the
+       memory init function */
+    WASM_STARTUP_START_FUNC,
+    WASM_STARTUP_PHASE_NUM
+} wasm_startup_phase_t;
+
+/* Time spent in each startup phase */
+typedef struct wasm_startup_timing_t {
+    /* total time of the phase, in microseconds */
+    uint64_t time_us[WASM_STARTUP_PHASE_NUM];
+    /* times that the phase is run */
+    uint32_t count[WASM_STARTUP_PHASE_NUM];
+} wasm_startup_timing_t;
+
+/* Kinds of the traps counted by the runtime metrics */
+typedef enum {
+    WASM_TRAP_UNREACHABLE = 0,
+    WASM_TRAP_OUT_OF_BOUNDS_MEMORY,
+    /* out of bounds table access, undefined or uninitialized element */
+    WASM_TRAP_OUT_OF_BOUNDS_TABLE,
+    WASM_TRAP_INDIRECT_CALL_TYPE_MISMATCH,
+    WASM_TRAP_INTEGER_OVERFLOW,
+    WASM_TRAP_INTEGER_DIVIDE_BY_ZERO,
+    WASM_TRAP_INVALID_CONVERSION,
+    /* native, operand or auxiliary stack overflow */
+    WASM_TRAP_STACK_OVERFLOW,
+    WASM_TRAP_OUT_OF_MEMORY,
+    WASM_TRAP_UNALIGNED_ATOMIC,
+    /* the other exceptions, e.g. failed to call an unlinked import */
+    WASM_TRAP_OTHER,
+    WASM_TRAP_KIND_NUM
+} wasm_trap_kind_t;
+
+/* Snapshot of the runtime metrics */
+typedef struct wasm_runtime_metrics_t {
+    /* module instances created by wasm_runtime_instantiate and alive */
+    uint32_t instance_count;
+    /* linear memory committed by the instances */
+    uint64_t memory_pages;
+    uint64_t memory_bytes;
+    /* app heaps of the instances, the highmark is the sum of the
+       peak usage of each heap */
+    uint64_t app_heap_size;
+    uint64_t app_heap_used;
+    uint64_t app_heap_highmark;
+    /* runtime memory pool, all zero if the runtime isn't initialized
+       with Alloc_With_Pool */
+    uint32_t pool_size;
+    uint32_t pool_free;
+    uint32_t pool_highmark;
+    /* the largest free chunk, which shows the fragmentation */
+    uint32_t pool_largest_free;
+    /* execution environments alive */
+    uint32_t exec_env_count;
+    /* thread clusters and the threads in them */
+    uint32_t cluster_count;
+    uint32_t thread_count;
+    uint32_t max_cluster_thread_count;
+    /* the counts below are accumulated since the runtime is initialized */
+    uint64_t host_calls;
+    uint64_t traps[WASM_TRAP_KIND_NUM];
+    uint64_t atomic_waits;
+    uint64_t atomic_wait_timeouts;
+    uint64_t atomic_notifies;
+} wasm_runtime_metrics_t;
+
 /* Package Type */
 typedef enum {
     Wasm_Module_Bytecode = 0,
@@ -133,6 +225,31 @@ typedef struct RuntimeInitArgs {
     /* maximum thread number, only used when
         WASM_ENABLE_THREAD_MGR is defined */
     uint32_t max_thread_num;
+
+    /* allocate the linear memory and the AOT code with huge page
+       aligned mappings backed by transparent huge pages, only used
+       on the platforms which support it, e.g. Linux */
+    bool enable_huge_page;
+
+    /* directory of the on-disk AOT code cache, only used when
+       WASM_ENABLE_JIT is defined: the wasm file loaded is looked up
+       in the directory by the hash of its content and the compile
+       options, the cached AOT file is loaded if found, otherwise the
+       wasm file is compiled and the AOT file is stored into it */
+    const char *aot_cache_dir;
+
+    /* when the AOT file isn't cached, load the wasm file with the
+       interpreter and compile the AOT file into the cache directory
+       in a background thread, only used when both WASM_ENABLE_JIT
+       and WASM_ENABLE_INTERP are defined */
+    bool aot_cache_compile_in_background;
+
+    /* emit the native code of the wasm functions loaded or compiled
+       into the perf map /tmp/perf-<pid>.map and/or the jitdump file
+       /tmp/jit-<pid>.dump for the Linux perf tool, only used when
+       WASM_ENABLE_LINUX_PERF is defined */
+    bool enable_perf_map;
+    bool enable_jitdump;
 } RuntimeInitArgs;
 
 #ifndef WASM_VALKIND_T_DEFINED
@@ -363,6 +480,63 @@ wasm_runtime_instantiate(const wasm_module_t module,
 WASM_RUNTIME_API_EXTERN void
 wasm_runtime_deinstantiate(wasm_module_inst_t module_inst);
 
+/**
+ * Create a pool of module instances, all the instances are instantiated
+ * with the same stack size and heap size, and each of them owns an exec
+ * env created with the stack size. An instance acquired from the pool is
+ * reset to its initial state when it is released back, the linear memory,
+ * tables and exec env are recycled instead of being freed.
+ *
+ * @param module the WASM module to instantiate, it must not be unloaded
+ *        before the pool is destroyed
+ * @param pool_size the count of instances to pre-instantiate
+ * @param stack_size the stack size of the instances and exec envs
+ * @param heap_size the heap size of the instances
+ * @param error_buf buffer to output the error info if failed
+ * @param error_buf_size the size of the error buffer
+ *
+ * @return the pool created, NULL if failed
+ */
+WASM_RUNTIME_API_EXTERN wasm_instance_pool_t
+wasm_runtime_instance_pool_create(const wasm_module_t module,
+                                  uint32_t pool_size,
+                                  uint32_t stack_size, uint32_t heap_size,
+                                  char *error_buf, uint32_t error_buf_size);
+
+/**
+ * Destroy the instance pool and all of its instances, the instances
+ * acquired must have been released before.
+ *
+ * @param pool the instance pool to destroy
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_instance_pool_destroy(wasm_instance_pool_t pool);
+
+/**
+ * Acquire a free module instance from the pool, it doesn't block.
+ *
+ * @param pool the instance pool
+ * @param p_exec_env return the exec env bound to the instance if it
+ *        isn't NULL
+ *
+ * @return the module instance, NULL if all instances are in use
+ */
+WASM_RUNTIME_API_EXTERN wasm_module_inst_t
+wasm_runtime_instance_pool_acquire(wasm_instance_pool_t pool,
+                                   wasm_exec_env_t *p_exec_env);
+
+/**
+ * Release a module instance back to the pool, the instance is reset, and
+ * it is re-instantiated if the reset fails, e.g. the linear memory was
+ * enlarged by the instance.
+ *
+ * @param pool the instance pool
+ * @param module_inst the module instance acquired from the pool
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_instance_pool_release(wasm_instance_pool_t pool,
+                                   wasm_module_inst_t module_inst);
+
 WASM_RUNTIME_API_EXTERN bool
 wasm_runtime_is_wasi_mode(wasm_module_inst_t module_inst);
 
@@ -397,6 +571,13 @@ wasm_runtime_create_exec_env(wasm_module_inst_t module_inst,
 
 /**
  * Destroy the execution environment.
+ * Note:
+ *   If the runtime is built with WAMR_BUILD_EXEC_ENV_CACHE=1, the exec env
+ *   is kept in the cache of current thread if the cache isn't full, and is
+ *   returned by the next wasm_runtime_create_exec_env() called in the same
+ *   thread with the same module instance and stack size. The cached exec
+ *   envs are destroyed when the module instance is deinstantiated, or
+ *   wasm_runtime_destroy_thread_env() is called in the thread.
  *
  * @param exec_env the execution environment to destroy
  */
@@ -829,6 +1010,188 @@ wasm_runtime_dump_mem_consumption(wasm_exec_env_t exec_env);
 WASM_RUNTIME_API_EXTERN void
 wasm_runtime_dump_perf_profiling(wasm_module_inst_t module_inst);
 
+/**
+ * Get the size of the profile data collected by an AOT module which was
+ * compiled with wamrc --enable-pgo-instrument
+ *
+ * @param module_inst the WASM module instance
+ *
+ * @return the size of the profile data, 0 if the module isn't instrumented
+ */
+WASM_RUNTIME_API_EXTERN uint32_t
+wasm_runtime_get_pgo_prof_data_size(wasm_module_inst_t module_inst);
+
+/**
+ * Dump the profile data collected by an instrumented AOT module to a
+ * buffer, which can be saved to a file and passed to wamrc
+ * --use-prof-file to optimize the module with it
+ *
+ * @param module_inst the WASM module instance
+ * @param buf the buffer to store the profile data
+ * @param len the length of the buffer
+ *
+ * @return the size of the data dumped, 0 if failed
+ */
+WASM_RUNTIME_API_EXTERN uint32_t
+wasm_runtime_dump_pgo_prof_data_to_buf(wasm_module_inst_t module_inst,
+                                       char *buf, uint32_t len);
+
+/**
+ * Get the size of the execution profile collected by the fast interpreter
+ * when WASM_ENABLE_OPCODE_COUNTER is defined, including the terminating
+ * null character. The profile is a JSON object with the execution counts
+ * of the opcodes and of the pairs of consecutive opcodes, which are
+ * counted for all the modules, and the calls, the instructions and the
+ * block entries of each function of the module which have been executed.
+ *
+ * @param module_inst the WASM module instance
+ *
+ * @return the size of the profile, 0 if the counters aren't enabled
+ */
+WASM_RUNTIME_API_EXTERN uint32_t
+wasm_runtime_get_exec_profile_size(wasm_module_inst_t module_inst);
+
+/**
+ * Dump the execution profile collected by the fast interpreter to a
+ * buffer as a null terminated JSON string
+ *
+ * @param module_inst the WASM module instance
+ * @param buf the buffer to store the profile
+ * @param len the length of the buffer
+ *
+ * @return the length of the profile dumped, 0 if failed
+ */
+WASM_RUNTIME_API_EXTERN uint32_t
+wasm_runtime_dump_exec_profile_to_buf(wasm_module_inst_t module_inst,
+                                      char *buf, uint32_t len);
+
+/**
+ * Start sampling the wasm call stacks of the threads running wasm code,
+ * only available when WASM_ENABLE_SAMPLING_PROFILER is defined. The
+ * samples are aggregated into a profile of folded stacks, one
+ * "outer;...;inner count" line per stack, which is the input format of
+ * flamegraph.pl and speedscope.
+ *
+ * @param frequency the sampling frequency in Hz of the CPU time consumed,
+ *        0 to use the default frequency
+ * @param profile_file the file to write the profile when the dump is
+ *        requested with wasm_runtime_request_sampling_profile_dump,
+ *        can be NULL
+ *
+ * @return true if success, false otherwise
+ */
+WASM_RUNTIME_API_EXTERN bool
+wasm_runtime_start_sampling_profiler(uint32_t frequency,
+                                     const char *profile_file);
+
+/**
+ * Stop sampling, the profile collected is kept until the profiler is
+ * started again or the runtime is destroyed.
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_stop_sampling_profiler(void);
+
+/**
+ * Write the profile collected by the sampling profiler to a file.
+ *
+ * @param file_path the path of the file
+ *
+ * @return true if success, false otherwise
+ */
+WASM_RUNTIME_API_EXTERN bool
+wasm_runtime_dump_sampling_profile(const char *file_path);
+
+/**
+ * Request the sampling profiler to write the profile to the profile file
+ * passed to wasm_runtime_start_sampling_profiler asynchronously, it is
+ * async-signal-safe and can be called in a signal handler.
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_request_sampling_profile_dump(void);
+
+/**
+ * Get the time spent by current thread in each phase of loading and
+ * instantiating modules since the thread starts or the timing is reset,
+ * only available when WASM_ENABLE_STARTUP_TIMING is defined.
+ *
+ * @param timing output of the timing
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_get_startup_timing(wasm_startup_timing_t *timing);
+
+/**
+ * Reset the startup timing of current thread.
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_reset_startup_timing(void);
+
+/**
+ * Get the name of a startup phase, e.g. "validate".
+ *
+ * @param phase the startup phase
+ *
+ * @return the name of the phase, NULL if the phase is invalid
+ */
+WASM_RUNTIME_API_EXTERN const char *
+wasm_runtime_get_startup_phase_name(wasm_startup_phase_t phase);
+
+/**
+ * Print the startup timing of current thread.
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_dump_startup_timing(void);
+
+/**
+ * Get a snapshot of the runtime metrics, only available when
+ * WASM_ENABLE_METRICS is defined. The event counters are kept per
+ * thread and summed up when the snapshot is taken, so the increments
+ * in flight in other threads may be missed.
+ *
+ * @param metrics output of the metrics
+ */
+WASM_RUNTIME_API_EXTERN void
+wasm_runtime_get_metrics(wasm_runtime_metrics_t *metrics);
+
+/**
+ * Get the name of a trap kind, e.g. "integer_divide_by_zero".
+ *
+ * @param kind the trap kind
+ *
+ * @return the name of the trap kind, NULL if the kind is invalid
+ */
+WASM_RUNTIME_API_EXTERN const char *
+wasm_runtime_get_trap_kind_name(wasm_trap_kind_t kind);
+
+/**
+ * Dump a snapshot of the runtime metrics to a buffer as a null
+ * terminated JSON string, which also contains the thread number of
+ * each cluster and the fragmentation of the memory pool.
+ *
+ * @param buf the buffer to store the metrics, may be NULL
+ * @param len the length of the buffer
+ *
+ * @return the length of the JSON string without the terminating null
+ *         character, the string is truncated if it isn't less than len
+ */
+WASM_RUNTIME_API_EXTERN uint32_t
+wasm_runtime_dump_metrics_to_buf(char *buf, uint32_t len);
+
+/**
+ * Dump the call stats of the registered native symbols which have been
+ * called by the wasm functions to a buffer as a null terminated JSON
+ * string: the call count, the total, average and max time, and the
+ * histogram of the latency of each symbol, whose keys are the lower
+ * bounds of the log2 buckets in nanoseconds.
+ *
+ * @param buf the buffer to store the call stats, may be NULL
+ * @param len the length of the buffer
+ *
+ * @return the length of the JSON string without the terminating null
+ *         character, the string is truncated if it isn't less than len
+ */
+WASM_RUNTIME_API_EXTERN uint32_t
+wasm_runtime_dump_native_call_stats_to_buf(char *buf, uint32_t len);
+
 /* wasm thread callback function type */
 typedef void* (*wasm_thread_callback_t)(wasm_exec_env_t, void *);
 /* wasm thread type */
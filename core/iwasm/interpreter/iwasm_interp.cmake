@@ -25,5 +25,9 @@ file (GLOB_RECURSE source_all
     ${IWASM_INTERP_DIR}/${INTERPRETER}
 )
 
+if (WAMR_BUILD_BASELINE_JIT EQUAL 1)
+    list (APPEND source_all ${IWASM_INTERP_DIR}/wasm_jit_baseline.c)
+endif ()
+
 set (IWASM_INTERP_SOURCE ${source_all})
 
@@ -30,6 +30,10 @@ extern "C" {
 
 #define DEFAULT_NUM_BYTES_PER_PAGE 65536
 
+/* Memory limits flag of the memory64 proposal, the memory is
+   indexed with i64 addresses */
+#define MEMORY64_FLAG 0x04
+
 #define NULL_REF (0xFFFFFFFF)
 
 #define TABLE_MAX_SIZE (1024)
@@ -133,6 +137,8 @@ typedef struct WASMTable {
     /* specified if (flags & 1), else it is 0x10000 */
     uint32 max_size;
     bool possible_grow;
+    /* whether the elements may be changed after instantiation */
+    bool possible_set;
 } WASMTable;
 
 typedef struct WASMMemory {
@@ -188,6 +194,10 @@ typedef struct WASMFunctionImport {
 #endif
     bool call_conv_wasm_c_api;
     bool wasm_c_api_with_env;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    /* call stats of the registered native symbol */
+    struct WASMNativeCallStats *call_stats;
+#endif
 } WASMFunctionImport;
 
 typedef struct WASMGlobalImport {
@@ -220,6 +230,31 @@ typedef struct WASMImport {
     } u;
 } WASMImport;
 
+#if WASM_ENABLE_BASELINE_JIT != 0
+typedef struct WASMJitResumePoint {
+    /* ip of the pre-compiled code following a call */
+    uint8 *ip;
+    /* offset of the native code from the jit_code of the function */
+    uint32 native_offset;
+} WASMJitResumePoint;
+#endif
+
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+typedef struct WASMBlockCounter {
+    /* times the block is entered, for a loop it includes the
+       iterations branched back to it, for an if it is the times
+       the condition is evaluated */
+    uint64 count;
+    /* times the condition of an if is true */
+    uint64 taken;
+    /* offset of the block opcode from the start of the function code,
+       which follows the local declarations */
+    uint32 code_offset;
+    /* LABEL_TYPE_BLOCK, LABEL_TYPE_LOOP or LABEL_TYPE_IF */
+    uint8 label_type;
+} WASMBlockCounter;
+#endif
+
 struct WASMFunction {
 #if WASM_ENABLE_CUSTOM_NAME_SECTION != 0
     char *field_name;
@@ -254,6 +289,26 @@ struct WASMFunction {
     uint8 *consts;
     uint32 const_cell_num;
 #endif
+#if WASM_ENABLE_BASELINE_JIT != 0
+    /* native code compiled by the baseline JIT, NULL if the
+       function is run by the interpreter */
+    uint8 *jit_code;
+    /* start of the function body in the native code */
+    uint8 *jit_entry;
+    /* where to continue in the native code after the calls,
+       sorted by ip */
+    WASMJitResumePoint *jit_resume_points;
+    uint32 jit_resume_point_count;
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    /* execution counters, shared by all the instances of the module */
+    uint64 call_count;
+    uint64 instr_count;
+    /* counters of the blocks in code order, the pre-compiled
+       code refers to them with EXT_OP_BLOCK_COUNT */
+    WASMBlockCounter *block_counters;
+    uint32 block_counter_count;
+#endif
 };
 
 struct WASMGlobal {
@@ -399,6 +454,12 @@ struct WASMModule {
     bool is_wasi_module;
 #endif
 
+#if WASM_ENABLE_BASELINE_JIT != 0
+    /* native code of all the functions compiled by the baseline JIT */
+    uint8 *jit_code;
+    uint32 jit_code_size;
+#endif
+
 #if WASM_ENABLE_MULTI_MODULE != 0
     /* TODO: add mutex for mutli-thread? */
     bh_list import_module_list_head;
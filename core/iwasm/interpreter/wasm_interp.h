@@ -78,6 +78,31 @@ wasm_interp_call_wasm(struct WASMModuleInstance *module_inst,
                       struct WASMFunctionInstance *function,
                       uint32 argc, uint32 argv[]);
 
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+/**
+ * Get the name of an opcode of the pre-compiled code.
+ *
+ * @param opcode the opcode
+ *
+ * @return the name, NULL if the opcode isn't used
+ */
+const char *
+wasm_interp_get_opcode_name(uint8 opcode);
+
+/**
+ * Get the execution counts of the opcodes, indexed by the opcode.
+ */
+const uint64 *
+wasm_interp_get_opcode_counts();
+
+/**
+ * Get the execution counts of the pairs of consecutive opcodes,
+ * indexed by (first opcode << 8) + second opcode.
+ */
+const uint64 *
+wasm_interp_get_opcode_pair_counts();
+#endif
+
 #ifdef __cplusplus
 }
 #endif
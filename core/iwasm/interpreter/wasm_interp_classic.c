@@ -9,6 +9,8 @@
 #include "wasm_opcode.h"
 #include "wasm_loader.h"
 #include "../common/wasm_exec_env.h"
+#include "../common/wasm_metrics.h"
+#include "../common/wasm_usdt.h"
 #if WASM_ENABLE_SHARED_MEMORY != 0
 #include "../common/wasm_shared_memory.h"
 #endif
@@ -20,6 +22,34 @@ typedef float64 CellType_F64;
 
 #define BR_TABLE_TMP_BUF_LEN 32
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* The memory offset of memory64 is 64-bit, the integer overflow
+   of offset + addr must be checked explicitly, which isn't needed
+   by the 32-bit memories, so the checks are selected per memory */
+typedef uint64 mem_offset_t;
+
+#define CHECK_MEMORY_OVERFLOW(bytes) do {                                   \
+    uint64 offset1 = (uint64)offset + (uint64)addr;                         \
+    if ((!is_memory64 /* integer overflow */                                \
+         || (offset1 >= (uint64)addr && offset1 + bytes >= offset1))        \
+        && offset1 + bytes <= (uint64)linear_mem_size)                      \
+      maddr = memory->memory_data + offset1;                                \
+    else                                                                    \
+      goto out_of_bounds;                                                   \
+  } while (0)
+
+#define CHECK_BULK_MEMORY_OVERFLOW(start, bytes, maddr) do {                \
+    uint64 offset1 = (uint64)(start);                                       \
+    if ((!is_memory64 || offset1 + bytes >= offset1) /* integer overflow */ \
+        && offset1 + bytes <= (uint64)linear_mem_size)                      \
+      /* App heap space is not valid space for bulk memory operation */     \
+      maddr = memory->memory_data + offset1;                                \
+    else                                                                    \
+      goto out_of_bounds;                                                   \
+  } while (0)
+#else
+typedef uint32 mem_offset_t;
+
 #define CHECK_MEMORY_OVERFLOW(bytes) do {                                   \
     uint64 offset1 = (uint64)offset + (uint64)addr;                         \
     if (offset1 + bytes <= (uint64)linear_mem_size)                         \
@@ -38,6 +68,7 @@ typedef float64 CellType_F64;
     else                                                                    \
       goto out_of_bounds;                                                   \
   } while (0)
+#endif /* end of WASM_ENABLE_MEMORY64 */
 
 #define CHECK_ATOMIC_MEMORY_ACCESS() do {               \
     if (((uintptr_t)maddr & ((1 << align) - 1)) != 0)   \
@@ -233,6 +264,21 @@ read_leb(const uint8 *buf, uint32 *p_offset, uint32 maxbits, bool sign)
 
 #define POP_F64() (frame_sp -= 2, GET_F64_FROM_ADDR(frame_sp))
 
+#if WASM_ENABLE_MEMORY64 != 0
+#define POP_MEM_OFFSET()                                \
+  (is_memory64 ? (uint64)POP_I64() : (uint64)(uint32)POP_I32())
+
+#define PUSH_MEM_OFFSET(value) do {                     \
+    if (is_memory64)                                    \
+      PUSH_I64(value);                                  \
+    else                                                \
+      PUSH_I32((uint32)(value));                        \
+  } while (0)
+#else
+#define POP_MEM_OFFSET() ((uint32)POP_I32())
+#define PUSH_MEM_OFFSET(value) PUSH_I32(value)
+#endif
+
 #define POP_CSP_CHECK_OVERFLOW(n) do {                          \
     bh_assert(frame_csp - n >= frame->csp_bottom);              \
   } while (0)
@@ -315,6 +361,29 @@ read_leb(const uint8 *buf, uint32 *p_offset, uint32 maxbits, bool sign)
   p += _off;                                    \
 } while (0)
 
+#if WASM_ENABLE_MEMORY64 != 0
+#define read_leb_uint64(p, p_end, res) do {     \
+  uint8 _val = *p;                              \
+  if (!(_val & 0x80)) {                         \
+    res = _val;                                 \
+    p++;                                        \
+    break;                                      \
+  }                                             \
+  uint32 _off = 0;                              \
+  res = read_leb(p, &_off, 64, false);          \
+  p += _off;                                    \
+} while (0)
+
+#define read_leb_mem_offset(p, p_end, res) do { \
+  if (is_memory64)                              \
+    read_leb_uint64(p, p_end, res);             \
+  else                                          \
+    read_leb_uint32(p, p_end, res);             \
+} while (0)
+#else
+#define read_leb_mem_offset read_leb_uint32
+#endif
+
 #if WASM_ENABLE_LABELS_AS_VALUES == 0
 #define RECOVER_FRAME_IP_END() \
     frame_ip_end = wasm_get_func_code_end(cur_func)
@@ -733,6 +802,9 @@ wasm_interp_call_func_native(WASMModuleInstance *module_inst,
     uint32 argv_ret[2];
     char buf[128];
     bool ret;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    uint64 call_begin_ns = 0;
+#endif
 
     if (!(frame = ALLOC_FRAME(exec_env,
                               wasm_interp_interp_frame_size(local_cell_num),
@@ -753,6 +825,13 @@ wasm_interp_call_func_native(WASMModuleInstance *module_inst,
         return;
     }
 
+    METRICS_INC(host_calls);
+
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    if (func_import->call_stats)
+        call_begin_ns = wasm_native_call_stats_now();
+#endif
+
     if (func_import->call_conv_wasm_c_api) {
         ret = wasm_runtime_invoke_c_api_native(
           (WASMModuleInstanceCommon *)module_inst,
@@ -765,18 +844,27 @@ wasm_interp_call_func_native(WASMModuleInstance *module_inst,
         }
     }
     else if (!func_import->call_conv_raw) {
+        USDT_PROBE2(host_call_begin, exec_env, func_import->func_ptr_linked);
         ret = wasm_runtime_invoke_native(exec_env, func_import->func_ptr_linked,
                                          func_import->func_type, func_import->signature,
                                          func_import->attachment,
                                          frame->lp, cur_func->param_cell_num, argv_ret);
+        USDT_PROBE3(host_call_end, exec_env, func_import->func_ptr_linked, ret);
     }
     else {
+        USDT_PROBE2(host_call_begin, exec_env, func_import->func_ptr_linked);
         ret = wasm_runtime_invoke_native_raw(exec_env, func_import->func_ptr_linked,
                                              func_import->func_type, func_import->signature,
                                              func_import->attachment,
                                              frame->lp, cur_func->param_cell_num, argv_ret);
+        USDT_PROBE3(host_call_end, exec_env, func_import->func_ptr_linked, ret);
     }
 
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    if (func_import->call_stats)
+        wasm_native_call_stats_add(func_import->call_stats, call_begin_ns);
+#endif
+
     if (!ret)
         return;
 
@@ -881,7 +969,11 @@ wasm_interp_call_func_bytecode(WASMModuleInstance *module,
   WASMMemoryInstance *memory = module->default_memory;
   uint32 num_bytes_per_page = memory ? memory->num_bytes_per_page : 0;
   uint8 *global_data = module->global_data;
-  uint32 linear_mem_size = memory ? num_bytes_per_page * memory->cur_page_count : 0;
+#if WASM_ENABLE_MEMORY64 != 0
+  bool is_memory64 = memory && memory->is_memory64;
+#endif
+  mem_offset_t linear_mem_size =
+      memory ? (mem_offset_t)num_bytes_per_page * memory->cur_page_count : 0;
   WASMType **wasm_types = module->module->types;
   WASMGlobalInstance *globals = module->globals, *global;
   uint8 opcode_IMPDEP = WASM_OP_IMPDEP;
@@ -1516,11 +1608,12 @@ label_pop_csp_n:
       HANDLE_OP (WASM_OP_I32_LOAD):
       HANDLE_OP (WASM_OP_F32_LOAD):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(4);
           PUSH_I32(LOAD_I32(maddr));
           (void)flags;
@@ -1530,11 +1623,12 @@ label_pop_csp_n:
       HANDLE_OP (WASM_OP_I64_LOAD):
       HANDLE_OP (WASM_OP_F64_LOAD):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(8);
           PUSH_I64(LOAD_I64(maddr));
           (void)flags;
@@ -1543,11 +1637,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I32_LOAD8_S):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
           PUSH_I32(sign_ext_8_32(*(int8*)maddr));
           (void)flags;
@@ -1556,11 +1651,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I32_LOAD8_U):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
           PUSH_I32((uint32)(*(uint8*)maddr));
           (void)flags;
@@ -1569,11 +1665,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I32_LOAD16_S):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
           PUSH_I32(sign_ext_16_32(LOAD_I16(maddr)));
           (void)flags;
@@ -1582,11 +1679,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I32_LOAD16_U):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
           PUSH_I32((uint32)(LOAD_U16(maddr)));
           (void)flags;
@@ -1595,11 +1693,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I64_LOAD8_S):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
           PUSH_I64(sign_ext_8_64(*(int8*)maddr));
           (void)flags;
@@ -1608,11 +1707,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I64_LOAD8_U):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
           PUSH_I64((uint64)(*(uint8*)maddr));
           (void)flags;
@@ -1621,11 +1721,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I64_LOAD16_S):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
           PUSH_I64(sign_ext_16_64(LOAD_I16(maddr)));
           (void)flags;
@@ -1634,11 +1735,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I64_LOAD16_U):
           {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
           PUSH_I64((uint64)(LOAD_U16(maddr)));
           (void)flags;
@@ -1647,12 +1749,13 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I64_LOAD32_S):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           opcode = *(frame_ip - 1);
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(4);
           PUSH_I64(sign_ext_32_64(LOAD_I32(maddr)));
           (void)flags;
@@ -1661,11 +1764,12 @@ label_pop_csp_n:
 
       HANDLE_OP (WASM_OP_I64_LOAD32_U):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
-          addr = POP_I32();
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(4);
           PUSH_I64((uint64)(LOAD_U32(maddr)));
           (void)flags;
@@ -1676,14 +1780,17 @@ label_pop_csp_n:
       HANDLE_OP (WASM_OP_I32_STORE):
       HANDLE_OP (WASM_OP_F32_STORE):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
+          uint32 *sval;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
           frame_sp--;
-          addr = POP_I32();
+          sval = frame_sp;
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(4);
-          STORE_U32(maddr, frame_sp[1]);
+          STORE_U32(maddr, sval[0]);
           (void)flags;
           HANDLE_OP_END ();
         }
@@ -1691,15 +1798,18 @@ label_pop_csp_n:
       HANDLE_OP (WASM_OP_I64_STORE):
       HANDLE_OP (WASM_OP_F64_STORE):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
+          uint32 *sval;
 
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
           frame_sp -= 2;
-          addr = POP_I32();
+          sval = frame_sp;
+          addr = POP_MEM_OFFSET();
           CHECK_MEMORY_OVERFLOW(8);
-          STORE_U32(maddr, frame_sp[1]);
-          STORE_U32(maddr + 4, frame_sp[2]);
+          STORE_U32(maddr, sval[0]);
+          STORE_U32(maddr + 4, sval[1]);
           (void)flags;
           HANDLE_OP_END ();
         }
@@ -1707,14 +1817,15 @@ label_pop_csp_n:
       HANDLE_OP (WASM_OP_I32_STORE8):
       HANDLE_OP (WASM_OP_I32_STORE16):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
           uint32 sval;
 
           opcode = *(frame_ip - 1);
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
           sval = (uint32)POP_I32();
-          addr = POP_I32();
+          addr = POP_MEM_OFFSET();
 
           if (opcode == WASM_OP_I32_STORE8) {
               CHECK_MEMORY_OVERFLOW(1);
@@ -1733,14 +1844,15 @@ label_pop_csp_n:
       HANDLE_OP (WASM_OP_I64_STORE16):
       HANDLE_OP (WASM_OP_I64_STORE32):
         {
-          uint32 offset, flags, addr;
+          uint32 flags;
+          mem_offset_t offset, addr;
           uint64 sval;
 
           opcode = *(frame_ip - 1);
           read_leb_uint32(frame_ip, frame_ip_end, flags);
-          read_leb_uint32(frame_ip, frame_ip_end, offset);
+          read_leb_mem_offset(frame_ip, frame_ip_end, offset);
           sval = (uint64)POP_I64();
-          addr = POP_I32();
+          addr = POP_MEM_OFFSET();
 
           if (opcode == WASM_OP_I64_STORE8) {
               CHECK_MEMORY_OVERFLOW(1);
@@ -1763,28 +1875,31 @@ label_pop_csp_n:
       {
         uint32 reserved;
         read_leb_uint32(frame_ip, frame_ip_end, reserved);
-        PUSH_I32(memory->cur_page_count);
+        PUSH_MEM_OFFSET(memory->cur_page_count);
         (void)reserved;
         HANDLE_OP_END ();
       }
 
       HANDLE_OP (WASM_OP_MEMORY_GROW):
       {
-        uint32 reserved, delta, prev_page_count = memory->cur_page_count;
+        uint32 reserved, prev_page_count = memory->cur_page_count;
+        mem_offset_t delta;
 
         read_leb_uint32(frame_ip, frame_ip_end, reserved);
-        delta = (uint32)POP_I32();
+        delta = POP_MEM_OFFSET();
 
-        if (!wasm_enlarge_memory(module, delta)) {
+        if (delta > UINT32_MAX
+            || !wasm_enlarge_memory(module, (uint32)delta)) {
           /* failed to memory.grow, return -1 */
-          PUSH_I32(-1);
+          PUSH_MEM_OFFSET((mem_offset_t)-1);
         }
         else {
           /* success, return previous page count */
-          PUSH_I32(prev_page_count);
+          PUSH_MEM_OFFSET(prev_page_count);
           /* update memory instance ptr and memory size */
           memory = module->default_memory;
-          linear_mem_size = num_bytes_per_page * memory->cur_page_count;
+          linear_mem_size = (mem_offset_t)num_bytes_per_page
+                            * memory->cur_page_count;
         }
 
         (void)reserved;
@@ -2627,7 +2742,8 @@ label_pop_csp_n:
 #if WASM_ENABLE_BULK_MEMORY != 0
         case WASM_OP_MEMORY_INIT:
         {
-          uint32 addr, segment;
+          uint32 segment;
+          mem_offset_t addr;
           uint64 bytes, offset, seg_len;
           uint8* data;
 
@@ -2637,17 +2753,20 @@ label_pop_csp_n:
 
           bytes = (uint64)(uint32)POP_I32();
           offset = (uint64)(uint32)POP_I32();
-          addr = (uint32)POP_I32();
+          addr = POP_MEM_OFFSET();
 
           CHECK_BULK_MEMORY_OVERFLOW(addr, bytes, maddr);
 
-          seg_len = (uint64)module->module->data_segments[segment]->data_length;
+          /* A dropped segment is treated as an empty segment */
+          seg_len = module->data_dropped[segment]
+                    ? 0 : module->module->data_segments[segment]->data_length;
           data = module->module->data_segments[segment]->data;
           if (offset + bytes > seg_len)
             goto out_of_bounds;
 
-          bh_memcpy_s(maddr, linear_mem_size - addr,
-                      data + offset, bytes);
+          /* The destination range has been checked above */
+          bh_memcpy_s(maddr, (uint32)bytes,
+                      data + offset, (uint32)bytes);
           break;
         }
         case WASM_OP_DATA_DROP:
@@ -2655,43 +2774,49 @@ label_pop_csp_n:
           uint32 segment;
 
           read_leb_uint32(frame_ip, frame_ip_end, segment);
-          module->module->data_segments[segment]->data_length = 0;
+          module->data_dropped[segment] = true;
 
           break;
         }
         case WASM_OP_MEMORY_COPY:
         {
-          uint32 dst, src, len;
+          mem_offset_t dst, src, len;
           uint8 *mdst, *msrc;
 
           frame_ip += 2;
 
-          len = POP_I32();
-          src = POP_I32();
-          dst = POP_I32();
+          len = POP_MEM_OFFSET();
+          src = POP_MEM_OFFSET();
+          dst = POP_MEM_OFFSET();
 
           CHECK_BULK_MEMORY_OVERFLOW(src, len, msrc);
           CHECK_BULK_MEMORY_OVERFLOW(dst, len, mdst);
 
           /* allowing the destination and source to overlap */
+#if WASM_ENABLE_MEMORY64 != 0
+          /* Both ranges have been checked, and len may exceed
+             the uint32 size of bh_memmove_s */
+          memmove(mdst, msrc, (size_t)len);
+#else
           bh_memmove_s(mdst, linear_mem_size - dst,
                        msrc, len);
+#endif
 
           break;
         }
         case WASM_OP_MEMORY_FILL:
         {
-          uint32 dst, len;
+          mem_offset_t dst, len;
           uint8 val, *mdst;
           frame_ip++;
 
-          len = POP_I32();
+          len = POP_MEM_OFFSET();
           val = POP_I32();
-          dst = POP_I32();
+          dst = POP_MEM_OFFSET();
 
           CHECK_BULK_MEMORY_OVERFLOW(dst, len, mdst);
 
-          memset(mdst, val, len);
+          memset(mdst, val, (size_t)len);
 
           break;
         }
@@ -2727,7 +2852,7 @@ label_pop_csp_n:
             goto got_exception;
           }
 
-          if (module->module->table_segments[elem_idx].is_dropped) {
+          if (module->elem_dropped[elem_idx]) {
             wasm_set_exception(module, "out of bounds table access");
             goto got_exception;
           }
@@ -2753,7 +2878,7 @@ label_pop_csp_n:
           read_leb_uint32(frame_ip, frame_ip_end, elem_idx);
           bh_assert(elem_idx < module->module->table_seg_count);
 
-          module->module->table_segments[elem_idx].is_dropped = true;
+          module->elem_dropped[elem_idx] = true;
           break;
         }
         case WASM_OP_TABLE_COPY:
@@ -3244,6 +3369,7 @@ label_pop_csp_n:
     HANDLE_OP (EXT_OP_COPY_STACK_TOP):
     HANDLE_OP (EXT_OP_COPY_STACK_TOP_I64):
     HANDLE_OP (EXT_OP_COPY_STACK_VALUES):
+    HANDLE_OP (EXT_OP_BLOCK_COUNT):
     {
       wasm_set_exception(module, "unsupported opcode");
       goto got_exception;
@@ -3297,7 +3423,8 @@ label_pop_csp_n:
           /* update memory instance ptr and memory size */
           memory = module->default_memory;
           if (memory)
-             linear_mem_size = num_bytes_per_page * memory->cur_page_count;
+             linear_mem_size = (mem_offset_t)num_bytes_per_page
+                               * memory->cur_page_count;
           if (wasm_get_exception(module))
               goto got_exception;
       }
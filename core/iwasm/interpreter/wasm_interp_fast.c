@@ -9,15 +9,48 @@
 #include "wasm_opcode.h"
 #include "wasm_loader.h"
 #include "../common/wasm_exec_env.h"
+#include "../common/wasm_metrics.h"
+#include "../common/wasm_usdt.h"
 #if WASM_ENABLE_SHARED_MEMORY != 0
 #include "../common/wasm_shared_memory.h"
 #endif
+#if WASM_ENABLE_BASELINE_JIT != 0
+#include "wasm_jit_baseline.h"
+#endif
 
 typedef int32 CellType_I32;
 typedef int64 CellType_I64;
 typedef float32 CellType_F32;
 typedef float64 CellType_F64;
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* The memory offset of memory64 is 64-bit, the integer overflow
+   of offset + addr must be checked explicitly, which isn't needed
+   by the 32-bit memories, so the checks are selected per memory */
+typedef uint64 mem_offset_t;
+
+#define CHECK_MEMORY_OVERFLOW(bytes) do {                                \
+    uint64 offset1 = (uint64)offset + (uint64)addr;                      \
+    if ((!is_memory64 /* integer overflow */                             \
+         || (offset1 >= (uint64)addr && offset1 + bytes >= offset1))     \
+        && offset1 + bytes <= (uint64)linear_mem_size)                   \
+      maddr = memory->memory_data + offset1;                             \
+    else                                                                 \
+      goto out_of_bounds;                                                \
+  } while (0)
+
+#define CHECK_BULK_MEMORY_OVERFLOW(start, bytes, maddr) do {             \
+    uint64 offset1 = (uint64)(start);                                    \
+    if ((!is_memory64 || offset1 + bytes >= offset1) /* overflow */      \
+        && offset1 + bytes <= linear_mem_size)                           \
+      /* App heap space is not valid space for bulk memory operation */  \
+      maddr = memory->memory_data + offset1;                             \
+    else                                                                 \
+      goto out_of_bounds;                                                \
+  } while (0)
+#else
+typedef uint32 mem_offset_t;
+
 #define CHECK_MEMORY_OVERFLOW(bytes) do {                                \
     uint64 offset1 = (uint64)offset + (uint64)addr;                      \
     if (offset1 + bytes <= (uint64)linear_mem_size)                      \
@@ -36,6 +69,7 @@ typedef float64 CellType_F64;
     else                                                                 \
       goto out_of_bounds;                                                \
   } while (0)
+#endif /* end of WASM_ENABLE_MEMORY64 */
 
 #define CHECK_ATOMIC_MEMORY_ACCESS(align) do {          \
     if (((uintptr_t)maddr & (align - 1)) != 0)          \
@@ -215,6 +249,18 @@ LOAD_PTR(void *addr)
 #define read_uint32(p) \
     (p += sizeof(uint32), LOAD_U32_WITH_2U16S(p - sizeof(uint32)))
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* The memarg offset of memory64 is emitted as two uint32 */
+#define read_mem_offset(p)                                              \
+    (is_memory64                                                        \
+     ? (p += sizeof(uint64),                                            \
+        (uint64)LOAD_U32_WITH_2U16S(p - sizeof(uint64))                 \
+        | ((uint64)LOAD_U32_WITH_2U16S(p - sizeof(uint32)) << 32))      \
+     : (uint64)read_uint32(p))
+#else
+#define read_mem_offset(p) read_uint32(p)
+#endif
+
 #define GET_LOCAL_INDEX_TYPE_AND_OFFSET() do {                      \
     uint32 param_count = cur_func->param_count;                     \
     local_idx = read_uint32(frame_ip);                              \
@@ -282,6 +328,19 @@ LOAD_PTR(void *addr)
 
 #define POP_F64() (GET_F64_FROM_ADDR(frame_lp + GET_OFFSET()))
 
+#if WASM_ENABLE_MEMORY64 != 0
+#define GET_MEM_OFFSET_OPERAND(off)                                 \
+    (is_memory64 ? GET_OPERAND(uint64, I64, off)                    \
+                 : (uint64)GET_OPERAND(uint32, I32, off))
+
+#define POP_MEM_OFFSET()                                            \
+    (is_memory64 ? (uint64)POP_I64() : (uint64)(uint32)POP_I32())
+#else
+#define GET_MEM_OFFSET_OPERAND(off) GET_OPERAND(uint32, I32, off)
+
+#define POP_MEM_OFFSET() ((uint32)POP_I32())
+#endif
+
 #define SYNC_ALL_TO_FRAME() do {                \
     frame->ip = frame_ip;                       \
   } while (0)
@@ -805,6 +864,9 @@ wasm_interp_call_func_native(WASMModuleInstance *module_inst,
     WASMInterpFrame *frame;
     uint32 argv_ret[2];
     bool ret;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    uint64 call_begin_ns = 0;
+#endif
 
     if (!(frame = ALLOC_FRAME(exec_env,
                               wasm_interp_interp_frame_size(local_cell_num),
@@ -826,6 +888,13 @@ wasm_interp_call_func_native(WASMModuleInstance *module_inst,
         return;
     }
 
+    METRICS_INC(host_calls);
+
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    if (func_import->call_stats)
+        call_begin_ns = wasm_native_call_stats_now();
+#endif
+
     if (func_import->call_conv_wasm_c_api) {
         ret = wasm_runtime_invoke_c_api_native(
           (WASMModuleInstanceCommon *)module_inst,
@@ -838,18 +907,27 @@ wasm_interp_call_func_native(WASMModuleInstance *module_inst,
         }
     }
     else if (!func_import->call_conv_raw) {
+        USDT_PROBE2(host_call_begin, exec_env, func_import->func_ptr_linked);
         ret = wasm_runtime_invoke_native(exec_env, func_import->func_ptr_linked,
                                          func_import->func_type, func_import->signature,
                                          func_import->attachment,
                                          frame->lp, cur_func->param_cell_num, argv_ret);
+        USDT_PROBE3(host_call_end, exec_env, func_import->func_ptr_linked, ret);
     }
     else {
+        USDT_PROBE2(host_call_begin, exec_env, func_import->func_ptr_linked);
         ret = wasm_runtime_invoke_native_raw(exec_env, func_import->func_ptr_linked,
                                              func_import->func_type, func_import->signature,
                                              func_import->attachment,
                                              frame->lp, cur_func->param_cell_num, argv_ret);
+        USDT_PROBE3(host_call_end, exec_env, func_import->func_ptr_linked, ret);
     }
 
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    if (func_import->call_stats)
+        wasm_native_call_stats_add(func_import->call_stats, call_begin_ns);
+#endif
+
     if (!ret)
         return;
 
@@ -931,37 +1009,55 @@ wasm_interp_call_func_import(WASMModuleInstance *module_inst,
 #endif
 
 #if WASM_ENABLE_OPCODE_COUNTER != 0
-typedef struct OpcodeInfo {
-    char *name;
-    uint64 count;
-} OpcodeInfo;
+static uint64 opcode_counts[WASM_INSTRUCTION_NUM];
+static uint64 opcode_pair_counts[WASM_INSTRUCTION_NUM * WASM_INSTRUCTION_NUM];
 
-#define HANDLE_OPCODE(op) { #op, 0 }
-DEFINE_GOTO_TABLE (OpcodeInfo, opcode_table);
+const char *
+wasm_interp_get_opcode_name(uint8 opcode)
+{
+#define HANDLE_OPCODE(op) #op
+    DEFINE_GOTO_TABLE (const char *, opcode_names);
 #undef HANDLE_OPCODE
+    return opcode_names[opcode];
+}
 
-static void
-wasm_interp_dump_op_count()
+const uint64 *
+wasm_interp_get_opcode_counts()
 {
-    uint32 i;
-    uint64 total_count = 0;
-    for (i = 0; i < WASM_OP_IMPDEP; i++)
-        total_count += opcode_table[i].count;
-
-    printf("total opcode count: %ld\n", total_count);
-    for (i = 0; i < WASM_OP_IMPDEP; i++)
-        if (opcode_table[i].count > 0)
-            printf("\t\t%s count:\t\t%ld,\t\t%.2f%%\n",
-                   opcode_table[i].name, opcode_table[i].count,
-                   opcode_table[i].count * 100.0f / total_count);
+    return opcode_counts;
 }
+
+const uint64 *
+wasm_interp_get_opcode_pair_counts()
+{
+    return opcode_pair_counts;
+}
+
+/* Count the opcode once even if the handlers of several opcodes are
+   shared, the flag is cleared when dispatching the next opcode */
+#define COUNT_OPCODE(op) do {                                   \
+    if (!opcode_counted) {                                      \
+        opcode_counts[op]++;                                    \
+        opcode_pair_counts[(prev_opcode << 8) + (op)]++;        \
+        prev_opcode = (op);                                     \
+        (*instr_counter)++;                                     \
+        opcode_counted = true;                                  \
+    }                                                           \
+  } while (0)
+#define RESET_OPCODE_COUNTED() opcode_counted = false
+#else
+#define RESET_OPCODE_COUNTED() (void)0
 #endif
 
 #if WASM_ENABLE_LABELS_AS_VALUES != 0
 
 /* #define HANDLE_OP(opcode) HANDLE_##opcode:printf(#opcode"\n");h_##opcode */
 #if WASM_ENABLE_OPCODE_COUNTER != 0
-#define HANDLE_OP(opcode) HANDLE_##opcode:opcode_table[opcode].count++;h_##opcode
+#if defined(__GNUC__)
+/* h_xxx only takes the colon following HANDLE_OP */
+#pragma GCC diagnostic ignored "-Wunused-label"
+#endif
+#define HANDLE_OP(opcode) HANDLE_##opcode:COUNT_OPCODE(opcode);h_##opcode
 #else
 #define HANDLE_OP(opcode) HANDLE_##opcode
 #endif
@@ -969,6 +1065,7 @@ wasm_interp_dump_op_count()
 #define FETCH_OPCODE_AND_DISPATCH() do {                    \
     const void *p_label_addr = *(void**)frame_ip;           \
     frame_ip += sizeof(void*);                              \
+    RESET_OPCODE_COUNTED();                                 \
     goto *p_label_addr;                                     \
   } while (0)
 #else
@@ -976,6 +1073,7 @@ wasm_interp_dump_op_count()
     const void *p_label_addr = label_base                   \
                                + *(int16*)frame_ip;         \
     frame_ip += sizeof(int16);                              \
+    RESET_OPCODE_COUNTED();                                 \
     goto *p_label_addr;                                     \
   } while (0)
 #endif /* end of WASM_CPU_SUPPORTS_UNALIGNED_ADDR_ACCESS */
@@ -1001,7 +1099,11 @@ wasm_interp_call_func_bytecode(WASMModuleInstance *module,
   WASMMemoryInstance *memory = module->default_memory;
   uint32 num_bytes_per_page = memory ? memory->num_bytes_per_page : 0;
   uint8 *global_data = module->global_data;
-  uint32 linear_mem_size = memory ? num_bytes_per_page * memory->cur_page_count : 0;
+#if WASM_ENABLE_MEMORY64 != 0
+  bool is_memory64 = memory && memory->is_memory64;
+#endif
+  mem_offset_t linear_mem_size =
+      memory ? (mem_offset_t)num_bytes_per_page * memory->cur_page_count : 0;
   WASMGlobalInstance *globals = module->globals, *global;
   uint8 opcode_IMPDEP = WASM_OP_IMPDEP;
   WASMInterpFrame *frame = NULL;
@@ -1022,6 +1124,15 @@ wasm_interp_call_func_bytecode(WASMModuleInstance *module,
   uint8 *maddr = NULL;
   uint32 local_idx, local_offset, global_idx;
   uint8 opcode, local_type, *global_addr;
+#if WASM_ENABLE_BASELINE_JIT != 0
+  uint8 *jit_native_addr = NULL;
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+  /* instruction counter of the current function */
+  uint64 entry_instr_count = 0, *instr_counter = &entry_instr_count;
+  uint32 prev_opcode = WASM_OP_IMPDEP;
+  bool opcode_counted = false;
+#endif
 
 #if WASM_ENABLE_LABELS_AS_VALUES != 0
   #define HANDLE_OPCODE(op) &&HANDLE_##op
@@ -1038,6 +1149,12 @@ wasm_interp_call_func_bytecode(WASMModuleInstance *module,
     opcode = *frame_ip++;
 #if WASM_CPU_SUPPORTS_UNALIGNED_ADDR_ACCESS == 0
     frame_ip++;
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    if (opcode != EXT_OP_BLOCK_COUNT) {
+        RESET_OPCODE_COUNTED();
+        COUNT_OPCODE(opcode);
+    }
 #endif
     switch (opcode) {
 #else
@@ -1069,6 +1186,19 @@ wasm_interp_call_func_bytecode(WASMModuleInstance *module,
         frame_ip = (uint8*)LOAD_PTR(frame_ip);
         HANDLE_OP_END ();
 
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+      /* Not counted as an instruction since it is only emitted
+         to count the entries of the blocks */
+#if WASM_ENABLE_LABELS_AS_VALUES != 0
+      HANDLE_EXT_OP_BLOCK_COUNT:
+#else
+      case EXT_OP_BLOCK_COUNT:
+#endif
+        (*(uint64*)LOAD_PTR(frame_ip))++;
+        frame_ip += sizeof(void*);
+        HANDLE_OP_END ();
+#endif
+
       HANDLE_OP (WASM_OP_BR):
 #if WASM_ENABLE_THREAD_MGR != 0
         CHECK_SUSPEND_FLAGS();
@@ -1466,9 +1596,9 @@ recover_br_info:
       /* memory load instructions */
       HANDLE_OP (WASM_OP_I32_LOAD):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(4);
@@ -1478,9 +1608,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_LOAD):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(8);
@@ -1490,9 +1620,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I32_LOAD8_S):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
@@ -1502,9 +1632,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I32_LOAD8_U):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
@@ -1514,9 +1644,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I32_LOAD16_S):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
@@ -1526,9 +1656,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I32_LOAD16_U):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
@@ -1538,9 +1668,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_LOAD8_S):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
@@ -1550,9 +1680,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_LOAD8_U):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(1);
@@ -1562,9 +1692,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_LOAD16_S):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
@@ -1574,9 +1704,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_LOAD16_U):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(2);
@@ -1586,9 +1716,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_LOAD32_S):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(4);
@@ -1598,9 +1728,9 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_LOAD32_U):
         {
-          uint32 offset, addr;
-          offset = read_uint32(frame_ip);
-          addr = GET_OPERAND(uint32, I32, 0);
+          mem_offset_t offset, addr;
+          offset = read_mem_offset(frame_ip);
+          addr = GET_MEM_OFFSET_OPERAND(0);
           frame_ip += 2;
           addr_ret = GET_OFFSET();
           CHECK_MEMORY_OVERFLOW(4);
@@ -1610,11 +1740,11 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I32_STORE):
         {
-          uint32 offset, addr;
+          mem_offset_t offset, addr;
           uint32 sval;
-          offset = read_uint32(frame_ip);
+          offset = read_mem_offset(frame_ip);
           sval = GET_OPERAND(uint32, I32, 0);
-          addr = GET_OPERAND(uint32, I32, 2);
+          addr = GET_MEM_OFFSET_OPERAND(2);
           frame_ip += 4;
           CHECK_MEMORY_OVERFLOW(4);
           STORE_U32(maddr, sval);
@@ -1623,11 +1753,11 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I32_STORE8):
         {
-          uint32 offset, addr;
+          mem_offset_t offset, addr;
           uint32 sval;
-          offset = read_uint32(frame_ip);
+          offset = read_mem_offset(frame_ip);
           sval = GET_OPERAND(uint32, I32, 0);
-          addr = GET_OPERAND(uint32, I32, 2);
+          addr = GET_MEM_OFFSET_OPERAND(2);
           frame_ip += 4;
           CHECK_MEMORY_OVERFLOW(1);
           *(uint8*)maddr = (uint8)sval;
@@ -1636,11 +1766,11 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I32_STORE16):
         {
-          uint32 offset, addr;
+          mem_offset_t offset, addr;
           uint32 sval;
-          offset = read_uint32(frame_ip);
+          offset = read_mem_offset(frame_ip);
           sval = GET_OPERAND(uint32, I32, 0);
-          addr = GET_OPERAND(uint32, I32, 2);
+          addr = GET_MEM_OFFSET_OPERAND(2);
           frame_ip += 4;
           CHECK_MEMORY_OVERFLOW(2);
           STORE_U16(maddr, (uint16)sval);
@@ -1649,11 +1779,11 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_STORE):
         {
-          uint32 offset, addr;
+          mem_offset_t offset, addr;
           uint64 sval;
-          offset = read_uint32(frame_ip);
+          offset = read_mem_offset(frame_ip);
           sval = GET_OPERAND(uint64, I64, 0);
-          addr = GET_OPERAND(uint32, I32, 2);
+          addr = GET_MEM_OFFSET_OPERAND(2);
           frame_ip += 4;
           CHECK_MEMORY_OVERFLOW(8);
           STORE_I64(maddr, sval);
@@ -1662,11 +1792,11 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_STORE8):
         {
-          uint32 offset, addr;
+          mem_offset_t offset, addr;
           uint64 sval;
-          offset = read_uint32(frame_ip);
+          offset = read_mem_offset(frame_ip);
           sval = GET_OPERAND(uint64, I64, 0);
-          addr = GET_OPERAND(uint32, I32, 2);
+          addr = GET_MEM_OFFSET_OPERAND(2);
           frame_ip += 4;
           CHECK_MEMORY_OVERFLOW(1);
           *(uint8*)maddr = (uint8)sval;
@@ -1675,11 +1805,11 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_STORE16):
         {
-          uint32 offset, addr;
+          mem_offset_t offset, addr;
           uint64 sval;
-          offset = read_uint32(frame_ip);
+          offset = read_mem_offset(frame_ip);
           sval = GET_OPERAND(uint64, I64, 0);
-          addr = GET_OPERAND(uint32, I32, 2);
+          addr = GET_MEM_OFFSET_OPERAND(2);
           frame_ip += 4;
           CHECK_MEMORY_OVERFLOW(2);
           STORE_U16(maddr, (uint16)sval);
@@ -1688,11 +1818,11 @@ recover_br_info:
 
       HANDLE_OP (WASM_OP_I64_STORE32):
         {
-          uint32 offset, addr;
+          mem_offset_t offset, addr;
           uint64 sval;
-          offset = read_uint32(frame_ip);
+          offset = read_mem_offset(frame_ip);
           sval = GET_OPERAND(uint64, I64, 0);
-          addr = GET_OPERAND(uint32, I32, 2);
+          addr = GET_MEM_OFFSET_OPERAND(2);
           frame_ip += 4;
           CHECK_MEMORY_OVERFLOW(4);
           STORE_U32(maddr, (uint32)sval);
@@ -1704,6 +1834,11 @@ recover_br_info:
       {
         uint32 reserved;
         addr_ret = GET_OFFSET();
+#if WASM_ENABLE_MEMORY64 != 0
+        if (is_memory64)
+          PUT_I64_TO_ADDR(frame_lp + addr_ret, (uint64)memory->cur_page_count);
+        else
+#endif
         frame_lp[addr_ret] = memory->cur_page_count;
         (void)reserved;
         HANDLE_OP_END ();
@@ -1712,21 +1847,34 @@ recover_br_info:
       HANDLE_OP (WASM_OP_MEMORY_GROW):
       {
         uint32 reserved, delta, prev_page_count = memory->cur_page_count;
+        bool success;
 
         addr1 = GET_OFFSET();
         addr_ret = GET_OFFSET();
-        delta = (uint32)frame_lp[addr1];
-
-        if (!wasm_enlarge_memory(module, delta)) {
-          /* failed to memory.grow, return -1 */
-          frame_lp[addr_ret] = -1;
+#if WASM_ENABLE_MEMORY64 != 0
+        if (is_memory64) {
+          uint64 delta64 = GET_I64_FROM_ADDR(frame_lp + addr1);
+          delta = (uint32)delta64;
+          success = delta64 <= UINT32_MAX
+                    && wasm_enlarge_memory(module, delta);
+          /* return previous page count or -1 if failed */
+          PUT_I64_TO_ADDR(frame_lp + addr_ret,
+                          success ? (uint64)prev_page_count : (uint64)-1);
         }
-        else {
-          /* success, return previous page count */
-          frame_lp[addr_ret] = prev_page_count;
+        else
+#endif
+        {
+          delta = (uint32)frame_lp[addr1];
+          success = wasm_enlarge_memory(module, delta);
+          /* return previous page count or -1 if failed */
+          frame_lp[addr_ret] = success ? prev_page_count : (uint32)-1;
+        }
+
+        if (success) {
           /* update memory instance ptr and memory size */
           memory = module->default_memory;
-          linear_mem_size = num_bytes_per_page * memory->cur_page_count;
+          linear_mem_size = (mem_offset_t)num_bytes_per_page
+                            * memory->cur_page_count;
         }
 
         (void)reserved;
@@ -2613,24 +2761,28 @@ recover_br_info:
 #if WASM_ENABLE_BULK_MEMORY != 0
         case WASM_OP_MEMORY_INIT:
         {
-          uint32 addr, segment;
+          uint32 segment;
+          mem_offset_t addr;
           uint64 bytes, offset, seg_len;
           uint8* data;
 
           segment = read_uint32(frame_ip);
 
-          bytes = (uint64)POP_I32();
-          offset = (uint64)POP_I32();
-          addr = POP_I32();
+          bytes = (uint64)(uint32)POP_I32();
+          offset = (uint64)(uint32)POP_I32();
+          addr = POP_MEM_OFFSET();
 
           CHECK_BULK_MEMORY_OVERFLOW(addr, bytes, maddr);
 
-          seg_len = (uint64)module->module->data_segments[segment]->data_length;
+          /* A dropped segment is treated as an empty segment */
+          seg_len = module->data_dropped[segment]
+                    ? 0 : module->module->data_segments[segment]->data_length;
           data = module->module->data_segments[segment]->data;
           if (offset + bytes > seg_len)
             goto out_of_bounds;
 
-          bh_memcpy_s(maddr, linear_mem_size - addr, data + offset, bytes);
+          /* The destination range has been checked above */
+          bh_memcpy_s(maddr, (uint32)bytes, data + offset, (uint32)bytes);
           break;
         }
         case WASM_OP_DATA_DROP:
@@ -2639,39 +2791,45 @@ recover_br_info:
 
           segment = read_uint32(frame_ip);
 
-          module->module->data_segments[segment]->data_length = 0;
+          module->data_dropped[segment] = true;
 
           break;
         }
         case WASM_OP_MEMORY_COPY:
         {
-          uint32 dst, src, len;
+          mem_offset_t dst, src, len;
           uint8 *mdst, *msrc;
 
-          len = POP_I32();
-          src = POP_I32();
-          dst = POP_I32();
+          len = POP_MEM_OFFSET();
+          src = POP_MEM_OFFSET();
+          dst = POP_MEM_OFFSET();
 
           CHECK_BULK_MEMORY_OVERFLOW(src, len, msrc);
           CHECK_BULK_MEMORY_OVERFLOW(dst, len, mdst);
 
           /* allowing the destination and source to overlap */
+#if WASM_ENABLE_MEMORY64 != 0
+          /* Both ranges have been checked, and len may exceed
+             the uint32 size of bh_memmove_s */
+          memmove(mdst, msrc, (size_t)len);
+#else
           bh_memmove_s(mdst, linear_mem_size - dst, msrc, len);
+#endif
 
           break;
         }
         case WASM_OP_MEMORY_FILL:
         {
-          uint32 dst, len;
+          mem_offset_t dst, len;
           uint8 val, *mdst;
 
-          len = POP_I32();
+          len = POP_MEM_OFFSET();
           val = POP_I32();
-          dst = POP_I32();
+          dst = POP_MEM_OFFSET();
 
           CHECK_BULK_MEMORY_OVERFLOW(dst, len, mdst);
 
-          memset(mdst, val, len);
+          memset(mdst, val, (size_t)len);
 
           break;
         }
@@ -2705,7 +2863,7 @@ recover_br_info:
                 goto got_exception;
             }
 
-            if (module->module->table_segments[elem_idx].is_dropped) {
+            if (module->elem_dropped[elem_idx]) {
                 wasm_set_exception(module, "out of bounds table access");
                 goto got_exception;
             }
@@ -2729,7 +2887,7 @@ recover_br_info:
             uint32 elem_idx = read_uint32(frame_ip);
             bh_assert(elem_idx < module->module->table_seg_count);
 
-            module->module->table_segments[elem_idx].is_dropped = true;
+            module->elem_dropped[elem_idx] = true;
             break;
         }
         case WASM_OP_TABLE_COPY:
@@ -3257,6 +3415,9 @@ recover_br_info:
     HANDLE_OP (EXT_OP_BLOCK):
     HANDLE_OP (EXT_OP_LOOP):
     HANDLE_OP (EXT_OP_IF):
+#if WASM_ENABLE_OPCODE_COUNTER == 0
+    HANDLE_OP (EXT_OP_BLOCK_COUNT):
+#endif
     {
       wasm_set_exception(module, "unsupported opcode");
       goto got_exception;
@@ -3357,17 +3518,31 @@ recover_br_info:
           prev_frame = frame->prev_frame;
           cur_func = frame->function;
           UPDATE_ALL_FROM_FRAME();
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+          instr_counter = &cur_func->u.func->instr_count;
+#endif
 
           /* update memory instance ptr and memory size */
           memory = module->default_memory;
           if (memory)
-              linear_mem_size = num_bytes_per_page * memory->cur_page_count;
+              linear_mem_size = (mem_offset_t)num_bytes_per_page
+                                * memory->cur_page_count;
           if (wasm_get_exception(module))
               goto got_exception;
+#if WASM_ENABLE_BASELINE_JIT != 0
+          if (cur_func->u.func->jit_code
+              && (jit_native_addr = wasm_jit_baseline_get_resume_addr(
+                      cur_func->u.func, frame_ip)))
+              goto call_jit_code;
+#endif
       }
       else {
         WASMFunction *cur_wasm_func = cur_func->u.func;
 
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+        cur_wasm_func->call_count++;
+        instr_counter = &cur_wasm_func->instr_count;
+#endif
         all_cell_num = (uint64)cur_func->param_cell_num
                        + (uint64)cur_func->local_cell_num
                        + (uint64)cur_func->const_cell_num
@@ -3399,6 +3574,12 @@ recover_br_info:
                (uint32)(cur_func->local_cell_num * 4));
 
         wasm_exec_env_set_cur_frame(exec_env, (WASMRuntimeFrame*)frame);
+#if WASM_ENABLE_BASELINE_JIT != 0
+        if (cur_wasm_func->jit_code) {
+          jit_native_addr = cur_wasm_func->jit_entry;
+          goto call_jit_code;
+        }
+#endif
       }
       HANDLE_OP_END ();
     }
@@ -3413,8 +3594,33 @@ recover_br_info:
         return;
 
       RECOVER_CONTEXT(prev_frame);
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+      instr_counter = &cur_func->u.func->instr_count;
+#endif
+#if WASM_ENABLE_BASELINE_JIT != 0
+      if (cur_func->u.func->jit_code
+          && (jit_native_addr = wasm_jit_baseline_get_resume_addr(
+                  cur_func->u.func, frame_ip)))
+        goto call_jit_code;
+#endif
+      HANDLE_OP_END ();
+    }
+
+#if WASM_ENABLE_BASELINE_JIT != 0
+  call_jit_code:
+    {
+      /* Run the native code until it hands over at frame_ip */
+      frame_ip = ((WASMJitCode)cur_func->u.func->jit_code)(
+                    frame_lp, module, exec_env, jit_native_addr);
+
+      /* update memory instance ptr and memory size */
+      memory = module->default_memory;
+      if (memory)
+        linear_mem_size = (mem_offset_t)num_bytes_per_page
+                          * memory->cur_page_count;
       HANDLE_OP_END ();
     }
+#endif
 
   (void)frame_ip_end;
 
@@ -3527,7 +3733,4 @@ wasm_interp_call_wasm(WASMModuleInstance *module_inst,
 
     wasm_exec_env_set_cur_frame(exec_env, prev_frame);
     FREE_FRAME(exec_env, frame);
-#if WASM_ENABLE_OPCODE_COUNTER != 0
-    wasm_interp_dump_op_count();
-#endif
 }
@@ -0,0 +1,2326 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "wasm_jit_baseline.h"
+#include "wasm_runtime.h"
+#include "wasm_opcode.h"
+#include "bh_log.h"
+#include "../common/wasm_exec_env.h"
+#if WASM_ENABLE_LINUX_PERF != 0
+#include "../common/wasm_linux_perf.h"
+#endif
+
+/*
+ * A single-pass compiler that translates the pre-compiled code of the
+ * fast interpreter into x86-64 machine code.
+ *
+ * The operands stay in the slots of the interpreter frame, addressed by
+ * the offsets that the loader has assigned, so the native code can hand
+ * over to the interpreter at any opcode: it returns the ip of the opcode
+ * and the interpreter continues from there. Calls and returns are always
+ * handed over, the interpreter re-enters the native code at the resume
+ * point after the call returns. Opcodes that trap are re-run by the
+ * interpreter, which raises the exception.
+ *
+ * Registers kept in the native code of a function:
+ *   rbx: frame_lp
+ *   rbp: exec_env
+ *   r12: base address of the default memory
+ *   r13: size of the default memory in bytes
+ *   r14: global data of the module instance
+ *   r15: module instance
+ */
+
+#if WASM_ENABLE_LABELS_AS_VALUES != 0
+void **
+wasm_interp_get_handle_table();
+#endif
+
+enum {
+    REG_RAX = 0, REG_RCX, REG_RDX, REG_RBX,
+    REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+    REG_R8, REG_R9, REG_R10, REG_R11,
+    REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+/* Condition codes of jcc, setcc and cmovcc */
+enum {
+    CC_ALWAYS = -1,
+    CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5,
+    CC_BE = 0x6, CC_A = 0x7, CC_P = 0xA, CC_NP = 0xB,
+    CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF
+};
+
+#define NO_INDEX -1
+
+/* Displacement of a slot of the interpreter frame from frame_lp */
+#define SLOT(offset) ((int32)(offset) * (int32)sizeof(uint32))
+
+/* Max number of values copied through registers, more are copied
+   by calling jit_copy_values */
+#define MAX_REG_COPY_COUNT 9
+
+/* Id of the opcodes of the misc prefix passed to jit_numeric_op */
+#define MISC_OPCODE(opcode) (0xFC00 | (opcode))
+
+typedef struct JitPatch {
+    /* Offset of the rel32 field in the native code of the function */
+    uint32 native_offset;
+    union {
+        /* Offset of the branch target in the pre-compiled code */
+        uint32 target;
+        /* The ip for the interpreter to continue at */
+        uint8 *ip;
+    } u;
+} JitPatch;
+
+#if WASM_ENABLE_LABELS_AS_VALUES != 0
+typedef struct JitLabel {
+    void *addr;
+    uint8 opcode;
+} JitLabel;
+#endif
+
+typedef struct JitBrInfo {
+    uint32 arity;
+    uint8 *cells;
+    int16 *src_offsets;
+    uint16 *dst_offsets;
+    uint8 *target;
+} JitBrInfo;
+
+typedef struct JitCompContext {
+    WASMModule *module;
+    WASMFunction *func;
+    /* The pre-compiled code of the function */
+    uint8 *code;
+    uint32 code_size;
+
+    /* The native code of all the functions */
+    uint8 *buf;
+    uint32 buf_size;
+    uint32 buf_capacity;
+    /* Start of the native code of the function in buf */
+    uint32 func_start;
+    /* Offsets of the epilogue and the body, relative to func_start */
+    uint32 epilogue;
+
+    /* Native offset of each opcode of the pre-compiled code, relative
+       to func_start, -1 if the opcode isn't translated yet */
+    int32 *native_offsets;
+
+    /* Offsets of the pre-compiled code to translate */
+    uint32 *worklist;
+    uint32 worklist_count;
+    uint32 worklist_capacity;
+
+    JitPatch *branch_patches;
+    uint32 branch_patch_count;
+    uint32 branch_patch_capacity;
+
+    JitPatch *exit_patches;
+    uint32 exit_patch_count;
+    uint32 exit_patch_capacity;
+
+    /* Offsets of the pre-compiled code following the calls */
+    uint32 *resume_offsets;
+    uint32 resume_count;
+    uint32 resume_capacity;
+
+    /* Offset of each global in the global data of the instance,
+       UINT32_MAX if it isn't accessible from the native code */
+    uint32 *global_data_offsets;
+
+#if WASM_ENABLE_LABELS_AS_VALUES != 0
+    /* Labels of the interpreter sorted by address */
+    JitLabel labels[256];
+#endif
+
+    /* The function uses an opcode that isn't supported */
+    bool unsupported;
+    bool oom;
+} JitCompContext;
+
+static void
+set_error_buf(char *error_buf, uint32 error_buf_size, const char *string)
+{
+    if (error_buf != NULL) {
+        snprintf(error_buf, error_buf_size,
+                 "WASM module load failed: %s", string);
+    }
+}
+
+static bool
+jit_array_reserve(void **p_data, uint32 *p_capacity,
+                  uint32 count, uint32 elem_size)
+{
+    uint32 capacity = *p_capacity;
+    uint64 size;
+    void *data;
+
+    if (count < capacity)
+        return true;
+
+    capacity = capacity ? capacity : 64;
+    while (capacity <= count)
+        capacity *= 2;
+
+    size = (uint64)capacity * elem_size;
+    if (size >= UINT32_MAX)
+        return false;
+
+    data = *p_data ? wasm_runtime_realloc(*p_data, (uint32)size)
+                   : wasm_runtime_malloc((uint32)size);
+    if (!data)
+        return false;
+
+    *p_data = data;
+    *p_capacity = capacity;
+    return true;
+}
+
+#define ARRAY_PUSH(ctx, array, count, capacity, value) do {             \
+    if (!jit_array_reserve((void **)&ctx->array, &ctx->capacity,        \
+                           ctx->count, sizeof(ctx->array[0]))) {        \
+        ctx->oom = true;                                                \
+        break;                                                          \
+    }                                                                   \
+    ctx->array[ctx->count++] = value;                                   \
+  } while (0)
+
+/* Helpers called by the native code */
+
+static inline double
+wa_fmax(double a, double b)
+{
+    double c = fmax(a, b);
+    if (c==0 && a==b)
+        return signbit(a) ? b : a;
+    return c;
+}
+
+static inline double
+wa_fmin(double a, double b)
+{
+    double c = fmin(a, b);
+    if (c==0 && a==b)
+        return signbit(a) ? a : b;
+    return c;
+}
+
+static inline uint32
+popcount64(uint64 u)
+{
+    uint32 ret = 0;
+    while (u) {
+        u = (u & (u - 1));
+        ret++;
+    }
+    return ret;
+}
+
+static bool
+jit_trunc(uint32 *frame_lp, int32 dst, float64 src_value,
+          float64 src_min, float64 src_max,
+          bool saturating, bool is_i32, bool is_sign)
+{
+    uint64 dst_value = 0;
+
+    if (isnan(src_value)) {
+        if (!saturating)
+            return false;
+    }
+    else if (src_value <= src_min) {
+        if (!saturating)
+            return false;
+        dst_value = is_sign ? (is_i32 ? (uint64)INT32_MIN : (uint64)INT64_MIN)
+                            : 0;
+    }
+    else if (src_value >= src_max) {
+        if (!saturating)
+            return false;
+        dst_value = is_sign ? (is_i32 ? (uint64)INT32_MAX : (uint64)INT64_MAX)
+                            : (is_i32 ? (uint64)UINT32_MAX : UINT64_MAX);
+    }
+    else if (is_i32) {
+        dst_value = is_sign ? (uint64)(uint32)(int32)src_value
+                            : (uint64)(uint32)src_value;
+    }
+    else {
+        dst_value = is_sign ? (uint64)(int64)src_value : (uint64)src_value;
+    }
+
+    if (is_i32)
+        frame_lp[dst] = (uint32)dst_value;
+    else
+        PUT_I64_TO_ADDR(frame_lp + dst, dst_value);
+    return true;
+}
+
+#define F32_OPERAND(offset) (*(float32 *)(frame_lp + (offset)))
+#define F64_OPERAND(offset) GET_F64_FROM_ADDR(frame_lp + (offset))
+
+#define TRUNC_F32(min, max, saturating, is_i32, is_sign)                \
+    jit_trunc(frame_lp, dst, (float64)F32_OPERAND(src1),                \
+              (float64)min, (float64)max, saturating, is_i32, is_sign)
+#define TRUNC_F64(min, max, saturating, is_i32, is_sign)                \
+    jit_trunc(frame_lp, dst, F64_OPERAND(src1),                         \
+              min, max, saturating, is_i32, is_sign)
+
+/* The numeric opcodes that aren't worth emitting inline, returns false
+   if the opcode traps */
+static bool
+jit_numeric_op(uint32 *frame_lp, uint32 opcode,
+               int32 src1, int32 src2, int32 dst)
+{
+    float64 a, b;
+
+    switch (opcode) {
+        case WASM_OP_I32_POPCNT:
+            frame_lp[dst] = popcount64(frame_lp[src1]);
+            break;
+        case WASM_OP_I64_POPCNT:
+            PUT_I64_TO_ADDR(frame_lp + dst, (uint64)popcount64(
+                              GET_I64_FROM_ADDR(frame_lp + src1)));
+            break;
+
+        case WASM_OP_F32_CEIL:
+            F32_OPERAND(dst) = (float32)ceil(F32_OPERAND(src1));
+            break;
+        case WASM_OP_F32_FLOOR:
+            F32_OPERAND(dst) = (float32)floor(F32_OPERAND(src1));
+            break;
+        case WASM_OP_F32_TRUNC:
+            F32_OPERAND(dst) = (float32)trunc(F32_OPERAND(src1));
+            break;
+        case WASM_OP_F32_NEAREST:
+            F32_OPERAND(dst) = (float32)rint(F32_OPERAND(src1));
+            break;
+        case WASM_OP_F64_CEIL:
+            PUT_F64_TO_ADDR(frame_lp + dst, ceil(F64_OPERAND(src1)));
+            break;
+        case WASM_OP_F64_FLOOR:
+            PUT_F64_TO_ADDR(frame_lp + dst, floor(F64_OPERAND(src1)));
+            break;
+        case WASM_OP_F64_TRUNC:
+            PUT_F64_TO_ADDR(frame_lp + dst, trunc(F64_OPERAND(src1)));
+            break;
+        case WASM_OP_F64_NEAREST:
+            PUT_F64_TO_ADDR(frame_lp + dst, rint(F64_OPERAND(src1)));
+            break;
+
+        case WASM_OP_F32_MIN:
+        case WASM_OP_F32_MAX:
+            b = F32_OPERAND(src1);
+            a = F32_OPERAND(src2);
+            if (isnan(a))
+                F32_OPERAND(dst) = (float32)a;
+            else if (isnan(b))
+                F32_OPERAND(dst) = (float32)b;
+            else if (opcode == WASM_OP_F32_MIN)
+                F32_OPERAND(dst) = (float32)wa_fmin(a, b);
+            else
+                F32_OPERAND(dst) = (float32)wa_fmax(a, b);
+            break;
+        case WASM_OP_F64_MIN:
+        case WASM_OP_F64_MAX:
+            b = F64_OPERAND(src1);
+            a = F64_OPERAND(src2);
+            if (isnan(a))
+                PUT_F64_TO_ADDR(frame_lp + dst, a);
+            else if (isnan(b))
+                PUT_F64_TO_ADDR(frame_lp + dst, b);
+            else if (opcode == WASM_OP_F64_MIN)
+                PUT_F64_TO_ADDR(frame_lp + dst, wa_fmin(a, b));
+            else
+                PUT_F64_TO_ADDR(frame_lp + dst, wa_fmax(a, b));
+            break;
+
+        case WASM_OP_F32_CONVERT_U_I64:
+            F32_OPERAND(dst) =
+                (float32)(uint64)GET_I64_FROM_ADDR(frame_lp + src1);
+            break;
+        case WASM_OP_F64_CONVERT_U_I64:
+            PUT_F64_TO_ADDR(frame_lp + dst,
+                (float64)(uint64)GET_I64_FROM_ADDR(frame_lp + src1));
+            break;
+
+        case WASM_OP_I32_TRUNC_S_F32:
+            return TRUNC_F32(-2147483904.0f, 2147483648.0f,
+                             false, true, true);
+        case WASM_OP_I32_TRUNC_U_F32:
+            return TRUNC_F32(-1.0f, 4294967296.0f, false, true, false);
+        case WASM_OP_I32_TRUNC_S_F64:
+            return TRUNC_F64(-2147483649.0, 2147483648.0, false, true, true);
+        case WASM_OP_I32_TRUNC_U_F64:
+            return TRUNC_F64(-1.0, 4294967296.0, false, true, false);
+        case WASM_OP_I64_TRUNC_S_F32:
+            return TRUNC_F32(-9223373136366403584.0f, 9223372036854775808.0f,
+                             false, false, true);
+        case WASM_OP_I64_TRUNC_U_F32:
+            return TRUNC_F32(-1.0f, 18446744073709551616.0f,
+                             false, false, false);
+        case WASM_OP_I64_TRUNC_S_F64:
+            return TRUNC_F64(-9223372036854777856.0, 9223372036854775808.0,
+                             false, false, true);
+        case WASM_OP_I64_TRUNC_U_F64:
+            return TRUNC_F64(-1.0, 18446744073709551616.0,
+                             false, false, false);
+
+        case MISC_OPCODE(WASM_OP_I32_TRUNC_SAT_S_F32):
+            return TRUNC_F32(-2147483904.0f, 2147483648.0f,
+                             true, true, true);
+        case MISC_OPCODE(WASM_OP_I32_TRUNC_SAT_U_F32):
+            return TRUNC_F32(-1.0f, 4294967296.0f, true, true, false);
+        case MISC_OPCODE(WASM_OP_I32_TRUNC_SAT_S_F64):
+            return TRUNC_F64(-2147483649.0, 2147483648.0, true, true, true);
+        case MISC_OPCODE(WASM_OP_I32_TRUNC_SAT_U_F64):
+            return TRUNC_F64(-1.0, 4294967296.0, true, true, false);
+        case MISC_OPCODE(WASM_OP_I64_TRUNC_SAT_S_F32):
+            return TRUNC_F32(-9223373136366403584.0f, 9223372036854775808.0f,
+                             true, false, true);
+        case MISC_OPCODE(WASM_OP_I64_TRUNC_SAT_U_F32):
+            return TRUNC_F32(-1.0f, 18446744073709551616.0f,
+                             true, false, false);
+        case MISC_OPCODE(WASM_OP_I64_TRUNC_SAT_S_F64):
+            return TRUNC_F64(-9223372036854777856.0, 9223372036854775808.0,
+                             true, false, true);
+        case MISC_OPCODE(WASM_OP_I64_TRUNC_SAT_U_F64):
+            return TRUNC_F64(-1.0, 18446744073709551616.0,
+                             true, false, false);
+
+        default:
+            bh_assert(0);
+            return false;
+    }
+    return true;
+}
+
+static bool
+jit_copy_values(uint32 *frame_lp, uint32 arity, const uint8 *cells,
+                const int16 *src_offsets, const uint16 *dst_offsets)
+{
+    /* Copy the values to a tmp buf first to avoid the overlap issue
+       between the src offsets and the dst offsets */
+    uint32 buf[16], *tmp_buf = buf, total_cell_num = 0, buf_index, i;
+    uint64 total_size;
+
+    for (i = 0; i < arity; i++)
+        total_cell_num += cells[i];
+
+    if (total_cell_num > sizeof(buf) / sizeof(uint32)) {
+        total_size = sizeof(uint32) * (uint64)total_cell_num;
+        if (total_size >= UINT32_MAX
+            || !(tmp_buf = wasm_runtime_malloc((uint32)total_size)))
+            return false;
+    }
+
+    for (i = 0, buf_index = 0; i < arity; i++) {
+        tmp_buf[buf_index] = frame_lp[src_offsets[i]];
+        if (cells[i] == 2)
+            tmp_buf[buf_index + 1] = frame_lp[src_offsets[i] + 1];
+        buf_index += cells[i];
+    }
+
+    for (i = 0, buf_index = 0; i < arity; i++) {
+        frame_lp[dst_offsets[i]] = tmp_buf[buf_index];
+        if (cells[i] == 2)
+            frame_lp[dst_offsets[i] + 1] = tmp_buf[buf_index + 1];
+        buf_index += cells[i];
+    }
+
+    if (tmp_buf != buf)
+        wasm_runtime_free(tmp_buf);
+    return true;
+}
+
+static uint32
+jit_memory_grow(WASMModuleInstance *module_inst, uint32 delta)
+{
+    uint32 prev_page_count = module_inst->default_memory->cur_page_count;
+
+    /* return previous page count or -1 if failed */
+    return wasm_enlarge_memory(module_inst, delta)
+           ? prev_page_count : (uint32)-1;
+}
+
+#if WASM_ENABLE_BULK_MEMORY != 0
+static bool
+jit_memory_copy(WASMModuleInstance *module_inst,
+                uint32 dst, uint32 src, uint32 len)
+{
+    WASMMemoryInstance *memory = module_inst->default_memory;
+    uint64 linear_mem_size =
+        (uint64)memory->num_bytes_per_page * memory->cur_page_count;
+
+    if ((uint64)src + len > linear_mem_size
+        || (uint64)dst + len > linear_mem_size)
+        return false;
+
+    /* allowing the destination and source to overlap */
+    bh_memmove_s(memory->memory_data + dst, (uint32)(linear_mem_size - dst),
+                 memory->memory_data + src, len);
+    return true;
+}
+
+static bool
+jit_memory_fill(WASMModuleInstance *module_inst,
+                uint32 dst, uint32 val, uint32 len)
+{
+    WASMMemoryInstance *memory = module_inst->default_memory;
+    uint64 linear_mem_size =
+        (uint64)memory->num_bytes_per_page * memory->cur_page_count;
+
+    if ((uint64)dst + len > linear_mem_size)
+        return false;
+
+    memset(memory->memory_data + dst, (uint8)val, len);
+    return true;
+}
+#endif /* end of WASM_ENABLE_BULK_MEMORY */
+
+/* Machine code emission */
+
+static inline uint32
+cur_offset(const JitCompContext *ctx)
+{
+    return ctx->buf_size - ctx->func_start;
+}
+
+static void
+emit_byte(JitCompContext *ctx, uint8 byte)
+{
+    if (ctx->buf_size >= ctx->buf_capacity
+        && !jit_array_reserve((void **)&ctx->buf, &ctx->buf_capacity,
+                              ctx->buf_size, 1)) {
+        ctx->oom = true;
+        return;
+    }
+    ctx->buf[ctx->buf_size++] = byte;
+}
+
+static void
+emit_u32(JitCompContext *ctx, uint32 value)
+{
+    uint32 i;
+    for (i = 0; i < 4; i++)
+        emit_byte(ctx, (uint8)(value >> (i * 8)));
+}
+
+static void
+emit_u64(JitCompContext *ctx, uint64 value)
+{
+    emit_u32(ctx, (uint32)value);
+    emit_u32(ctx, (uint32)(value >> 32));
+}
+
+/* Emit the mandatory prefix, the REX prefix and the 1 to 3 bytes of
+   opcode, the first byte of the opcode is in the highest byte */
+static void
+emit_opcode(JitCompContext *ctx, uint8 prefix, uint8 rex, uint32 opcode)
+{
+    if (prefix)
+        emit_byte(ctx, prefix);
+    if (rex != 0x40)
+        emit_byte(ctx, rex);
+    if (opcode > 0xFFFF)
+        emit_byte(ctx, (uint8)(opcode >> 16));
+    if (opcode > 0xFF)
+        emit_byte(ctx, (uint8)(opcode >> 8));
+    emit_byte(ctx, (uint8)opcode);
+}
+
+/* op reg, [base + index * (1 << scale) + disp] */
+static void
+emit_mem(JitCompContext *ctx, uint8 prefix, bool w, uint32 opcode,
+         uint32 reg, uint32 base, int32 index, uint32 scale, int32 disp)
+{
+    uint8 rex = 0x40 | (w ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0)
+                | ((index != NO_INDEX && (index & 8)) ? 0x02 : 0)
+                | ((base & 8) ? 0x01 : 0);
+    uint8 mod;
+
+    emit_opcode(ctx, prefix, rex, opcode);
+
+    if (disp == 0 && (base & 7) != REG_RBP)
+        mod = 0;
+    else if (disp >= INT8_MIN && disp <= INT8_MAX)
+        mod = 1;
+    else
+        mod = 2;
+
+    if (index != NO_INDEX || (base & 7) == REG_RSP) {
+        emit_byte(ctx, (uint8)((mod << 6) | ((reg & 7) << 3) | 4));
+        emit_byte(ctx, (uint8)((scale << 6)
+                               | ((index != NO_INDEX ? index & 7 : 4) << 3)
+                               | (base & 7)));
+    }
+    else {
+        emit_byte(ctx, (uint8)((mod << 6) | ((reg & 7) << 3) | (base & 7)));
+    }
+
+    if (mod == 1)
+        emit_byte(ctx, (uint8)disp);
+    else if (mod == 2)
+        emit_u32(ctx, (uint32)disp);
+}
+
+/* op reg, rm */
+static void
+emit_reg(JitCompContext *ctx, uint8 prefix, bool w, uint32 opcode,
+         uint32 reg, uint32 rm)
+{
+    uint8 rex = 0x40 | (w ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0)
+                | ((rm & 8) ? 0x01 : 0);
+
+    emit_opcode(ctx, prefix, rex, opcode);
+    emit_byte(ctx, (uint8)(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+/* op reg, [frame_lp + offset * 4] */
+static void
+emit_slot(JitCompContext *ctx, uint8 prefix, bool w, uint32 opcode,
+          uint32 reg, int32 offset)
+{
+    emit_mem(ctx, prefix, w, opcode, reg, REG_RBX, NO_INDEX, 0, SLOT(offset));
+}
+
+static void
+emit_load(JitCompContext *ctx, bool w, uint32 reg, int32 offset)
+{
+    emit_slot(ctx, 0, w, 0x8B, reg, offset);
+}
+
+static void
+emit_store(JitCompContext *ctx, bool w, uint32 reg, int32 offset)
+{
+    emit_slot(ctx, 0, w, 0x89, reg, offset);
+}
+
+static void
+emit_mov_imm32(JitCompContext *ctx, uint32 reg, uint32 imm)
+{
+    if (reg & 8)
+        emit_byte(ctx, 0x41);
+    emit_byte(ctx, (uint8)(0xB8 + (reg & 7)));
+    emit_u32(ctx, imm);
+}
+
+static void
+emit_mov_imm64(JitCompContext *ctx, uint32 reg, uint64 imm)
+{
+    emit_byte(ctx, (reg & 8) ? 0x49 : 0x48);
+    emit_byte(ctx, (uint8)(0xB8 + (reg & 7)));
+    emit_u64(ctx, imm);
+}
+
+static void
+emit_call(JitCompContext *ctx, void *func)
+{
+    /* mov rax, func; call rax */
+    emit_mov_imm64(ctx, REG_RAX, (uint64)(uintptr_t)func);
+    emit_byte(ctx, 0xFF);
+    emit_byte(ctx, 0xD0);
+}
+
+/* Emit jmp or jcc with a rel32 to patch, returns the offset of
+   the rel32 field */
+static uint32
+emit_jcc(JitCompContext *ctx, int32 cc)
+{
+    if (cc == CC_ALWAYS) {
+        emit_byte(ctx, 0xE9);
+    }
+    else {
+        emit_byte(ctx, 0x0F);
+        emit_byte(ctx, (uint8)(0x80 + cc));
+    }
+    emit_u32(ctx, 0);
+    return cur_offset(ctx) - sizeof(uint32);
+}
+
+static void
+patch_u32(JitCompContext *ctx, uint32 field, uint32 value)
+{
+    uint8 *p = ctx->buf + ctx->func_start + field;
+
+    if (ctx->oom)
+        return;
+    p[0] = (uint8)value;
+    p[1] = (uint8)(value >> 8);
+    p[2] = (uint8)(value >> 16);
+    p[3] = (uint8)(value >> 24);
+}
+
+static void
+patch_rel32(JitCompContext *ctx, uint32 field, uint32 target)
+{
+    patch_u32(ctx, field, target - (field + (uint32)sizeof(uint32)));
+}
+
+static void
+emit_exit(JitCompContext *ctx, uint8 *ip)
+{
+    emit_mov_imm64(ctx, REG_RAX, (uint64)(uintptr_t)ip);
+    patch_rel32(ctx, emit_jcc(ctx, CC_ALWAYS), ctx->epilogue);
+}
+
+/* Hand over to the interpreter at ip if the condition is met, the
+   exit stubs are emitted after the function body */
+static void
+emit_exit_if(JitCompContext *ctx, int32 cc, uint8 *ip)
+{
+    JitPatch patch;
+
+    patch.native_offset = emit_jcc(ctx, cc);
+    patch.u.ip = ip;
+    ARRAY_PUSH(ctx, exit_patches, exit_patch_count, exit_patch_capacity,
+               patch);
+}
+
+static void
+emit_branch(JitCompContext *ctx, int32 cc, uint8 *target_ip)
+{
+    JitPatch patch;
+    uint32 target = (uint32)(target_ip - ctx->code);
+
+    if (target_ip < ctx->code || target >= ctx->code_size) {
+        ctx->unsupported = true;
+        return;
+    }
+
+    patch.native_offset = emit_jcc(ctx, cc);
+    if (ctx->native_offsets[target] >= 0) {
+        patch_rel32(ctx, patch.native_offset,
+                    (uint32)ctx->native_offsets[target]);
+    }
+    else {
+        patch.u.target = target;
+        ARRAY_PUSH(ctx, branch_patches, branch_patch_count,
+                   branch_patch_capacity, patch);
+        ARRAY_PUSH(ctx, worklist, worklist_count, worklist_capacity, target);
+    }
+}
+
+/* Load the base address and the size of the default memory */
+static void
+emit_load_memory(JitCompContext *ctx)
+{
+    uint32 skip;
+
+    /* xor r13d, r13d; mov rax, module_inst->default_memory */
+    emit_reg(ctx, 0, false, 0x33, REG_R13, REG_R13);
+    emit_mem(ctx, 0, true, 0x8B, REG_RAX, REG_R15, NO_INDEX, 0,
+             offsetof(WASMModuleInstance, default_memory));
+    /* test rax, rax; jz skip */
+    emit_reg(ctx, 0, true, 0x85, REG_RAX, REG_RAX);
+    skip = emit_jcc(ctx, CC_E);
+    emit_mem(ctx, 0, true, 0x8B, REG_R12, REG_RAX, NO_INDEX, 0,
+             offsetof(WASMMemoryInstance, memory_data));
+    emit_mem(ctx, 0, false, 0x8B, REG_R13, REG_RAX, NO_INDEX, 0,
+             offsetof(WASMMemoryInstance, cur_page_count));
+    emit_mem(ctx, 0, false, 0x8B, REG_RDX, REG_RAX, NO_INDEX, 0,
+             offsetof(WASMMemoryInstance, num_bytes_per_page));
+    /* imul r13, rdx */
+    emit_reg(ctx, 0, true, 0x0FAF, REG_R13, REG_RDX);
+    patch_rel32(ctx, skip, cur_offset(ctx));
+}
+
+/* The prologue saves the callee-saved registers, loads the pinned
+   registers and jumps to the native address given, the epilogue
+   restores the registers and returns the ip in rax */
+static void
+emit_prologue_epilogue(JitCompContext *ctx)
+{
+    static const uint8 prologue[] = {
+        0x55,                   /* push rbp */
+        0x53,                   /* push rbx */
+        0x41, 0x54,             /* push r12 */
+        0x41, 0x55,             /* push r13 */
+        0x41, 0x56,             /* push r14 */
+        0x41, 0x57,             /* push r15 */
+        0x48, 0x83, 0xEC, 0x08, /* sub rsp, 8 */
+    };
+    static const uint8 epilogue[] = {
+        0x48, 0x83, 0xC4, 0x08, /* add rsp, 8 */
+        0x41, 0x5F,             /* pop r15 */
+        0x41, 0x5E,             /* pop r14 */
+        0x41, 0x5D,             /* pop r13 */
+        0x41, 0x5C,             /* pop r12 */
+        0x5B,                   /* pop rbx */
+        0x5D,                   /* pop rbp */
+        0xC3,                   /* ret */
+    };
+    uint32 i;
+
+    for (i = 0; i < sizeof(prologue); i++)
+        emit_byte(ctx, prologue[i]);
+
+    /* mov rbx, rdi; mov r15, rsi; mov rbp, rdx */
+    emit_reg(ctx, 0, true, 0x89, REG_RDI, REG_RBX);
+    emit_reg(ctx, 0, true, 0x89, REG_RSI, REG_R15);
+    emit_reg(ctx, 0, true, 0x89, REG_RDX, REG_RBP);
+    emit_mem(ctx, 0, true, 0x8B, REG_R14, REG_R15, NO_INDEX, 0,
+             offsetof(WASMModuleInstance, global_data));
+    emit_load_memory(ctx);
+    /* jmp rcx */
+    emit_byte(ctx, 0xFF);
+    emit_byte(ctx, 0xE1);
+
+    ctx->epilogue = cur_offset(ctx);
+    for (i = 0; i < sizeof(epilogue); i++)
+        emit_byte(ctx, epilogue[i]);
+}
+
+#if WASM_ENABLE_THREAD_MGR != 0
+static void
+emit_check_suspend(JitCompContext *ctx, uint8 *ip)
+{
+    /* Let the interpreter terminate the thread:
+       test dword [exec_env->suspend_flags], 1; jnz exit */
+    emit_mem(ctx, 0, false, 0xF7, 0, REG_RBP, NO_INDEX, 0,
+             offsetof(WASMExecEnv, suspend_flags));
+    emit_u32(ctx, 1);
+    emit_exit_if(ctx, CC_NE, ip);
+}
+#endif
+
+static void
+emit_copy_values(JitCompContext *ctx, uint32 arity, uint8 *cells,
+                 int16 *src_offsets, uint16 *dst_offsets, uint8 *ip)
+{
+    static const uint8 regs[MAX_REG_COPY_COUNT] = {
+        REG_RAX, REG_RCX, REG_RDX, REG_RSI, REG_RDI,
+        REG_R8, REG_R9, REG_R10, REG_R11
+    };
+    uint32 i;
+
+    if (arity <= MAX_REG_COPY_COUNT) {
+        for (i = 0; i < arity; i++)
+            emit_load(ctx, cells[i] == 2, regs[i], src_offsets[i]);
+        for (i = 0; i < arity; i++)
+            emit_store(ctx, cells[i] == 2, regs[i], dst_offsets[i]);
+        return;
+    }
+
+    emit_reg(ctx, 0, true, 0x89, REG_RBX, REG_RDI);
+    emit_mov_imm32(ctx, REG_RSI, arity);
+    emit_mov_imm64(ctx, REG_RDX, (uint64)(uintptr_t)cells);
+    emit_mov_imm64(ctx, REG_RCX, (uint64)(uintptr_t)src_offsets);
+    emit_mov_imm64(ctx, REG_R8, (uint64)(uintptr_t)dst_offsets);
+    emit_call(ctx, jit_copy_values);
+    /* test al, al; jz exit */
+    emit_byte(ctx, 0x84);
+    emit_byte(ctx, 0xC0);
+    emit_exit_if(ctx, CC_E, ip);
+}
+
+static void
+emit_br(JitCompContext *ctx, JitBrInfo *info, uint8 *ip,
+        bool check_suspend)
+{
+#if WASM_ENABLE_THREAD_MGR != 0
+    if (check_suspend)
+        emit_check_suspend(ctx, ip);
+#endif
+    (void)check_suspend;
+    if (info->arity)
+        emit_copy_values(ctx, info->arity, info->cells, info->src_offsets,
+                         info->dst_offsets, ip);
+    emit_branch(ctx, CC_ALWAYS, info->target);
+}
+
+/* Emit the numeric opcode with a call of jit_numeric_op, traps
+   are handed over to the interpreter at ip if it isn't NULL */
+static void
+emit_numeric_call(JitCompContext *ctx, uint32 opcode, int32 src1, int32 src2,
+                  int32 dst, uint8 *ip)
+{
+    emit_reg(ctx, 0, true, 0x89, REG_RBX, REG_RDI);
+    emit_mov_imm32(ctx, REG_RSI, opcode);
+    emit_mov_imm32(ctx, REG_RDX, (uint32)src1);
+    emit_mov_imm32(ctx, REG_RCX, (uint32)src2);
+    emit_mov_imm32(ctx, REG_R8, (uint32)dst);
+    emit_call(ctx, jit_numeric_op);
+    if (ip) {
+        emit_byte(ctx, 0x84);
+        emit_byte(ctx, 0xC0);
+        emit_exit_if(ctx, CC_E, ip);
+    }
+}
+
+/* rax = offset + addr, exits if offset + addr + bytes is out of the
+   default memory */
+static void
+emit_check_memory(JitCompContext *ctx, uint32 offset, int32 addr,
+                  uint32 bytes, uint8 *ip)
+{
+    emit_load(ctx, false, REG_RAX, addr);
+    if (offset <= INT32_MAX) {
+        if (offset) {
+            /* add rax, offset */
+            emit_reg(ctx, 0, true, 0x81, 0, REG_RAX);
+            emit_u32(ctx, offset);
+        }
+    }
+    else {
+        /* mov ecx, offset; add rax, rcx */
+        emit_mov_imm32(ctx, REG_RCX, offset);
+        emit_reg(ctx, 0, true, 0x01, REG_RCX, REG_RAX);
+    }
+    /* lea rcx, [rax + bytes]; cmp rcx, r13; ja exit */
+    emit_mem(ctx, 0, true, 0x8D, REG_RCX, REG_RAX, NO_INDEX, 0, (int32)bytes);
+    emit_reg(ctx, 0, true, 0x3B, REG_RCX, REG_R13);
+    emit_exit_if(ctx, CC_A, ip);
+}
+
+/* op reg, [memory_data + rax] */
+static void
+emit_memory_access(JitCompContext *ctx, uint8 prefix, bool w, uint32 opcode,
+                   uint32 reg)
+{
+    emit_mem(ctx, prefix, w, opcode, reg, REG_R12, REG_RAX, 0, 0);
+}
+
+static void
+emit_binary(JitCompContext *ctx, bool w, uint32 opcode,
+            int32 rhs, int32 lhs, int32 dst)
+{
+    emit_load(ctx, w, REG_RAX, lhs);
+    emit_slot(ctx, 0, w, opcode, REG_RAX, rhs);
+    emit_store(ctx, w, REG_RAX, dst);
+}
+
+static void
+emit_shift(JitCompContext *ctx, bool w, uint32 digit,
+           int32 rhs, int32 lhs, int32 dst)
+{
+    emit_load(ctx, w, REG_RAX, lhs);
+    emit_load(ctx, false, REG_RCX, rhs);
+    emit_reg(ctx, 0, w, 0xD3, digit, REG_RAX);
+    emit_store(ctx, w, REG_RAX, dst);
+}
+
+static void
+emit_compare(JitCompContext *ctx, bool w, int32 cc,
+             int32 rhs, int32 lhs, int32 dst)
+{
+    /* xor ecx, ecx; cmp lhs, rhs; setcc cl */
+    emit_reg(ctx, 0, false, 0x33, REG_RCX, REG_RCX);
+    emit_load(ctx, w, REG_RAX, lhs);
+    emit_slot(ctx, 0, w, 0x3B, REG_RAX, rhs);
+    emit_reg(ctx, 0, false, 0x0F90 + (uint32)cc, 0, REG_RCX);
+    emit_store(ctx, false, REG_RCX, dst);
+}
+
+static void
+emit_float_compare(JitCompContext *ctx, bool f64, uint32 opcode,
+                   int32 rhs, int32 lhs, int32 dst)
+{
+    uint8 prefix = f64 ? 0xF2 : 0xF3;
+    int32 a = lhs, b = rhs, cc;
+    bool swap = false;
+
+    switch (opcode) {
+        case WASM_OP_F32_LT: case WASM_OP_F64_LT:
+            cc = CC_A; swap = true; break;
+        case WASM_OP_F32_LE: case WASM_OP_F64_LE:
+            cc = CC_AE; swap = true; break;
+        case WASM_OP_F32_GT: case WASM_OP_F64_GT:
+            cc = CC_A; break;
+        case WASM_OP_F32_GE: case WASM_OP_F64_GE:
+            cc = CC_AE; break;
+        case WASM_OP_F32_EQ: case WASM_OP_F64_EQ:
+            cc = CC_E; break;
+        default:
+            cc = CC_NE; break;
+    }
+    if (swap) {
+        a = rhs;
+        b = lhs;
+    }
+
+    emit_reg(ctx, 0, false, 0x33, REG_RCX, REG_RCX);
+    emit_reg(ctx, 0, false, 0x33, REG_RDX, REG_RDX);
+    /* movss/movsd xmm0, a; ucomiss/ucomisd xmm0, b */
+    emit_slot(ctx, prefix, false, 0x0F10, 0, a);
+    emit_slot(ctx, f64 ? 0x66 : 0, false, 0x0F2E, 0, b);
+    emit_reg(ctx, 0, false, 0x0F90 + (uint32)cc, 0, REG_RCX);
+    /* The result of eq is false and the one of ne is true
+       if either operand is NaN */
+    if (cc == CC_E) {
+        emit_reg(ctx, 0, false, 0x0F90 + CC_NP, 0, REG_RDX);
+        emit_reg(ctx, 0, false, 0x23, REG_RCX, REG_RDX);
+    }
+    else if (cc == CC_NE) {
+        emit_reg(ctx, 0, false, 0x0F90 + CC_P, 0, REG_RDX);
+        emit_reg(ctx, 0, false, 0x0B, REG_RCX, REG_RDX);
+    }
+    emit_store(ctx, false, REG_RCX, dst);
+}
+
+static void
+emit_float_binary(JitCompContext *ctx, bool f64, uint32 opcode,
+                  int32 rhs, int32 lhs, int32 dst)
+{
+    uint8 prefix = f64 ? 0xF2 : 0xF3;
+
+    emit_slot(ctx, prefix, false, 0x0F10, 0, lhs);
+    emit_slot(ctx, prefix, false, opcode, 0, rhs);
+    emit_slot(ctx, prefix, false, 0x0F11, 0, dst);
+}
+
+static void
+emit_div_rem(JitCompContext *ctx, bool w, bool is_sign, bool is_rem,
+             int32 rhs, int32 lhs, int32 dst, uint8 *ip)
+{
+    uint32 skip = 0;
+
+    /* Exit if divided by zero */
+    emit_load(ctx, w, REG_RCX, rhs);
+    emit_reg(ctx, 0, w, 0x85, REG_RCX, REG_RCX);
+    emit_exit_if(ctx, CC_E, ip);
+    emit_load(ctx, w, REG_RAX, lhs);
+
+    if (!is_sign) {
+        emit_reg(ctx, 0, false, 0x33, REG_RDX, REG_RDX);
+        /* div rcx */
+        emit_reg(ctx, 0, w, 0xF7, 6, REG_RCX);
+        emit_store(ctx, w, is_rem ? REG_RDX : REG_RAX, dst);
+        return;
+    }
+
+    if (is_rem) {
+        /* The remainder of INT_MIN / -1 is 0 */
+        emit_reg(ctx, 0, false, 0x33, REG_RDX, REG_RDX);
+        /* cmp rcx, -1; je skip */
+        emit_reg(ctx, 0, w, 0x83, 7, REG_RCX);
+        emit_byte(ctx, 0xFF);
+        skip = emit_jcc(ctx, CC_E);
+    }
+    else {
+        uint32 not_minus_one;
+        /* Exit if INT_MIN / -1 overflows */
+        emit_reg(ctx, 0, w, 0x83, 7, REG_RCX);
+        emit_byte(ctx, 0xFF);
+        not_minus_one = emit_jcc(ctx, CC_NE);
+        if (w) {
+            emit_mov_imm64(ctx, REG_RDX, (uint64)INT64_MIN);
+            emit_reg(ctx, 0, true, 0x3B, REG_RAX, REG_RDX);
+        }
+        else {
+            /* cmp eax, INT32_MIN */
+            emit_reg(ctx, 0, false, 0x81, 7, REG_RAX);
+            emit_u32(ctx, (uint32)INT32_MIN);
+        }
+        emit_exit_if(ctx, CC_E, ip);
+        patch_rel32(ctx, not_minus_one, cur_offset(ctx));
+    }
+
+    /* cdq/cqo; idiv rcx */
+    if (w)
+        emit_byte(ctx, 0x48);
+    emit_byte(ctx, 0x99);
+    emit_reg(ctx, 0, w, 0xF7, 7, REG_RCX);
+
+    if (is_rem)
+        patch_rel32(ctx, skip, cur_offset(ctx));
+    emit_store(ctx, w, is_rem ? REG_RDX : REG_RAX, dst);
+}
+
+/* Translation of the pre-compiled code */
+
+#define READ_BYTE() (*ip++)
+#define READ_U32() (ip += sizeof(uint32), *(uint32 *)(ip - sizeof(uint32)))
+#define READ_OFFSET() (ip += sizeof(int16), *(int16 *)(ip - sizeof(int16)))
+#define READ_PTR() (ip += sizeof(void *), *(uint8 **)(ip - sizeof(void *)))
+
+static uint8 *
+read_br_info(uint8 *ip, JitBrInfo *info)
+{
+    info->arity = READ_U32();
+    if (info->arity) {
+        /* skip total cell num */
+        ip += sizeof(uint32);
+        info->cells = ip;
+        ip += info->arity;
+        info->src_offsets = (int16 *)ip;
+        ip += sizeof(int16) * info->arity;
+        info->dst_offsets = (uint16 *)ip;
+        ip += sizeof(uint16) * info->arity;
+    }
+    info->target = READ_PTR();
+    return ip;
+}
+
+static bool
+read_opcode(JitCompContext *ctx, uint8 **p_ip, uint8 *p_opcode)
+{
+#if WASM_ENABLE_LABELS_AS_VALUES != 0
+    uintptr_t label = (uintptr_t)*(void **)*p_ip;
+    int32 low = 0, high = 255, mid;
+
+    *p_ip += sizeof(void *);
+    while (low <= high) {
+        mid = (low + high) / 2;
+        if ((uintptr_t)ctx->labels[mid].addr == label) {
+            *p_opcode = ctx->labels[mid].opcode;
+            return true;
+        }
+        else if ((uintptr_t)ctx->labels[mid].addr < label)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+    return false;
+#else
+    (void)ctx;
+    *p_opcode = *(*p_ip)++;
+    return true;
+#endif
+}
+
+static uint8 *
+skip_call_operands(JitCompContext *ctx, uint8 *ip, WASMType *func_type,
+                   bool has_results)
+{
+    ip += sizeof(int16) * func_type->param_count;
+    if (has_results)
+        ip += sizeof(int16) * func_type->result_count;
+    (void)ctx;
+    return ip;
+}
+
+static bool
+get_global_data_offset(JitCompContext *ctx, uint32 global_idx,
+                       uint32 *p_offset)
+{
+    if (global_idx >= ctx->module->import_global_count
+                      + ctx->module->global_count
+        || ctx->global_data_offsets[global_idx] == UINT32_MAX) {
+        ctx->unsupported = true;
+        return false;
+    }
+    *p_offset = ctx->global_data_offsets[global_idx];
+    return true;
+}
+
+/* Translate the opcode at ip_start, returns false if the control
+   doesn't fall through to the next opcode */
+static bool
+translate_opcode(JitCompContext *ctx, uint8 opcode, uint8 *ip_start,
+                 uint8 **p_ip)
+{
+    WASMModule *module = ctx->module;
+    uint8 *ip = *p_ip;
+    JitBrInfo info;
+    WASMType *func_type;
+    uint32 idx, count, offset, i, field, table;
+    int32 a, b, c, d;
+    bool w;
+
+    switch (opcode) {
+        case WASM_OP_UNREACHABLE:
+        case WASM_OP_RETURN:
+            emit_exit(ctx, ip_start);
+            return false;
+
+        case WASM_OP_IF:
+        {
+            uint8 *else_addr, *end_addr;
+            a = READ_OFFSET();
+            else_addr = READ_PTR();
+            end_addr = READ_PTR();
+            /* cmp dword cond, 0 */
+            emit_slot(ctx, 0, false, 0x83, 7, a);
+            emit_byte(ctx, 0);
+            emit_branch(ctx, CC_E, else_addr ? else_addr : end_addr);
+            break;
+        }
+
+        case WASM_OP_ELSE:
+            emit_branch(ctx, CC_ALWAYS, READ_PTR());
+            return false;
+
+        case WASM_OP_BR:
+            ip = read_br_info(ip, &info);
+            emit_br(ctx, &info, ip_start, info.target <= ip_start);
+            return false;
+
+        case WASM_OP_BR_IF:
+        {
+            bool check_suspend;
+            a = READ_OFFSET();
+            ip = read_br_info(ip, &info);
+#if WASM_ENABLE_THREAD_MGR != 0
+            check_suspend = info.target <= ip_start;
+#else
+            check_suspend = false;
+#endif
+            emit_slot(ctx, 0, false, 0x83, 7, a);
+            emit_byte(ctx, 0);
+            if (!info.arity && !check_suspend) {
+                emit_branch(ctx, CC_NE, info.target);
+            }
+            else {
+                field = emit_jcc(ctx, CC_E);
+                emit_br(ctx, &info, ip_start, check_suspend);
+                patch_rel32(ctx, field, cur_offset(ctx));
+            }
+            break;
+        }
+
+        case WASM_OP_BR_TABLE:
+            count = READ_U32();
+            a = READ_OFFSET();
+#if WASM_ENABLE_THREAD_MGR != 0
+            emit_check_suspend(ctx, ip_start);
+#endif
+            /* eax = index < count ? index : count */
+            emit_load(ctx, false, REG_RAX, a);
+            emit_mov_imm32(ctx, REG_RCX, count);
+            emit_reg(ctx, 0, false, 0x3B, REG_RAX, REG_RCX);
+            emit_reg(ctx, 0, false, 0x0F40 + CC_AE, REG_RAX, REG_RCX);
+            /* lea rcx, [rip + table] */
+            emit_byte(ctx, 0x48);
+            emit_byte(ctx, 0x8D);
+            emit_byte(ctx, 0x0D);
+            emit_u32(ctx, 0);
+            field = cur_offset(ctx) - sizeof(uint32);
+            /* movsxd rax, [rcx + rax * 4]; add rax, rcx; jmp rax */
+            emit_mem(ctx, 0, true, 0x63, REG_RAX, REG_RCX, REG_RAX, 2, 0);
+            emit_reg(ctx, 0, true, 0x01, REG_RCX, REG_RAX);
+            emit_byte(ctx, 0xFF);
+            emit_byte(ctx, 0xE0);
+
+            /* The table holds the offsets of the br items from it */
+            table = cur_offset(ctx);
+            patch_rel32(ctx, field, table);
+            for (i = 0; i <= count; i++)
+                emit_u32(ctx, 0);
+            for (i = 0; i <= count && !ctx->oom; i++) {
+                patch_u32(ctx, table + i * sizeof(uint32),
+                          cur_offset(ctx) - table);
+                ip = read_br_info(ip, &info);
+                emit_br(ctx, &info, ip_start, false);
+            }
+            return false;
+
+        case WASM_OP_CALL:
+            idx = READ_U32();
+            if (idx < module->import_function_count)
+                func_type = module->import_functions[idx].u.function.func_type;
+            else
+                func_type =
+                    module->functions[idx - module->import_function_count]
+                        ->func_type;
+            ip = skip_call_operands(ctx, ip, func_type, true);
+            emit_exit(ctx, ip_start);
+            ARRAY_PUSH(ctx, resume_offsets, resume_count, resume_capacity,
+                       (uint32)(ip - ctx->code));
+            break;
+
+        case WASM_OP_CALL_INDIRECT:
+#if WASM_ENABLE_TAIL_CALL != 0
+        case WASM_OP_RETURN_CALL_INDIRECT:
+            opcode = READ_BYTE();
+#endif
+            idx = READ_U32();
+            /* skip table index and element index */
+            ip += sizeof(uint32) + sizeof(int16);
+            func_type = module->types[idx];
+            emit_exit(ctx, ip_start);
+            if (opcode == WASM_OP_RETURN_CALL_INDIRECT)
+                return false;
+            ip = skip_call_operands(ctx, ip, func_type, true);
+            ARRAY_PUSH(ctx, resume_offsets, resume_count, resume_capacity,
+                       (uint32)(ip - ctx->code));
+            break;
+
+#if WASM_ENABLE_TAIL_CALL != 0
+        case WASM_OP_RETURN_CALL:
+            emit_exit(ctx, ip_start);
+            return false;
+#endif
+
+        case WASM_OP_SELECT:
+        case WASM_OP_SELECT_64:
+            w = opcode == WASM_OP_SELECT_64;
+            a = READ_OFFSET();
+            b = READ_OFFSET();
+            c = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, w, REG_RAX, c);
+            emit_slot(ctx, 0, false, 0x83, 7, a);
+            emit_byte(ctx, 0);
+            emit_slot(ctx, 0, w, 0x0F40 + CC_E, REG_RAX, b);
+            emit_store(ctx, w, REG_RAX, d);
+            break;
+
+#if WASM_ENABLE_REF_TYPES != 0
+        case WASM_OP_REF_NULL:
+            /* mov dword dst, NULL_REF */
+            emit_slot(ctx, 0, false, 0xC7, 0, READ_OFFSET());
+            emit_u32(ctx, NULL_REF);
+            break;
+
+        case WASM_OP_REF_IS_NULL:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_reg(ctx, 0, false, 0x33, REG_RCX, REG_RCX);
+            emit_slot(ctx, 0, false, 0x83, 7, a);
+            emit_byte(ctx, 0xFF);
+            emit_reg(ctx, 0, false, 0x0F90 + CC_E, 0, REG_RCX);
+            emit_store(ctx, false, REG_RCX, d);
+            break;
+
+        case WASM_OP_REF_FUNC:
+            idx = READ_U32();
+            emit_slot(ctx, 0, false, 0xC7, 0, READ_OFFSET());
+            emit_u32(ctx, idx);
+            break;
+#endif
+
+        case EXT_OP_SET_LOCAL_FAST:
+        case EXT_OP_TEE_LOCAL_FAST:
+        case EXT_OP_SET_LOCAL_FAST_I64:
+        case EXT_OP_TEE_LOCAL_FAST_I64:
+            w = opcode == EXT_OP_SET_LOCAL_FAST_I64
+                || opcode == EXT_OP_TEE_LOCAL_FAST_I64;
+            d = READ_BYTE();
+            a = READ_OFFSET();
+            emit_load(ctx, w, REG_RAX, a);
+            emit_store(ctx, w, REG_RAX, d);
+            break;
+
+        case WASM_OP_SET_LOCAL:
+        case WASM_OP_TEE_LOCAL:
+        {
+            WASMFunction *func = ctx->func;
+            uint32 param_count = func->func_type->param_count;
+            uint8 local_type;
+
+            idx = READ_U32();
+            a = READ_OFFSET();
+            local_type = idx < param_count
+                         ? func->func_type->types[idx]
+                         : func->local_types[idx - param_count];
+            if (local_type == VALUE_TYPE_I32 || local_type == VALUE_TYPE_F32)
+                w = false;
+            else if (local_type == VALUE_TYPE_I64
+                     || local_type == VALUE_TYPE_F64)
+                w = true;
+            else {
+                /* the interpreter raises an exception */
+                ctx->unsupported = true;
+                break;
+            }
+            emit_load(ctx, w, REG_RAX, a);
+            emit_store(ctx, w, REG_RAX, func->local_offsets[idx]);
+            break;
+        }
+
+        case WASM_OP_GET_GLOBAL:
+        case WASM_OP_GET_GLOBAL_64:
+            w = opcode == WASM_OP_GET_GLOBAL_64;
+            idx = READ_U32();
+            d = READ_OFFSET();
+            if (!get_global_data_offset(ctx, idx, &offset))
+                break;
+            emit_mem(ctx, 0, w, 0x8B, REG_RAX, REG_R14, NO_INDEX, 0,
+                     (int32)offset);
+            emit_store(ctx, w, REG_RAX, d);
+            break;
+
+        case WASM_OP_SET_GLOBAL:
+        case WASM_OP_SET_GLOBAL_64:
+            w = opcode == WASM_OP_SET_GLOBAL_64;
+            idx = READ_U32();
+            a = READ_OFFSET();
+            if (!get_global_data_offset(ctx, idx, &offset))
+                break;
+            emit_load(ctx, w, REG_RAX, a);
+            emit_mem(ctx, 0, w, 0x89, REG_RAX, REG_R14, NO_INDEX, 0,
+                     (int32)offset);
+            break;
+
+        case WASM_OP_SET_GLOBAL_AUX_STACK:
+            idx = READ_U32();
+            a = READ_OFFSET();
+            if (!get_global_data_offset(ctx, idx, &offset))
+                break;
+            /* Exit on aux stack overflow or underflow */
+            emit_load(ctx, false, REG_RAX, a);
+            emit_mem(ctx, 0, false, 0x3B, REG_RAX, REG_RBP, NO_INDEX, 0,
+                     offsetof(WASMExecEnv, aux_stack_boundary));
+            emit_exit_if(ctx, CC_BE, ip_start);
+            emit_mem(ctx, 0, false, 0x3B, REG_RAX, REG_RBP, NO_INDEX, 0,
+                     offsetof(WASMExecEnv, aux_stack_bottom));
+            emit_exit_if(ctx, CC_A, ip_start);
+            emit_mem(ctx, 0, false, 0x89, REG_RAX, REG_R14, NO_INDEX, 0,
+                     (int32)offset);
+#if WASM_ENABLE_MEMORY_PROFILING != 0
+            /* the interpreter records the max aux stack used */
+            ctx->unsupported = true;
+#endif
+            break;
+
+        /* memory load instructions */
+        case WASM_OP_I32_LOAD:
+        case WASM_OP_I64_LOAD:
+        case WASM_OP_I32_LOAD8_S:
+        case WASM_OP_I32_LOAD8_U:
+        case WASM_OP_I32_LOAD16_S:
+        case WASM_OP_I32_LOAD16_U:
+        case WASM_OP_I64_LOAD8_S:
+        case WASM_OP_I64_LOAD8_U:
+        case WASM_OP_I64_LOAD16_S:
+        case WASM_OP_I64_LOAD16_U:
+        case WASM_OP_I64_LOAD32_S:
+        case WASM_OP_I64_LOAD32_U:
+        {
+            static const struct {
+                uint8 bytes;
+                bool w;
+                uint32 opcode;
+            } loads[] = {
+                { 4, false, 0x8B },   /* i32.load: mov eax */
+                { 8, true, 0x8B },    /* i64.load: mov rax */
+                { 4, false, 0 },      /* f32.load */
+                { 8, false, 0 },      /* f64.load */
+                { 1, false, 0x0FBE }, /* i32.load8_s: movsx eax */
+                { 1, false, 0x0FB6 }, /* i32.load8_u: movzx eax */
+                { 2, false, 0x0FBF }, /* i32.load16_s: movsx eax */
+                { 2, false, 0x0FB7 }, /* i32.load16_u: movzx eax */
+                { 1, true, 0x0FBE },  /* i64.load8_s: movsx rax */
+                { 1, false, 0x0FB6 }, /* i64.load8_u: movzx eax */
+                { 2, true, 0x0FBF },  /* i64.load16_s: movsx rax */
+                { 2, false, 0x0FB7 }, /* i64.load16_u: movzx eax */
+                { 4, true, 0x63 },    /* i64.load32_s: movsxd rax */
+                { 4, false, 0x8B },   /* i64.load32_u: mov eax */
+            };
+            uint32 k = opcode - WASM_OP_I32_LOAD;
+
+            offset = READ_U32();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_check_memory(ctx, offset, a, loads[k].bytes, ip_start);
+            emit_memory_access(ctx, 0, loads[k].w, loads[k].opcode, REG_RAX);
+            emit_store(ctx, opcode == WASM_OP_I32_LOAD
+                            || (opcode >= WASM_OP_I32_LOAD8_S
+                                && opcode <= WASM_OP_I32_LOAD16_U)
+                            ? false : true, REG_RAX, d);
+            break;
+        }
+
+        /* memory store instructions */
+        case WASM_OP_I32_STORE:
+        case WASM_OP_I64_STORE:
+        case WASM_OP_I32_STORE8:
+        case WASM_OP_I32_STORE16:
+        case WASM_OP_I64_STORE8:
+        case WASM_OP_I64_STORE16:
+        case WASM_OP_I64_STORE32:
+        {
+            uint32 bytes;
+            offset = READ_U32();
+            a = READ_OFFSET();
+            b = READ_OFFSET();
+            switch (opcode) {
+                case WASM_OP_I32_STORE8:
+                case WASM_OP_I64_STORE8:
+                    bytes = 1;
+                    break;
+                case WASM_OP_I32_STORE16:
+                case WASM_OP_I64_STORE16:
+                    bytes = 2;
+                    break;
+                case WASM_OP_I64_STORE:
+                    bytes = 8;
+                    break;
+                default:
+                    bytes = 4;
+                    break;
+            }
+            emit_check_memory(ctx, offset, b, bytes, ip_start);
+            emit_load(ctx, bytes == 8, REG_RDX, a);
+            if (bytes == 1)
+                emit_memory_access(ctx, 0, false, 0x88, REG_RDX);
+            else if (bytes == 2)
+                emit_memory_access(ctx, 0x66, false, 0x89, REG_RDX);
+            else
+                emit_memory_access(ctx, 0, bytes == 8, 0x89, REG_RDX);
+            break;
+        }
+
+        /* memory size and memory grow instructions */
+        case WASM_OP_MEMORY_SIZE:
+            d = READ_OFFSET();
+            emit_mem(ctx, 0, true, 0x8B, REG_RAX, REG_R15, NO_INDEX, 0,
+                     offsetof(WASMModuleInstance, default_memory));
+            emit_mem(ctx, 0, false, 0x8B, REG_RAX, REG_RAX, NO_INDEX, 0,
+                     offsetof(WASMMemoryInstance, cur_page_count));
+            emit_store(ctx, false, REG_RAX, d);
+            break;
+
+        case WASM_OP_MEMORY_GROW:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_reg(ctx, 0, true, 0x89, REG_R15, REG_RDI);
+            emit_load(ctx, false, REG_RSI, a);
+            emit_call(ctx, jit_memory_grow);
+            emit_store(ctx, false, REG_RAX, d);
+            emit_load_memory(ctx);
+            break;
+
+        /* comparison instructions */
+        case WASM_OP_I32_EQZ:
+        case WASM_OP_I64_EQZ:
+            w = opcode == WASM_OP_I64_EQZ;
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_reg(ctx, 0, false, 0x33, REG_RCX, REG_RCX);
+            emit_slot(ctx, 0, w, 0x83, 7, a);
+            emit_byte(ctx, 0);
+            emit_reg(ctx, 0, false, 0x0F90 + CC_E, 0, REG_RCX);
+            emit_store(ctx, false, REG_RCX, d);
+            break;
+
+        case WASM_OP_I32_EQ:
+        case WASM_OP_I32_NE:
+        case WASM_OP_I32_LT_S:
+        case WASM_OP_I32_LT_U:
+        case WASM_OP_I32_GT_S:
+        case WASM_OP_I32_GT_U:
+        case WASM_OP_I32_LE_S:
+        case WASM_OP_I32_LE_U:
+        case WASM_OP_I32_GE_S:
+        case WASM_OP_I32_GE_U:
+        case WASM_OP_I64_EQ:
+        case WASM_OP_I64_NE:
+        case WASM_OP_I64_LT_S:
+        case WASM_OP_I64_LT_U:
+        case WASM_OP_I64_GT_S:
+        case WASM_OP_I64_GT_U:
+        case WASM_OP_I64_LE_S:
+        case WASM_OP_I64_LE_U:
+        case WASM_OP_I64_GE_S:
+        case WASM_OP_I64_GE_U:
+        {
+            static const uint8 ccs[] = {
+                CC_E, CC_NE, CC_L, CC_B, CC_G, CC_A, CC_LE, CC_BE, CC_GE, CC_AE
+            };
+            w = opcode >= WASM_OP_I64_EQ;
+            b = READ_OFFSET();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_compare(ctx, w,
+                         ccs[opcode - (w ? WASM_OP_I64_EQ : WASM_OP_I32_EQ)],
+                         b, a, d);
+            break;
+        }
+
+        case WASM_OP_F32_EQ:
+        case WASM_OP_F32_NE:
+        case WASM_OP_F32_LT:
+        case WASM_OP_F32_GT:
+        case WASM_OP_F32_LE:
+        case WASM_OP_F32_GE:
+        case WASM_OP_F64_EQ:
+        case WASM_OP_F64_NE:
+        case WASM_OP_F64_LT:
+        case WASM_OP_F64_GT:
+        case WASM_OP_F64_LE:
+        case WASM_OP_F64_GE:
+            b = READ_OFFSET();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_float_compare(ctx, opcode >= WASM_OP_F64_EQ, opcode, b, a, d);
+            break;
+
+        /* numeric instructions */
+        case WASM_OP_I32_CLZ:
+        case WASM_OP_I64_CLZ:
+            w = opcode == WASM_OP_I64_CLZ;
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            /* the bit index of the highest set bit xor 31 or 63,
+               bsr leaves ZF set if the operand is 0 */
+            emit_load(ctx, w, REG_RAX, a);
+            emit_reg(ctx, 0, w, 0x0FBD, REG_RAX, REG_RAX);
+            emit_mov_imm32(ctx, REG_RCX, w ? 127 : 63);
+            emit_reg(ctx, 0, w, 0x0F40 + CC_E, REG_RAX, REG_RCX);
+            emit_reg(ctx, 0, w, 0x83, 6, REG_RAX);
+            emit_byte(ctx, w ? 63 : 31);
+            emit_store(ctx, w, REG_RAX, d);
+            break;
+
+        case WASM_OP_I32_CTZ:
+        case WASM_OP_I64_CTZ:
+            w = opcode == WASM_OP_I64_CTZ;
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, w, REG_RAX, a);
+            emit_reg(ctx, 0, w, 0x0FBC, REG_RAX, REG_RAX);
+            emit_mov_imm32(ctx, REG_RCX, w ? 64 : 32);
+            emit_reg(ctx, 0, w, 0x0F40 + CC_E, REG_RAX, REG_RCX);
+            emit_store(ctx, w, REG_RAX, d);
+            break;
+
+        case WASM_OP_I32_POPCNT:
+        case WASM_OP_I64_POPCNT:
+        case WASM_OP_F32_CEIL:
+        case WASM_OP_F32_FLOOR:
+        case WASM_OP_F32_TRUNC:
+        case WASM_OP_F32_NEAREST:
+        case WASM_OP_F64_CEIL:
+        case WASM_OP_F64_FLOOR:
+        case WASM_OP_F64_TRUNC:
+        case WASM_OP_F64_NEAREST:
+        case WASM_OP_F32_CONVERT_U_I64:
+        case WASM_OP_F64_CONVERT_U_I64:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_numeric_call(ctx, opcode, a, 0, d, NULL);
+            break;
+
+        case WASM_OP_I32_TRUNC_S_F32:
+        case WASM_OP_I32_TRUNC_U_F32:
+        case WASM_OP_I32_TRUNC_S_F64:
+        case WASM_OP_I32_TRUNC_U_F64:
+        case WASM_OP_I64_TRUNC_S_F32:
+        case WASM_OP_I64_TRUNC_U_F32:
+        case WASM_OP_I64_TRUNC_S_F64:
+        case WASM_OP_I64_TRUNC_U_F64:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_numeric_call(ctx, opcode, a, 0, d, ip_start);
+            break;
+
+        case WASM_OP_F32_MIN:
+        case WASM_OP_F32_MAX:
+        case WASM_OP_F64_MIN:
+        case WASM_OP_F64_MAX:
+            b = READ_OFFSET();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_numeric_call(ctx, opcode, b, a, d, NULL);
+            break;
+
+        case WASM_OP_I32_ADD:
+        case WASM_OP_I64_ADD:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_binary(ctx, opcode == WASM_OP_I64_ADD, 0x03, b, a, d);
+            break;
+        case WASM_OP_I32_SUB:
+        case WASM_OP_I64_SUB:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_binary(ctx, opcode == WASM_OP_I64_SUB, 0x2B, b, a, d);
+            break;
+        case WASM_OP_I32_MUL:
+        case WASM_OP_I64_MUL:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_binary(ctx, opcode == WASM_OP_I64_MUL, 0x0FAF, b, a, d);
+            break;
+        case WASM_OP_I32_AND:
+        case WASM_OP_I64_AND:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_binary(ctx, opcode == WASM_OP_I64_AND, 0x23, b, a, d);
+            break;
+        case WASM_OP_I32_OR:
+        case WASM_OP_I64_OR:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_binary(ctx, opcode == WASM_OP_I64_OR, 0x0B, b, a, d);
+            break;
+        case WASM_OP_I32_XOR:
+        case WASM_OP_I64_XOR:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_binary(ctx, opcode == WASM_OP_I64_XOR, 0x33, b, a, d);
+            break;
+
+        case WASM_OP_I32_DIV_S:
+        case WASM_OP_I32_DIV_U:
+        case WASM_OP_I32_REM_S:
+        case WASM_OP_I32_REM_U:
+        case WASM_OP_I64_DIV_S:
+        case WASM_OP_I64_DIV_U:
+        case WASM_OP_I64_REM_S:
+        case WASM_OP_I64_REM_U:
+            w = opcode >= WASM_OP_I64_DIV_S;
+            b = READ_OFFSET();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_div_rem(ctx, w,
+                         opcode == WASM_OP_I32_DIV_S
+                         || opcode == WASM_OP_I32_REM_S
+                         || opcode == WASM_OP_I64_DIV_S
+                         || opcode == WASM_OP_I64_REM_S,
+                         opcode == WASM_OP_I32_REM_S
+                         || opcode == WASM_OP_I32_REM_U
+                         || opcode == WASM_OP_I64_REM_S
+                         || opcode == WASM_OP_I64_REM_U,
+                         b, a, d, ip_start);
+            break;
+
+        case WASM_OP_I32_SHL:
+        case WASM_OP_I32_SHR_S:
+        case WASM_OP_I32_SHR_U:
+        case WASM_OP_I32_ROTL:
+        case WASM_OP_I32_ROTR:
+        case WASM_OP_I64_SHL:
+        case WASM_OP_I64_SHR_S:
+        case WASM_OP_I64_SHR_U:
+        case WASM_OP_I64_ROTL:
+        case WASM_OP_I64_ROTR:
+        {
+            /* shl, sar, shr, rol and ror, the count is masked
+               by the cpu */
+            static const uint8 digits[] = { 4, 7, 5, 0, 1 };
+            w = opcode >= WASM_OP_I64_SHL;
+            b = READ_OFFSET();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_shift(ctx, w,
+                       digits[opcode - (w ? WASM_OP_I64_SHL : WASM_OP_I32_SHL)],
+                       b, a, d);
+            break;
+        }
+
+        case WASM_OP_F32_ABS:
+        case WASM_OP_F32_NEG:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, false, REG_RAX, a);
+            /* and eax, 0x7FFFFFFF or xor eax, 0x80000000 */
+            emit_reg(ctx, 0, false, 0x81,
+                     opcode == WASM_OP_F32_ABS ? 4 : 6, REG_RAX);
+            emit_u32(ctx, opcode == WASM_OP_F32_ABS ? 0x7FFFFFFF : 0x80000000);
+            emit_store(ctx, false, REG_RAX, d);
+            break;
+
+        case WASM_OP_F64_ABS:
+        case WASM_OP_F64_NEG:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, true, REG_RAX, a);
+            /* btr rax, 63 or btc rax, 63 */
+            emit_reg(ctx, 0, true, 0x0FBA,
+                     opcode == WASM_OP_F64_ABS ? 6 : 7, REG_RAX);
+            emit_byte(ctx, 63);
+            emit_store(ctx, true, REG_RAX, d);
+            break;
+
+        case WASM_OP_F32_COPYSIGN:
+            b = READ_OFFSET();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, false, REG_RAX, a);
+            emit_load(ctx, false, REG_RCX, b);
+            emit_reg(ctx, 0, false, 0x81, 4, REG_RAX);
+            emit_u32(ctx, 0x7FFFFFFF);
+            emit_reg(ctx, 0, false, 0x81, 4, REG_RCX);
+            emit_u32(ctx, 0x80000000);
+            emit_reg(ctx, 0, false, 0x0B, REG_RAX, REG_RCX);
+            emit_store(ctx, false, REG_RAX, d);
+            break;
+
+        case WASM_OP_F64_COPYSIGN:
+            b = READ_OFFSET();
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, true, REG_RAX, a);
+            emit_load(ctx, true, REG_RCX, b);
+            /* btr rax, 63; shr rcx, 63; shl rcx, 63; or rax, rcx */
+            emit_reg(ctx, 0, true, 0x0FBA, 6, REG_RAX);
+            emit_byte(ctx, 63);
+            emit_reg(ctx, 0, true, 0xC1, 5, REG_RCX);
+            emit_byte(ctx, 63);
+            emit_reg(ctx, 0, true, 0xC1, 4, REG_RCX);
+            emit_byte(ctx, 63);
+            emit_reg(ctx, 0, true, 0x0B, REG_RAX, REG_RCX);
+            emit_store(ctx, true, REG_RAX, d);
+            break;
+
+        case WASM_OP_F32_SQRT:
+        case WASM_OP_F64_SQRT:
+        {
+            uint8 prefix = opcode == WASM_OP_F64_SQRT ? 0xF2 : 0xF3;
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_slot(ctx, prefix, false, 0x0F51, 0, a);
+            emit_slot(ctx, prefix, false, 0x0F11, 0, d);
+            break;
+        }
+
+        case WASM_OP_F32_ADD:
+        case WASM_OP_F64_ADD:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_float_binary(ctx, opcode == WASM_OP_F64_ADD, 0x0F58, b, a, d);
+            break;
+        case WASM_OP_F32_SUB:
+        case WASM_OP_F64_SUB:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_float_binary(ctx, opcode == WASM_OP_F64_SUB, 0x0F5C, b, a, d);
+            break;
+        case WASM_OP_F32_MUL:
+        case WASM_OP_F64_MUL:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_float_binary(ctx, opcode == WASM_OP_F64_MUL, 0x0F59, b, a, d);
+            break;
+        case WASM_OP_F32_DIV:
+        case WASM_OP_F64_DIV:
+            b = READ_OFFSET(); a = READ_OFFSET(); d = READ_OFFSET();
+            emit_float_binary(ctx, opcode == WASM_OP_F64_DIV, 0x0F5E, b, a, d);
+            break;
+
+        /* conversions */
+        case WASM_OP_I32_WRAP_I64:
+        case WASM_OP_I64_EXTEND_U_I32:
+        case WASM_OP_I32_REINTERPRET_F32:
+        case WASM_OP_F32_REINTERPRET_I32:
+        case EXT_OP_COPY_STACK_TOP:
+            /* mov eax zero-extends the value */
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, false, REG_RAX, a);
+            emit_store(ctx, opcode == WASM_OP_I64_EXTEND_U_I32, REG_RAX, d);
+            break;
+
+        case WASM_OP_I64_REINTERPRET_F64:
+        case WASM_OP_F64_REINTERPRET_I64:
+        case EXT_OP_COPY_STACK_TOP_I64:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_load(ctx, true, REG_RAX, a);
+            emit_store(ctx, true, REG_RAX, d);
+            break;
+
+        case WASM_OP_I64_EXTEND_S_I32:
+        case WASM_OP_I64_EXTEND32_S:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_slot(ctx, 0, true, 0x63, REG_RAX, a);
+            emit_store(ctx, true, REG_RAX, d);
+            break;
+
+        case WASM_OP_I32_EXTEND8_S:
+        case WASM_OP_I32_EXTEND16_S:
+        case WASM_OP_I64_EXTEND8_S:
+        case WASM_OP_I64_EXTEND16_S:
+            w = opcode >= WASM_OP_I64_EXTEND8_S;
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_slot(ctx, 0, w,
+                      opcode == WASM_OP_I32_EXTEND8_S
+                      || opcode == WASM_OP_I64_EXTEND8_S ? 0x0FBE : 0x0FBF,
+                      REG_RAX, a);
+            emit_store(ctx, w, REG_RAX, d);
+            break;
+
+        case WASM_OP_F32_CONVERT_S_I32:
+        case WASM_OP_F32_CONVERT_S_I64:
+        case WASM_OP_F64_CONVERT_S_I32:
+        case WASM_OP_F64_CONVERT_S_I64:
+        {
+            uint8 prefix = opcode >= WASM_OP_F64_CONVERT_S_I32 ? 0xF2 : 0xF3;
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            /* cvtsi2ss/cvtsi2sd xmm0, a */
+            emit_slot(ctx, prefix,
+                      opcode == WASM_OP_F32_CONVERT_S_I64
+                      || opcode == WASM_OP_F64_CONVERT_S_I64,
+                      0x0F2A, 0, a);
+            emit_slot(ctx, prefix, false, 0x0F11, 0, d);
+            break;
+        }
+
+        case WASM_OP_F32_CONVERT_U_I32:
+        case WASM_OP_F64_CONVERT_U_I32:
+        {
+            uint8 prefix = opcode == WASM_OP_F64_CONVERT_U_I32 ? 0xF2 : 0xF3;
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            /* the zero-extended value converted as a signed i64 */
+            emit_load(ctx, false, REG_RAX, a);
+            emit_reg(ctx, prefix, true, 0x0F2A, 0, REG_RAX);
+            emit_slot(ctx, prefix, false, 0x0F11, 0, d);
+            break;
+        }
+
+        case WASM_OP_F32_DEMOTE_F64:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_slot(ctx, 0xF2, false, 0x0F5A, 0, a);
+            emit_slot(ctx, 0xF3, false, 0x0F11, 0, d);
+            break;
+
+        case WASM_OP_F64_PROMOTE_F32:
+            a = READ_OFFSET();
+            d = READ_OFFSET();
+            emit_slot(ctx, 0xF3, false, 0x0F5A, 0, a);
+            emit_slot(ctx, 0xF2, false, 0x0F11, 0, d);
+            break;
+
+        case EXT_OP_COPY_STACK_VALUES:
+        {
+            uint8 *cells;
+            int16 *src_offsets;
+            uint16 *dst_offsets;
+
+            count = READ_U32();
+            /* skip total cell num */
+            ip += sizeof(uint32);
+            cells = ip;
+            ip += count;
+            src_offsets = (int16 *)ip;
+            ip += sizeof(int16) * count;
+            dst_offsets = (uint16 *)ip;
+            ip += sizeof(uint16) * count;
+            emit_copy_values(ctx, count, cells, src_offsets, dst_offsets,
+                             ip_start);
+            break;
+        }
+
+        case WASM_OP_MISC_PREFIX:
+            opcode = READ_BYTE();
+            switch (opcode) {
+                case WASM_OP_I32_TRUNC_SAT_S_F32:
+                case WASM_OP_I32_TRUNC_SAT_U_F32:
+                case WASM_OP_I32_TRUNC_SAT_S_F64:
+                case WASM_OP_I32_TRUNC_SAT_U_F64:
+                case WASM_OP_I64_TRUNC_SAT_S_F32:
+                case WASM_OP_I64_TRUNC_SAT_U_F32:
+                case WASM_OP_I64_TRUNC_SAT_S_F64:
+                case WASM_OP_I64_TRUNC_SAT_U_F64:
+                    a = READ_OFFSET();
+                    d = READ_OFFSET();
+                    emit_numeric_call(ctx, MISC_OPCODE(opcode), a, 0, d,
+                                      NULL);
+                    break;
+#if WASM_ENABLE_BULK_MEMORY != 0
+                case WASM_OP_MEMORY_COPY:
+                case WASM_OP_MEMORY_FILL:
+                    /* len, src or val, dst */
+                    a = READ_OFFSET();
+                    b = READ_OFFSET();
+                    d = READ_OFFSET();
+                    emit_reg(ctx, 0, true, 0x89, REG_R15, REG_RDI);
+                    emit_load(ctx, false, REG_RSI, d);
+                    emit_load(ctx, false, REG_RDX, b);
+                    emit_load(ctx, false, REG_RCX, a);
+                    emit_call(ctx, opcode == WASM_OP_MEMORY_COPY
+                                   ? (void *)jit_memory_copy
+                                   : (void *)jit_memory_fill);
+                    emit_byte(ctx, 0x84);
+                    emit_byte(ctx, 0xC0);
+                    emit_exit_if(ctx, CC_E, ip_start);
+                    break;
+#endif
+                default:
+                    ctx->unsupported = true;
+                    break;
+            }
+            break;
+
+        default:
+            ctx->unsupported = true;
+            break;
+    }
+
+    *p_ip = ip;
+    return true;
+}
+
+static void
+translate_block(JitCompContext *ctx, uint32 start)
+{
+    uint8 *ip = ctx->code + start, *ip_start = ip;
+    uint32 offset;
+    uint8 opcode = 0;
+
+    if (ctx->native_offsets[start] >= 0)
+        return;
+
+    while (!ctx->unsupported && !ctx->oom) {
+        offset = (uint32)(ip - ctx->code);
+        if (offset >= ctx->code_size) {
+            ctx->unsupported = true;
+            break;
+        }
+        if (ctx->native_offsets[offset] >= 0) {
+            /* Fall through to the code translated */
+            patch_rel32(ctx, emit_jcc(ctx, CC_ALWAYS),
+                        (uint32)ctx->native_offsets[offset]);
+            break;
+        }
+
+        ctx->native_offsets[offset] = (int32)cur_offset(ctx);
+        ip_start = ip;
+        if (!read_opcode(ctx, &ip, &opcode)) {
+            ctx->unsupported = true;
+            break;
+        }
+        if (!translate_opcode(ctx, opcode, ip_start, &ip))
+            break;
+    }
+
+    if (ctx->unsupported)
+        LOG_VERBOSE("Baseline JIT: unsupported opcode 0x%02x at offset %u",
+                    opcode, (uint32)(ip_start - ctx->code));
+}
+
+static bool
+compile_func(JitCompContext *ctx, WASMFunction *func,
+             uint32 *p_func_start, uint32 *p_entry)
+{
+    WASMJitResumePoint *points = NULL;
+    uint64 total_size;
+    uint32 i, j;
+
+    ctx->func = func;
+    ctx->code = func->code_compiled;
+    ctx->code_size = func->code_compiled_size;
+    ctx->func_start = ctx->buf_size;
+    ctx->worklist_count = 0;
+    ctx->branch_patch_count = 0;
+    ctx->exit_patch_count = 0;
+    ctx->resume_count = 0;
+    ctx->unsupported = false;
+
+    *p_func_start = UINT32_MAX;
+    if (!ctx->code_size)
+        return true;
+
+    total_size = sizeof(int32) * (uint64)ctx->code_size;
+    if (total_size >= UINT32_MAX
+        || !(ctx->native_offsets = wasm_runtime_malloc((uint32)total_size)))
+        return false;
+    memset(ctx->native_offsets, 0xFF, (uint32)total_size);
+
+    emit_prologue_epilogue(ctx);
+
+    translate_block(ctx, 0);
+    while (ctx->worklist_count && !ctx->unsupported && !ctx->oom)
+        translate_block(ctx, ctx->worklist[--ctx->worklist_count]);
+
+    if (!ctx->unsupported && !ctx->oom) {
+        for (i = 0; i < ctx->branch_patch_count; i++) {
+            JitPatch *patch = ctx->branch_patches + i;
+            patch_rel32(ctx, patch->native_offset,
+                        (uint32)ctx->native_offsets[patch->u.target]);
+        }
+
+        for (i = 0; i < ctx->exit_patch_count; i++) {
+            patch_rel32(ctx, ctx->exit_patches[i].native_offset,
+                        cur_offset(ctx));
+            emit_exit(ctx, ctx->exit_patches[i].u.ip);
+        }
+
+        if (ctx->resume_count) {
+            total_size = sizeof(WASMJitResumePoint) * (uint64)ctx->resume_count;
+            if (total_size >= UINT32_MAX
+                || !(points = wasm_runtime_malloc((uint32)total_size)))
+                ctx->oom = true;
+        }
+
+        /* Sort the resume points by ip with insertion sort, they are
+           nearly in order since the code is translated mostly from
+           the start to the end */
+        for (i = 0; points && i < ctx->resume_count; i++) {
+            WASMJitResumePoint point;
+            uint32 offset = ctx->resume_offsets[i];
+
+            bh_assert(ctx->native_offsets[offset] >= 0);
+            point.ip = ctx->code + offset;
+            point.native_offset = (uint32)ctx->native_offsets[offset];
+            for (j = i; j > 0 && points[j - 1].ip > point.ip; j--)
+                points[j] = points[j - 1];
+            points[j] = point;
+        }
+    }
+
+    if (ctx->oom) {
+        if (points)
+            wasm_runtime_free(points);
+        wasm_runtime_free(ctx->native_offsets);
+        ctx->native_offsets = NULL;
+        return false;
+    }
+
+    if (ctx->unsupported) {
+        /* Leave the function to the interpreter */
+        ctx->buf_size = ctx->func_start;
+    }
+    else {
+        *p_func_start = ctx->func_start;
+        *p_entry = (uint32)ctx->native_offsets[0];
+        func->jit_resume_points = points;
+        func->jit_resume_point_count = ctx->resume_count;
+    }
+
+    wasm_runtime_free(ctx->native_offsets);
+    ctx->native_offsets = NULL;
+    return true;
+}
+
+static bool
+init_comp_context(JitCompContext *ctx, WASMModule *module)
+{
+    uint32 global_count = module->import_global_count + module->global_count;
+    uint32 data_offset = 0, i;
+    uint8 type;
+#if WASM_ENABLE_LABELS_AS_VALUES != 0
+    void **handle_table = wasm_interp_get_handle_table();
+    uint32 j;
+#endif
+
+    memset(ctx, 0, sizeof(JitCompContext));
+    ctx->module = module;
+
+#if WASM_ENABLE_LABELS_AS_VALUES != 0
+    /* Sort the labels of the interpreter to map them back to opcodes,
+       opcodes sharing a label are handled the same way */
+    for (i = 0; i < 256; i++) {
+        JitLabel label;
+        label.addr = handle_table[i];
+        label.opcode = (uint8)i;
+        for (j = i; j > 0 && (uintptr_t)ctx->labels[j - 1].addr
+                                 > (uintptr_t)label.addr; j--)
+            ctx->labels[j] = ctx->labels[j - 1];
+        ctx->labels[j] = label;
+    }
+#endif
+
+    if (global_count) {
+        if (!(ctx->global_data_offsets =
+                wasm_runtime_malloc(sizeof(uint32) * global_count)))
+            return false;
+
+        /* Same layout as the global data of the instance */
+        for (i = 0; i < global_count; i++) {
+            if (i < module->import_global_count) {
+                type = module->import_globals[i].u.global.type;
+#if WASM_ENABLE_MULTI_MODULE != 0
+                /* The global of the imported module is elsewhere */
+                if (module->import_globals[i].u.global.import_module) {
+                    ctx->global_data_offsets[i] = UINT32_MAX;
+                    data_offset += wasm_value_type_size(type);
+                    continue;
+                }
+#endif
+            }
+            else {
+                type = module->globals[i - module->import_global_count].type;
+            }
+            ctx->global_data_offsets[i] = data_offset;
+            data_offset += wasm_value_type_size(type);
+        }
+    }
+    return true;
+}
+
+static void
+destroy_comp_context(JitCompContext *ctx)
+{
+    if (ctx->buf)
+        wasm_runtime_free(ctx->buf);
+    if (ctx->worklist)
+        wasm_runtime_free(ctx->worklist);
+    if (ctx->branch_patches)
+        wasm_runtime_free(ctx->branch_patches);
+    if (ctx->exit_patches)
+        wasm_runtime_free(ctx->exit_patches);
+    if (ctx->resume_offsets)
+        wasm_runtime_free(ctx->resume_offsets);
+    if (ctx->global_data_offsets)
+        wasm_runtime_free(ctx->global_data_offsets);
+}
+
+static bool
+is_memory_supported(const WASMModule *module)
+{
+    uint32 flags;
+
+    if (module->import_memory_count)
+        flags = module->import_memories[0].u.memory.flags;
+    else if (module->memory_count)
+        flags = module->memories[0].flags;
+    else
+        return true;
+
+    /* memory64 and shared memory are left to the interpreter */
+    return (flags & (MEMORY64_FLAG | 0x02)) ? false : true;
+}
+
+#if WASM_ENABLE_LINUX_PERF != 0
+/* Emit the native code of the functions compiled for the Linux perf
+   tool, the functions are compiled one after another into the code */
+static void
+emit_linux_perf_funcs(const WASMModule *module, const uint32 *func_starts,
+                      uint32 code_size)
+{
+    const char *name;
+    char buf[32];
+    uint32 i, j, code_end;
+
+    if (!wasm_linux_perf_enabled())
+        return;
+
+    for (i = 0; i < module->function_count; i++) {
+        if (func_starts[i] == UINT32_MAX)
+            continue;
+
+        for (j = i + 1; j < module->function_count; j++) {
+            if (func_starts[j] != UINT32_MAX)
+                break;
+        }
+        code_end = j < module->function_count ? func_starts[j] : code_size;
+
+        name = NULL;
+#if WASM_ENABLE_CUSTOM_NAME_SECTION != 0
+        name = module->functions[i]->field_name;
+#endif
+        for (j = 0; !name && j < module->export_count; j++) {
+            if (module->exports[j].kind == EXPORT_KIND_FUNC
+                && module->exports[j].index
+                       == i + module->import_function_count)
+                name = module->exports[j].name;
+        }
+        if (!name) {
+            snprintf(buf, sizeof(buf), "wasm_func#%u", i);
+            name = buf;
+        }
+
+        wasm_linux_perf_add_code(module->jit_code + func_starts[i],
+                                 code_end - func_starts[i], name);
+    }
+}
+#endif /* end of WASM_ENABLE_LINUX_PERF != 0 */
+
+bool
+wasm_jit_baseline_compile(WASMModule *module,
+                          char *error_buf, uint32 error_buf_size)
+{
+    JitCompContext ctx;
+    WASMFunction *func;
+    uint32 *func_starts = NULL, *entries = NULL, compiled_count = 0, i;
+    uint64 total_size;
+    uint8 *code;
+
+    if (!module->function_count)
+        return true;
+
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    /* The native code doesn't update the execution counters, keep all
+       the functions in the interpreter so that the profile is complete */
+    LOG_VERBOSE("Baseline JIT: disabled by the opcode counter");
+    return true;
+#endif
+
+    if (!is_memory_supported(module)) {
+        LOG_VERBOSE("Baseline JIT: memory of the module unsupported");
+        return true;
+    }
+
+    total_size = sizeof(uint32) * (uint64)module->function_count;
+    if (!init_comp_context(&ctx, module)
+        || total_size >= UINT32_MAX
+        || !(func_starts = wasm_runtime_malloc((uint32)total_size))
+        || !(entries = wasm_runtime_malloc((uint32)total_size))) {
+        set_error_buf(error_buf, error_buf_size,
+                      "allocate memory failed");
+        goto fail;
+    }
+
+    for (i = 0; i < module->function_count; i++) {
+        if (!compile_func(&ctx, module->functions[i],
+                          func_starts + i, entries + i)) {
+            set_error_buf(error_buf, error_buf_size,
+                          "allocate memory failed");
+            goto fail;
+        }
+        if (func_starts[i] != UINT32_MAX)
+            compiled_count++;
+    }
+
+    if (ctx.buf_size) {
+        if (!(code = os_mmap(NULL, ctx.buf_size,
+                             MMAP_PROT_READ | MMAP_PROT_WRITE,
+                             MMAP_MAP_NONE))) {
+            set_error_buf(error_buf, error_buf_size, "mmap memory failed");
+            goto fail;
+        }
+        bh_memcpy_s(code, ctx.buf_size, ctx.buf, ctx.buf_size);
+        os_mprotect(code, ctx.buf_size, MMAP_PROT_READ | MMAP_PROT_EXEC);
+        module->jit_code = code;
+        module->jit_code_size = ctx.buf_size;
+
+        for (i = 0; i < module->function_count; i++) {
+            if (func_starts[i] != UINT32_MAX) {
+                func = module->functions[i];
+                func->jit_code = code + func_starts[i];
+                func->jit_entry = func->jit_code + entries[i];
+            }
+        }
+
+#if WASM_ENABLE_LINUX_PERF != 0
+        emit_linux_perf_funcs(module, func_starts, ctx.buf_size);
+#endif
+    }
+
+    LOG_VERBOSE("Baseline JIT: %u of %u functions compiled, "
+                "code size %u bytes", compiled_count,
+                module->function_count, ctx.buf_size);
+
+    destroy_comp_context(&ctx);
+    wasm_runtime_free(func_starts);
+    wasm_runtime_free(entries);
+    return true;
+
+fail:
+    destroy_comp_context(&ctx);
+    if (func_starts)
+        wasm_runtime_free(func_starts);
+    if (entries)
+        wasm_runtime_free(entries);
+    return false;
+}
+
+void
+wasm_jit_baseline_destroy(WASMModule *module)
+{
+    WASMFunction *func;
+    uint32 i;
+
+    for (i = 0; module->functions && i < module->function_count; i++) {
+        if ((func = module->functions[i]) && func->jit_resume_points) {
+            wasm_runtime_free(func->jit_resume_points);
+            func->jit_resume_points = NULL;
+        }
+    }
+
+    if (module->jit_code) {
+        os_munmap(module->jit_code, module->jit_code_size);
+        module->jit_code = NULL;
+    }
+}
+
+uint8 *
+wasm_jit_baseline_get_resume_addr(const WASMFunction *func, const uint8 *ip)
+{
+    const WASMJitResumePoint *points = func->jit_resume_points;
+    int32 low = 0, high = (int32)func->jit_resume_point_count - 1, mid;
+
+    while (low <= high) {
+        mid = (low + high) / 2;
+        if (points[mid].ip == ip)
+            return func->jit_code + points[mid].native_offset;
+        else if (points[mid].ip < ip)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+    return NULL;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef _WASM_JIT_BASELINE_H
+#define _WASM_JIT_BASELINE_H
+
+#include "wasm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct WASMModuleInstance;
+struct WASMExecEnv;
+
+/**
+ * The native code of a function compiled by the baseline JIT.
+ *
+ * @param frame_lp the local pointer of the interpreter frame
+ * @param module_inst the current module instance
+ * @param exec_env the current execution environment
+ * @param native_addr the native code to start at, either the entry
+ *        of the function or a resume point returned by
+ *        wasm_jit_baseline_get_resume_addr
+ *
+ * @return the ip of the pre-compiled code for the interpreter to
+ *         continue at, e.g. a call, a return or an opcode that traps
+ */
+typedef uint8 *(*WASMJitCode)(uint32 *frame_lp,
+                              struct WASMModuleInstance *module_inst,
+                              struct WASMExecEnv *exec_env,
+                              uint8 *native_addr);
+
+/**
+ * Compile the pre-compiled code of the fast interpreter of all the
+ * functions of the module into native code, functions that use an
+ * opcode unsupported by the baseline JIT are left to the interpreter.
+ *
+ * @param module the module loaded
+ * @param error_buf output of the error info
+ * @param error_buf_size the size of the error buffer
+ *
+ * @return true if success, false if out of memory
+ */
+bool
+wasm_jit_baseline_compile(WASMModule *module,
+                          char *error_buf, uint32 error_buf_size);
+
+/**
+ * Free the native code of the module and of its functions.
+ *
+ * @param module the module to free the native code
+ */
+void
+wasm_jit_baseline_destroy(WASMModule *module);
+
+/**
+ * Get the native code to continue at after the interpreter finished
+ * a call of the function.
+ *
+ * @param func the function compiled
+ * @param ip the ip of the pre-compiled code following the call
+ *
+ * @return the native code, or NULL if not found
+ */
+uint8 *
+wasm_jit_baseline_get_resume_addr(const WASMFunction *func, const uint8 *ip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of _WASM_JIT_BASELINE_H */
@@ -10,6 +10,10 @@
 #include "wasm_opcode.h"
 #include "wasm_runtime.h"
 #include "../common/wasm_native.h"
+#include "../common/wasm_startup_timing.h"
+#if WASM_ENABLE_BASELINE_JIT != 0
+#include "wasm_jit_baseline.h"
+#endif
 
 /* Read a value of given type from the address pointed to by the given
    pointer and increase the pointer to the position just after the
@@ -119,6 +123,11 @@ read_leb(uint8 **p_buf, const uint8 *buf_end,
         if (((uint8)byte) & 0xf0)
             goto fail_integer_too_large;
     }
+    else if (!sign && maxbits == 64 && shift >= maxbits) {
+        /* The top bits set represent values > 64 bits */
+        if (((uint8)byte) & 0xfe)
+            goto fail_integer_too_large;
+    }
     else if (sign && maxbits == 32) {
         if (shift < maxbits) {
             /* Sign extend */
@@ -181,6 +190,26 @@ fail:
   res = (uint32)res64;                              \
 } while (0)
 
+#if WASM_ENABLE_MEMORY64 != 0
+#define read_leb_uint64(p, p_end, res) do {         \
+  uint64 res64;                                     \
+  if (!read_leb((uint8**)&p, p_end, 64, false, &res64,\
+                error_buf, error_buf_size))         \
+    goto fail;                                      \
+  res = res64;                                      \
+} while (0)
+
+/* The memarg offset is u64 for memory64 */
+#define read_leb_mem_offset(p, p_end, res) do {     \
+  if (is_memory64)                                  \
+    read_leb_uint64(p, p_end, res);                 \
+  else                                              \
+    read_leb_uint32(p, p_end, res);                 \
+} while (0)
+#else
+#define read_leb_mem_offset(p, p_end, res) read_leb_uint32(p, p_end, res)
+#endif
+
 #define read_leb_int32(p, p_end, res) do {          \
   uint64 res64;                                     \
   if (!read_leb((uint8**)&p, p_end, 32, true, &res64,\
@@ -1112,6 +1141,11 @@ load_function_import(const uint8 **p_buf, const uint8 *buf_end,
     function->signature = linked_signature;
     function->attachment = linked_attachment;
     function->call_conv_raw = linked_call_conv_raw;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    function->call_stats = is_native_symbol
+        ? wasm_native_lookup_call_stats(sub_module_name, function_name)
+        : NULL;
+#endif
 #if WASM_ENABLE_MULTI_MODULE != 0
     function->import_module = is_native_symbol ? NULL : sub_module;
     function->import_func_linked = is_native_symbol ? NULL : linked_func;
@@ -1274,6 +1308,57 @@ check_memory_max_size(uint32 init_size, uint32 max_size,
     return true;
 }
 
+#if WASM_ENABLE_MEMORY64 != 0
+static bool
+load_memory64_limits(const uint8 **p_buf, const uint8 *buf_end, uint32 flags,
+                     uint32 *p_init_page_count, uint32 *p_max_page_count,
+                     char *error_buf, uint32 error_buf_size)
+{
+    const uint8 *p = *p_buf, *p_end = buf_end;
+    uint64 init_page_count, max_page_count = WASM_MEMORY64_MAX_PAGES;
+
+    if (flags & 0x02) {
+        set_error_buf(error_buf, error_buf_size,
+                      "shared memory64 isn't supported");
+        return false;
+    }
+
+    /* The limits of memory64 are encoded as u64 */
+    read_leb_uint64(p, p_end, init_page_count);
+    if (flags & 1) {
+        read_leb_uint64(p, p_end, max_page_count);
+        if (max_page_count < init_page_count) {
+            set_error_buf(error_buf, error_buf_size,
+                          "size minimum must not be greater than maximum");
+            return false;
+        }
+        if (max_page_count > ((uint64)1 << 48)) {
+            set_error_buf(error_buf, error_buf_size,
+                          "memory size must be at most 2^48 pages");
+            return false;
+        }
+    }
+
+    if (init_page_count > WASM_MEMORY64_MAX_PAGES) {
+        set_error_buf_v(error_buf, error_buf_size,
+                        "memory64 size must be at most %u pages",
+                        (uint32)WASM_MEMORY64_MAX_PAGES);
+        return false;
+    }
+
+    /* Limit the maximum memory size to WASM_MEMORY64_MAX_PAGES */
+    if (max_page_count > WASM_MEMORY64_MAX_PAGES)
+        max_page_count = WASM_MEMORY64_MAX_PAGES;
+
+    *p_init_page_count = (uint32)init_page_count;
+    *p_max_page_count = (uint32)max_page_count;
+    *p_buf = p;
+    return true;
+fail:
+    return false;
+}
+#endif /* end of WASM_ENABLE_MEMORY64 */
+
 static bool
 load_memory_import(const uint8 **p_buf, const uint8 *buf_end,
                    WASMModule *parent_module,
@@ -1299,6 +1384,35 @@ load_memory_import(const uint8 **p_buf, const uint8 *buf_end,
 #endif
 
     read_leb_uint32(p, p_end, declare_max_page_count_flag);
+#if WASM_ENABLE_MEMORY64 != 0
+    if (declare_max_page_count_flag & MEMORY64_FLAG) {
+        if (!load_memory64_limits(&p, p_end, declare_max_page_count_flag,
+                                  &declare_init_page_count,
+                                  &declare_max_page_count,
+                                  error_buf, error_buf_size)) {
+            return false;
+        }
+
+        if (!strcmp("spectest", sub_module_name)
+#if WASM_ENABLE_MULTI_MODULE != 0
+            || !wasm_runtime_is_built_in_module(sub_module_name)
+#endif
+           ) {
+            set_error_buf(error_buf, error_buf_size,
+                          "linking memory64 with other modules "
+                          "isn't supported");
+            return false;
+        }
+
+        memory->flags = declare_max_page_count_flag;
+        memory->init_page_count = declare_init_page_count;
+        memory->max_page_count = declare_max_page_count;
+        memory->num_bytes_per_page = DEFAULT_NUM_BYTES_PER_PAGE;
+
+        *p_buf = p;
+        return true;
+    }
+#endif
     read_leb_uint32(p, p_end, declare_init_page_count);
     if (!check_memory_init_size(declare_init_page_count, error_buf,
                                 error_buf_size)) {
@@ -1527,6 +1641,24 @@ load_memory(const uint8 **p_buf, const uint8 *buf_end, WASMMemory *memory,
 
     p_org = p;
     read_leb_uint32(p, p_end, memory->flags);
+#if WASM_ENABLE_MEMORY64 != 0
+    if (memory->flags & MEMORY64_FLAG) {
+        if (p - p_org > 1 || memory->flags > (MEMORY64_FLAG | 0x03)) {
+            set_error_buf(error_buf, error_buf_size, "invalid limits flags");
+            return false;
+        }
+        if (!load_memory64_limits(&p, p_end, memory->flags,
+                                  &memory->init_page_count,
+                                  &memory->max_page_count,
+                                  error_buf, error_buf_size))
+            return false;
+
+        memory->num_bytes_per_page = DEFAULT_NUM_BYTES_PER_PAGE;
+
+        *p_buf = p;
+        return true;
+    }
+#endif
 #if WASM_ENABLE_SHARED_MEMORY == 0
     if (p - p_org > 1) {
         set_error_buf(error_buf, error_buf_size,
@@ -2561,6 +2693,19 @@ fail:
     return false;
 }
 
+#if WASM_ENABLE_MEMORY64 != 0
+static bool
+is_memory64_module(const WASMModule *module)
+{
+    if (module->import_memory_count > 0)
+        return module->import_memories[0].u.memory.flags & MEMORY64_FLAG
+               ? true : false;
+    if (module->memory_count > 0)
+        return module->memories[0].flags & MEMORY64_FLAG ? true : false;
+    return false;
+}
+#endif
+
 static bool
 load_data_segment_section(const uint8 *buf, const uint8 *buf_end,
                           WASMModule *module,
@@ -2571,6 +2716,13 @@ load_data_segment_section(const uint8 *buf, const uint8 *buf_end,
     uint64 total_size;
     WASMDataSeg *dataseg;
     InitializerExpression init_expr;
+    /* The offset of data segment is i64 for memory64 */
+#if WASM_ENABLE_MEMORY64 != 0
+    uint8 offset_type = is_memory64_module(module)
+                        ? VALUE_TYPE_I64 : VALUE_TYPE_I32;
+#else
+    uint8 offset_type = VALUE_TYPE_I32;
+#endif
 #if WASM_ENABLE_BULK_MEMORY != 0
     bool is_passive = false;
     uint32 mem_flag;
@@ -2637,7 +2789,7 @@ check_mem_index:
 #if WASM_ENABLE_BULK_MEMORY != 0
             if (!is_passive)
 #endif
-                if (!load_init_expr(&p, p_end, &init_expr, VALUE_TYPE_I32,
+                if (!load_init_expr(&p, p_end, &init_expr, offset_type,
                                     error_buf, error_buf_size))
                     return false;
 
@@ -3212,13 +3364,25 @@ load_from_sections(WASMModule *module, WASMSection *sections,
     handle_table = wasm_interp_get_handle_table();
 #endif
 
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_VALIDATE);
     for (i = 0; i < module->function_count; i++) {
         WASMFunction *func = module->functions[i];
         if (!wasm_loader_prepare_bytecode(module, func, i,
                                           error_buf, error_buf_size)) {
+            STARTUP_TIMING_END(WASM_STARTUP_VALIDATE);
             return false;
         }
     }
+    STARTUP_TIMING_END(WASM_STARTUP_VALIDATE);
+
+#if WASM_ENABLE_BASELINE_JIT != 0
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_COMPILE);
+    if (!wasm_jit_baseline_compile(module, error_buf, error_buf_size)) {
+        STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
+        return false;
+    }
+    STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
+#endif
 
     if (!module->possible_memory_grow) {
         WASMMemoryImport *memory_import;
@@ -3513,6 +3677,10 @@ wasm_loader_unload(WASMModule *module)
     if (!module)
         return;
 
+#if WASM_ENABLE_BASELINE_JIT != 0
+    wasm_jit_baseline_destroy(module);
+#endif
+
     if (module->types) {
         for (i = 0; i < module->type_count; i++) {
             if (module->types[i])
@@ -3534,6 +3702,10 @@ wasm_loader_unload(WASMModule *module)
                     wasm_runtime_free(module->functions[i]->code_compiled);
                 if (module->functions[i]->consts)
                     wasm_runtime_free(module->functions[i]->consts);
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                if (module->functions[i]->block_counters)
+                    wasm_runtime_free(module->functions[i]->block_counters);
 #endif
                 wasm_runtime_free(module->functions[i]);
             }
@@ -4673,6 +4845,26 @@ fail:
   } while (0)
 #endif /* end of WASM_ENABLE_LABELS_AS_VALUES */
 
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+/* Emit the counter of the block started by the current opcode, the
+   counters are allocated after the first traversal counts them */
+#define emit_block_counter(type, field) do {                        \
+    emit_label(EXT_OP_BLOCK_COUNT);                                 \
+    if (loader_ctx->p_code_compiled) {                              \
+        WASMBlockCounter *block_counter =                           \
+            func->block_counters + block_counter_idx;               \
+        bh_assert(block_counter_idx < func->block_counter_count);   \
+        block_counter->code_offset =                                \
+            (uint32)(p_org - 1 - func->code);                       \
+        block_counter->label_type = type;                           \
+        wasm_loader_emit_ptr(loader_ctx, &block_counter->field);    \
+    }                                                               \
+    else {                                                          \
+        wasm_loader_emit_ptr(loader_ctx, NULL);                     \
+    }                                                               \
+  } while (0)
+#endif
+
 #define emit_empty_label_addr_and_frame_ip(type) do {               \
     if (!add_label_patch_to_list(loader_ctx->frame_csp - 1, type,   \
                                  loader_ctx->p_code_compiled,       \
@@ -4756,6 +4948,18 @@ fail:
     LOG_OP("%d\t", value);                                          \
   } while (0)
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* The memarg offset of memory64 is emitted as two uint32,
+   the low 32 bits first */
+#define emit_mem_offset(ctx, value) do {                            \
+    emit_uint32(ctx, (uint32)(value));                              \
+    if (is_memory64)                                                \
+        emit_uint32(ctx, (uint32)((value) >> 32));                  \
+  } while (0)
+#else
+#define emit_mem_offset(ctx, value) emit_uint32(ctx, value)
+#endif
+
 static bool
 wasm_loader_ctx_reinit(WASMLoaderContext *ctx)
 {
@@ -5438,6 +5642,34 @@ fail:
 #define POP_FUNCREF() TEMPLATE_POP(FUNCREF)
 #define POP_EXTERNREF() TEMPLATE_POP(EXTERNREF)
 
+/* The memory index operand is i64 for memory64 and i32 otherwise */
+#if WASM_ENABLE_FAST_INTERP != 0
+#define PUSH_MEM_OFFSET() do {                                          \
+    if (!wasm_loader_push_frame_ref_offset(loader_ctx, mem_offset_type, \
+                                           disable_emit, operand_offset,\
+                                           error_buf, error_buf_size))  \
+        goto fail;                                                      \
+  } while (0)
+
+#define POP_MEM_OFFSET() do {                                           \
+    if (!wasm_loader_pop_frame_ref_offset(loader_ctx, mem_offset_type,  \
+                                          error_buf, error_buf_size))   \
+        goto fail;                                                      \
+  } while (0)
+#else
+#define PUSH_MEM_OFFSET() do {                                          \
+    if (!(wasm_loader_push_frame_ref(loader_ctx, mem_offset_type,       \
+                                     error_buf, error_buf_size)))       \
+        goto fail;                                                      \
+  } while (0)
+
+#define POP_MEM_OFFSET() do {                                           \
+    if (!(wasm_loader_pop_frame_ref(loader_ctx, mem_offset_type,        \
+                                    error_buf, error_buf_size)))        \
+        goto fail;                                                      \
+  } while (0)
+#endif /* WASM_ENABLE_FAST_INTERP */
+
 #if WASM_ENABLE_FAST_INTERP != 0
 
 static bool
@@ -6131,6 +6363,16 @@ get_table_seg_elem_type(const WASMModule *module,
     }
     return true;
 }
+
+/* Mark the table as possibly written at runtime by table.set, table.init,
+   table.copy, table.fill or table.grow */
+static void
+set_table_possible_set(WASMModule *module, uint32 table_idx)
+{
+    if (table_idx >= module->import_table_count)
+        module->tables[table_idx - module->import_table_count]
+          .possible_set = true;
+}
 #endif
 
 static bool
@@ -6144,7 +6386,15 @@ wasm_loader_prepare_bytecode(WASMModule *module,
     BlockType func_type;
     uint16 *local_offsets, local_offset;
     uint32 type_idx, func_idx, local_idx, global_idx, table_idx;
-    uint32 table_seg_idx, data_seg_idx, count, i, align, mem_offset;
+    uint32 table_seg_idx, data_seg_idx, count, i, align;
+#if WASM_ENABLE_MEMORY64 != 0
+    bool is_memory64 = is_memory64_module(module);
+    uint8 mem_offset_type = is_memory64 ? VALUE_TYPE_I64 : VALUE_TYPE_I32;
+    uint64 mem_offset;
+#else
+    uint8 mem_offset_type = VALUE_TYPE_I32;
+    uint32 mem_offset;
+#endif
     int32 i32_const = 0;
     int64 i64;
     uint8 opcode;
@@ -6156,6 +6406,9 @@ wasm_loader_prepare_bytecode(WASMModule *module,
     int16 operand_offset = 0;
     uint8 last_op = 0;
     bool disable_emit, preserve_local = false;
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    uint32 block_counter_idx = 0;
+#endif
     float32 f32;
     float64 f64;
 
@@ -6194,6 +6447,15 @@ re_scan:
         p = func->code;
         func->code_compiled = loader_ctx->p_code_compiled;
         func->code_compiled_size = loader_ctx->code_compiled_size;
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+        if (block_counter_idx > 0
+            && !(func->block_counters = loader_malloc
+                    (sizeof(WASMBlockCounter) * (uint64)block_counter_idx,
+                     error_buf, error_buf_size)))
+            goto fail;
+        func->block_counter_count = block_counter_idx;
+        block_counter_idx = 0;
+#endif
     }
 #endif
 
@@ -6222,6 +6484,12 @@ re_scan:
             case WASM_OP_IF:
 #if WASM_ENABLE_FAST_INTERP != 0
                 PRESERVE_LOCAL_FOR_BLOCK();
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                /* count the if before the condition is checked */
+                skip_label();
+                emit_block_counter(LABEL_TYPE_IF, count);
+                emit_label(opcode);
+#endif
 #endif
                 POP_I32();
                 goto handle_op_block_and_loop;
@@ -6284,6 +6552,9 @@ handle_op_block_and_loop:
 #if WASM_ENABLE_FAST_INTERP != 0
                 if (opcode == WASM_OP_BLOCK) {
                     skip_label();
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                    emit_block_counter(LABEL_TYPE_BLOCK, count);
+#endif
                 }
                 else if (opcode == WASM_OP_LOOP) {
                     skip_label();
@@ -6297,6 +6568,10 @@ handle_op_block_and_loop:
                     }
                     (loader_ctx->frame_csp - 1)->code_compiled =
                                         loader_ctx->p_code_compiled;
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                    /* the branches back to the loop also count it */
+                    emit_block_counter(LABEL_TYPE_LOOP, count);
+#endif
                 }
                 else if (opcode == WASM_OP_IF) {
                     /* If block has parameters, we should make sure they are in
@@ -6351,7 +6626,13 @@ handle_op_block_and_loop:
 
                     emit_empty_label_addr_and_frame_ip(PATCH_ELSE);
                     emit_empty_label_addr_and_frame_ip(PATCH_END);
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                    emit_block_counter(LABEL_TYPE_IF, taken);
+#endif
                 }
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                block_counter_idx++;
+#endif
 #endif
                 break;
             }
@@ -7011,6 +7292,9 @@ handle_op_block_and_loop:
                                          error_buf, error_buf_size))
                     goto fail;
 
+                if (opcode == WASM_OP_TABLE_SET)
+                    set_table_possible_set(module, table_idx);
+
 #if WASM_ENABLE_FAST_INTERP != 0
                 emit_uint32(loader_ctx, table_idx);
 #endif
@@ -7408,13 +7692,13 @@ handle_op_block_and_loop:
 #endif
                 CHECK_MEMORY();
                 read_leb_uint32(p, p_end, align); /* align */
-                read_leb_uint32(p, p_end, mem_offset); /* offset */
+                read_leb_mem_offset(p, p_end, mem_offset); /* offset */
                 if (!check_memory_access_align(opcode, align,
                                                error_buf, error_buf_size)) {
                     goto fail;
                 }
 #if WASM_ENABLE_FAST_INTERP != 0
-                emit_uint32(loader_ctx, mem_offset);
+                emit_mem_offset(loader_ctx, mem_offset);
 #endif
                 switch (opcode)
                 {
@@ -7424,7 +7708,7 @@ handle_op_block_and_loop:
                     case WASM_OP_I32_LOAD8_U:
                     case WASM_OP_I32_LOAD16_S:
                     case WASM_OP_I32_LOAD16_U:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_I32);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_I32);
                         break;
                     case WASM_OP_I64_LOAD:
                     case WASM_OP_I64_LOAD8_S:
@@ -7433,35 +7717,35 @@ handle_op_block_and_loop:
                     case WASM_OP_I64_LOAD16_U:
                     case WASM_OP_I64_LOAD32_S:
                     case WASM_OP_I64_LOAD32_U:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_I64);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_I64);
                         break;
                     case WASM_OP_F32_LOAD:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_F32);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_F32);
                         break;
                     case WASM_OP_F64_LOAD:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_F64);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_F64);
                         break;
                     /* store */
                     case WASM_OP_I32_STORE:
                     case WASM_OP_I32_STORE8:
                     case WASM_OP_I32_STORE16:
                         POP_I32();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     case WASM_OP_I64_STORE:
                     case WASM_OP_I64_STORE8:
                     case WASM_OP_I64_STORE16:
                     case WASM_OP_I64_STORE32:
                         POP_I64();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     case WASM_OP_F32_STORE:
                         POP_F32();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     case WASM_OP_F64_STORE:
                         POP_F64();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     default:
                         break;
@@ -7477,7 +7761,7 @@ handle_op_block_and_loop:
                                   "zero byte expected");
                     goto fail;
                 }
-                PUSH_I32();
+                PUSH_MEM_OFFSET();
 
                 module->possible_memory_grow = true;
                 break;
@@ -7490,7 +7774,7 @@ handle_op_block_and_loop:
                                   "zero byte expected");
                     goto fail;
                 }
-                POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_I32);
+                POP_AND_PUSH(mem_offset_type, mem_offset_type);
 
                 func->has_op_memory_grow = true;
                 module->possible_memory_grow = true;
@@ -7815,7 +8099,7 @@ handle_op_block_and_loop:
 
                     POP_I32();
                     POP_I32();
-                    POP_I32();
+                    POP_MEM_OFFSET();
                     break;
                 }
                 case WASM_OP_DATA_DROP:
@@ -7845,9 +8129,9 @@ handle_op_block_and_loop:
                     if (module->import_memory_count == 0 && module->memory_count == 0)
                         goto fail_unknown_memory;
 
-                    POP_I32();
-                    POP_I32();
-                    POP_I32();
+                    POP_MEM_OFFSET();
+                    POP_MEM_OFFSET();
+                    POP_MEM_OFFSET();
                     break;
                 }
                 case WASM_OP_MEMORY_FILL:
@@ -7859,9 +8143,9 @@ handle_op_block_and_loop:
                         goto fail_unknown_memory;
                     }
 
+                    POP_MEM_OFFSET();
                     POP_I32();
-                    POP_I32();
-                    POP_I32();
+                    POP_MEM_OFFSET();
                     break;
 fail_zero_byte_expected:
                     set_error_buf(error_buf, error_buf_size,
@@ -7905,6 +8189,8 @@ fail_data_cnt_sec_require:
                         goto fail;
                     }
 
+                    set_table_possible_set(module, table_idx);
+
 #if WASM_ENABLE_FAST_INTERP != 0
                     emit_uint32(loader_ctx, table_seg_idx);
                     emit_uint32(loader_ctx, table_idx);
@@ -7954,6 +8240,8 @@ fail_data_cnt_sec_require:
                         goto fail;
                     }
 
+                    set_table_possible_set(module, dst_tbl_idx);
+
 #if WASM_ENABLE_FAST_INTERP != 0
                     emit_uint32(loader_ctx, src_tbl_idx);
                     emit_uint32(loader_ctx, dst_tbl_idx);
@@ -7998,6 +8286,8 @@ fail_data_cnt_sec_require:
                                              error_buf_size))
                         goto fail;
 
+                    set_table_possible_set(module, table_idx);
+
                     if (opcode1 == WASM_OP_TABLE_GROW) {
                         if (table_idx < module->import_table_count) {
                             module->import_tables[table_idx]
@@ -8062,10 +8352,10 @@ fail_data_cnt_sec_require:
                             goto fail;
                         }
 
-                        read_leb_uint32(p, p_end, mem_offset); /* offset */
+                        read_leb_mem_offset(p, p_end, mem_offset); /* offset */
 
                         /* pop(i32 %i), push(v128 *result) */
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_V128);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_V128);
                         break;
                     }
 
@@ -8079,12 +8369,12 @@ fail_data_cnt_sec_require:
                             goto fail;
                         }
 
-                        read_leb_uint32(p, p_end, mem_offset); /* offset */
+                        read_leb_mem_offset(p, p_end, mem_offset); /* offset */
 
                         /* pop(v128 %value) */
                         POP_V128();
                         /* pop(i32 %i) */
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     }
 
@@ -8420,6 +8710,14 @@ fail_data_cnt_sec_require:
 #endif
                 if (opcode != WASM_OP_ATOMIC_FENCE) {
                     CHECK_MEMORY();
+#if WASM_ENABLE_MEMORY64 != 0
+                    if (is_memory64) {
+                        set_error_buf(error_buf, error_buf_size,
+                                      "atomic operations on memory64 "
+                                      "aren't supported");
+                        goto fail;
+                    }
+#endif
                     read_leb_uint32(p, p_end, align); /* align */
                     read_leb_uint32(p, p_end, mem_offset); /* offset */
                     if (!check_memory_align_equal(opcode, align,
@@ -10,6 +10,10 @@
 #include "wasm_opcode.h"
 #include "wasm_runtime.h"
 #include "../common/wasm_native.h"
+#include "../common/wasm_startup_timing.h"
+#if WASM_ENABLE_BASELINE_JIT != 0
+#include "wasm_jit_baseline.h"
+#endif
 
 /* Read a value of given type from the address pointed to by the given
    pointer and increase the pointer to the position just after the
@@ -150,6 +154,25 @@ read_leb(uint8 **p_buf, const uint8 *buf_end,
   res = (int32)res64;                               \
 } while (0)
 
+#if WASM_ENABLE_MEMORY64 != 0
+#define read_leb_uint64(p, p_end, res) do {         \
+  uint64 res64;                                     \
+  read_leb((uint8**)&p, p_end, 64, false, &res64,   \
+                error_buf, error_buf_size);         \
+  res = res64;                                      \
+} while (0)
+
+/* The memarg offset is u64 for memory64 */
+#define read_leb_mem_offset(p, p_end, res) do {     \
+  if (is_memory64)                                  \
+    read_leb_uint64(p, p_end, res);                 \
+  else                                              \
+    read_leb_uint32(p, p_end, res);                 \
+} while (0)
+#else
+#define read_leb_mem_offset(p, p_end, res) read_leb_uint32(p, p_end, res)
+#endif
+
 static void *
 loader_malloc(uint64 size, char *error_buf, uint32 error_buf_size)
 {
@@ -429,6 +452,11 @@ load_function_import(const uint8 **p_buf, const uint8 *buf_end,
     function->signature = linked_signature;
     function->attachment = linked_attachment;
     function->call_conv_raw = linked_call_conv_raw;
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    function->call_stats = linked_func
+        ? wasm_native_lookup_call_stats(sub_module_name, function_name)
+        : NULL;
+#endif
     return true;
 }
 
@@ -479,6 +507,36 @@ load_table_import(const uint8 **p_buf, const uint8 *buf_end,
 unsigned
 wasm_runtime_memory_pool_size();
 
+#if WASM_ENABLE_MEMORY64 != 0
+static void
+load_memory64_limits(const uint8 **p_buf, const uint8 *buf_end, uint32 flags,
+                     uint32 *p_init_page_count, uint32 *p_max_page_count,
+                     char *error_buf, uint32 error_buf_size)
+{
+    const uint8 *p = *p_buf, *p_end = buf_end;
+    uint64 init_page_count, max_page_count = WASM_MEMORY64_MAX_PAGES;
+
+    /* Shared memory64 isn't supported */
+    bh_assert(!(flags & 0x02));
+
+    /* The limits of memory64 are encoded as u64 */
+    read_leb_uint64(p, p_end, init_page_count);
+    bh_assert(init_page_count <= WASM_MEMORY64_MAX_PAGES);
+    if (flags & 1) {
+        read_leb_uint64(p, p_end, max_page_count);
+        bh_assert(init_page_count <= max_page_count);
+    }
+
+    /* Limit the maximum memory size to WASM_MEMORY64_MAX_PAGES */
+    if (max_page_count > WASM_MEMORY64_MAX_PAGES)
+        max_page_count = WASM_MEMORY64_MAX_PAGES;
+
+    *p_init_page_count = (uint32)init_page_count;
+    *p_max_page_count = (uint32)max_page_count;
+    *p_buf = p;
+}
+#endif /* end of WASM_ENABLE_MEMORY64 */
+
 static bool
 load_memory_import(const uint8 **p_buf, const uint8 *buf_end,
                    WASMModule *parent_module,
@@ -500,6 +558,22 @@ load_memory_import(const uint8 **p_buf, const uint8 *buf_end,
     uint32 declare_max_page_count = 0;
 
     read_leb_uint32(p, p_end, declare_max_page_count_flag);
+#if WASM_ENABLE_MEMORY64 != 0
+    if (declare_max_page_count_flag & MEMORY64_FLAG) {
+        load_memory64_limits(&p, p_end, declare_max_page_count_flag,
+                             &declare_init_page_count,
+                             &declare_max_page_count,
+                             error_buf, error_buf_size);
+
+        memory->flags = declare_max_page_count_flag;
+        memory->init_page_count = declare_init_page_count;
+        memory->max_page_count = declare_max_page_count;
+        memory->num_bytes_per_page = DEFAULT_NUM_BYTES_PER_PAGE;
+
+        *p_buf = p;
+        return true;
+    }
+#endif
     read_leb_uint32(p, p_end, declare_init_page_count);
     bh_assert(declare_init_page_count <= 65536);
 
@@ -618,6 +692,19 @@ load_memory(const uint8 **p_buf, const uint8 *buf_end, WASMMemory *memory,
     read_leb_uint32(p, p_end, memory->flags);
     bh_assert(p - p_org <= 1);
     (void)p_org;
+#if WASM_ENABLE_MEMORY64 != 0
+    if (memory->flags & MEMORY64_FLAG) {
+        bh_assert(memory->flags <= (MEMORY64_FLAG | 0x03));
+        load_memory64_limits(&p, p_end, memory->flags,
+                             &memory->init_page_count,
+                             &memory->max_page_count,
+                             error_buf, error_buf_size);
+        memory->num_bytes_per_page = DEFAULT_NUM_BYTES_PER_PAGE;
+
+        *p_buf = p;
+        return true;
+    }
+#endif
 #if WASM_ENABLE_SHARED_MEMORY == 0
     bh_assert(memory->flags <= 1);
 #else
@@ -1491,6 +1578,19 @@ load_table_segment_section(const uint8 *buf, const uint8 *buf_end, WASMModule *m
     return true;
 }
 
+#if WASM_ENABLE_MEMORY64 != 0
+static bool
+is_memory64_module(const WASMModule *module)
+{
+    if (module->import_memory_count > 0)
+        return module->import_memories[0].u.memory.flags & MEMORY64_FLAG
+               ? true : false;
+    if (module->memory_count > 0)
+        return module->memories[0].flags & MEMORY64_FLAG ? true : false;
+    return false;
+}
+#endif
+
 static bool
 load_data_segment_section(const uint8 *buf, const uint8 *buf_end,
                           WASMModule *module,
@@ -1501,6 +1601,13 @@ load_data_segment_section(const uint8 *buf, const uint8 *buf_end,
     uint64 total_size;
     WASMDataSeg *dataseg;
     InitializerExpression init_expr;
+    /* The offset of data segment is i64 for memory64 */
+#if WASM_ENABLE_MEMORY64 != 0
+    uint8 offset_type = is_memory64_module(module)
+                        ? VALUE_TYPE_I64 : VALUE_TYPE_I32;
+#else
+    uint8 offset_type = VALUE_TYPE_I32;
+#endif
 #if WASM_ENABLE_BULK_MEMORY != 0
     bool is_passive = false;
     uint32 mem_flag;
@@ -1554,7 +1661,7 @@ check_mem_index:
 #if WASM_ENABLE_BULK_MEMORY != 0
             if (!is_passive)
 #endif
-                if (!load_init_expr(&p, p_end, &init_expr, VALUE_TYPE_I32,
+                if (!load_init_expr(&p, p_end, &init_expr, offset_type,
                                     error_buf, error_buf_size))
                     return false;
 
@@ -1785,6 +1892,16 @@ get_table_seg_elem_type(const WASMModule *module,
     }
     return true;
 }
+
+/* Mark the table as possibly written at runtime by table.set, table.init,
+   table.copy, table.fill or table.grow */
+static void
+set_table_possible_set(WASMModule *module, uint32 table_idx)
+{
+    if (table_idx >= module->import_table_count)
+        module->tables[table_idx - module->import_table_count]
+          .possible_set = true;
+}
 #endif
 
 static bool
@@ -2089,13 +2206,25 @@ load_from_sections(WASMModule *module, WASMSection *sections,
     handle_table = wasm_interp_get_handle_table();
 #endif
 
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_VALIDATE);
     for (i = 0; i < module->function_count; i++) {
         WASMFunction *func = module->functions[i];
         if (!wasm_loader_prepare_bytecode(module, func, i,
                                           error_buf, error_buf_size)) {
+            STARTUP_TIMING_END(WASM_STARTUP_VALIDATE);
             return false;
         }
     }
+    STARTUP_TIMING_END(WASM_STARTUP_VALIDATE);
+
+#if WASM_ENABLE_BASELINE_JIT != 0
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_COMPILE);
+    if (!wasm_jit_baseline_compile(module, error_buf, error_buf_size)) {
+        STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
+        return false;
+    }
+    STARTUP_TIMING_END(WASM_STARTUP_COMPILE);
+#endif
 
     if (!module->possible_memory_grow) {
         WASMMemoryImport *memory_import;
@@ -2377,6 +2506,10 @@ wasm_loader_unload(WASMModule *module)
     if (!module)
         return;
 
+#if WASM_ENABLE_BASELINE_JIT != 0
+    wasm_jit_baseline_destroy(module);
+#endif
+
     if (module->types) {
         for (i = 0; i < module->type_count; i++) {
             if (module->types[i])
@@ -2398,6 +2531,10 @@ wasm_loader_unload(WASMModule *module)
                     wasm_runtime_free(module->functions[i]->code_compiled);
                 if (module->functions[i]->consts)
                     wasm_runtime_free(module->functions[i]->consts);
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                if (module->functions[i]->block_counters)
+                    wasm_runtime_free(module->functions[i]->block_counters);
 #endif
                 wasm_runtime_free(module->functions[i]);
             }
@@ -3382,6 +3519,26 @@ wasm_loader_pop_frame_csp(WASMLoaderContext *ctx,
   } while (0)
 #endif /* end of WASM_ENABLE_LABELS_AS_VALUES */
 
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+/* Emit the counter of the block started by the current opcode, the
+   counters are allocated after the first traversal counts them */
+#define emit_block_counter(type, field) do {                        \
+    emit_label(EXT_OP_BLOCK_COUNT);                                 \
+    if (loader_ctx->p_code_compiled) {                              \
+        WASMBlockCounter *block_counter =                           \
+            func->block_counters + block_counter_idx;               \
+        bh_assert(block_counter_idx < func->block_counter_count);   \
+        block_counter->code_offset =                                \
+            (uint32)(p_org - 1 - func->code);                       \
+        block_counter->label_type = type;                           \
+        wasm_loader_emit_ptr(loader_ctx, &block_counter->field);    \
+    }                                                               \
+    else {                                                          \
+        wasm_loader_emit_ptr(loader_ctx, NULL);                     \
+    }                                                               \
+  } while (0)
+#endif
+
 #define emit_empty_label_addr_and_frame_ip(type) do {               \
     if (!add_label_patch_to_list(loader_ctx->frame_csp - 1, type,   \
                                  loader_ctx->p_code_compiled,       \
@@ -3465,6 +3622,18 @@ wasm_loader_pop_frame_csp(WASMLoaderContext *ctx,
     LOG_OP("%d\t", value);                                          \
   } while (0)
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* The memarg offset of memory64 is emitted as two uint32,
+   the low 32 bits first */
+#define emit_mem_offset(ctx, value) do {                            \
+    emit_uint32(ctx, (uint32)(value));                              \
+    if (is_memory64)                                                \
+        emit_uint32(ctx, (uint32)((value) >> 32));                  \
+  } while (0)
+#else
+#define emit_mem_offset(ctx, value) emit_uint32(ctx, value)
+#endif
+
 static bool
 wasm_loader_ctx_reinit(WASMLoaderContext *ctx)
 {
@@ -4116,6 +4285,20 @@ fail:
         goto fail;                                                      \
   } while (0)
 
+/* The memory index operand is i64 for memory64 and i32 otherwise */
+#define PUSH_MEM_OFFSET() do {                                          \
+    if (!wasm_loader_push_frame_ref_offset(loader_ctx, mem_offset_type, \
+                                           disable_emit, operand_offset,\
+                                           error_buf, error_buf_size))  \
+        goto fail;                                                      \
+  } while (0)
+
+#define POP_MEM_OFFSET() do {                                           \
+    if (!wasm_loader_pop_frame_ref_offset(loader_ctx, mem_offset_type,  \
+                                          error_buf, error_buf_size))   \
+        goto fail;                                                      \
+  } while (0)
+
 #define PUSH_OFFSET_TYPE(type) do {                                     \
     if (!(wasm_loader_push_frame_offset(loader_ctx, type,               \
                                         disable_emit, operand_offset,   \
@@ -4208,6 +4391,19 @@ fail:
         goto fail;                                                  \
   } while (0)
 
+/* The memory index operand is i64 for memory64 and i32 otherwise */
+#define PUSH_MEM_OFFSET() do {                                      \
+    if (!(wasm_loader_push_frame_ref(loader_ctx, mem_offset_type,   \
+                                     error_buf, error_buf_size)))   \
+        goto fail;                                                  \
+  } while (0)
+
+#define POP_MEM_OFFSET() do {                                       \
+    if (!(wasm_loader_pop_frame_ref(loader_ctx, mem_offset_type,    \
+                                    error_buf, error_buf_size)))    \
+        goto fail;                                                  \
+  } while (0)
+
 #define POP_AND_PUSH(type_pop, type_push) do {                           \
     if (!(wasm_loader_push_pop_frame_ref(loader_ctx, 1,                  \
                                          type_push, type_pop,            \
@@ -4748,7 +4944,15 @@ wasm_loader_prepare_bytecode(WASMModule *module,
     uint8 *param_types, *local_types, local_type, global_type;
     BlockType func_type;
     uint16 *local_offsets, local_offset;
-    uint32 count, i, local_idx, global_idx, u32, align, mem_offset;
+    uint32 count, i, local_idx, global_idx, u32, align;
+#if WASM_ENABLE_MEMORY64 != 0
+    bool is_memory64 = is_memory64_module(module);
+    uint8 mem_offset_type = is_memory64 ? VALUE_TYPE_I64 : VALUE_TYPE_I32;
+    uint64 mem_offset;
+#else
+    uint8 mem_offset_type = VALUE_TYPE_I32;
+    uint32 mem_offset;
+#endif
     int32 i32, i32_const = 0;
     int64 i64;
     uint8 opcode, u8;
@@ -4763,6 +4967,9 @@ wasm_loader_prepare_bytecode(WASMModule *module,
     int16 operand_offset = 0;
     uint8 last_op = 0;
     bool disable_emit, preserve_local = false;
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    uint32 block_counter_idx = 0;
+#endif
     float32 f32;
     float64 f64;
 
@@ -4801,6 +5008,15 @@ re_scan:
         p = func->code;
         func->code_compiled = loader_ctx->p_code_compiled;
         func->code_compiled_size = loader_ctx->code_compiled_size;
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+        if (block_counter_idx > 0
+            && !(func->block_counters = loader_malloc
+                    (sizeof(WASMBlockCounter) * (uint64)block_counter_idx,
+                     error_buf, error_buf_size)))
+            goto fail;
+        func->block_counter_count = block_counter_idx;
+        block_counter_idx = 0;
+#endif
     }
 #endif
 
@@ -4829,6 +5045,12 @@ re_scan:
             case WASM_OP_IF:
 #if WASM_ENABLE_FAST_INTERP != 0
                 PRESERVE_LOCAL_FOR_BLOCK();
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                /* count the if before the condition is checked */
+                skip_label();
+                emit_block_counter(LABEL_TYPE_IF, count);
+                emit_label(opcode);
+#endif
 #endif
                 POP_I32();
                 goto handle_op_block_and_loop;
@@ -4887,6 +5109,9 @@ handle_op_block_and_loop:
 #if WASM_ENABLE_FAST_INTERP != 0
                 if (opcode == WASM_OP_BLOCK) {
                     skip_label();
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                    emit_block_counter(LABEL_TYPE_BLOCK, count);
+#endif
                 }
                 else if (opcode == WASM_OP_LOOP) {
                     skip_label();
@@ -4900,6 +5125,10 @@ handle_op_block_and_loop:
                     }
                     (loader_ctx->frame_csp - 1)->code_compiled =
                                         loader_ctx->p_code_compiled;
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                    /* the branches back to the loop also count it */
+                    emit_block_counter(LABEL_TYPE_LOOP, count);
+#endif
                 }
                 else if (opcode == WASM_OP_IF) {
                     /* If block has parameters, we should make sure they are in
@@ -4954,7 +5183,13 @@ handle_op_block_and_loop:
 
                     emit_empty_label_addr_and_frame_ip(PATCH_ELSE);
                     emit_empty_label_addr_and_frame_ip(PATCH_END);
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                    emit_block_counter(LABEL_TYPE_IF, taken);
+#endif
                 }
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+                block_counter_idx++;
+#endif
 #endif
                 break;
             }
@@ -5505,6 +5740,9 @@ handle_op_block_and_loop:
                                          error_buf, error_buf_size))
                     goto fail;
 
+                if (opcode == WASM_OP_TABLE_SET)
+                    set_table_possible_set(module, table_idx);
+
 #if WASM_ENABLE_FAST_INTERP != 0
                 emit_uint32(loader_ctx, table_idx);
 #endif
@@ -5892,9 +6130,9 @@ handle_op_block_and_loop:
 #endif
                 CHECK_MEMORY();
                 read_leb_uint32(p, p_end, align); /* align */
-                read_leb_uint32(p, p_end, mem_offset); /* offset */
+                read_leb_mem_offset(p, p_end, mem_offset); /* offset */
 #if WASM_ENABLE_FAST_INTERP != 0
-                emit_uint32(loader_ctx, mem_offset);
+                emit_mem_offset(loader_ctx, mem_offset);
 #endif
                 switch (opcode)
                 {
@@ -5904,7 +6142,7 @@ handle_op_block_and_loop:
                     case WASM_OP_I32_LOAD8_U:
                     case WASM_OP_I32_LOAD16_S:
                     case WASM_OP_I32_LOAD16_U:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_I32);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_I32);
                         break;
                     case WASM_OP_I64_LOAD:
                     case WASM_OP_I64_LOAD8_S:
@@ -5913,35 +6151,35 @@ handle_op_block_and_loop:
                     case WASM_OP_I64_LOAD16_U:
                     case WASM_OP_I64_LOAD32_S:
                     case WASM_OP_I64_LOAD32_U:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_I64);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_I64);
                         break;
                     case WASM_OP_F32_LOAD:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_F32);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_F32);
                         break;
                     case WASM_OP_F64_LOAD:
-                        POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_F64);
+                        POP_AND_PUSH(mem_offset_type, VALUE_TYPE_F64);
                         break;
                     /* store */
                     case WASM_OP_I32_STORE:
                     case WASM_OP_I32_STORE8:
                     case WASM_OP_I32_STORE16:
                         POP_I32();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     case WASM_OP_I64_STORE:
                     case WASM_OP_I64_STORE8:
                     case WASM_OP_I64_STORE16:
                     case WASM_OP_I64_STORE32:
                         POP_I64();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     case WASM_OP_F32_STORE:
                         POP_F32();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     case WASM_OP_F64_STORE:
                         POP_F64();
-                        POP_I32();
+                        POP_MEM_OFFSET();
                         break;
                     default:
                         break;
@@ -5954,7 +6192,7 @@ handle_op_block_and_loop:
                 /* reserved byte 0x00 */
                 bh_assert(*p == 0x00);
                 p++;
-                PUSH_I32();
+                PUSH_MEM_OFFSET();
 
                 module->possible_memory_grow = true;
                 break;
@@ -5964,7 +6202,7 @@ handle_op_block_and_loop:
                 /* reserved byte 0x00 */
                 bh_assert(*p == 0x00);
                 p++;
-                POP_AND_PUSH(VALUE_TYPE_I32, VALUE_TYPE_I32);
+                POP_AND_PUSH(mem_offset_type, mem_offset_type);
 
                 func->has_op_memory_grow = true;
                 module->possible_memory_grow = true;
@@ -6281,7 +6519,7 @@ handle_op_block_and_loop:
 
                     POP_I32();
                     POP_I32();
-                    POP_I32();
+                    POP_MEM_OFFSET();
                     break;
                 case WASM_OP_DATA_DROP:
                     read_leb_uint32(p, p_end, segment_index);
@@ -6299,9 +6537,9 @@ handle_op_block_and_loop:
                     bh_assert(module->import_memory_count
                               + module->memory_count > 0);
 
-                    POP_I32();
-                    POP_I32();
-                    POP_I32();
+                    POP_MEM_OFFSET();
+                    POP_MEM_OFFSET();
+                    POP_MEM_OFFSET();
                     break;
                 case WASM_OP_MEMORY_FILL:
                     bh_assert(*p == 0);
@@ -6310,9 +6548,9 @@ handle_op_block_and_loop:
                     bh_assert(module->import_memory_count
                               + module->memory_count > 0);
 
+                    POP_MEM_OFFSET();
                     POP_I32();
-                    POP_I32();
-                    POP_I32();
+                    POP_MEM_OFFSET();
                     break;
 #endif /* WASM_ENABLE_BULK_MEMORY */
 #if WASM_ENABLE_REF_TYPES != 0
@@ -6343,6 +6581,8 @@ handle_op_block_and_loop:
                         goto fail;
                     }
 
+                    set_table_possible_set(module, table_idx);
+
 #if WASM_ENABLE_FAST_INTERP != 0
                     emit_uint32(loader_ctx, table_seg_idx);
                     emit_uint32(loader_ctx, table_idx);
@@ -6393,6 +6633,8 @@ handle_op_block_and_loop:
                         goto fail;
                     }
 
+                    set_table_possible_set(module, dst_tbl_idx);
+
 #if WASM_ENABLE_FAST_INTERP != 0
                     emit_uint32(loader_ctx, src_tbl_idx);
                     emit_uint32(loader_ctx, dst_tbl_idx);
@@ -6439,6 +6681,8 @@ handle_op_block_and_loop:
                                              error_buf_size))
                         goto fail;
 
+                    set_table_possible_set(module, table_idx);
+
                     if (opcode1 == WASM_OP_TABLE_GROW) {
                         if (table_idx < module->import_table_count) {
                             module->import_tables[table_idx]
@@ -6482,6 +6726,10 @@ handle_op_block_and_loop:
 #endif
                 if (opcode != WASM_OP_ATOMIC_FENCE) {
                     CHECK_MEMORY();
+#if WASM_ENABLE_MEMORY64 != 0
+                    /* Atomic operations on memory64 aren't supported */
+                    bh_assert(!is_memory64);
+#endif
                     read_leb_uint32(p, p_end, align); /* align */
                     read_leb_uint32(p, p_end, mem_offset); /* offset */
 #if WASM_ENABLE_FAST_INTERP != 0
@@ -267,6 +267,9 @@ typedef enum WASMOpcode {
     EXT_OP_LOOP                   = 0xd4, /* loop with blocktype */
     EXT_OP_IF                     = 0xd5, /* if with blocktype */
 
+    /* Used by fast interpreter to count the block entries */
+    EXT_OP_BLOCK_COUNT            = 0xd6,
+
     /* Post-MVP extend op prefix */
     WASM_OP_MISC_PREFIX           = 0xfc,
     WASM_OP_SIMD_PREFIX           = 0xfd,
@@ -822,6 +825,7 @@ static type _name[WASM_INSTRUCTION_NUM] = {                  \
   HANDLE_OPCODE (EXT_OP_BLOCK),              /* 0xd3 */      \
   HANDLE_OPCODE (EXT_OP_LOOP),               /* 0xd4 */      \
   HANDLE_OPCODE (EXT_OP_IF),                 /* 0xd5 */      \
+  HANDLE_OPCODE (EXT_OP_BLOCK_COUNT),        /* 0xd6 */      \
 };                                                           \
 do {                                                         \
   _name[WASM_OP_MISC_PREFIX] =                               \
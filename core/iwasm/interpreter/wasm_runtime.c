@@ -16,6 +16,17 @@
 #if WASM_ENABLE_THREAD_MGR != 0
 #include "../libraries/thread-mgr/thread_manager.h"
 #endif
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+#include "../common/wasm_sampling_profiler.h"
+#endif
+#include "../common/wasm_startup_timing.h"
+#if WASM_ENABLE_METRICS != 0
+#include "../common/wasm_metrics.h"
+#endif
+#include "../common/wasm_usdt.h"
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+#include "wasm_opcode.h"
+#endif
 
 static void
 set_error_buf(char *error_buf, uint32 error_buf_size, const char *string)
@@ -94,6 +105,53 @@ get_sub_module_inst(const WASMModuleInstance *parent_module_inst,
 }
 #endif
 
+#if WASM_ENABLE_MEMORY64 != 0
+/* Reserve the space of max pages for memory64 and commit the initial
+   pages, so that the memory is never moved when it is enlarged */
+static uint8 *
+memory64_data_alloc(uint32 num_bytes_per_page,
+                    uint32 init_page_count, uint32 max_page_count,
+                    char *error_buf, uint32 error_buf_size)
+{
+    uint64 map_size = (uint64)num_bytes_per_page * max_page_count;
+    uint64 init_size = (uint64)num_bytes_per_page * init_page_count;
+    uint8 *p;
+
+    if (map_size >= SIZE_MAX
+        || !(p = os_mmap(NULL, (size_t)map_size,
+                         MMAP_PROT_NONE, MMAP_MAP_NONE))) {
+        set_error_buf(error_buf, error_buf_size, "mmap memory failed");
+        return NULL;
+    }
+
+    if (init_size > 0) {
+#ifdef BH_PLATFORM_WINDOWS
+        if (!os_mem_commit(p, (size_t)init_size,
+                           MMAP_PROT_READ | MMAP_PROT_WRITE)) {
+            set_error_buf(error_buf, error_buf_size, "commit memory failed");
+            os_munmap(p, (size_t)map_size);
+            return NULL;
+        }
+#endif
+        if (os_mprotect(p, (size_t)init_size,
+                        MMAP_PROT_READ | MMAP_PROT_WRITE) != 0) {
+            set_error_buf(error_buf, error_buf_size, "mprotect memory failed");
+            os_munmap(p, (size_t)map_size);
+            return NULL;
+        }
+    }
+    return p;
+}
+
+static void
+memory64_data_free(WASMMemoryInstance *memory)
+{
+    os_munmap(memory->memory_data,
+              (size_t)((uint64)memory->num_bytes_per_page
+                       * memory->max_page_count));
+}
+#endif /* end of WASM_ENABLE_MEMORY64 */
+
 /**
  * Destroy memory instances.
  */
@@ -129,6 +187,14 @@ memories_deinstantiate(WASMModuleInstance *module_inst,
                     wasm_runtime_free(memories[i]->heap_handle);
                     memories[i]->heap_handle = NULL;
                 }
+#if WASM_ENABLE_MEMORY64 != 0
+                if (memories[i]->is_memory64) {
+                    if (memories[i]->memory_data)
+                        memory64_data_free(memories[i]);
+                    wasm_runtime_free(memories[i]);
+                    continue;
+                }
+#endif
                 if (memories[i]->memory_data)
                     wasm_runtime_free(memories[i]->memory_data);
                 wasm_runtime_free(memories[i]);
@@ -153,6 +219,13 @@ memory_instantiate(WASMModuleInstance *module_inst,
     uint32 inc_page_count, aux_heap_base, global_idx;
     uint32 bytes_of_last_page, bytes_to_page_end;
     uint8 *global_addr;
+    uint32 max_page_limit = 65536;
+#if WASM_ENABLE_MEMORY64 != 0
+    bool is_memory64 = flags & MEMORY64_FLAG ? true : false;
+
+    if (is_memory64)
+        max_page_limit = WASM_MEMORY64_MAX_PAGES;
+#endif
 
 #if WASM_ENABLE_SHARED_MEMORY != 0
     bool is_shared_memory = flags & 0x02 ? true : false;
@@ -186,6 +259,17 @@ memory_instantiate(WASMModuleInstance *module_inst,
         heap_size = 0;
     }
 
+#if WASM_ENABLE_MEMORY64 != 0
+    if (is_memory64 && heap_size > 0
+        && (uint64)num_bytes_per_page * init_page_count + heap_size
+             > UINT32_MAX) {
+        /* The app heap is accessed with 32-bit app offsets */
+        LOG_WARNING("App heap is disabled since memory64 initial size "
+                    "exceeds 4GB");
+        heap_size = 0;
+    }
+#endif
+
     if (init_page_count == max_page_count && init_page_count == 1) {
         /* If only one page and at most one page, we just append
            the app heap to the end of linear memory, enlarge the
@@ -240,13 +324,14 @@ memory_instantiate(WASMModuleInstance *module_inst,
         }
         init_page_count += inc_page_count;
         max_page_count += inc_page_count;
-        if (init_page_count > 65536) {
-            set_error_buf(error_buf, error_buf_size,
-                          "memory size must be at most 65536 pages (4GiB)");
+        if (init_page_count > max_page_limit) {
+            set_error_buf_v(error_buf, error_buf_size,
+                            "memory size must be at most %u pages",
+                            max_page_limit);
             return NULL;
         }
-        if (max_page_count > 65536)
-            max_page_count = 65536;
+        if (max_page_count > max_page_limit)
+            max_page_count = max_page_limit;
     }
 
     LOG_VERBOSE("Memory instantiate:");
@@ -268,6 +353,19 @@ memory_instantiate(WASMModuleInstance *module_inst,
         return NULL;
     }
 
+#if WASM_ENABLE_MEMORY64 != 0
+    if (is_memory64) {
+        memory->is_memory64 = true;
+        if (max_page_count > 0
+            && !(memory->memory_data =
+                    memory64_data_alloc(num_bytes_per_page, init_page_count,
+                                        max_page_count,
+                                        error_buf, error_buf_size))) {
+            goto fail1;
+        }
+    }
+    else
+#endif
     if (memory_data_size > 0
         && !(memory->memory_data =
                     runtime_malloc(memory_data_size,
@@ -282,7 +380,7 @@ memory_instantiate(WASMModuleInstance *module_inst,
 
     memory->heap_data = memory->memory_data + heap_offset;
     memory->heap_data_end = memory->heap_data + heap_size;
-    memory->memory_data_end = memory->memory_data + (uint32)memory_data_size;
+    memory->memory_data_end = memory->memory_data + memory_data_size;
 
     /* Initialize heap */
     if (heap_size > 0) {
@@ -329,6 +427,13 @@ fail3:
     if (heap_size > 0)
         wasm_runtime_free(memory->heap_handle);
 fail2:
+#if WASM_ENABLE_MEMORY64 != 0
+    if (memory->is_memory64) {
+        if (memory->memory_data)
+            memory64_data_free(memory);
+    }
+    else
+#endif
     if (memory->memory_data)
         wasm_runtime_free(memory->memory_data);
 fail1:
@@ -1116,160 +1221,54 @@ check_linked_symbol(WASMModuleInstance *module_inst, char *error_buf,
 }
 
 /**
- * Instantiate module
+ * Initialize the global data with the initial values of globals
  */
-WASMModuleInstance*
-wasm_instantiate(WASMModule *module, bool is_sub_inst,
-                 uint32 stack_size, uint32 heap_size,
-                 char *error_buf, uint32 error_buf_size)
+static void
+globals_init_data(WASMModuleInstance *module_inst)
 {
-    WASMModuleInstance *module_inst;
-    WASMGlobalInstance *globals = NULL, *global;
-    uint32 global_count, global_data_size = 0, i;
-    uint32 base_offset, length;
-    uint8 *global_data, *global_data_end;
-#if WASM_ENABLE_MULTI_MODULE != 0
-    bool ret = false;
-#endif
-
-    if (!module)
-        return NULL;
-
-    /* Check heap size */
-    heap_size = align_uint(heap_size, 8);
-    if (heap_size > APP_HEAP_SIZE_MAX)
-        heap_size = APP_HEAP_SIZE_MAX;
-
-    /* Allocate the memory */
-    if (!(module_inst = runtime_malloc(sizeof(WASMModuleInstance),
-                                       error_buf, error_buf_size))) {
-        return NULL;
-    }
-
-    module_inst->module = module;
-
-#if WASM_ENABLE_MULTI_MODULE != 0
-    module_inst->sub_module_inst_list =
-      &module_inst->sub_module_inst_list_head;
-    ret = sub_module_instantiate(module, module_inst, stack_size, heap_size,
-                                 error_buf, error_buf_size);
-    if (!ret) {
-        LOG_DEBUG("build a sub module list failed");
-        goto fail;
-    }
-#endif
-
-#if WASM_ENABLE_DUMP_CALL_STACK != 0
-    if (!(module_inst->frames = runtime_malloc((uint64)sizeof(Vector),
-                                               error_buf, error_buf_size))) {
-        goto fail;
-    }
-#endif
-
-    /* Instantiate global firstly to get the mutable data size */
-    global_count = module->import_global_count + module->global_count;
-    if (global_count
-        && !(globals = globals_instantiate(module, module_inst,
-                                           &global_data_size,
-                                           error_buf, error_buf_size))) {
-        goto fail;
-    }
-    module_inst->global_count = global_count;
-    module_inst->globals = globals;
-
-    module_inst->memory_count =
-        module->import_memory_count + module->memory_count;
-    module_inst->table_count =
-        module->import_table_count + module->table_count;
-    module_inst->function_count =
-        module->import_function_count + module->function_count;
-
-    /* export */
-    module_inst->export_func_count = get_export_count(module, EXPORT_KIND_FUNC);
-#if WASM_ENABLE_MULTI_MODULE != 0
-    module_inst->export_tab_count = get_export_count(module, EXPORT_KIND_TABLE);
-    module_inst->export_mem_count = get_export_count(module, EXPORT_KIND_MEMORY);
-    module_inst->export_glob_count = get_export_count(module, EXPORT_KIND_GLOBAL);
-#endif
-
-    if (global_count > 0) {
-        if (!(module_inst->global_data = runtime_malloc
-                    (global_data_size, error_buf, error_buf_size))) {
-            goto fail;
-        }
-    }
-
-    /* Instantiate memories/tables/functions */
-    if ((module_inst->memory_count > 0
-         && !(module_inst->memories =
-                memories_instantiate(module,
-                                     module_inst,
-                                     heap_size, error_buf, error_buf_size)))
-        || (module_inst->table_count > 0
-            && !(module_inst->tables =
-                   tables_instantiate(module,
-                                      module_inst,
-                                      error_buf, error_buf_size)))
-        || (module_inst->function_count > 0
-            && !(module_inst->functions =
-                   functions_instantiate(module,
-                                         module_inst,
-                                         error_buf, error_buf_size)))
-        || (module_inst->export_func_count > 0
-            && !(module_inst->export_functions = export_functions_instantiate(
-                   module, module_inst, module_inst->export_func_count,
-                   error_buf, error_buf_size)))
-#if WASM_ENABLE_MULTI_MODULE != 0
-        || (module_inst->export_glob_count > 0
-            && !(module_inst->export_globals = export_globals_instantiate(
-                   module, module_inst, module_inst->export_glob_count,
-                   error_buf, error_buf_size)))
-#endif
-    ) {
-        goto fail;
-    }
+    WASMGlobalInstance *global = module_inst->globals;
+    uint8 *global_data;
+    uint32 i;
 
-    if (global_count > 0) {
-        /* Initialize the global data */
-        global_data = module_inst->global_data;
-        global_data_end = global_data + global_data_size;
-        global = globals;
-        for (i = 0; i < global_count; i++, global++) {
-            switch (global->type) {
-                case VALUE_TYPE_I32:
-                case VALUE_TYPE_F32:
+    for (i = 0; i < module_inst->global_count; i++, global++) {
+        global_data = module_inst->global_data + global->data_offset;
+        switch (global->type) {
+            case VALUE_TYPE_I32:
+            case VALUE_TYPE_F32:
 #if WASM_ENABLE_REF_TYPES != 0
-                case VALUE_TYPE_FUNCREF:
-                case VALUE_TYPE_EXTERNREF:
+            case VALUE_TYPE_FUNCREF:
+            case VALUE_TYPE_EXTERNREF:
 #endif
-                    *(int32*)global_data = global->initial_value.i32;
-                    global_data += sizeof(int32);
-                    break;
-                case VALUE_TYPE_I64:
-                case VALUE_TYPE_F64:
-                    bh_memcpy_s(global_data, (uint32)(global_data_end - global_data),
-                                &global->initial_value.i64, sizeof(int64));
-                    global_data += sizeof(int64);
-                    break;
-                default:
-                    bh_assert(0);
-            }
+                *(int32*)global_data = global->initial_value.i32;
+                break;
+            case VALUE_TYPE_I64:
+            case VALUE_TYPE_F64:
+                bh_memcpy_s(global_data, sizeof(int64),
+                            &global->initial_value.i64, sizeof(int64));
+                break;
+            default:
+                bh_assert(0);
         }
-        bh_assert(global_data == global_data_end);
-    }
-
-    if (!check_linked_symbol(module_inst, error_buf, error_buf_size)) {
-        goto fail;
     }
+}
 
-    /* Initialize the memory data with data segment section */
-    module_inst->default_memory =
-      module_inst->memory_count ? module_inst->memories[0] : NULL;
+/**
+ * Initialize the memory data with data segment section
+ */
+static bool
+memories_init_data_segments(WASMModuleInstance *module_inst,
+                            char *error_buf, uint32 error_buf_size)
+{
+    WASMModule *module = module_inst->module;
+    WASMGlobalInstance *globals = module_inst->globals;
+    uint64 base_offset;
+    uint32 length, i;
 
     for (i = 0; i < module->data_seg_count; i++) {
         WASMMemoryInstance *memory = NULL;
         uint8 *memory_data = NULL;
-        uint32 memory_size = 0;
+        uint64 memory_size = 0;
+        uint8 offset_type = VALUE_TYPE_I32;
         WASMDataSeg *data_seg = module->data_segments[i];
 
 #if WASM_ENABLE_BULK_MEMORY != 0
@@ -1282,11 +1281,18 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
         bh_assert(memory);
 
         memory_data = memory->memory_data;
-        memory_size = memory->num_bytes_per_page * memory->cur_page_count;
+        memory_size = (uint64)memory->num_bytes_per_page
+                      * memory->cur_page_count;
         bh_assert(memory_data || memory_size == 0);
+#if WASM_ENABLE_MEMORY64 != 0
+        if (memory->is_memory64)
+            offset_type = VALUE_TYPE_I64;
+#endif
 
         bh_assert(data_seg->base_offset.init_expr_type
                     == INIT_EXPR_TYPE_I32_CONST
+                  || data_seg->base_offset.init_expr_type
+                       == INIT_EXPR_TYPE_I64_CONST
                   || data_seg->base_offset.init_expr_type
                        == INIT_EXPR_TYPE_GET_GLOBAL);
 
@@ -1295,27 +1301,37 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
             if (!check_global_init_expr(module,
                                         data_seg->base_offset.u.global_index,
                                         error_buf, error_buf_size)) {
-                goto fail;
+                return false;
             }
 
             if (!globals
                 || globals[data_seg->base_offset.u.global_index].type
-                     != VALUE_TYPE_I32) {
+                     != offset_type) {
                 set_error_buf(error_buf, error_buf_size,
                               "data segment does not fit");
-                goto fail;
+                return false;
             }
 
-            data_seg->base_offset.u.i32 =
-                globals[data_seg->base_offset.u.global_index]
-                .initial_value.i32;
-        }
+            /* Don't write the offset back to the segment, the global
+               index is needed again when the instance is reset */
+            if (offset_type == VALUE_TYPE_I64)
+                base_offset = (uint64)
+                    globals[data_seg->base_offset.u.global_index]
+                    .initial_value.i64;
+            else
+                base_offset = (uint32)
+                    globals[data_seg->base_offset.u.global_index]
+                    .initial_value.i32;
+        }
+        else if (offset_type == VALUE_TYPE_I64)
+            base_offset = (uint64)data_seg->base_offset.u.i64;
+        else
+            base_offset = (uint32)data_seg->base_offset.u.i32;
 
         /* check offset */
-        base_offset = (uint32)data_seg->base_offset.u.i32;
         if (base_offset > memory_size) {
-            LOG_DEBUG("base_offset(%d) > memory_size(%d)", base_offset,
-                      memory_size);
+            LOG_DEBUG("base_offset(%"PRIu64") > memory_size(%"PRIu64")",
+                      base_offset, memory_size);
 #if WASM_ENABLE_REF_TYPES != 0
             set_error_buf(error_buf, error_buf_size,
                           "out of bounds memory access");
@@ -1323,13 +1339,14 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
             set_error_buf(error_buf, error_buf_size,
                           "data segment does not fit");
 #endif
-            goto fail;
+            return false;
         }
 
         /* check offset + length(could be zero) */
         length = data_seg->data_length;
         if (base_offset + length > memory_size) {
-            LOG_DEBUG("base_offset(%d) + length(%d) > memory_size(%d)",
+            LOG_DEBUG("base_offset(%"PRIu64") + length(%u) "
+                      "> memory_size(%"PRIu64")",
                       base_offset, length, memory_size);
 #if WASM_ENABLE_REF_TYPES != 0
             set_error_buf(error_buf, error_buf_size,
@@ -1338,18 +1355,31 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
             set_error_buf(error_buf, error_buf_size,
                           "data segment does not fit");
 #endif
-            goto fail;
+            return false;
         }
 
         if (memory_data) {
-            bh_memcpy_s(memory_data + base_offset, memory_size - base_offset,
+            /* The range has been checked above, and the remaining memory
+               size may exceed the uint32 size of bh_memcpy_s */
+            bh_memcpy_s(memory_data + base_offset, length,
                         data_seg->data, length);
         }
     }
 
-    /* Initialize the table data with table segment section */
-    module_inst->default_table =
-      module_inst->table_count ? module_inst->tables[0] : NULL;
+    return true;
+}
+
+/**
+ * Initialize the table data with table segment section
+ */
+static bool
+tables_init_table_segments(WASMModuleInstance *module_inst,
+                           char *error_buf, uint32 error_buf_size)
+{
+    WASMModule *module = module_inst->module;
+    WASMGlobalInstance *globals = module_inst->globals;
+    uint32 base_offset, length, i;
+
     /* in case there is no table */
     for (i = 0; module_inst->table_count > 0 && i < module->table_seg_count;
          i++) {
@@ -1363,7 +1393,7 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
             && table->elem_type != VALUE_TYPE_EXTERNREF) {
             set_error_buf(error_buf, error_buf_size,
                           "elements segment does not fit");
-            goto fail;
+            return false;
         }
 #endif
 
@@ -1395,7 +1425,7 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
             if (!check_global_init_expr(module,
                                         table_seg->base_offset.u.global_index,
                                         error_buf, error_buf_size)) {
-                goto fail;
+                return false;
             }
 
             if (!globals
@@ -1403,17 +1433,21 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
                    != VALUE_TYPE_I32) {
                 set_error_buf(error_buf, error_buf_size,
                               "elements segment does not fit");
-                goto fail;
+                return false;
             }
 
-            table_seg->base_offset.u.i32 =
+            /* Don't write the offset back to the segment, the global
+               index is needed again when the instance is reset */
+            base_offset = (uint32)
               globals[table_seg->base_offset.u.global_index].initial_value.i32;
         }
+        else
+            base_offset = (uint32)table_seg->base_offset.u.i32;
 
         /* check offset since length might negative */
-        if ((uint32)table_seg->base_offset.u.i32 > table->cur_size) {
-            LOG_DEBUG("base_offset(%d) > table->cur_size(%d)",
-                      table_seg->base_offset.u.i32, table->cur_size);
+        if (base_offset > table->cur_size) {
+            LOG_DEBUG("base_offset(%u) > table->cur_size(%u)",
+                      base_offset, table->cur_size);
 #if WASM_ENABLE_REF_TYPES != 0
             set_error_buf(error_buf, error_buf_size,
                           "out of bounds table access");
@@ -1421,14 +1455,14 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
             set_error_buf(error_buf, error_buf_size,
                           "elements segment does not fit");
 #endif
-            goto fail;
+            return false;
         }
 
         /* check offset + length(could be zero) */
         length = table_seg->function_count;
-        if ((uint32)table_seg->base_offset.u.i32 + length > table->cur_size) {
-            LOG_DEBUG("base_offset(%d) + length(%d)> table->cur_size(%d)",
-                      table_seg->base_offset.u.i32, length, table->cur_size);
+        if (base_offset + length > table->cur_size) {
+            LOG_DEBUG("base_offset(%u) + length(%u)> table->cur_size(%u)",
+                      base_offset, length, table->cur_size);
 #if WASM_ENABLE_REF_TYPES != 0
             set_error_buf(error_buf, error_buf_size,
                           "out of bounds table access");
@@ -1436,7 +1470,7 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
             set_error_buf(error_buf, error_buf_size,
                           "elements segment does not fit");
 #endif
-            goto fail;
+            return false;
         }
 
         /**
@@ -1445,43 +1479,194 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
          * so loader check is enough
          */
         bh_memcpy_s(
-          table_data + table_seg->base_offset.u.i32,
-          (uint32)((table->cur_size - (uint32)table_seg->base_offset.u.i32)
-                   * sizeof(uint32)),
+          table_data + base_offset,
+          (uint32)((table->cur_size - base_offset) * sizeof(uint32)),
           table_seg->func_indexes, (uint32)(length * sizeof(uint32)));
     }
 
-    /* module instance type */
-    module_inst->module_type = Wasm_Module_Bytecode;
+    return true;
+}
 
-    /* Initialize the thread related data */
-    if (stack_size == 0)
-        stack_size = DEFAULT_WASM_STACK_SIZE;
-#if WASM_ENABLE_SPEC_TEST != 0
-    if (stack_size < 48 *1024)
-        stack_size = 48 * 1024;
+/**
+ * Instantiate module
+ */
+WASMModuleInstance*
+wasm_instantiate(WASMModule *module, bool is_sub_inst,
+                 uint32 stack_size, uint32 heap_size,
+                 char *error_buf, uint32 error_buf_size)
+{
+    WASMModuleInstance *module_inst;
+    WASMGlobalInstance *globals = NULL;
+    uint32 global_count, global_data_size = 0;
+#if WASM_ENABLE_MULTI_MODULE != 0
+    bool ret = false;
 #endif
-    module_inst->default_wasm_stack_size = stack_size;
 
-    if (module->malloc_function != (uint32)-1) {
-        module_inst->malloc_function =
-            &module_inst->functions[module->malloc_function];
+    if (!module)
+        return NULL;
+
+    /* Check heap size */
+    heap_size = align_uint(heap_size, 8);
+    if (heap_size > APP_HEAP_SIZE_MAX)
+        heap_size = APP_HEAP_SIZE_MAX;
+
+    /* Allocate the memory */
+    if (!(module_inst = runtime_malloc(sizeof(WASMModuleInstance),
+                                       error_buf, error_buf_size))) {
+        return NULL;
     }
 
-    if (module->free_function != (uint32)-1) {
-        module_inst->free_function =
-            &module_inst->functions[module->free_function];
+    module_inst->module = module;
+
+#if WASM_ENABLE_MULTI_MODULE != 0
+    module_inst->sub_module_inst_list =
+      &module_inst->sub_module_inst_list_head;
+    ret = sub_module_instantiate(module, module_inst, stack_size, heap_size,
+                                 error_buf, error_buf_size);
+    if (!ret) {
+        LOG_DEBUG("build a sub module list failed");
+        goto fail;
     }
+#endif
 
-    if (module->retain_function != (uint32)-1) {
-        module_inst->retain_function =
-            &module_inst->functions[module->retain_function];
+#if WASM_ENABLE_DUMP_CALL_STACK != 0
+    if (!(module_inst->frames = runtime_malloc((uint64)sizeof(Vector),
+                                               error_buf, error_buf_size))) {
+        goto fail;
     }
+#endif
 
-#if WASM_ENABLE_LIBC_WASI != 0
-    /* The sub-instance will get the wasi_ctx from main-instance */
-    if (!is_sub_inst) {
-        if (!wasm_runtime_init_wasi((WASMModuleInstanceCommon*)module_inst,
+    /* Instantiate global firstly to get the mutable data size */
+    global_count = module->import_global_count + module->global_count;
+    if (global_count
+        && !(globals = globals_instantiate(module, module_inst,
+                                           &global_data_size,
+                                           error_buf, error_buf_size))) {
+        goto fail;
+    }
+    module_inst->global_count = global_count;
+    module_inst->globals = globals;
+
+    module_inst->memory_count =
+        module->import_memory_count + module->memory_count;
+    module_inst->table_count =
+        module->import_table_count + module->table_count;
+    module_inst->function_count =
+        module->import_function_count + module->function_count;
+
+    /* export */
+    module_inst->export_func_count = get_export_count(module, EXPORT_KIND_FUNC);
+#if WASM_ENABLE_MULTI_MODULE != 0
+    module_inst->export_tab_count = get_export_count(module, EXPORT_KIND_TABLE);
+    module_inst->export_mem_count = get_export_count(module, EXPORT_KIND_MEMORY);
+    module_inst->export_glob_count = get_export_count(module, EXPORT_KIND_GLOBAL);
+#endif
+
+    if (global_count > 0) {
+        if (!(module_inst->global_data = runtime_malloc
+                    (global_data_size, error_buf, error_buf_size))) {
+            goto fail;
+        }
+    }
+
+#if WASM_ENABLE_BULK_MEMORY != 0
+    if (module->data_seg_count > 0
+        && !(module_inst->data_dropped = runtime_malloc
+                    (sizeof(bool) * (uint64)module->data_seg_count,
+                     error_buf, error_buf_size))) {
+        goto fail;
+    }
+#endif
+#if WASM_ENABLE_REF_TYPES != 0
+    if (module->table_seg_count > 0
+        && !(module_inst->elem_dropped = runtime_malloc
+                    (sizeof(bool) * (uint64)module->table_seg_count,
+                     error_buf, error_buf_size))) {
+        goto fail;
+    }
+#endif
+
+    /* Instantiate memories/tables/functions */
+    if ((module_inst->memory_count > 0
+         && !(module_inst->memories =
+                memories_instantiate(module,
+                                     module_inst,
+                                     heap_size, error_buf, error_buf_size)))
+        || (module_inst->table_count > 0
+            && !(module_inst->tables =
+                   tables_instantiate(module,
+                                      module_inst,
+                                      error_buf, error_buf_size)))
+        || (module_inst->function_count > 0
+            && !(module_inst->functions =
+                   functions_instantiate(module,
+                                         module_inst,
+                                         error_buf, error_buf_size)))
+        || (module_inst->export_func_count > 0
+            && !(module_inst->export_functions = export_functions_instantiate(
+                   module, module_inst, module_inst->export_func_count,
+                   error_buf, error_buf_size)))
+#if WASM_ENABLE_MULTI_MODULE != 0
+        || (module_inst->export_glob_count > 0
+            && !(module_inst->export_globals = export_globals_instantiate(
+                   module, module_inst, module_inst->export_glob_count,
+                   error_buf, error_buf_size)))
+#endif
+    ) {
+        goto fail;
+    }
+
+    if (global_count > 0)
+        globals_init_data(module_inst);
+
+    if (!check_linked_symbol(module_inst, error_buf, error_buf_size)) {
+        goto fail;
+    }
+
+    /* Initialize the memory data with data segment section */
+    module_inst->default_memory =
+      module_inst->memory_count ? module_inst->memories[0] : NULL;
+    if (!memories_init_data_segments(module_inst, error_buf, error_buf_size))
+        goto fail;
+
+    /* Initialize the table data with table segment section */
+    module_inst->default_table =
+      module_inst->table_count ? module_inst->tables[0] : NULL;
+    if (!tables_init_table_segments(module_inst, error_buf, error_buf_size))
+        goto fail;
+
+    /* module instance type */
+    module_inst->module_type = Wasm_Module_Bytecode;
+
+    /* Initialize the thread related data */
+    if (stack_size == 0)
+        stack_size = DEFAULT_WASM_STACK_SIZE;
+#if WASM_ENABLE_SPEC_TEST != 0
+    if (stack_size < 48 *1024)
+        stack_size = 48 * 1024;
+#endif
+    module_inst->default_wasm_stack_size = stack_size;
+
+    if (module->malloc_function != (uint32)-1) {
+        module_inst->malloc_function =
+            &module_inst->functions[module->malloc_function];
+    }
+
+    if (module->free_function != (uint32)-1) {
+        module_inst->free_function =
+            &module_inst->functions[module->free_function];
+    }
+
+    if (module->retain_function != (uint32)-1) {
+        module_inst->retain_function =
+            &module_inst->functions[module->retain_function];
+    }
+
+#if WASM_ENABLE_LIBC_WASI != 0
+    /* The sub-instance will get the wasi_ctx from main-instance */
+    if (!is_sub_inst) {
+        STARTUP_TIMING_BEGIN(WASM_STARTUP_WASI_INIT);
+        if (!wasm_runtime_init_wasi((WASMModuleInstanceCommon*)module_inst,
                                     module->wasi_args.dir_list,
                                     module->wasi_args.dir_count,
                                     module->wasi_args.map_dir_list,
@@ -1494,8 +1679,10 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
                                     module->wasi_args.stdio[1],
                                     module->wasi_args.stdio[2],
                                     error_buf, error_buf_size)) {
+            STARTUP_TIMING_END(WASM_STARTUP_WASI_INIT);
             goto fail;
         }
+        STARTUP_TIMING_END(WASM_STARTUP_WASI_INIT);
     }
 #endif
 
@@ -1506,9 +1693,12 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
                 &module_inst->functions[module->start_function];
     }
 
-    /* Execute __post_instantiate function */
+    /* Execute __post_instantiate function, start function and memory
+       init function, they are timed as one start function phase */
+    STARTUP_TIMING_BEGIN(WASM_STARTUP_START_FUNC);
     if (!execute_post_inst_function(module_inst)
         || !execute_start_function(module_inst)) {
+        STARTUP_TIMING_END(WASM_STARTUP_START_FUNC);
         set_error_buf(error_buf, error_buf_size,
                       module_inst->cur_exception);
         goto fail;
@@ -1523,6 +1713,7 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
         */
         if (!is_sub_inst) {
             if (!execute_memory_init_function(module_inst)) {
+                STARTUP_TIMING_END(WASM_STARTUP_START_FUNC);
                 set_error_buf(error_buf, error_buf_size,
                               module_inst->cur_exception);
                 goto fail;
@@ -1532,12 +1723,12 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
     }
 #endif
 #endif
+    STARTUP_TIMING_END(WASM_STARTUP_START_FUNC);
 
 #if WASM_ENABLE_MEMORY_TRACING != 0
     wasm_runtime_dump_module_inst_mem_consumption
                     ((WASMModuleInstanceCommon *)module_inst);
 #endif
-    (void)global_data_end;
     return module_inst;
 fail:
     wasm_deinstantiate(module_inst, false);
@@ -1580,6 +1771,15 @@ wasm_deinstantiate(WASMModuleInstance *module_inst, bool is_sub_inst)
     if (module_inst->global_data)
         wasm_runtime_free(module_inst->global_data);
 
+#if WASM_ENABLE_BULK_MEMORY != 0
+    if (module_inst->data_dropped)
+        wasm_runtime_free(module_inst->data_dropped);
+#endif
+#if WASM_ENABLE_REF_TYPES != 0
+    if (module_inst->elem_dropped)
+        wasm_runtime_free(module_inst->elem_dropped);
+#endif
+
 #if WASM_ENABLE_REF_TYPES != 0
     wasm_externref_cleanup((WASMModuleInstanceCommon*)module_inst);
 #endif
@@ -1598,6 +1798,177 @@ wasm_deinstantiate(WASMModuleInstance *module_inst, bool is_sub_inst)
     wasm_runtime_free(module_inst);
 }
 
+#if WASM_ENABLE_INSTANCE_POOL != 0
+/* Zero the linear memory for reuse. The memory64 memory is reserved
+   by the runtime with os_mmap, its whole pages are discarded by mapping
+   fresh zero pages over them like the AOT runtime does, so that they
+   are only populated again when they are touched. Other memories are
+   allocated with the runtime allocator, whose pages may belong to the
+   pool or the allocator of the embedder, they are cleared with memset */
+static bool
+memory_data_clear(WASMMemoryInstance *memory)
+{
+    uint8 *data = memory->memory_data;
+    uint64 size = (uint64)(memory->memory_data_end - memory->memory_data);
+#if WASM_ENABLE_MEMORY64 != 0 && !defined(BH_PLATFORM_WINDOWS)
+    uintptr_t page_size = (uintptr_t)os_getpagesize();
+    uint8 *end = (uint8*)(((uintptr_t)data + size) & ~(page_size - 1));
+
+    /* The reservation is page aligned, only the partial page at the
+       end is cleared */
+    if (memory->is_memory64 && data < end) {
+        if (os_mmap(data, (size_t)(end - data),
+                    MMAP_PROT_READ | MMAP_PROT_WRITE, MMAP_MAP_FIXED)
+            != data)
+            return false;
+        memset(end, 0, (size_t)(data + size - end));
+        return true;
+    }
+#endif
+    memset(data, 0, (size_t)size);
+    return true;
+}
+
+static bool
+memory_reset(WASMMemoryInstance *memory,
+             char *error_buf, uint32 error_buf_size)
+{
+    uint32 heap_size = (uint32)(memory->heap_data_end - memory->heap_data);
+
+    if (memory->memory_data && !memory_data_clear(memory)) {
+        set_error_buf(error_buf, error_buf_size, "mmap memory failed");
+        return false;
+    }
+
+    if (memory->heap_handle) {
+        mem_allocator_destroy(memory->heap_handle);
+        if (!mem_allocator_create_with_struct_and_pool(
+                memory->heap_handle, mem_allocator_get_heap_struct_size(),
+                memory->heap_data, heap_size)) {
+            set_error_buf(error_buf, error_buf_size,
+                          "init app heap failed");
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+table_reset(const WASMModule *module, WASMTableInstance *table,
+            uint32 table_idx)
+{
+    uint32 init_size = table_idx < module->import_table_count
+        ? module->import_tables[table_idx].u.table.init_size
+        : module->tables[table_idx - module->import_table_count].init_size;
+
+    /* Set all elements to -1 to mark them as uninitialized elements */
+    memset(table->base_addr, -1, sizeof(uint32) * table->cur_size);
+    table->cur_size = init_size;
+}
+
+bool
+wasm_reset_instance(WASMModuleInstance *module_inst,
+                    char *error_buf, uint32 error_buf_size)
+{
+    WASMModule *module = module_inst->module;
+    uint32 i;
+
+#if WASM_ENABLE_MULTI_MODULE != 0
+    if (bh_list_length(module_inst->sub_module_inst_list) > 0) {
+        set_error_buf(error_buf, error_buf_size,
+                      "reset instance failed: instance has sub modules");
+        return false;
+    }
+#endif
+#if WASM_ENABLE_SHARED_MEMORY != 0
+    for (i = 0; i < module_inst->memory_count; i++) {
+        if (module_inst->memories[i]->is_shared) {
+            set_error_buf(error_buf, error_buf_size,
+                          "reset instance failed: memory is shared");
+            return false;
+        }
+    }
+#endif
+
+#if WASM_ENABLE_LIBC_WASI != 0
+    /* The wasi ctx is allocated from app heap, destroy it before
+       the app heap is re-created */
+    wasm_runtime_destroy_wasi((WASMModuleInstanceCommon*)module_inst);
+#endif
+
+    for (i = 0; i < module_inst->memory_count; i++) {
+        if (!memory_reset(module_inst->memories[i],
+                          error_buf, error_buf_size))
+            return false;
+    }
+
+    for (i = 0; i < module_inst->table_count; i++)
+        table_reset(module, module_inst->tables[i], i);
+
+    if (module_inst->global_count > 0)
+        globals_init_data(module_inst);
+
+#if WASM_ENABLE_BULK_MEMORY != 0
+    if (module_inst->data_dropped)
+        memset(module_inst->data_dropped, 0,
+               sizeof(bool) * module->data_seg_count);
+#endif
+#if WASM_ENABLE_REF_TYPES != 0
+    if (module_inst->elem_dropped)
+        memset(module_inst->elem_dropped, 0,
+               sizeof(bool) * module->table_seg_count);
+#endif
+
+    if (!memories_init_data_segments(module_inst, error_buf, error_buf_size)
+        || !tables_init_table_segments(module_inst,
+                                       error_buf, error_buf_size))
+        return false;
+
+    module_inst->cur_exception[0] = '\0';
+
+#if WASM_ENABLE_LIBC_WASI != 0
+    if (!wasm_runtime_init_wasi((WASMModuleInstanceCommon*)module_inst,
+                                module->wasi_args.dir_list,
+                                module->wasi_args.dir_count,
+                                module->wasi_args.map_dir_list,
+                                module->wasi_args.map_dir_count,
+                                module->wasi_args.env,
+                                module->wasi_args.env_count,
+                                module->wasi_args.argv,
+                                module->wasi_args.argc,
+                                module->wasi_args.stdio[0],
+                                module->wasi_args.stdio[1],
+                                module->wasi_args.stdio[2],
+                                error_buf, error_buf_size)) {
+        return false;
+    }
+#endif
+
+    if (!execute_post_inst_function(module_inst)
+        || !execute_start_function(module_inst)) {
+        set_error_buf(error_buf, error_buf_size,
+                      module_inst->cur_exception);
+        return false;
+    }
+
+#if WASM_ENABLE_BULK_MEMORY != 0
+#if WASM_ENABLE_LIBC_WASI != 0
+    if (!module->is_wasi_module) {
+#endif
+        if (!execute_memory_init_function(module_inst)) {
+            set_error_buf(error_buf, error_buf_size,
+                          module_inst->cur_exception);
+            return false;
+        }
+#if WASM_ENABLE_LIBC_WASI != 0
+    }
+#endif
+#endif
+
+    return true;
+}
+#endif /* end of WASM_ENABLE_INSTANCE_POOL */
+
 WASMFunctionInstance*
 wasm_lookup_function(const WASMModuleInstance *module_inst,
                      const char *name, const char *signature)
@@ -1684,6 +2055,9 @@ wasm_create_exec_env_and_call_function(WASMModuleInstance *module_inst,
 {
     WASMExecEnv *exec_env;
     bool ret;
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    WASMSamplingContext prev_sampling_ctx;
+#endif
 
 #if WASM_ENABLE_THREAD_MGR != 0
     WASMExecEnv *existing_exec_env = NULL;
@@ -1707,8 +2081,16 @@ wasm_create_exec_env_and_call_function(WASMModuleInstance *module_inst,
     wasm_runtime_prepare_call_function(exec_env, func);
 #endif
 
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_enter(exec_env, &prev_sampling_ctx);
+#endif
+
     ret = wasm_call_function(exec_env, func, argc, argv);
 
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    wasm_sampling_profiler_leave(&prev_sampling_ctx);
+#endif
+
 #if WASM_ENABLE_REF_TYPES != 0
     wasm_runtime_finalize_call_function(exec_env, func, ret, argv);
 #endif
@@ -1738,10 +2120,17 @@ void
 wasm_set_exception(WASMModuleInstance *module_inst,
                    const char *exception)
 {
+#if WASM_ENABLE_METRICS != 0
     if (exception)
+        wasm_metrics_count_trap(exception);
+#endif
+
+    if (exception) {
+        USDT_PROBE2(trap, module_inst, exception);
         snprintf(module_inst->cur_exception,
                  sizeof(module_inst->cur_exception),
                  "Exception: %s", exception);
+    }
     else
         module_inst->cur_exception[0] = '\0';
 }
@@ -1798,6 +2187,183 @@ wasm_dump_perf_profiling(const WASMModuleInstance *module_inst)
 }
 #endif
 
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+typedef struct ExecProfileWriter {
+    char *buf;
+    uint32 size;
+    /* length of the whole profile, may be larger than size */
+    uint64 len;
+} ExecProfileWriter;
+
+static void
+profile_printf(ExecProfileWriter *writer, const char *format, ...)
+{
+    va_list args;
+    char *buf = NULL;
+    uint32 size = 0;
+    int n;
+
+    if (writer->buf && writer->len < writer->size) {
+        buf = writer->buf + writer->len;
+        size = writer->size - (uint32)writer->len;
+    }
+
+    va_start(args, format);
+    n = vsnprintf(buf, size, format, args);
+    va_end(args);
+
+    if (n > 0)
+        writer->len += (uint32)n;
+}
+
+static void
+profile_print_string(ExecProfileWriter *writer, const char *str)
+{
+    profile_printf(writer, "\"");
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            profile_printf(writer, "\\%c", *str);
+        else if ((uint8)*str < 0x20)
+            profile_printf(writer, "\\u%04x", (uint8)*str);
+        else
+            profile_printf(writer, "%c", *str);
+    }
+    profile_printf(writer, "\"");
+}
+
+static const char *
+get_func_name(const WASMModuleInstance *module_inst,
+              const WASMFunctionInstance *func_inst)
+{
+    uint32 i;
+
+#if WASM_ENABLE_CUSTOM_NAME_SECTION != 0
+    if (func_inst->u.func->field_name)
+        return func_inst->u.func->field_name;
+#endif
+    for (i = 0; i < module_inst->export_func_count; i++) {
+        if (module_inst->export_functions[i].function == func_inst)
+            return module_inst->export_functions[i].name;
+    }
+    return NULL;
+}
+
+static const char *
+get_label_type_name(uint8 label_type)
+{
+    switch (label_type) {
+        case LABEL_TYPE_BLOCK:
+            return "block";
+        case LABEL_TYPE_LOOP:
+            return "loop";
+        default:
+            return "if";
+    }
+}
+
+static uint64
+write_exec_profile(const WASMModuleInstance *module_inst,
+                   char *buf, uint32 size)
+{
+    ExecProfileWriter writer = { buf, size, 0 };
+    const uint64 *opcode_counts = wasm_interp_get_opcode_counts();
+    const uint64 *pair_counts = wasm_interp_get_opcode_pair_counts();
+    const WASMFunctionInstance *func_inst;
+    const WASMFunction *func;
+    const WASMBlockCounter *block_counter;
+    const char *func_name;
+    bool first = true;
+    uint32 i, j;
+
+    /* WASM_OP_IMPDEP is only executed when entering the interpreter */
+    profile_printf(&writer, "{\n  \"opcodes\": [");
+    for (i = 0; i < WASM_INSTRUCTION_NUM; i++) {
+        if (!opcode_counts[i] || i == WASM_OP_IMPDEP)
+            continue;
+        profile_printf(&writer, "%s\n    {\"opcode\": \"%s\", "
+                       "\"count\": %"PRIu64"}", first ? "" : ",",
+                       wasm_interp_get_opcode_name((uint8)i),
+                       opcode_counts[i]);
+        first = false;
+    }
+
+    profile_printf(&writer, "\n  ],\n  \"opcode_pairs\": [");
+    first = true;
+    for (i = 0; i < WASM_INSTRUCTION_NUM * WASM_INSTRUCTION_NUM; i++) {
+        if (!pair_counts[i] || (i >> 8) == WASM_OP_IMPDEP
+            || (i & 0xFF) == WASM_OP_IMPDEP)
+            continue;
+        profile_printf(&writer, "%s\n    {\"first\": \"%s\", "
+                       "\"second\": \"%s\", \"count\": %"PRIu64"}",
+                       first ? "" : ",",
+                       wasm_interp_get_opcode_name((uint8)(i >> 8)),
+                       wasm_interp_get_opcode_name((uint8)i),
+                       pair_counts[i]);
+        first = false;
+    }
+
+    profile_printf(&writer, "\n  ],\n  \"functions\": [");
+    first = true;
+    for (i = 0; i < module_inst->function_count; i++) {
+        func_inst = module_inst->functions + i;
+        if (func_inst->is_import_func)
+            continue;
+        func = func_inst->u.func;
+        if (!func->call_count && !func->instr_count)
+            continue;
+
+        profile_printf(&writer, "%s\n    {\"index\": %u, \"name\": ",
+                       first ? "" : ",", i);
+        if ((func_name = get_func_name(module_inst, func_inst)))
+            profile_print_string(&writer, func_name);
+        else
+            profile_printf(&writer, "null");
+        profile_printf(&writer, ", \"calls\": %"PRIu64", "
+                       "\"instructions\": %"PRIu64", \"blocks\": [",
+                       func->call_count, func->instr_count);
+
+        for (j = 0; j < func->block_counter_count; j++) {
+            block_counter = func->block_counters + j;
+            profile_printf(&writer, "%s\n      {\"offset\": %u, "
+                           "\"type\": \"%s\", \"count\": %"PRIu64,
+                           j > 0 ? "," : "", block_counter->code_offset,
+                           get_label_type_name(block_counter->label_type),
+                           block_counter->count);
+            if (block_counter->label_type == LABEL_TYPE_IF)
+                profile_printf(&writer, ", \"taken\": %"PRIu64,
+                               block_counter->taken);
+            profile_printf(&writer, "}");
+        }
+        profile_printf(&writer, "%s]}",
+                       func->block_counter_count > 0 ? "\n    " : "");
+        first = false;
+    }
+    profile_printf(&writer, "\n  ]\n}\n");
+
+    return writer.len;
+}
+
+uint32
+wasm_get_exec_profile_size(const WASMModuleInstance *module_inst)
+{
+    uint64 len = write_exec_profile(module_inst, NULL, 0);
+
+    /* including the terminating null character */
+    return len < UINT32_MAX ? (uint32)len + 1 : 0;
+}
+
+uint32
+wasm_dump_exec_profile_to_buf(const WASMModuleInstance *module_inst,
+                              char *buf, uint32 len)
+{
+    uint64 profile_len = write_exec_profile(module_inst, buf, len);
+
+    if (profile_len >= len)
+        return 0;
+    return (uint32)profile_len;
+}
+#endif /* end of WASM_ENABLE_OPCODE_COUNTER != 0 */
+
 uint32
 wasm_module_malloc(WASMModuleInstance *module_inst, uint32 size,
                    void **p_native_addr)
@@ -1931,13 +2497,14 @@ wasm_validate_app_addr(WASMModuleInstance *module_inst,
                        uint32 app_offset, uint32 size)
 {
     WASMMemoryInstance *memory = module_inst->default_memory;
-    uint32 memory_data_size;
+    uint64 memory_data_size;
 
     if (!memory) {
         goto fail;
     }
 
-    memory_data_size = memory->num_bytes_per_page * memory->cur_page_count;
+    memory_data_size = (uint64)memory->num_bytes_per_page
+                       * memory->cur_page_count;
 
     /* integer overflow check */
     if (app_offset > UINT32_MAX - size) {
@@ -2018,18 +2585,21 @@ wasm_get_app_addr_range(WASMModuleInstance *module_inst,
                         uint32 *p_app_end_offset)
 {
     WASMMemoryInstance *memory = module_inst->default_memory;
-    uint32 memory_data_size;
+    uint64 memory_data_size;
 
     if (!memory)
         return false;
 
-    memory_data_size = memory->num_bytes_per_page * memory->cur_page_count;
+    memory_data_size = (uint64)memory->num_bytes_per_page
+                       * memory->cur_page_count;
 
     if (app_offset < memory_data_size) {
         if (p_app_start_offset)
             *p_app_start_offset = 0;
         if (p_app_end_offset)
-            *p_app_end_offset = memory_data_size;
+            /* App offsets of native APIs are 32-bit */
+            *p_app_end_offset = memory_data_size > UINT32_MAX
+                                ? UINT32_MAX : (uint32)memory_data_size;
         return true;
     }
     return false;
@@ -2058,20 +2628,20 @@ wasm_get_native_addr_range(WASMModuleInstance *module_inst,
     return false;
 }
 
-bool
-wasm_enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count)
+static bool
+enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count)
 {
     WASMMemoryInstance *memory = module->default_memory;
     uint8 *new_memory_data, *memory_data, *heap_data_old;
-    uint32 heap_size, total_size_old, total_page_count;
-    uint64 total_size;
+    uint32 heap_size, total_page_count;
+    uint64 total_size, total_size_old;
 
     if (!memory)
         return false;
 
     memory_data = memory->memory_data;
     heap_size = (uint32)(memory->heap_data_end - memory->heap_data);
-    total_size_old = (uint32)(memory->memory_data_end - memory_data);
+    total_size_old = (uint64)(memory->memory_data_end - memory_data);
     total_page_count = inc_page_count + memory->cur_page_count;
     total_size = memory->num_bytes_per_page * (uint64)total_page_count;
     heap_data_old = memory->heap_data;
@@ -2085,6 +2655,28 @@ wasm_enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count)
         return false;
     }
 
+#if WASM_ENABLE_MEMORY64 != 0
+    if (memory->is_memory64) {
+        /* The max pages have been reserved during instantiate,
+           commit the new pages, the data is never moved */
+#ifdef BH_PLATFORM_WINDOWS
+        if (!os_mem_commit(memory->memory_data_end,
+                           (size_t)(total_size - total_size_old),
+                           MMAP_PROT_READ | MMAP_PROT_WRITE)) {
+            return false;
+        }
+#endif
+        if (os_mprotect(memory->memory_data_end,
+                        (size_t)(total_size - total_size_old),
+                        MMAP_PROT_READ | MMAP_PROT_WRITE) != 0) {
+            return false;
+        }
+        memory->cur_page_count = total_page_count;
+        memory->memory_data_end = memory->memory_data + total_size;
+        return true;
+    }
+#endif
+
     if (total_size >= UINT32_MAX) {
         return false;
     }
@@ -2104,13 +2696,13 @@ wasm_enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count)
         }
         if (memory_data) {
             bh_memcpy_s(new_memory_data, (uint32)total_size,
-                        memory_data, total_size_old);
+                        memory_data, (uint32)total_size_old);
             wasm_runtime_free(memory_data);
         }
     }
 
     memset(new_memory_data + total_size_old,
-           0, (uint32)total_size - total_size_old);
+           0, (uint32)(total_size - total_size_old));
 
     if (heap_size > 0) {
         if (mem_allocator_migrate(memory->heap_handle,
@@ -2132,6 +2724,19 @@ wasm_enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count)
     return true;
 }
 
+bool
+wasm_enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count)
+{
+#if WASM_ENABLE_USDT != 0
+    WASMMemoryInstance *memory = module->default_memory;
+    uint32 cur_page_count = memory ? memory->cur_page_count : 0;
+#endif
+    bool ret = enlarge_memory(module, inc_page_count);
+
+    USDT_PROBE4(memory_grow, module, cur_page_count, inc_page_count, ret);
+    return ret;
+}
+
 #if WASM_ENABLE_REF_TYPES != 0
 bool
 wasm_enlarge_table(WASMModuleInstance *module_inst,
@@ -26,6 +26,11 @@ struct WASMMemoryInstance {
     uint32 module_type;
     /* Shared memory flag */
     bool is_shared;
+#if WASM_ENABLE_MEMORY64 != 0
+    /* Memory64 flag, the max pages are reserved with os_mmap
+       and committed on demand */
+    bool is_memory64;
+#endif
     /* Number bytes per page */
     uint32 num_bytes_per_page;
     /* Current page count */
@@ -226,6 +231,16 @@ struct WASMModuleInstance {
 #if WASM_ENABLE_MEMORY_PROFILING != 0
     uint32 max_aux_stack_used;
 #endif
+
+#if WASM_ENABLE_BULK_MEMORY != 0
+    /* Whether each data segment was dropped by data.drop, it is kept
+       in the instance so that the module isn't changed */
+    bool *data_dropped;
+#endif
+#if WASM_ENABLE_REF_TYPES != 0
+    /* Whether each table segment was dropped by elem.drop */
+    bool *elem_dropped;
+#endif
 };
 
 struct WASMInterpFrame;
@@ -296,9 +311,29 @@ wasm_instantiate(WASMModule *module, bool is_sub_inst,
 void
 wasm_dump_perf_profiling(const WASMModuleInstance *module_inst);
 
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+uint32
+wasm_get_exec_profile_size(const WASMModuleInstance *module_inst);
+
+uint32
+wasm_dump_exec_profile_to_buf(const WASMModuleInstance *module_inst,
+                              char *buf, uint32 len);
+#endif
+
 void
 wasm_deinstantiate(WASMModuleInstance *module_inst, bool is_sub_inst);
 
+#if WASM_ENABLE_INSTANCE_POOL != 0
+/**
+ * Reset the instance to the state right after instantiation, the
+ * linear memories, tables, globals and wasi ctx are re-initialized
+ * and the start functions are executed again.
+ */
+bool
+wasm_reset_instance(WASMModuleInstance *module_inst,
+                    char *error_buf, uint32 error_buf_size);
+#endif
+
 WASMFunctionInstance *
 wasm_lookup_function(const WASMModuleInstance *module_inst,
                      const char *name, const char *signature);
@@ -4,6 +4,8 @@
  */
 
 #include "thread_manager.h"
+#include "wasm_metrics.h"
+#include "wasm_usdt.h"
 
 typedef struct {
     bh_list_link l;
@@ -324,6 +326,34 @@ wasm_clusters_search_exec_env(WASMModuleInstanceCommon *module_inst)
     return NULL;
 }
 
+uint32
+wasm_cluster_get_thread_nums(uint32 *thread_nums, uint32 buf_count,
+                             uint32 *p_thread_count, uint32 *p_max_thread_num)
+{
+    WASMCluster *cluster;
+    uint32 cluster_count = 0, thread_count = 0, max_thread_num = 0, n;
+
+    os_mutex_lock(&cluster_list_lock);
+    cluster = bh_list_first_elem(cluster_list);
+    while (cluster) {
+        n = bh_list_length(&cluster->exec_env_list);
+        if (thread_nums && cluster_count < buf_count)
+            thread_nums[cluster_count] = n;
+        thread_count += n;
+        if (max_thread_num < n)
+            max_thread_num = n;
+        cluster_count++;
+        cluster = bh_list_elem_next(cluster);
+    }
+    os_mutex_unlock(&cluster_list_lock);
+
+    if (p_thread_count)
+        *p_thread_count = thread_count;
+    if (p_max_thread_num)
+        *p_max_thread_num = max_thread_num;
+    return cluster_count;
+}
+
 WASMExecEnv *
 wasm_cluster_spawn_exec_env(WASMExecEnv *exec_env)
 {
@@ -409,6 +439,7 @@ thread_manager_start_routine(void *arg)
     bh_assert(cluster != NULL);
 
     exec_env->handle = os_self_thread();
+    USDT_PROBE1(thread_start, exec_env);
     ret = exec_env->thread_start_routine(exec_env);
 
 #ifdef OS_ENABLE_HW_BOUND_CHECK
@@ -417,6 +448,7 @@ thread_manager_start_routine(void *arg)
 #endif
 
     /* Routine exit */
+    USDT_PROBE2(thread_exit, exec_env, ret);
     /* Free aux stack space */
     free_aux_stack(cluster, exec_env->aux_stack_bottom.bottom);
     /* Detach the native thread here to ensure the resources are freed */
@@ -425,6 +457,10 @@ thread_manager_start_routine(void *arg)
     wasm_cluster_del_exec_env(cluster, exec_env);
     wasm_exec_env_destroy_internal(exec_env);
 
+#if WASM_ENABLE_METRICS != 0
+    wasm_metrics_retire_thread();
+#endif
+
     os_thread_exit(ret);
     return ret;
 }
@@ -466,6 +502,7 @@ wasm_cluster_create_thread(WASMExecEnv *exec_env,
     new_exec_env->thread_start_routine = thread_routine;
     new_exec_env->thread_arg = arg;
 
+    USDT_PROBE2(thread_create, exec_env, new_exec_env);
     if (0 != os_thread_create(&tid, thread_manager_start_routine,
                               (void *)new_exec_env,
                               APP_THREAD_STACK_SIZE_DEFAULT)) {
@@ -521,6 +558,8 @@ wasm_cluster_exit_thread(WASMExecEnv *exec_env, void *retval)
     cluster = wasm_exec_env_get_cluster(exec_env);
     bh_assert(cluster);
 
+    USDT_PROBE2(thread_exit, exec_env, retval);
+
     /* App exit the thread, free the resources before exit native thread */
     /* Free aux stack space */
     free_aux_stack(cluster, exec_env->aux_stack_bottom.bottom);
@@ -530,6 +569,10 @@ wasm_cluster_exit_thread(WASMExecEnv *exec_env, void *retval)
     wasm_cluster_del_exec_env(cluster, exec_env);
     wasm_exec_env_destroy_internal(exec_env);
 
+#if WASM_ENABLE_METRICS != 0
+    wasm_metrics_retire_thread();
+#endif
+
     os_thread_exit(retval);
 }
 
@@ -661,7 +704,13 @@ wasm_cluster_spread_exception(WASMExecEnv *exec_env)
     WASMCluster *cluster = wasm_exec_env_get_cluster(exec_env);
     bh_assert(cluster);
 
+#if WASM_ENABLE_METRICS != 0
+    wasm_metrics_spreading_exception = true;
+#endif
     traverse_list(&cluster->exec_env_list, set_exception_visitor, exec_env);
+#if WASM_ENABLE_METRICS != 0
+    wasm_metrics_spreading_exception = false;
+#endif
 }
 
 static void
@@ -109,6 +109,12 @@ wasm_cluster_del_exec_env(WASMCluster *cluster, WASMExecEnv *exec_env);
 WASMExecEnv *
 wasm_clusters_search_exec_env(WASMModuleInstanceCommon *module_inst);
 
+/* Get the thread numbers of the clusters, at most buf_count numbers
+   are written into thread_nums, return the number of the clusters */
+uint32
+wasm_cluster_get_thread_nums(uint32 *thread_nums, uint32 buf_count,
+                             uint32 *p_thread_count, uint32 *p_max_thread_num);
+
 void
 wasm_cluster_spread_exception(WASMExecEnv *exec_env);
 
@@ -48,6 +48,7 @@ typedef enum {
     GC_STAT_TOTAL = 0,
     GC_STAT_FREE,
     GC_STAT_HIGHMARK,
+    GC_STAT_LARGEST_FREE,
 } GC_STAT_INDEX;
 
 /**
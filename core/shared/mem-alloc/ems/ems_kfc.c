@@ -237,12 +237,34 @@ gci_verify_heap(gc_heap_t *heap)
 }
 #endif
 
+/* Size of the largest free chunk, the free chunks in the tree are
+   larger than the ones in the normal lists */
+static gc_size_t
+get_largest_free_size(gc_heap_t *heap)
+{
+    hmu_tree_node_t *node = heap->kfc_tree_root.right;
+    int i;
+
+    if (node) {
+        while (node->right)
+            node = node->right;
+        return node->size;
+    }
+
+    for (i = HMU_NORMAL_NODE_CNT - 1; i > 0; i--) {
+        if (heap->kfc_normal_list[i].next)
+            return (gc_size_t)i << 3;
+    }
+    return 0;
+}
+
 void *
 gc_heap_stats(void *heap_arg, uint32* stats, int size)
 {
     int i;
     gc_heap_t *heap = (gc_heap_t *) heap_arg;
 
+    os_mutex_lock(&heap->lock);
     for (i = 0; i < size; i++) {
         switch (i) {
         case GC_STAT_TOTAL:
@@ -254,10 +276,13 @@ gc_heap_stats(void *heap_arg, uint32* stats, int size)
         case GC_STAT_HIGHMARK:
             stats[i] = heap->highmark_size;
             break;
+        case GC_STAT_LARGEST_FREE:
+            stats[i] = get_largest_free_size(heap);
+            break;
         default:
             break;
         }
     }
+    os_mutex_unlock(&heap->lock);
     return heap;
 }
-
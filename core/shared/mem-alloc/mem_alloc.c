@@ -69,6 +69,21 @@ mem_allocator_is_heap_corrupted(mem_allocator_t allocator)
     return gc_is_heap_corrupted((gc_handle_t) allocator);
 }
 
+bool
+mem_allocator_get_alloc_info(mem_allocator_t allocator,
+                             mem_alloc_info_t *info)
+{
+    uint32 stats[GC_STAT_LARGEST_FREE + 1];
+
+    gc_heap_stats((gc_handle_t) allocator, stats,
+                  sizeof(stats) / sizeof(stats[0]));
+    info->total_size = stats[GC_STAT_TOTAL];
+    info->total_free_size = stats[GC_STAT_FREE];
+    info->highmark_size = stats[GC_STAT_HIGHMARK];
+    info->largest_free_size = stats[GC_STAT_LARGEST_FREE];
+    return true;
+}
+
 #else /* else of DEFAULT_MEM_ALLOCATOR */
 
 #include "tlsf/tlsf.h"
@@ -181,5 +196,15 @@ mem_allocator_migrate(mem_allocator_t allocator,
                         (mem_allocator_tlsf *) allocator_old);
 }
 
+bool
+mem_allocator_get_alloc_info(mem_allocator_t allocator,
+                             mem_alloc_info_t *info)
+{
+    /* not supported by the tlsf allocator */
+    (void)allocator;
+    (void)info;
+    return false;
+}
+
 #endif /* end of DEFAULT_MEM_ALLOCATOR */
 
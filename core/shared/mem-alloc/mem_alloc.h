@@ -14,6 +14,14 @@ extern "C" {
 
 typedef void *mem_allocator_t;
 
+typedef struct mem_alloc_info_t {
+    uint32_t total_size;
+    uint32_t total_free_size;
+    uint32_t highmark_size;
+    /* size of the largest free chunk */
+    uint32_t largest_free_size;
+} mem_alloc_info_t;
+
 mem_allocator_t
 mem_allocator_create(void *mem, uint32_t size);
 
@@ -45,6 +53,10 @@ mem_allocator_migrate(mem_allocator_t allocator,
 bool
 mem_allocator_is_heap_corrupted(mem_allocator_t allocator);
 
+bool
+mem_allocator_get_alloc_info(mem_allocator_t allocator,
+                             mem_alloc_info_t *info);
+
 #ifdef __cplusplus
 }
 #endif
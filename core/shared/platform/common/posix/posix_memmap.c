@@ -5,12 +5,38 @@
 
 #include "platform_api_vmcore.h"
 
+#if defined(MADV_HUGEPAGE)
+/* Size of the PMD level huge page on x86_64 and aarch64 (4K granule) */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static uint8 *
+align_to_huge_page(uint8 *addr, uint64 map_size, uint64 request_size)
+{
+    uint8 *addr_aligned = (uint8 *)(((uintptr_t)addr + HUGE_PAGE_SIZE - 1)
+                                    & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+    uint64 head_size = (uint64)(addr_aligned - addr);
+    uint64 tail_size = map_size - head_size - request_size;
+
+    /* Release the unaligned head and the unused tail of the reservation,
+       the remaining mapping is exactly request_size bytes, so that
+       os_munmap() can release it with the original size */
+    if (head_size > 0)
+        munmap(addr, head_size);
+    if (tail_size > 0)
+        munmap(addr_aligned + request_size, tail_size);
+
+    /* It is only a hint, the kernel may have THP disabled */
+    madvise(addr_aligned, request_size, MADV_HUGEPAGE);
+    return addr_aligned;
+}
+#endif
+
 void *
 os_mmap(void *hint, size_t size, int prot, int flags)
 {
     int map_prot = PROT_NONE;
     int map_flags = MAP_ANONYMOUS | MAP_PRIVATE;
-    uint64 request_size, page_size;
+    uint64 request_size, map_size, page_size;
     uint8 *addr;
     uint32 i;
 
@@ -44,9 +70,16 @@ os_mmap(void *hint, size_t size, int prot, int flags)
     if (flags & MMAP_MAP_FIXED)
         map_flags |= MAP_FIXED;
 
+    map_size = request_size;
+#if defined(MADV_HUGEPAGE)
+    if ((flags & MMAP_MAP_HUGEPAGE) && !(flags & MMAP_MAP_FIXED))
+        /* Reserve one more huge page to align the start address */
+        map_size += HUGE_PAGE_SIZE;
+#endif
+
     /* try 5 times */
     for (i = 0; i < 5; i ++) {
-        addr = mmap(hint, request_size, map_prot, map_flags, -1, 0);
+        addr = mmap(hint, map_size, map_prot, map_flags, -1, 0);
         if (addr != MAP_FAILED)
             break;
     }
@@ -54,6 +87,15 @@ os_mmap(void *hint, size_t size, int prot, int flags)
     if (addr == MAP_FAILED)
         return NULL;
 
+#if defined(MADV_HUGEPAGE)
+    if (map_size > request_size)
+        addr = align_to_huge_page(addr, map_size, request_size);
+    else if ((flags & MMAP_MAP_HUGEPAGE) && (flags & MMAP_MAP_FIXED))
+        /* Re-mapping part of an existing reservation, the caller
+           is responsible for the alignment */
+        madvise(addr, request_size, MADV_HUGEPAGE);
+#endif
+
     return addr;
 }
 
@@ -107,7 +107,11 @@ enum {
     MMAP_MAP_32BIT = 1,
     /* Don't interpret addr as a hint: place the mapping at exactly
        that address. */
-    MMAP_MAP_FIXED = 2
+    MMAP_MAP_FIXED = 2,
+    /* Align the mapping to huge page boundary and back it with
+       transparent huge pages if the platform supports it, the
+       flag is ignored otherwise */
+    MMAP_MAP_HUGEPAGE = 4
 };
 
 void *os_mmap(void *hint, size_t size, int prot, int flags);
@@ -57,6 +57,8 @@ typedef pthread_t korp_thread;
 
 #define os_thread_local_attribute __thread
 
+#define os_getpagesize getpagesize
+
 #if WASM_DISABLE_HW_BOUND_CHECK == 0
 #if defined(BUILD_TARGET_X86_64) \
     || defined(BUILD_TARGET_AMD_64) \
@@ -72,8 +74,6 @@ typedef jmp_buf korp_jmpbuf;
 #define os_longjmp longjmp
 #define os_alloca alloca
 
-#define os_getpagesize getpagesize
-
 typedef void (*os_signal_handler)(void *sig_addr);
 
 int os_thread_signal_init(os_signal_handler handler);
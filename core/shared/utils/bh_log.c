@@ -17,21 +17,12 @@ bh_log_set_verbose_level(uint32 level)
     log_verbose_level = level;
 }
 
-void
-bh_log(LogLevel log_level, const char *file, int line, const char *fmt, ...)
+static void
+log_print_header(uint64 usec, uintptr_t self, const char *file, int line)
 {
-    va_list ap;
-    korp_tid self;
     char buf[32] = { 0 };
-    uint64 usec;
     uint32 t, h, m, s, mills;
 
-    if ((uint32)log_level > log_verbose_level)
-        return;
-
-    self = os_self_thread();
-
-    usec = os_time_get_boot_microsecond();
     t = (uint32)(usec / 1000000) % (24 * 60 * 60);
     h = t / (60 * 60);
     t = t % (60 * 60);
@@ -41,10 +32,289 @@ bh_log(LogLevel log_level, const char *file, int line, const char *fmt, ...)
 
     snprintf(buf, sizeof(buf), "%02u:%02u:%02u:%03u", h, m, s, mills);
 
-    os_printf("[%s - %X]: ", buf, (uint32)(uintptr_t)self);
+    os_printf("[%s - %X]: ", buf, (uint32)self);
 
     if (file)
         os_printf("%s, line %d, ", file, line);
+}
+
+#if WASM_ENABLE_ASYNC_LOG != 0
+
+/*
+ * In the async mode, the message of a log is formatted by the calling
+ * thread into a slot of a bounded ring, since its arguments may not
+ * live long, and a background thread formats the header and prints the
+ * logs in order. The ring is a lock-free multi-producer queue whose
+ * slots carry sequence numbers, a log is dropped and counted when the
+ * ring is full. The background thread sleeps on the condition variable
+ * when the ring is empty, and only the writer which finds it sleeping
+ * takes the lock to wake it up. The fatal logs are still printed
+ * synchronously.
+ */
+
+#if (WASM_ASYNC_LOG_SLOT_COUNT & (WASM_ASYNC_LOG_SLOT_COUNT - 1)) != 0
+#error "WASM_ASYNC_LOG_SLOT_COUNT must be a power of 2"
+#endif
+
+#define SLOT_MASK (WASM_ASYNC_LOG_SLOT_COUNT - 1)
+
+typedef struct LogSlot {
+    /* the position of the log which can be written into the slot when
+       it is free, or the position + 1 when its log is ready */
+    uint32 seq;
+    int line;
+    const char *file;
+    uint64 usec;
+    uintptr_t self;
+    char msg[WASM_ASYNC_LOG_MSG_SIZE];
+} LogSlot;
+
+typedef struct AsyncLog {
+    /* the fields below accessed by the writers are atomic */
+    uint32 running;
+    uint32 active_writers;
+    uint32 write_pos;
+    uint32 read_pos;
+    /* set by the background thread before it sleeps, and cleared with
+       the lock held by the writer which wakes it up */
+    uint32 flusher_idle;
+    uint64 dropped_count;
+    LogSlot *slots;
+
+    uint64 reported_dropped_count;
+    korp_mutex lock;
+    korp_cond cond;
+    korp_tid thread;
+    bool thread_exit;
+} AsyncLog;
+
+static AsyncLog async_log;
+
+/* Return false if the async mode isn't running */
+static bool
+async_log_write(const char *file, int line, const char *fmt, va_list ap)
+{
+    LogSlot *slot;
+    uint32 pos, seq;
+    bool ret = false;
+
+    __atomic_add_fetch(&async_log.active_writers, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&async_log.running, __ATOMIC_SEQ_CST))
+        goto leave;
+
+    ret = true;
+    pos = __atomic_load_n(&async_log.write_pos, __ATOMIC_RELAXED);
+    while (true) {
+        slot = async_log.slots + (pos & SLOT_MASK);
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq == pos) {
+            /* pos is reloaded if another writer takes the slot */
+            if (__atomic_compare_exchange_n(&async_log.write_pos, &pos,
+                                            pos + 1, true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+                break;
+        }
+        else if ((int32)(seq - pos) < 0) {
+            /* The log of the last round isn't flushed, the ring is full */
+            __atomic_fetch_add(&async_log.dropped_count, 1,
+                               __ATOMIC_RELAXED);
+            goto leave;
+        }
+        else
+            pos = __atomic_load_n(&async_log.write_pos, __ATOMIC_RELAXED);
+    }
+
+    slot->file = file;
+    slot->line = line;
+    slot->usec = os_time_get_boot_microsecond();
+    slot->self = (uintptr_t)os_self_thread();
+    vsnprintf(slot->msg, sizeof(slot->msg), fmt, ap);
+    /* Sequentially consistent with the check of flusher_idle below and
+       the checks in the background thread, so that either the log is
+       seen by the background thread before it sleeps, or it is seen
+       sleeping here */
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&async_log.flusher_idle, __ATOMIC_SEQ_CST)) {
+        os_mutex_lock(&async_log.lock);
+        if (async_log.flusher_idle) {
+            __atomic_store_n(&async_log.flusher_idle, 0, __ATOMIC_SEQ_CST);
+            os_cond_signal(&async_log.cond);
+        }
+        os_mutex_unlock(&async_log.lock);
+    }
+
+leave:
+    __atomic_sub_fetch(&async_log.active_writers, 1, __ATOMIC_SEQ_CST);
+    return ret;
+}
+
+/* Print the logs ready in order, called by the background thread only,
+   or after it exits */
+static void
+async_log_flush()
+{
+    LogSlot *slot;
+    uint32 pos = async_log.read_pos;
+    uint64 dropped_count;
+
+    while (true) {
+        slot = async_log.slots + (pos & SLOT_MASK);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+            break;
+
+        log_print_header(slot->usec, slot->self, slot->file, slot->line);
+        os_printf("%s\n", slot->msg);
+
+        __atomic_store_n(&slot->seq, pos + WASM_ASYNC_LOG_SLOT_COUNT,
+                         __ATOMIC_RELEASE);
+        pos++;
+        __atomic_store_n(&async_log.read_pos, pos, __ATOMIC_RELAXED);
+    }
+
+    dropped_count = __atomic_load_n(&async_log.dropped_count,
+                                    __ATOMIC_RELAXED);
+    if (dropped_count != async_log.reported_dropped_count) {
+        os_printf("[bh_log]: %"PRIu64" logs dropped since the ring is full\n",
+                  dropped_count - async_log.reported_dropped_count);
+        async_log.reported_dropped_count = dropped_count;
+    }
+}
+
+static bool
+async_log_ready()
+{
+    uint32 pos = async_log.read_pos;
+    LogSlot *slot = async_log.slots + (pos & SLOT_MASK);
+
+    return __atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) == pos + 1;
+}
+
+static void *
+async_log_thread_routine(void *arg)
+{
+    (void)arg;
+
+    os_mutex_lock(&async_log.lock);
+    while (!async_log.thread_exit) {
+        os_mutex_unlock(&async_log.lock);
+        async_log_flush();
+        os_mutex_lock(&async_log.lock);
+
+        if (async_log.thread_exit)
+            break;
+
+        /* Re-check the ring after announcing the sleep, a writer which
+           doesn't see flusher_idle has made its log visible */
+        __atomic_store_n(&async_log.flusher_idle, 1, __ATOMIC_SEQ_CST);
+        if (async_log_ready())
+            __atomic_store_n(&async_log.flusher_idle, 0, __ATOMIC_SEQ_CST);
+        else
+            os_cond_wait(&async_log.cond, &async_log.lock);
+    }
+    __atomic_store_n(&async_log.flusher_idle, 0, __ATOMIC_SEQ_CST);
+    os_mutex_unlock(&async_log.lock);
+    return NULL;
+}
+
+bool
+bh_log_async_start()
+{
+    uint32 i;
+
+    if (async_log.slots)
+        return true;
+
+    if (!(async_log.slots = BH_MALLOC(sizeof(LogSlot)
+                                      * WASM_ASYNC_LOG_SLOT_COUNT)))
+        return false;
+
+    for (i = 0; i < WASM_ASYNC_LOG_SLOT_COUNT; i++)
+        async_log.slots[i].seq = i;
+    async_log.write_pos = async_log.read_pos = 0;
+    async_log.dropped_count = async_log.reported_dropped_count = 0;
+    async_log.flusher_idle = 0;
+
+    if (os_mutex_init(&async_log.lock) != 0)
+        goto fail1;
+
+    if (os_cond_init(&async_log.cond) != 0)
+        goto fail2;
+
+    async_log.thread_exit = false;
+    if (os_thread_create(&async_log.thread, async_log_thread_routine, NULL,
+                         APP_THREAD_STACK_SIZE_DEFAULT) != 0)
+        goto fail3;
+
+    __atomic_store_n(&async_log.running, 1, __ATOMIC_SEQ_CST);
+    return true;
+
+fail3:
+    os_cond_destroy(&async_log.cond);
+fail2:
+    os_mutex_destroy(&async_log.lock);
+fail1:
+    BH_FREE(async_log.slots);
+    async_log.slots = NULL;
+    return false;
+}
+
+void
+bh_log_async_stop()
+{
+    if (!async_log.slots)
+        return;
+
+    /* The logs are printed synchronously since then, wait for the
+       writers which see the async mode running */
+    __atomic_store_n(&async_log.running, 0, __ATOMIC_SEQ_CST);
+
+    os_mutex_lock(&async_log.lock);
+    while (__atomic_load_n(&async_log.active_writers, __ATOMIC_SEQ_CST) > 0)
+        os_cond_reltimedwait(&async_log.cond, &async_log.lock, 100);
+    async_log.thread_exit = true;
+    os_cond_signal(&async_log.cond);
+    os_mutex_unlock(&async_log.lock);
+    os_thread_join(async_log.thread, NULL);
+
+    async_log_flush();
+
+    os_cond_destroy(&async_log.cond);
+    os_mutex_destroy(&async_log.lock);
+    BH_FREE(async_log.slots);
+    async_log.slots = NULL;
+}
+
+uint64
+bh_log_async_get_dropped_count()
+{
+    return __atomic_load_n(&async_log.dropped_count, __ATOMIC_RELAXED);
+}
+
+#endif /* end of WASM_ENABLE_ASYNC_LOG != 0 */
+
+void
+bh_log(LogLevel log_level, const char *file, int line, const char *fmt, ...)
+{
+    va_list ap;
+
+    if ((uint32)log_level > log_verbose_level)
+        return;
+
+#if WASM_ENABLE_ASYNC_LOG != 0
+    if (log_level != BH_LOG_LEVEL_FATAL) {
+        bool written;
+
+        va_start(ap, fmt);
+        written = async_log_write(file, line, fmt, ap);
+        va_end(ap);
+        if (written)
+            return;
+    }
+#endif
+
+    log_print_header(os_time_get_boot_microsecond(),
+                     (uintptr_t)os_self_thread(), file, line);
 
     va_start(ap, fmt);
     os_vprintf(fmt, ap);
@@ -41,6 +41,30 @@ bh_log_set_verbose_level(uint32 level);
 void
 bh_log(LogLevel log_level, const char *file, int line, const char *fmt, ...);
 
+#if WASM_ENABLE_ASYNC_LOG != 0
+/**
+ * Start the async mode, in which the logs except the fatal ones are
+ * queued into a bounded ring and printed by a background thread.
+ *
+ * @return true if success, false otherwise
+ */
+bool
+bh_log_async_start();
+
+/**
+ * Stop the async mode after printing the logs queued, the logs are
+ * printed synchronously since then.
+ */
+void
+bh_log_async_stop();
+
+/**
+ * Get the count of the logs dropped since the ring is full.
+ */
+uint64
+bh_log_async_get_dropped_count();
+#endif
+
 #ifdef BH_PLATFORM_NUTTX
 
 #undef LOG_FATAL
@@ -33,6 +33,8 @@ print_help()
     printf("  --heap-size=n          Set maximum heap size in bytes, default is 16 KB\n");
     printf("  --repl                 Start a very simple REPL (read-eval-print-loop) mode\n"
            "                         that runs commands in the form of `FUNC ARG...`\n");
+    printf("  --huge-page            Map linear memory and AOT code with transparent huge\n"
+           "                         pages to reduce TLB misses\n");
 #if WASM_ENABLE_LIBC_WASI != 0
     printf("  --env=<env>            Pass wasi environment variables with \"key=value\"\n");
     printf("                         to the program, for example:\n");
@@ -47,6 +49,45 @@ print_help()
 #endif
 #if WASM_ENABLE_LIB_PTHREAD != 0
     printf("  --max-threads=n        Set maximum thread number per cluster, default is 4\n");
+#endif
+#if WASM_ENABLE_STATIC_PGO != 0
+    printf("  --gen-prof-file=<path> Generate the profile file of the AOT module compiled\n"
+           "                         with wamrc --enable-pgo-instrument after running it\n");
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    printf("  --gen-exec-profile=<path>\n"
+           "                         Write the execution counts of the opcodes, the\n"
+           "                         functions and the blocks into the file in JSON\n");
+#endif
+#if WASM_ENABLE_JIT != 0
+    printf("  --aot-cache-dir=<dir>  Cache the AOT files compiled from the wasm files in\n"
+           "                         the directory and load them on the later runs\n");
+#if WASM_ENABLE_INTERP != 0
+    printf("  --aot-cache-background Run with the interpreter when the AOT file isn't\n"
+           "                         cached yet and compile it in a background thread\n");
+#endif
+#endif
+#if WASM_ENABLE_LINUX_PERF != 0
+    printf("  --perf-map             Write the native code of the wasm functions into\n"
+           "                         /tmp/perf-<pid>.map for perf\n");
+    printf("  --jitdump              Write the native code of the wasm functions with\n"
+           "                         the code bytes into /tmp/jit-<pid>.dump for perf\n");
+#endif
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    printf("  --sampling-profile=<path>\n"
+           "                         Sample the wasm call stacks and write the folded\n"
+           "                         stacks into the file at exit or on SIGUSR2\n");
+#endif
+#if WASM_ENABLE_STARTUP_TIMING != 0
+    printf("  --startup-timing       Print the time spent in each phase of loading and\n"
+           "                         instantiating the module before running it\n");
+#endif
+#if WASM_ENABLE_METRICS != 0
+    printf("  --metrics              Print the runtime metrics as JSON after running\n");
+#endif
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    printf("  --native-call-stats    Print the call count and latency of each native\n"
+           "                         function as JSON after running\n");
 #endif
     return 1;
 }
@@ -166,6 +207,150 @@ validate_env_str(char *env)
 }
 #endif
 
+#if WASM_ENABLE_STATIC_PGO != 0
+static void
+dump_pgo_prof_data(wasm_module_inst_t module_inst, const char *path)
+{
+    char *buf;
+    uint32 len;
+    FILE *file;
+
+    if (!(len = wasm_runtime_get_pgo_prof_data_size(module_inst))) {
+        printf("Failed to get the profile data, the module should be compiled "
+               "with wamrc --enable-pgo-instrument\n");
+        return;
+    }
+
+    if (!(buf = wasm_runtime_malloc(len))) {
+        printf("Allocate memory failed\n");
+        return;
+    }
+
+    len = wasm_runtime_dump_pgo_prof_data_to_buf(module_inst, buf, len);
+    if (!(file = fopen(path, "wb"))) {
+        printf("Open file %s failed\n", path);
+        wasm_runtime_free(buf);
+        return;
+    }
+
+    if (fwrite(buf, 1, len, file) != len)
+        printf("Write profile data to file %s failed\n", path);
+
+    fclose(file);
+    wasm_runtime_free(buf);
+}
+#endif
+
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+static void
+dump_exec_profile(wasm_module_inst_t module_inst, const char *path)
+{
+    char *buf;
+    uint32 len;
+    FILE *file;
+
+    if (!(len = wasm_runtime_get_exec_profile_size(module_inst))) {
+        printf("Failed to get the execution profile\n");
+        return;
+    }
+
+    if (!(buf = wasm_runtime_malloc(len))) {
+        printf("Allocate memory failed\n");
+        return;
+    }
+
+    len = wasm_runtime_dump_exec_profile_to_buf(module_inst, buf, len);
+    if (!(file = fopen(path, "w"))) {
+        printf("Open file %s failed\n", path);
+        wasm_runtime_free(buf);
+        return;
+    }
+
+    if (fwrite(buf, 1, len, file) != len)
+        printf("Write execution profile to file %s failed\n", path);
+
+    fclose(file);
+    wasm_runtime_free(buf);
+}
+#endif
+
+#if WASM_ENABLE_METRICS != 0
+static void
+print_metrics()
+{
+    char *buf;
+    uint32 len, size = 0;
+
+    /* the metrics may grow between the calls */
+    do {
+        size = wasm_runtime_dump_metrics_to_buf(NULL, 0) + 128;
+        if (!(buf = wasm_runtime_malloc(size))) {
+            printf("Allocate memory failed\n");
+            return;
+        }
+        len = wasm_runtime_dump_metrics_to_buf(buf, size);
+        if (len < size)
+            break;
+        wasm_runtime_free(buf);
+    } while (true);
+
+    printf("%s", buf);
+    wasm_runtime_free(buf);
+}
+#endif
+
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+static void
+print_native_call_stats()
+{
+    char *buf;
+    uint32 len, size = 0;
+
+    /* the stats may grow between the calls */
+    do {
+        size = wasm_runtime_dump_native_call_stats_to_buf(NULL, 0) + 128;
+        if (!(buf = wasm_runtime_malloc(size))) {
+            printf("Allocate memory failed\n");
+            return;
+        }
+        len = wasm_runtime_dump_native_call_stats_to_buf(buf, size);
+        if (len < size)
+            break;
+        wasm_runtime_free(buf);
+    } while (true);
+
+    printf("%s", buf);
+    wasm_runtime_free(buf);
+}
+#endif
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+static void
+sampling_profile_dump_handler(int sig)
+{
+    (void)sig;
+    wasm_runtime_request_sampling_profile_dump();
+}
+
+static bool
+start_sampling_profiler(const char *path)
+{
+    struct sigaction sig_act;
+
+    if (!wasm_runtime_start_sampling_profiler(0, path)) {
+        printf("Start sampling profiler failed\n");
+        return false;
+    }
+
+    memset(&sig_act, 0, sizeof(sig_act));
+    sig_act.sa_handler = sampling_profile_dump_handler;
+    sig_act.sa_flags = SA_RESTART;
+    sigemptyset(&sig_act.sa_mask);
+    sigaction(SIGUSR2, &sig_act, NULL);
+    return true;
+}
+#endif
+
 #define USE_GLOBAL_HEAP_BUF 0
 
 #if USE_GLOBAL_HEAP_BUF != 0
@@ -230,6 +415,32 @@ main(int argc, char *argv[])
     int log_verbose_level = 2;
 #endif
     bool is_repl_mode = false;
+    bool enable_huge_page = false;
+#if WASM_ENABLE_STATIC_PGO != 0
+    const char *gen_prof_file = NULL;
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    const char *gen_exec_profile = NULL;
+#endif
+#if WASM_ENABLE_JIT != 0
+    const char *aot_cache_dir = NULL;
+    bool aot_cache_compile_in_background = false;
+#endif
+#if WASM_ENABLE_LINUX_PERF != 0
+    bool enable_perf_map = false, enable_jitdump = false;
+#endif
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    const char *sampling_profile = NULL;
+#endif
+#if WASM_ENABLE_STARTUP_TIMING != 0
+    bool print_startup_timing = false;
+#endif
+#if WASM_ENABLE_METRICS != 0
+    bool print_runtime_metrics = false;
+#endif
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    bool print_call_stats = false;
+#endif
 #if WASM_ENABLE_LIBC_WASI != 0
     const char *dir_list[8] = { NULL };
     uint32 dir_list_size = 0;
@@ -257,6 +468,9 @@ main(int argc, char *argv[])
         else if (!strcmp(argv[0], "--repl")) {
             is_repl_mode = true;
         }
+        else if (!strcmp(argv[0], "--huge-page")) {
+            enable_huge_page = true;
+        }
         else if (!strncmp(argv[0], "--stack-size=", 13)) {
             if (argv[0][13] == '\0')
                 return print_help();
@@ -313,6 +527,62 @@ main(int argc, char *argv[])
                 return print_help();
             wasm_runtime_set_max_thread_num(atoi(argv[0] + 14));
         }
+#endif
+#if WASM_ENABLE_STATIC_PGO != 0
+        else if (!strncmp(argv[0], "--gen-prof-file=", 16)) {
+            if (argv[0][16] == '\0')
+                return print_help();
+            gen_prof_file = argv[0] + 16;
+        }
+#endif
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+        else if (!strncmp(argv[0], "--gen-exec-profile=", 19)) {
+            if (argv[0][19] == '\0')
+                return print_help();
+            gen_exec_profile = argv[0] + 19;
+        }
+#endif
+#if WASM_ENABLE_JIT != 0
+        else if (!strncmp(argv[0], "--aot-cache-dir=", 16)) {
+            if (argv[0][16] == '\0')
+                return print_help();
+            aot_cache_dir = argv[0] + 16;
+        }
+#if WASM_ENABLE_INTERP != 0
+        else if (!strcmp(argv[0], "--aot-cache-background")) {
+            aot_cache_compile_in_background = true;
+        }
+#endif
+#endif
+#if WASM_ENABLE_LINUX_PERF != 0
+        else if (!strcmp(argv[0], "--perf-map")) {
+            enable_perf_map = true;
+        }
+        else if (!strcmp(argv[0], "--jitdump")) {
+            enable_jitdump = true;
+        }
+#endif
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+        else if (!strncmp(argv[0], "--sampling-profile=", 19)) {
+            if (argv[0][19] == '\0')
+                return print_help();
+            sampling_profile = argv[0] + 19;
+        }
+#endif
+#if WASM_ENABLE_STARTUP_TIMING != 0
+        else if (!strcmp(argv[0], "--startup-timing")) {
+            print_startup_timing = true;
+        }
+#endif
+#if WASM_ENABLE_METRICS != 0
+        else if (!strcmp(argv[0], "--metrics")) {
+            print_runtime_metrics = true;
+        }
+#endif
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+        else if (!strcmp(argv[0], "--native-call-stats")) {
+            print_call_stats = true;
+        }
 #endif
         else
             return print_help();
@@ -338,6 +608,17 @@ main(int argc, char *argv[])
     init_args.mem_alloc_option.allocator.free_func = free;
 #endif
 
+    init_args.enable_huge_page = enable_huge_page;
+#if WASM_ENABLE_JIT != 0
+    init_args.aot_cache_dir = aot_cache_dir;
+    init_args.aot_cache_compile_in_background =
+        aot_cache_compile_in_background;
+#endif
+#if WASM_ENABLE_LINUX_PERF != 0
+    init_args.enable_perf_map = enable_perf_map;
+    init_args.enable_jitdump = enable_jitdump;
+#endif
+
     /* initialize runtime environment */
     if (!wasm_runtime_full_init(&init_args)) {
         printf("Init runtime environment failed.\n");
@@ -377,6 +658,16 @@ main(int argc, char *argv[])
         goto fail3;
     }
 
+#if WASM_ENABLE_STARTUP_TIMING != 0
+    if (print_startup_timing)
+        wasm_runtime_dump_startup_timing();
+#endif
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    if (sampling_profile && !start_sampling_profiler(sampling_profile))
+        goto fail4;
+#endif
+
     if (is_repl_mode)
         app_instance_repl(wasm_module_inst);
     else if (func_name)
@@ -384,6 +675,36 @@ main(int argc, char *argv[])
     else
         app_instance_main(wasm_module_inst);
 
+#if WASM_ENABLE_STATIC_PGO != 0
+    if (gen_prof_file)
+        dump_pgo_prof_data(wasm_module_inst, gen_prof_file);
+#endif
+
+#if WASM_ENABLE_OPCODE_COUNTER != 0
+    if (gen_exec_profile)
+        dump_exec_profile(wasm_module_inst, gen_exec_profile);
+#endif
+
+#if WASM_ENABLE_METRICS != 0
+    if (print_runtime_metrics)
+        print_metrics();
+#endif
+
+#if WASM_ENABLE_NATIVE_CALL_STATS != 0
+    if (print_call_stats)
+        print_native_call_stats();
+#endif
+
+#if WASM_ENABLE_SAMPLING_PROFILER != 0
+    if (sampling_profile) {
+        wasm_runtime_stop_sampling_profiler();
+        if (!wasm_runtime_dump_sampling_profile(sampling_profile))
+            printf("Write sampling profile to file %s failed\n",
+                   sampling_profile);
+    }
+
+fail4:
+#endif
     /* destroy the module instance */
     wasm_runtime_deinstantiate(wasm_module_inst);
 
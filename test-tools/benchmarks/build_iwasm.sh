@@ -0,0 +1,53 @@
+#!/bin/bash
+
+#
+# Copyright (C) 2019 Intel Corporation.  All rights reserved.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+
+# Build the iwasm of each running mode into build/<mode>/iwasm:
+#   classic  classic interpreter
+#   fast     fast interpreter, also used to run the AOT files
+#   baseline fast interpreter with the baseline JIT, x86-64 only
+#   jit      LLVM JIT, requires the LLVM libraries built by
+#            <wamr dir>/product-mini/platforms/linux/build_llvm.sh
+# and the wamrc to compile the AOT files.
+#
+# The extra arguments are passed to cmake of all the builds, e.g.
+#   ./build_iwasm.sh -DWAMR_BUILD_LIB_PTHREAD=1
+
+set -e
+
+BENCH_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+WAMR_DIR="${BENCH_DIR}/../.."
+PLATFORM_DIR="${WAMR_DIR}/product-mini/platforms/linux"
+OUT_DIR="${BENCH_DIR}/build"
+COMMON_OPTIONS="-DCMAKE_BUILD_TYPE=Release -DWAMR_BUILD_SIMD=1 \
+                -DWAMR_BUILD_LIBC_EMCC=1 $*"
+
+function build_iwasm()
+{
+    local mode=$1
+    shift
+    echo "---> build iwasm of ${mode} mode"
+    rm -rf ${OUT_DIR}/${mode}
+    mkdir -p ${OUT_DIR}/${mode}
+    cd ${OUT_DIR}/${mode}
+    cmake ${PLATFORM_DIR} ${COMMON_OPTIONS} "$@"
+    make -j $(nproc)
+}
+
+build_iwasm classic -DWAMR_BUILD_FAST_INTERP=0
+build_iwasm fast -DWAMR_BUILD_FAST_INTERP=1 -DWAMR_BUILD_AOT=1
+build_iwasm jit -DWAMR_BUILD_JIT=1
+if [ "$(uname -m)" == "x86_64" ]; then
+    build_iwasm baseline -DWAMR_BUILD_FAST_INTERP=1 -DWAMR_BUILD_BASELINE_JIT=1
+fi
+
+if [ ! -f ${WAMR_DIR}/wamr-compiler/build/wamrc ]; then
+    echo "---> build wamrc"
+    cd ${WAMR_DIR}/wamr-compiler
+    mkdir -p build && cd build
+    cmake .. -DCMAKE_BUILD_TYPE=Release
+    make -j $(nproc)
+fi
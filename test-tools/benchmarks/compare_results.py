@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2019 Intel Corporation.  All rights reserved.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+
+"""
+Compare the results of run_benchmarks.py with the baseline results, print
+the change of each metric and exit with 1 if any metric regresses beyond
+the threshold, so that it can be used as a gate in CI.
+"""
+
+import argparse
+import json
+import math
+import sys
+
+# The metrics compared, lower is better for all of them
+METRICS = ["wall_time", "startup_time", "max_rss_kb", "instructions"]
+
+
+def get_metric(result, metric):
+    value = result.get(metric)
+    if isinstance(value, dict):
+        value = value.get("median")
+    return value if isinstance(value, (int, float)) and value > 0 else None
+
+
+def geomean(ratios):
+    return math.exp(sum(math.log(r) for r in ratios) / len(ratios))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare the benchmark results with the baseline")
+    parser.add_argument("baseline", help="the results of the baseline")
+    parser.add_argument("current", help="the results to check")
+    parser.add_argument("-t", "--threshold", type=float, default=5.0,
+                        help="the percentage of the increase of a metric "
+                             "to report as a regression (default: 5)")
+    parser.add_argument("--metric-threshold", action="append", default=[],
+                        metavar="METRIC=PERCENT",
+                        help="the threshold of a metric, e.g. "
+                             "startup_time=10, can be repeated")
+    parser.add_argument("-m", "--metrics", default=",".join(METRICS),
+                        help="comma separated metrics to compare "
+                             "(default: all)")
+    args = parser.parse_args()
+
+    thresholds = {metric: args.threshold for metric in METRICS}
+    for item in args.metric_threshold:
+        metric, _, percent = item.partition("=")
+        if metric not in METRICS:
+            parser.error("unknown metric {}".format(metric))
+        try:
+            thresholds[metric] = float(percent)
+        except ValueError:
+            parser.error("invalid threshold {}".format(item))
+
+    metrics = [m for m in args.metrics.split(",") if m]
+    for metric in metrics:
+        if metric not in METRICS:
+            parser.error("unknown metric {}".format(metric))
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)["results"]
+    with open(args.current) as f:
+        current = json.load(f)["results"]
+
+    regressions = []
+    ratios = {}
+    print("{:<32} {:<8} {:<14} {:>14} {:>14} {:>9}".format(
+        "benchmark", "mode", "metric", "baseline", "current", "change"))
+    for bench in sorted(current):
+        for mode in sorted(current[bench]):
+            cur_result = current[bench][mode]
+            base_result = baseline.get(bench, {}).get(mode)
+            if base_result is None:
+                continue
+            if "error" in cur_result and "error" not in base_result:
+                regressions.append((bench, mode, "error"))
+                print("{:<32} {:<8} failed: {}".format(bench, mode,
+                                                        cur_result["error"]))
+                continue
+
+            for metric in metrics:
+                base_value = get_metric(base_result, metric)
+                cur_value = get_metric(cur_result, metric)
+                if base_value is None or cur_value is None:
+                    continue
+
+                ratio = cur_value / base_value
+                ratios.setdefault((mode, metric), []).append(ratio)
+                change = (ratio - 1) * 100
+                mark = ""
+                if change > thresholds[metric]:
+                    mark = "  REGRESSION"
+                    regressions.append((bench, mode, metric))
+                elif change < -thresholds[metric]:
+                    mark = "  improved"
+                print("{:<32} {:<8} {:<14} {:>14.6g} {:>14.6g} {:>+8.2f}%{}"
+                      .format(bench, mode, metric, base_value, cur_value,
+                              change, mark))
+
+    if ratios:
+        print("\nGeometric mean of the changes:")
+        for (mode, metric), values in sorted(ratios.items()):
+            print("  {:<8} {:<14} {:>+8.2f}% ({} benchmarks)".format(
+                mode, metric, (geomean(values) - 1) * 100, len(values)))
+
+    if regressions:
+        print("\n{} regressions beyond the thresholds".format(
+            len(regressions)))
+        return 1
+    print("\nNo regression beyond the thresholds")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,127 @@
+#!/bin/bash
+
+#
+# Copyright (C) 2019 Intel Corporation.  All rights reserved.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+
+# Compare the TLB misses and the execution time of a wasm/AOT application
+# run by iwasm without and with the `--huge-page` option, e.g.
+#   cd <wamr dir>/samples/workload/bwa/build
+#   <wamr dir>/test-tools/benchmarks/compare_tlb_misses.sh -- \
+#       --dir=. bwa.aot index hs38DH.fa
+#
+# The arguments after `--` are passed to iwasm, options:
+#   -i <iwasm>  the iwasm to run, build/fast/iwasm built by build_iwasm.sh
+#               by default
+#   -r <count>  run the application <count> times in each mode, 1 by default
+#
+# perf is required, and the transparent huge pages must be enabled in
+# `madvise` or `always` mode. The max AnonHugePages of the iwasm process
+# is also sampled to check whether the huge pages are actually used.
+
+set -e
+
+BENCH_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+IWASM="${BENCH_DIR}/build/fast/iwasm"
+REPEAT=1
+EVENTS="dTLB-loads,dTLB-load-misses,iTLB-loads,iTLB-load-misses"
+THP_ENABLED=/sys/kernel/mm/transparent_hugepage/enabled
+
+function usage()
+{
+    echo "Usage: $0 [-i <iwasm>] [-r <count>] -- <iwasm args>"
+    exit 1
+}
+
+while getopts "i:r:h" opt; do
+    case ${opt} in
+        i) IWASM=${OPTARG} ;;
+        r) REPEAT=${OPTARG} ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ]; then
+    usage
+fi
+
+if ! command -v perf > /dev/null; then
+    echo "perf is not found, please install it first"
+    exit 1
+fi
+
+if [ ! -x "${IWASM}" ]; then
+    echo "${IWASM} is not found, build it with build_iwasm.sh or set it with -i"
+    exit 1
+fi
+
+if [ -f ${THP_ENABLED} ]; then
+    echo "transparent huge pages: $(cat ${THP_ENABLED})"
+    if grep -q "\[never\]" ${THP_ENABLED}; then
+        echo "warning: transparent huge pages are disabled, enable them with"
+        echo "  echo madvise | sudo tee ${THP_ENABLED}"
+    fi
+else
+    echo "warning: ${THP_ENABLED} is not found, huge pages may not be supported"
+fi
+
+TMP_DIR=$(mktemp -d)
+trap "rm -rf ${TMP_DIR}" EXIT
+
+# Run iwasm with perf stat and print the counters, the miss rates, the
+# elapsed time and the max AnonHugePages of the iwasm processes
+function run_mode()
+{
+    local name=$1
+    shift
+    local stat_file=${TMP_DIR}/${name}.csv
+    local max_huge_kb=0
+    local begin end perf_pid iwasm_pid huge_kb
+
+    echo "---> run iwasm ${name}"
+    begin=$(date +%s.%N)
+    perf stat -x , -e ${EVENTS} -r ${REPEAT} -o ${stat_file} \
+        -- "${IWASM}" "$@" &
+    perf_pid=$!
+    while kill -0 ${perf_pid} 2> /dev/null; do
+        iwasm_pid=$(pgrep -P ${perf_pid} | head -n 1)
+        if [ -n "${iwasm_pid}" ]; then
+            huge_kb=$(awk '/^AnonHugePages:/ { print $2 }' \
+                      /proc/${iwasm_pid}/smaps_rollup 2> /dev/null)
+            if [ -n "${huge_kb}" ] && [ ${huge_kb} -gt ${max_huge_kb} ]; then
+                max_huge_kb=${huge_kb}
+            fi
+        fi
+        sleep 0.1
+    done
+    wait ${perf_pid}
+    end=$(date +%s.%N)
+
+    awk -F , -v name="${name}" -v huge_kb=${max_huge_kb} \
+        -v elapsed=$(echo "${begin} ${end} ${REPEAT}" \
+                     | awk '{ printf "%.3f", ($2 - $1) / $3 }') '
+        $3 != "" { count[$3] = $1 }
+        function rate(misses, loads) {
+            if (loads ~ /^[0-9]+$/ && misses ~ /^[0-9]+$/ && loads > 0)
+                return sprintf("%.4f%%", misses * 100 / loads)
+            return "n/a"
+        }
+        END {
+            printf "%-8s dTLB-loads: %s, dTLB-load-misses: %s (%s)\n", name,
+                   count["dTLB-loads"], count["dTLB-load-misses"],
+                   rate(count["dTLB-load-misses"], count["dTLB-loads"])
+            printf "%-8s iTLB-loads: %s, iTLB-load-misses: %s (%s)\n", name,
+                   count["iTLB-loads"], count["iTLB-load-misses"],
+                   rate(count["iTLB-load-misses"], count["iTLB-loads"])
+            printf "%-8s elapsed: %ss per run, max AnonHugePages: %s kB\n",
+                   name, elapsed, huge_kb
+        }' ${stat_file} | tee -a ${TMP_DIR}/summary
+}
+
+run_mode default "$@"
+run_mode huge "--huge-page" "$@"
+
+echo "---> summary"
+cat ${TMP_DIR}/summary
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+#
+# Copyright (C) 2019 Intel Corporation.  All rights reserved.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+
+# Build coremark.wasm into out/ with wasi-sdk, which is installed in
+# /opt/wasi-sdk by default, or set WASI_SDK_DIR to its directory
+
+set -e
+
+BUILD_SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+OUT_DIR="${BUILD_SCRIPT_DIR}/out"
+WASI_SDK_DIR="${WASI_SDK_DIR:-/opt/wasi-sdk}"
+
+cd ${BUILD_SCRIPT_DIR}
+if [ ! -d coremark ]; then
+    git clone https://github.com/eembc/coremark.git
+fi
+
+mkdir -p ${OUT_DIR}
+cd coremark
+
+echo "---> build coremark.wasm"
+${WASI_SDK_DIR}/bin/clang -O3 -Iposix -I. -DFLAGS_STR=\""-O3 -DPERFORMANCE_RUN=1"\" \
+        -Wl,--export=main \
+        -DITERATIONS=400000 -DSEED_METHOD=SEED_VOLATILE -DPERFORMANCE_RUN=1 \
+        -Wl,--allow-undefined \
+        core_list_join.c core_main.c core_matrix.c core_state.c \
+        core_util.c posix/core_portme.c \
+        -o ${OUT_DIR}/coremark.wasm
+
+echo "---> build coremark native"
+gcc -O3 -Iposix -I. -DFLAGS_STR=\""-O3 -DPERFORMANCE_RUN=1"\" \
+        -DITERATIONS=400000 -DSEED_METHOD=SEED_VOLATILE -DPERFORMANCE_RUN=1 \
+        core_list_join.c core_main.c core_matrix.c core_state.c \
+        core_util.c posix/core_portme.c \
+        -o ${OUT_DIR}/coremark_native -lrt
+
+echo "Done"
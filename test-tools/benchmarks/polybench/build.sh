@@ -0,0 +1,42 @@
+#!/bin/bash
+
+#
+# Copyright (C) 2019 Intel Corporation.  All rights reserved.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+
+# Build the PolyBench/C kernels into out/<kernel>.wasm with wasi-sdk,
+# which is installed in /opt/wasi-sdk by default, or set WASI_SDK_DIR
+# to its directory
+
+set -e
+
+BUILD_SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+OUT_DIR="${BUILD_SCRIPT_DIR}/out"
+WASI_SDK_DIR="${WASI_SDK_DIR:-/opt/wasi-sdk}"
+POLYBENCH_NAME="polybench-c-4.2.1-beta"
+POLYBENCH_DIR="${BUILD_SCRIPT_DIR}/${POLYBENCH_NAME}"
+
+cd ${BUILD_SCRIPT_DIR}
+if [ ! -d ${POLYBENCH_NAME} ]; then
+    if [ ! -f ${POLYBENCH_NAME}.tar.gz ]; then
+        wget https://downloads.sourceforge.net/project/polybench/${POLYBENCH_NAME}.tar.gz
+    fi
+    tar -xzf ${POLYBENCH_NAME}.tar.gz
+fi
+
+mkdir -p ${OUT_DIR}
+cd ${POLYBENCH_DIR}
+
+for file in $(find . -name "*.c" ! -path "./utilities/*")
+do
+    kernel=$(basename ${file} .c)
+    echo "---> build ${kernel}.wasm"
+    ${WASI_SDK_DIR}/bin/clang -O3 -I utilities -I $(dirname ${file}) \
+            -DPOLYBENCH_TIME -D_WASI_EMULATED_PROCESS_CLOCKS \
+            utilities/polybench.c ${file} \
+            -lwasi-emulated-process-clocks \
+            -o ${OUT_DIR}/${kernel}.wasm
+done
+
+echo "Done"
@@ -0,0 +1,379 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2019 Intel Corporation.  All rights reserved.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+
+"""
+Run the benchmarks listed in benchmarks.json with iwasm in the classic
+interpreter, fast interpreter, baseline JIT, AOT and LLVM JIT modes, and
+write the results into a JSON file which can be compared with
+compare_results.py.
+
+For each benchmark and mode, the following metrics are recorded:
+  wall_time     the wall clock time of the whole run, in seconds
+  startup_time  the time to start iwasm, load and instantiate the module
+                without running it, in seconds
+  max_rss_kb    the max resident set size of the run, in KB
+  instructions  the user space instructions retired, counted with
+                `perf stat` if it is available
+"""
+
+import argparse
+import glob
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+SCRIPT_DIR = Path(__file__).resolve().parent
+WAMR_DIR = SCRIPT_DIR.parent.parent
+RESULT_FORMAT_VERSION = 1
+
+MODES = ["classic", "fast", "baseline", "aot", "jit"]
+
+# The iwasm binaries built by build_iwasm.sh, the AOT files are run
+# with the fast interpreter build
+DEFAULT_IWASM = {
+    "classic": SCRIPT_DIR / "build" / "classic" / "iwasm",
+    "fast": SCRIPT_DIR / "build" / "fast" / "iwasm",
+    "baseline": SCRIPT_DIR / "build" / "baseline" / "iwasm",
+    "aot": SCRIPT_DIR / "build" / "fast" / "iwasm",
+    "jit": SCRIPT_DIR / "build" / "jit" / "iwasm",
+}
+DEFAULT_WAMRC = WAMR_DIR / "wamr-compiler" / "build" / "wamrc"
+
+# The function looked up to measure the startup time, iwasm exits after
+# instantiating the module since the function doesn't exist
+STARTUP_PROBE_FUNC = "__wamr_benchmark_startup_probe__"
+
+
+def load_manifest(manifest_path, name_filter):
+    """Expand the benchmarks of the manifest, the "wasm" field can be a
+    glob pattern, which adds a benchmark for each file matched"""
+    with open(manifest_path) as f:
+        manifest = json.load(f)
+
+    base_dir = Path(manifest_path).resolve().parent
+    benchmarks = []
+    for entry in manifest["benchmarks"]:
+        pattern = str(base_dir / entry["wasm"])
+        files = sorted(glob.glob(pattern))
+        if not files:
+            if not entry.get("optional", False):
+                print("warning: {} not found, build the suite first"
+                      .format(entry["wasm"]), file=sys.stderr)
+            continue
+
+        for wasm_file in files:
+            bench = dict(entry)
+            if glob.has_magic(entry["wasm"]):
+                bench["name"] = "{}/{}".format(entry["suite"],
+                                               Path(wasm_file).stem)
+            bench["wasm"] = Path(wasm_file)
+            bench["cwd"] = (base_dir / entry["cwd"] if "cwd" in entry
+                            else Path(wasm_file).parent)
+            if name_filter and not any(f in bench["name"]
+                                       for f in name_filter):
+                continue
+            benchmarks.append(bench)
+    return benchmarks
+
+
+def compile_aot(wamrc, bench, aot_dir):
+    """Compile the wasm file to an AOT file, which is reused if it is
+    newer than the wasm file and wamrc"""
+    aot_file = aot_dir / (bench["name"].replace("/", "_") + ".aot")
+    if (aot_file.exists()
+            and aot_file.stat().st_mtime > bench["wasm"].stat().st_mtime
+            and aot_file.stat().st_mtime > Path(wamrc).stat().st_mtime):
+        return aot_file
+
+    cmd = [str(wamrc)] + bench.get("wamrc_args", []) \
+        + ["-o", str(aot_file), str(bench["wasm"])]
+    ret = subprocess.run(cmd, stdout=subprocess.DEVNULL,
+                         stderr=subprocess.PIPE, universal_newlines=True)
+    if ret.returncode != 0 or not aot_file.exists():
+        print("error: failed to compile {}: {}".format(
+            bench["name"], ret.stderr.strip()), file=sys.stderr)
+        return None
+    return aot_file
+
+
+def run_once(cmd, cwd, timeout, gnu_time=None):
+    """Run the command, return (wall time, max RSS in KB, error, output),
+    the error is None if it succeeds"""
+    # iwasm exits with 0 even if an exception is thrown, so the output is
+    # kept to check the exception, it is written to a file rather than a
+    # pipe to avoid blocking the benchmark
+    with tempfile.TemporaryFile(mode="w+", errors="replace") as out, \
+            tempfile.NamedTemporaryFile(mode="r", suffix=".txt") as rss:
+        # The max RSS of a child of this script includes the memory of
+        # this script, which is copied before exec, while GNU time forks
+        # the command from a much smaller process
+        if gnu_time:
+            cmd = [gnu_time, "-f", "%M", "-o", rss.name, "--"] + cmd
+        begin = time.perf_counter()
+        proc = subprocess.Popen(cmd, cwd=str(cwd), stdout=out,
+                                stderr=subprocess.STDOUT)
+        try:
+            # wait4 returns the resource usage of the process waited for
+            if hasattr(os, "wait4") and timeout is None:
+                _, status, rusage = os.wait4(proc.pid, 0)
+                proc.returncode = os.waitstatus_to_exitcode(status) \
+                    if hasattr(os, "waitstatus_to_exitcode") else status
+                max_rss = rusage.ru_maxrss
+                # ru_maxrss is in bytes on macOS
+                if sys.platform == "darwin":
+                    max_rss //= 1024
+            else:
+                proc.wait(timeout=timeout)
+                max_rss = None
+        except subprocess.TimeoutExpired:
+            proc.kill()
+            proc.wait()
+            return None, None, "timeout", ""
+        elapsed = time.perf_counter() - begin
+
+        out.seek(0)
+        output = out.read()
+        if gnu_time:
+            lines = rss.read().split()
+            max_rss = int(lines[-1]) if lines and lines[-1].isdigit() \
+                else None
+
+    error = None
+    if proc.returncode != 0:
+        error = "exit status {}".format(proc.returncode)
+    else:
+        for line in output.splitlines():
+            if line.startswith("Exception: ") \
+                    and line != "Exception: wasi proc exit":
+                error = line
+                break
+    return elapsed, max_rss, error, output
+
+
+def count_instructions(perf, cmd, cwd):
+    """Count the user space instructions of the command with perf stat"""
+    with tempfile.NamedTemporaryFile(mode="r", suffix=".txt") as out:
+        ret = subprocess.run([perf, "stat", "-x", ",", "-e", "instructions:u",
+                              "-o", out.name, "--"] + cmd,
+                             cwd=str(cwd), stdout=subprocess.DEVNULL,
+                             stderr=subprocess.DEVNULL)
+        if ret.returncode != 0:
+            return None
+        for line in out.read().splitlines():
+            fields = line.split(",")
+            if len(fields) > 2 and fields[2].startswith("instructions"):
+                try:
+                    return int(fields[0])
+                except ValueError:
+                    return None
+    return None
+
+
+def summarize(samples):
+    return {
+        "median": statistics.median(samples),
+        "min": min(samples),
+        "mean": statistics.mean(samples),
+        "stdev": statistics.stdev(samples) if len(samples) > 1 else 0.0,
+        "samples": samples,
+    }
+
+
+def run_benchmark(bench, mode, iwasm, module_file, args):
+    iwasm_args = [str(iwasm)] + bench.get("iwasm_args", [])
+    if bench.get("dir", False):
+        iwasm_args.append("--dir=.")
+    cmd = iwasm_args + [str(module_file)] + bench.get("args", [])
+
+    result = {}
+    wall_times, max_rss = [], 0
+    for i in range(args.warmup + args.repeat):
+        elapsed, rss, error, _ = run_once(cmd, bench["cwd"], args.timeout,
+                                          args.gnu_time)
+        if error:
+            result["error"] = error
+            return result
+        if i >= args.warmup:
+            wall_times.append(elapsed)
+        if rss:
+            max_rss = max(max_rss, rss)
+    result["wall_time"] = summarize(wall_times)
+    if max_rss:
+        result["max_rss_kb"] = max_rss
+
+    # Stop after instantiating the module by calling a function that
+    # doesn't exist, the lookup only fails if the module is instantiated
+    startup_cmd = iwasm_args + ["-f", STARTUP_PROBE_FUNC, str(module_file)]
+    startup_times = []
+    for i in range(args.repeat):
+        elapsed, _, _, output = run_once(startup_cmd, bench["cwd"],
+                                         args.timeout)
+        if elapsed is None or STARTUP_PROBE_FUNC not in output:
+            break
+        startup_times.append(elapsed)
+    if startup_times:
+        result["startup_time"] = summarize(startup_times)
+
+    if args.perf:
+        instructions = count_instructions(args.perf, cmd, bench["cwd"])
+        if instructions is not None:
+            result["instructions"] = instructions
+    return result
+
+
+def get_gnu_time():
+    """Return the path of GNU time if it is installed"""
+    for path in ["/usr/bin/time", "/usr/local/bin/gtime", "/usr/bin/gtime"]:
+        if not os.access(path, os.X_OK):
+            continue
+        ret = subprocess.run([path, "-f", "%M", "true"],
+                             stdout=subprocess.DEVNULL,
+                             stderr=subprocess.PIPE, universal_newlines=True)
+        if ret.returncode == 0 and ret.stderr.strip().isdigit():
+            return path
+    return None
+
+
+def get_git_commit():
+    try:
+        return subprocess.check_output(
+            ["git", "-C", str(WAMR_DIR), "rev-parse", "HEAD"],
+            stderr=subprocess.DEVNULL, universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Run the WAMR benchmarks in each running mode")
+    parser.add_argument("-m", "--modes", default=",".join(MODES),
+                        help="comma separated modes to run, from {} "
+                             "(default: all)".format(", ".join(MODES)))
+    parser.add_argument("-b", "--benchmarks", action="append",
+                        help="only run the benchmarks whose names contain "
+                             "the string, can be repeated")
+    parser.add_argument("--manifest", default=SCRIPT_DIR / "benchmarks.json",
+                        help="the benchmark list (default: benchmarks.json)")
+    for mode in MODES:
+        parser.add_argument("--iwasm-{}".format(mode),
+                            default=DEFAULT_IWASM[mode],
+                            help="the iwasm to run the {} mode "
+                                 "(default: %(default)s)".format(mode))
+    parser.add_argument("--wamrc", default=DEFAULT_WAMRC,
+                        help="the wamrc to compile the AOT files "
+                             "(default: %(default)s)")
+    parser.add_argument("-r", "--repeat", type=int, default=3,
+                        help="measured runs of each benchmark (default: 3)")
+    parser.add_argument("-w", "--warmup", type=int, default=0,
+                        help="unmeasured runs before the measured ones "
+                             "(default: 0)")
+    parser.add_argument("-t", "--timeout", type=float, default=None,
+                        help="timeout of each run in seconds, the max RSS "
+                             "is only recorded with GNU time if it is set")
+    parser.add_argument("--no-perf", action="store_true",
+                        help="don't count the instructions with perf")
+    parser.add_argument("-o", "--output", default="results.json",
+                        help="the JSON file to write the results "
+                             "(default: results.json)")
+    args = parser.parse_args()
+
+    modes = [m for m in args.modes.split(",") if m]
+    for mode in modes:
+        if mode not in MODES:
+            parser.error("unknown mode {}".format(mode))
+    if args.repeat < 1:
+        parser.error("--repeat must be at least 1")
+
+    args.perf = None if args.no_perf else shutil.which("perf")
+    args.gnu_time = get_gnu_time()
+    if not args.gnu_time:
+        print("warning: GNU time not found, the max RSS includes the memory "
+              "of this script", file=sys.stderr)
+
+    benchmarks = load_manifest(args.manifest, args.benchmarks)
+    if not benchmarks:
+        print("error: no benchmark to run", file=sys.stderr)
+        return 1
+
+    iwasm = {}
+    for mode in modes:
+        path = Path(getattr(args, "iwasm_" + mode))
+        if path.exists():
+            iwasm[mode] = path.resolve()
+        else:
+            print("warning: {} not found, skip {} mode".format(path, mode),
+                  file=sys.stderr)
+
+    aot_dir = None
+    if "aot" in iwasm:
+        if Path(args.wamrc).exists():
+            aot_dir = SCRIPT_DIR / "build" / "aot"
+            aot_dir.mkdir(parents=True, exist_ok=True)
+        else:
+            print("warning: {} not found, skip aot mode".format(args.wamrc),
+                  file=sys.stderr)
+            del iwasm["aot"]
+
+    results = {}
+    for bench in benchmarks:
+        results[bench["name"]] = bench_results = {}
+        for mode in modes:
+            if mode not in iwasm:
+                continue
+            if mode == "aot":
+                module_file = compile_aot(args.wamrc, bench, aot_dir)
+                if not module_file:
+                    bench_results[mode] = {"error": "compilation failed"}
+                    continue
+            else:
+                module_file = bench["wasm"]
+
+            print("Running {} in {} mode ..".format(bench["name"], mode),
+                  flush=True)
+            result = run_benchmark(bench, mode, iwasm[mode], module_file,
+                                   args)
+            bench_results[mode] = result
+            if "error" in result:
+                print("  failed: {}".format(result["error"]))
+            else:
+                print("  wall time {:.3f} s, startup {:.1f} ms{}{}".format(
+                    result["wall_time"]["median"],
+                    result["startup_time"]["median"] * 1000
+                    if "startup_time" in result else float("nan"),
+                    ", max RSS {} KB".format(result["max_rss_kb"])
+                    if "max_rss_kb" in result else "",
+                    ", {} instructions".format(result["instructions"])
+                    if "instructions" in result else ""))
+
+    output = {
+        "version": RESULT_FORMAT_VERSION,
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "git_commit": get_git_commit(),
+        "host": {
+            "system": platform.system(),
+            "machine": platform.machine(),
+            "processor": platform.processor(),
+            "cpu_count": os.cpu_count(),
+        },
+        "iwasm": {mode: str(path) for mode, path in iwasm.items()},
+        "repeat": args.repeat,
+        "results": results,
+    }
+    with open(args.output, "w") as f:
+        json.dump(output, f, indent=2)
+    print("Results written to {}".format(args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+#
+# Copyright (C) 2019 Intel Corporation.  All rights reserved.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+
+# Build the shootout kernels of sightglass into out/<kernel>.wasm with
+# wasi-sdk, which is installed in /opt/wasi-sdk by default, or set
+# WASI_SDK_DIR to its directory
+
+set -e
+
+BUILD_SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+OUT_DIR="${BUILD_SCRIPT_DIR}/out"
+WASI_SDK_DIR="${WASI_SDK_DIR:-/opt/wasi-sdk}"
+SHOOTOUT_CASES="base64 fib2 gimli heapsort matrix memmove nestedloop \
+                nestedloop2 nestedloop3 random seqhash sieve strchr \
+                switch2"
+
+cd ${BUILD_SCRIPT_DIR}
+if [ ! -d sightglass ]; then
+    git clone https://github.com/wasm-micro-runtime/sightglass.git
+fi
+
+mkdir -p ${OUT_DIR}
+cd sightglass/benchmarks/shootout
+
+for bench in ${SHOOTOUT_CASES}
+do
+    echo "---> build ${bench}.wasm"
+    ${WASI_SDK_DIR}/bin/clang -O3 -nostdlib \
+            -Wno-unknown-attributes \
+            -Dblack_box=set_res \
+            -I../../include -DNOSTDLIB_MODE \
+            -Wl,--initial-memory=1310720,--allow-undefined \
+            -Wl,--strip-all,--no-entry \
+            -Wl,--export=app_main -Wl,--export=_start \
+            -o ${OUT_DIR}/${bench}.wasm \
+            ${bench}.c main/main_${bench}.c main/my_libc.c
+done
+
+echo "Done"
@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2019 Intel Corporation.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+/*
+ * Measure the latency of loading a module, instantiating it and calling
+ * its first function, which is the cold start latency of a short-lived
+ * instance. Each iteration starts from a fresh copy of the module file,
+ * and the percentiles of each step are reported per module, together
+ * with the startup phases timed by the runtime.
+ *
+ * Without module files, synthetic modules with different counts of
+ * functions are generated to show how the latency scales with the
+ * module size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wasm_export.h"
+#include "bh_read_file.h"
+
+#define DEFAULT_ITERATIONS 200
+#define MAX_FUNC_ARGS 8
+
+enum {
+    STEP_LOAD = 0,
+    STEP_INSTANTIATE,
+    STEP_FIRST_CALL,
+    STEP_TOTAL,
+    STEP_NUM
+};
+
+static const char *step_names[STEP_NUM] = {
+    "load", "instantiate", "first call", "total"
+};
+
+static uint32_t iterations = DEFAULT_ITERATIONS;
+static uint32_t stack_size = 16 * 1024, heap_size = 16 * 1024;
+static const char *func_name = NULL;
+static uint32_t func_argv[MAX_FUNC_ARGS];
+static uint32_t func_argc = 0;
+
+static int
+print_help()
+{
+    printf("Usage: startup_bench [options] [wasm or aot files]\n");
+    printf("options:\n");
+    printf("  -n <count>             Iterations of each module, default is %u\n",
+           DEFAULT_ITERATIONS);
+    printf("  -s <n1,n2,...>         Function counts of the synthetic modules run\n"
+           "                         when no file is given, default is\n"
+           "                         1,10,100,1000,10000\n");
+    printf("  -f <function>          Function called after instantiating the files,\n"
+           "                         the synthetic modules call \"run\"\n");
+    printf("  -a <i32>               Argument of the function, can be repeated\n");
+    printf("  --stack-size=n         Set maximum stack size in bytes, default is 16 KB\n");
+    printf("  --heap-size=n          Set maximum heap size in bytes, default is 16 KB\n");
+    return 1;
+}
+
+static uint64_t
+time_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct ByteBuf {
+    uint8_t *data;
+    uint32_t size;
+    uint32_t capacity;
+} ByteBuf;
+
+static void
+buf_put(ByteBuf *buf, const void *data, uint32_t size)
+{
+    if (buf->size + size > buf->capacity) {
+        uint32_t capacity = buf->capacity ? buf->capacity : 256;
+
+        while (capacity < buf->size + size)
+            capacity *= 2;
+        if (!(buf->data = realloc(buf->data, capacity))) {
+            printf("Allocate memory failed\n");
+            exit(1);
+        }
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->size, data, size);
+    buf->size += size;
+}
+
+static void
+buf_put_byte(ByteBuf *buf, uint8_t byte)
+{
+    buf_put(buf, &byte, 1);
+}
+
+static void
+buf_put_uleb(ByteBuf *buf, uint32_t value)
+{
+    do {
+        uint8_t byte = value & 0x7F;
+
+        value >>= 7;
+        if (value)
+            byte |= 0x80;
+        buf_put_byte(buf, byte);
+    } while (value);
+}
+
+static void
+buf_put_sleb(ByteBuf *buf, int32_t value)
+{
+    bool more = true;
+
+    while (more) {
+        uint8_t byte = value & 0x7F;
+
+        value >>= 7;
+        if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40)))
+            more = false;
+        else
+            byte |= 0x80;
+        buf_put_byte(buf, byte);
+    }
+}
+
+static void
+buf_put_section(ByteBuf *buf, uint8_t id, ByteBuf *body)
+{
+    buf_put_byte(buf, id);
+    buf_put_uleb(buf, body->size);
+    buf_put(buf, body->data, body->size);
+    body->size = 0;
+}
+
+/*
+ * Generate a module with func_count functions of type (i32) -> i32, each
+ * of them runs a loop storing into the linear memory, and the first one
+ * is exported as "run".
+ */
+static uint8_t *
+generate_module(uint32_t func_count, uint32_t *p_size)
+{
+    static const uint8_t header[] = { 0x00, 0x61, 0x73, 0x6D,
+                                      0x01, 0x00, 0x00, 0x00 };
+    static const uint8_t type[] = { 0x01, 0x60, 0x01, 0x7F, 0x01, 0x7F };
+    ByteBuf module = { 0 }, section = { 0 }, body = { 0 };
+    uint8_t data[256];
+    uint32_t i;
+
+    buf_put(&module, header, sizeof(header));
+
+    buf_put(&section, type, sizeof(type));
+    buf_put_section(&module, 1, &section);
+
+    buf_put_uleb(&section, func_count);
+    for (i = 0; i < func_count; i++)
+        buf_put_byte(&section, 0);
+    buf_put_section(&module, 3, &section);
+
+    /* memory 1 */
+    buf_put(&section, "\x01\x00\x01", 3);
+    buf_put_section(&module, 5, &section);
+
+    /* export "run" */
+    buf_put(&section, "\x01\x03run\x00\x00", 7);
+    buf_put_section(&module, 7, &section);
+
+    buf_put_uleb(&section, func_count);
+    for (i = 0; i < func_count; i++) {
+        /* no local */
+        buf_put_byte(&body, 0x00);
+        /* block, loop */
+        buf_put(&body, "\x02\x40\x03\x40", 4);
+        /* br_if 1 (i32.eqz (local.get 0)) */
+        buf_put(&body, "\x20\x00\x45\x0D\x01", 5);
+        /* i32.store (i32.const 0) (i32.mul (local.get 0) (i32.const k)) */
+        buf_put(&body, "\x41\x00\x20\x00\x41", 5);
+        buf_put_sleb(&body, (int32_t)(i % 100 + 1));
+        buf_put(&body, "\x6C\x36\x02\x00", 4);
+        /* local.set 0 (i32.sub (local.get 0) (i32.const 1)), br 0 */
+        buf_put(&body, "\x20\x00\x41\x01\x6B\x21\x00\x0C\x00", 9);
+        /* end, end, i32.load (i32.const 0), end */
+        buf_put(&body, "\x0B\x0B\x41\x00\x28\x02\x00\x0B", 8);
+
+        buf_put_uleb(&section, body.size);
+        buf_put(&section, body.data, body.size);
+        body.size = 0;
+    }
+    buf_put_section(&module, 10, &section);
+
+    /* an active data segment at offset 0 */
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)i;
+    buf_put(&section, "\x01\x00\x41\x00\x0B", 5);
+    buf_put_uleb(&section, sizeof(data));
+    buf_put(&section, data, sizeof(data));
+    buf_put_section(&module, 11, &section);
+
+    free(section.data);
+    free(body.data);
+    *p_size = module.size;
+    return module.data;
+}
+
+static int
+compare_uint64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* Nearest-rank percentile of the sorted samples */
+static uint64_t
+percentile(const uint64_t *sorted, uint32_t count, uint32_t p)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)count * p + 99) / 100);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static bool
+run_iteration(const uint8_t *file_buf, uint8_t *buf, uint32_t size,
+              const char *call_name, const uint32_t *argv, uint32_t argc,
+              uint64_t *times)
+{
+    wasm_module_t module = NULL;
+    wasm_module_inst_t module_inst = NULL;
+    wasm_exec_env_t exec_env = NULL;
+    wasm_function_inst_t func;
+    uint32_t args[MAX_FUNC_ARGS];
+    char error_buf[128];
+    uint64_t t0, t1, t2, t3;
+    bool ret = false;
+
+    /* The loader may modify the buffer, e.g. the classic interpreter
+       rewrites some opcodes, so load a fresh copy each time */
+    memcpy(buf, file_buf, size);
+    memcpy(args, argv, sizeof(uint32_t) * argc);
+
+    t0 = time_ns();
+    if (!(module = wasm_runtime_load(buf, size,
+                                     error_buf, sizeof(error_buf)))) {
+        printf("%s\n", error_buf);
+        return false;
+    }
+
+    t1 = time_ns();
+    if (!(module_inst = wasm_runtime_instantiate(module, stack_size,
+                                                 heap_size, error_buf,
+                                                 sizeof(error_buf)))) {
+        printf("%s\n", error_buf);
+        goto fail;
+    }
+
+    t2 = time_ns();
+    if (call_name) {
+        if (!(func = wasm_runtime_lookup_function(module_inst, call_name,
+                                                  NULL))) {
+            printf("function %s not found\n", call_name);
+            goto fail;
+        }
+        if (!(exec_env = wasm_runtime_create_exec_env(module_inst,
+                                                      stack_size))) {
+            printf("Create exec env failed\n");
+            goto fail;
+        }
+        if (!wasm_runtime_call_wasm(exec_env, func, argc, args)) {
+            printf("%s\n", wasm_runtime_get_exception(module_inst));
+            goto fail;
+        }
+    }
+    t3 = time_ns();
+
+    times[STEP_LOAD] = t1 - t0;
+    times[STEP_INSTANTIATE] = t2 - t1;
+    times[STEP_FIRST_CALL] = t3 - t2;
+    times[STEP_TOTAL] = t3 - t0;
+    ret = true;
+
+fail:
+    if (exec_env)
+        wasm_runtime_destroy_exec_env(exec_env);
+    if (module_inst)
+        wasm_runtime_deinstantiate(module_inst);
+    wasm_runtime_unload(module);
+    return ret;
+}
+
+static bool
+run_module(const char *name, const uint8_t *file_buf, uint32_t size,
+           const char *call_name, const uint32_t *argv, uint32_t argc)
+{
+    uint64_t *samples[STEP_NUM] = { NULL }, times[STEP_NUM], cold_total = 0;
+#if WASM_ENABLE_STARTUP_TIMING != 0
+    uint64_t phase_total[WASM_STARTUP_PHASE_NUM] = { 0 };
+    wasm_startup_timing_t timing;
+#endif
+    uint8_t *buf;
+    uint32_t i, j;
+    bool ret = false;
+
+    if (!(buf = malloc(size))) {
+        printf("Allocate memory failed\n");
+        return false;
+    }
+    for (i = 0; i < STEP_NUM; i++) {
+        if (!(samples[i] = malloc(sizeof(uint64_t) * iterations))) {
+            printf("Allocate memory failed\n");
+            goto fail;
+        }
+    }
+
+    for (i = 0; i < iterations; i++) {
+#if WASM_ENABLE_STARTUP_TIMING != 0
+        wasm_runtime_reset_startup_timing();
+#endif
+        if (!run_iteration(file_buf, buf, size, call_name, argv, argc,
+                           times))
+            goto fail;
+#if WASM_ENABLE_STARTUP_TIMING != 0
+        wasm_runtime_get_startup_timing(&timing);
+        for (j = 0; j < WASM_STARTUP_PHASE_NUM; j++)
+            phase_total[j] += timing.time_us[j];
+#endif
+        for (j = 0; j < STEP_NUM; j++)
+            samples[j][i] = times[j];
+        if (i == 0)
+            cold_total = times[STEP_TOTAL];
+    }
+
+    printf("== %s (%u bytes, %u iterations) ==\n", name, size, iterations);
+    printf("  %-14s %10s %10s %10s %10s %10s  (us)\n",
+           "", "mean", "p50", "p90", "p99", "max");
+    for (i = 0; i < STEP_NUM; i++) {
+        uint64_t sum = 0;
+
+        if (i == STEP_FIRST_CALL && !call_name)
+            continue;
+        for (j = 0; j < iterations; j++)
+            sum += samples[i][j];
+        qsort(samples[i], iterations, sizeof(uint64_t), compare_uint64);
+        printf("  %-14s %10.1f %10.1f %10.1f %10.1f %10.1f\n", step_names[i],
+               sum / 1000.0 / iterations,
+               percentile(samples[i], iterations, 50) / 1000.0,
+               percentile(samples[i], iterations, 90) / 1000.0,
+               percentile(samples[i], iterations, 99) / 1000.0,
+               samples[i][iterations - 1] / 1000.0);
+    }
+    printf("  cold start (the first iteration): %.1f us\n",
+           cold_total / 1000.0);
+
+#if WASM_ENABLE_STARTUP_TIMING != 0
+    printf("  startup phases (mean us):");
+    for (i = 0, j = 0; j < WASM_STARTUP_PHASE_NUM; j++) {
+        if (j == WASM_STARTUP_LOAD || j == WASM_STARTUP_INSTANTIATE
+            || phase_total[j] == 0)
+            continue;
+        printf("%s %s %.1f", i++ > 0 ? "," : "",
+               wasm_runtime_get_startup_phase_name(j),
+               (double)phase_total[j] / iterations);
+    }
+    printf("\n");
+#endif
+    printf("\n");
+    ret = true;
+
+fail:
+    for (i = 0; i < STEP_NUM; i++)
+        free(samples[i]);
+    free(buf);
+    return ret;
+}
+
+static bool
+run_synthetic_modules(const char *sizes)
+{
+    const char *p = sizes;
+    char name[64];
+
+    while (*p) {
+        char *end;
+        unsigned long func_count = strtoul(p, &end, 10);
+        uint32_t argv[1] = { 100 }, size;
+        uint8_t *module_buf;
+        bool ret;
+
+        if (end == p || func_count == 0 || func_count > 1000000
+            || (*end != ',' && *end != '\0')) {
+            printf("Invalid function counts %s\n", sizes);
+            return false;
+        }
+
+        module_buf = generate_module((uint32_t)func_count, &size);
+        snprintf(name, sizeof(name), "synthetic, %lu functions", func_count);
+        ret = run_module(name, module_buf, size, "run", argv, 1);
+        free(module_buf);
+        if (!ret)
+            return false;
+
+        p = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *sizes = "1,10,100,1000,10000";
+    RuntimeInitArgs init_args;
+    int i, ret = 0;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "-n")) {
+            if (++i >= argc || (iterations = (uint32_t)atoi(argv[i])) == 0)
+                return print_help();
+        }
+        else if (!strcmp(argv[i], "-s")) {
+            if (++i >= argc)
+                return print_help();
+            sizes = argv[i];
+        }
+        else if (!strcmp(argv[i], "-f")) {
+            if (++i >= argc)
+                return print_help();
+            func_name = argv[i];
+        }
+        else if (!strcmp(argv[i], "-a")) {
+            if (++i >= argc || func_argc >= MAX_FUNC_ARGS)
+                return print_help();
+            func_argv[func_argc++] = (uint32_t)strtol(argv[i], NULL, 0);
+        }
+        else if (!strncmp(argv[i], "--stack-size=", 13)) {
+            if (argv[i][13] == '\0')
+                return print_help();
+            stack_size = (uint32_t)atoi(argv[i] + 13);
+        }
+        else if (!strncmp(argv[i], "--heap-size=", 12)) {
+            if (argv[i][12] == '\0')
+                return print_help();
+            heap_size = (uint32_t)atoi(argv[i] + 12);
+        }
+        else
+            return print_help();
+    }
+
+    memset(&init_args, 0, sizeof(RuntimeInitArgs));
+    init_args.mem_alloc_type = Alloc_With_Allocator;
+    init_args.mem_alloc_option.allocator.malloc_func = malloc;
+    init_args.mem_alloc_option.allocator.realloc_func = realloc;
+    init_args.mem_alloc_option.allocator.free_func = free;
+
+    if (!wasm_runtime_full_init(&init_args)) {
+        printf("Init runtime environment failed.\n");
+        return 1;
+    }
+
+    if (i == argc) {
+        if (!run_synthetic_modules(sizes))
+            ret = 1;
+    }
+
+    for (; i < argc; i++) {
+        uint32_t size;
+        uint8_t *file_buf = (uint8_t *)bh_read_file_to_buffer(argv[i], &size);
+
+        if (!file_buf) {
+            ret = 1;
+            break;
+        }
+        if (!run_module(argv[i], file_buf, size, func_name,
+                        func_argv, func_argc))
+            ret = 1;
+        wasm_runtime_free(file_buf);
+        if (ret)
+            break;
+    }
+
+    wasm_runtime_destroy();
+    return ret;
+}
@@ -9,6 +9,8 @@
 #include "wasm_export.h"
 #include "aot_export.h"
 
+/* Max number of the CPUs of a fat AoT file */
+#define MAX_CPU_VARIANT_NUM 8
 
 #if WASM_ENABLE_REF_TYPES != 0
 extern void
@@ -32,8 +34,13 @@ print_help()
   printf("                            Use +feature to enable a feature, or -feature to disable it\n");
   printf("                            For example, --cpu-features=+feature1,-feature2\n");
   printf("                            Use --cpu-features=+help to list all the features supported\n");
+  printf("  --cpu-variants=<cpus>     Generate a fat AoT file with the code compiled for each of the\n");
+  printf("                            comma separated x86 CPUs, the runtime loads the variant that\n");
+  printf("                            best fits the host CPU. --target must be set, for example,\n");
+  printf("                            --target=x86_64 --cpu-variants=nehalem,haswell,skylake-avx512\n");
   printf("  --opt-level=n             Set the optimization level (0 to 3, default is 3)\n");
   printf("  --size-level=n            Set the code size level (0 to 3, default is 3)\n");
+  printf("                            A smaller level inlines larger functions into their callers\n");
   printf("  -sgx                      Generate code for SGX platform (Intel Software Guard Extention)\n");
   printf("  --bounds-checks=1/0       Enable or disable the bounds checks for memory access:\n");
   printf("                              by default it is disabled in all 64-bit platforms except SGX and\n");
@@ -56,7 +63,22 @@ print_help()
   printf("  --enable-ref-types        Enable the post-MVP reference types feature\n");
   printf("  --disable-aux-stack-check Disable auxiliary stack overflow/underflow check\n");
   printf("  --enable-dump-call-stack  Enable stack trace feature\n");
+  printf("  --enable-frame-pointer    Keep the frame pointer in the functions, so that the call stack can\n");
+  printf("                            be walked by the runtime, profilers and debuggers without the\n");
+  printf("                            auxiliary stack frames of --enable-dump-call-stack\n");
   printf("  --enable-perf-profiling   Enable function performance profiling\n");
+  printf("  --enable-pgo-instrument   Instrument the code to generate the profile data for PGO, run the\n");
+  printf("                            AoT file with iwasm --gen-prof-file=<file> to save the profile data\n");
+  printf("  --use-prof-file=<file>    Use the profile data generated by the instrumented AoT file to\n");
+  printf("                            optimize the code, the wasm file must be the same\n");
+  printf("  --enable-call-indirect-devirt\n");
+  printf("                            Call the functions of the tables that are never changed at runtime\n");
+  printf("                            directly in call_indirect, so that they can be inlined\n");
+  printf("  --incremental-cache-dir=<dir>\n");
+  printf("                            Optimize and compile each function separately, cache the code\n");
+  printf("                            of the functions in the directory and reuse the code of the\n");
+  printf("                            unchanged functions in the later compilations, the functions\n");
+  printf("                            aren't inlined into each other, only for aot format\n");
   printf("  -v=n                      Set log verbose level (0 to 5, default is 2), larger with more log\n");
   printf("Examples: wamrc -o test.aot test.wasm\n");
   printf("          wamrc --target=i386 -o test.aot test.wasm\n");
@@ -68,8 +90,11 @@ int
 main(int argc, char *argv[])
 {
   char *wasm_file_name = NULL, *out_file_name = NULL;
-  uint8 *wasm_file = NULL;
-  uint32 wasm_file_size;
+  char *prof_file_name = NULL;
+  char *cpu_variants[MAX_CPU_VARIANT_NUM];
+  uint32 cpu_variant_count = 0;
+  uint8 *wasm_file = NULL, *prof_file = NULL;
+  uint32 wasm_file_size, prof_file_size;
   wasm_module_t wasm_module = NULL;
   aot_comp_data_t comp_data = NULL;
   aot_comp_context_t comp_ctx = NULL;
@@ -110,6 +135,16 @@ main(int argc, char *argv[])
             return print_help();
         option.target_cpu = argv[0] + 6;
     }
+    else if (!strncmp(argv[0], "--cpu-variants=", 15)) {
+        char *cpu;
+        if (argv[0][15] == '\0')
+            return print_help();
+        for (cpu = strtok(argv[0] + 15, ","); cpu; cpu = strtok(NULL, ",")) {
+            if (cpu_variant_count == MAX_CPU_VARIANT_NUM)
+                return print_help();
+            cpu_variants[cpu_variant_count++] = cpu;
+        }
+    }
     else if (!strncmp(argv[0], "--cpu-features=", 15)) {
         if (argv[0][15] == '\0')
             return print_help();
@@ -182,9 +217,28 @@ main(int argc, char *argv[])
     else if (!strcmp(argv[0], "--enable-dump-call-stack")) {
         option.enable_aux_stack_frame = true;
     }
+    else if (!strcmp(argv[0], "--enable-frame-pointer")) {
+        option.enable_frame_pointer = true;
+    }
     else if (!strcmp(argv[0], "--enable-perf-profiling")) {
         option.enable_aux_stack_frame = true;
     }
+    else if (!strcmp(argv[0], "--enable-pgo-instrument")) {
+        option.enable_pgo_instrument = true;
+    }
+    else if (!strncmp(argv[0], "--use-prof-file=", 16)) {
+        if (argv[0][16] == '\0')
+            return print_help();
+        prof_file_name = argv[0] + 16;
+    }
+    else if (!strcmp(argv[0], "--enable-call-indirect-devirt")) {
+        option.enable_call_indirect_devirt = true;
+    }
+    else if (!strncmp(argv[0], "--incremental-cache-dir=", 24)) {
+        if (argv[0][24] == '\0')
+            return print_help();
+        option.incremental_cache_dir = argv[0] + 24;
+    }
     else
       return print_help();
   }
@@ -192,6 +246,17 @@ main(int argc, char *argv[])
   if (argc == 0 || !out_file_name)
     return print_help();
 
+  /* The variants are compiled for their own CPUs to AoT files */
+  if (cpu_variant_count > 0
+      && (option.target_cpu || option.output_format != AOT_FORMAT_FILE))
+    return print_help();
+
+  /* The functions are only compiled separately when emitting AoT file */
+  if (option.incremental_cache_dir
+      && (option.output_format != AOT_FORMAT_FILE
+          || option.enable_pgo_instrument))
+    return print_help();
+
   if (sgx_mode) {
     option.size_level = 1;
     option.is_sgx_platform = true;
@@ -237,6 +302,30 @@ main(int argc, char *argv[])
     goto fail3;
   }
 
+  if (prof_file_name) {
+    /* load the profile data of PGO */
+    if (!(prof_file = (uint8*)
+          bh_read_file_to_buffer(prof_file_name, &prof_file_size)))
+      goto fail4;
+    option.pgo_prof_data = prof_file;
+    option.pgo_prof_data_size = prof_file_size;
+  }
+
+  if (cpu_variant_count > 0) {
+    bh_print_time("Begin to compile the CPU variants");
+
+    if (!aot_emit_fat_aot_file(comp_data, &option, cpu_variants,
+                               cpu_variant_count, out_file_name)) {
+      printf("%s\n", aot_get_last_error());
+      goto fail4;
+    }
+
+    bh_print_time("Compile end");
+
+    printf("Compile success, file %s was generated.\n", out_file_name);
+    goto fail4;
+  }
+
   bh_print_time("Begin to create compile context");
 
   if (!(comp_ctx = aot_create_comp_context(comp_data,
@@ -285,6 +374,9 @@ fail5:
   aot_destroy_comp_context(comp_ctx);
 
 fail4:
+  if (prof_file)
+    wasm_runtime_free(prof_file);
+
   /* Destroy compile data */
   aot_destroy_comp_data(comp_data);
 